@@ -63,6 +63,8 @@
 #include "mdf_mem.h"
 #include "mdf_event_loop.h"
 #include "mdf_info_store.h"
+#include "mdf_dedup.h"
+#include "mdf_reassembly.h"
 
 #define MCOMMON_ESPRESSIF_ID        (0x02E5) /**< Espressif Incorporated */
 
@@ -0,0 +1,86 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __MDF_DEDUP_H__
+#define __MDF_DEDUP_H__
+
+#include "mdf_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /**< _cplusplus */
+
+#ifndef CONFIG_MDF_DEDUP_ENTRY_NUM
+#define CONFIG_MDF_DEDUP_ENTRY_NUM      (128)
+#endif  /**< CONFIG_MDF_DEDUP_ENTRY_NUM */
+#define MDF_DEDUP_ENTRY_NUM CONFIG_MDF_DEDUP_ENTRY_NUM
+
+#ifndef CONFIG_MDF_DEDUP_AGING_MS
+#define CONFIG_MDF_DEDUP_AGING_MS       (5000)
+#endif  /**< CONFIG_MDF_DEDUP_AGING_MS */
+#define MDF_DEDUP_AGING_MS CONFIG_MDF_DEDUP_AGING_MS
+
+/**
+ * @brief Duplicate packet filter.
+ *
+ *        Remembers the (source address, magic) of the recently received packets
+ *        in a fixed-size 8-way set-associative table. Each record stores a 32-bit
+ *        fingerprint, lookup and insertion are O(1) and don't allocate memory,
+ *        so the filter can be used in the Wi-Fi receive callbacks.
+ */
+typedef struct mdf_dedup mdf_dedup_t;
+
+/**
+ * @brief  Create a duplicate packet filter
+ *
+ * @param  entry_num  Number of packets remembered, rounded up to a power of two
+ * @param  aging_ms   Packets older than this are forgotten
+ *
+ * @return
+ *     - valid pointer on success
+ *     - NULL when out of memory
+ */
+mdf_dedup_t *mdf_dedup_create(size_t entry_num, uint32_t aging_ms);
+
+/**
+ * @brief  Delete a duplicate packet filter
+ *
+ * @param  dedup  Filter created by mdf_dedup_create()
+ */
+void mdf_dedup_delete(mdf_dedup_t *dedup);
+
+/**
+ * @brief  Check whether a packet has been received recently, record it if not
+ *
+ * @param  dedup  Filter created by mdf_dedup_create()
+ * @param  addr   Source address of the packet
+ * @param  magic  Magic of the packet
+ *
+ * @return
+ *     - true: The packet is a duplicate
+ *     - false: The packet is new and has been recorded
+ */
+bool mdf_dedup_check(mdf_dedup_t *dedup, const uint8_t *addr, uint32_t magic);
+
+/**
+ * @brief  Forget all the recorded packets
+ *
+ * @param  dedup  Filter created by mdf_dedup_create()
+ */
+void mdf_dedup_reset(mdf_dedup_t *dedup);
+
+#ifdef __cplusplus
+}
+#endif /**< _cplusplus */
+#endif /**< __MDF_DEDUP_H__ */
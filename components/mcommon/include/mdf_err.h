@@ -136,7 +136,7 @@ const char *mdf_err_to_name(mdf_err_t code);
         mdf_err_t __err_rc = (err); \
         if (__err_rc != MDF_OK) { \
             MDF_LOGW("<%s> MDF_ERROR_ASSERT failed, at 0x%08x, expression: %s", \
-                     mdf_err_to_name(__err_rc), (intptr_t)__builtin_return_address(0) - 3, __ASSERT_FUNC); \
+                     mdf_err_to_name(__err_rc), (unsigned int)((intptr_t)__builtin_return_address(0) - 3), __ASSERT_FUNC); \
             assert(0 && #err); \
         } \
     } while(0)
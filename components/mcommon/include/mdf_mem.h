@@ -75,6 +75,84 @@ void mdf_mem_print_heap(void);
  * @brief Print the state of tasks in the system
  */
 void mdf_mem_print_task(void);
+
+/**
+ * @brief Fixed-block memory pool.
+ *
+ *        All blocks are carved from one allocation made at creation time,
+ *        allocating and freeing a block is O(1) and never touches the heap,
+ *        so it does not fragment the heap however often it is used.
+ */
+typedef struct mdf_mem_pool mdf_mem_pool_t;
+
+/**
+ * @brief  Create a fixed-block memory pool
+ *
+ * @param  block_size  Size of each block, rounded up to a multiple of the pointer size
+ * @param  block_num   Number of blocks
+ *
+ * @return
+ *     - valid pointer on success
+ *     - NULL when out of memory
+ */
+mdf_mem_pool_t *mdf_mem_pool_create(size_t block_size, size_t block_num);
+
+/**
+ * @brief  Delete a memory pool, all the blocks must have been freed
+ *
+ * @param  pool  Pool created by mdf_mem_pool_create()
+ */
+void mdf_mem_pool_delete(mdf_mem_pool_t *pool);
+
+/**
+ * @brief  Allocate a block from the pool
+ *
+ * @param  pool  Pool created by mdf_mem_pool_create()
+ *
+ * @return
+ *     - valid pointer on success
+ *     - NULL when all the blocks are in use
+ */
+void *mdf_mem_pool_alloc(mdf_mem_pool_t *pool);
+
+/**
+ * @brief  Return a block to the pool
+ *
+ * @param  pool  Pool created by mdf_mem_pool_create()
+ * @param  ptr   Block allocated by mdf_mem_pool_alloc()
+ */
+void mdf_mem_pool_free(mdf_mem_pool_t *pool, void *ptr);
+
+/**
+ * @brief  Check whether the memory belongs to the pool
+ *
+ * @param  pool  Pool created by mdf_mem_pool_create()
+ * @param  ptr   Memory pointer
+ *
+ * @return
+ *     - true: ptr points into one of the blocks of the pool
+ *     - false: ptr is not allocated from the pool
+ */
+bool mdf_mem_pool_contains(const mdf_mem_pool_t *pool, const void *ptr);
+
+/**
+ * @brief  Get the block size of the pool
+ *
+ * @param  pool  Pool created by mdf_mem_pool_create()
+ *
+ * @return Size of each block, 0 if pool is NULL
+ */
+size_t mdf_mem_pool_get_block_size(const mdf_mem_pool_t *pool);
+
+/**
+ * @brief  Get the number of free blocks
+ *
+ * @param  pool      Pool created by mdf_mem_pool_create()
+ * @param  min_free  Lowest number of free blocks since the pool was created, can be NULL
+ *
+ * @return Number of free blocks
+ */
+size_t mdf_mem_pool_get_free_num(const mdf_mem_pool_t *pool, size_t *min_free);
 /**
  * @brief  Malloc memory
  *
@@ -88,7 +166,7 @@ void mdf_mem_print_task(void);
         void *ptr = heap_caps_malloc(size, MALLOC_CAP_INDICATE); \
         if (MDF_MEM_DEBUG) { \
             if(!ptr) { \
-                MDF_LOGW("<ESP_ERR_NO_MEM> Malloc size: %d, ptr: %p, heap free: %d", (int)size, ptr, esp_get_free_heap_size()); \
+                MDF_LOGW("<ESP_ERR_NO_MEM> Malloc size: %d, ptr: %p, heap free: %d", (int)(size), ptr, esp_get_free_heap_size()); \
             } else { \
                 mdf_mem_add_record(ptr, size, TAG, __LINE__); \
             } \
@@ -110,7 +188,7 @@ void mdf_mem_print_task(void);
         void *ptr = heap_caps_calloc(n, size, MALLOC_CAP_INDICATE); \
         if (MDF_MEM_DEBUG) { \
             if(!ptr) { \
-                MDF_LOGW("<ESP_ERR_NO_MEM> Calloc size: %d, ptr: %p, heap free: %d", (int)(n) * (size), ptr, esp_get_free_heap_size()); \
+                MDF_LOGW("<ESP_ERR_NO_MEM> Calloc size: %d, ptr: %p, heap free: %d", (int)((n) * (size)), ptr, esp_get_free_heap_size()); \
             } else { \
                 mdf_mem_add_record(ptr, (n) * (size), TAG, __LINE__); \
             } \
@@ -132,7 +210,7 @@ void mdf_mem_print_task(void);
         void *new_ptr = heap_caps_realloc(ptr, size, MALLOC_CAP_INDICATE); \
         if (MDF_MEM_DEBUG) { \
             if(!new_ptr) { \
-                MDF_LOGW("<ESP_ERR_NO_MEM> Realloc size: %d, new_ptr: %p, heap free: %d", (int)size, new_ptr, esp_get_free_heap_size()); \
+                MDF_LOGW("<ESP_ERR_NO_MEM> Realloc size: %d, new_ptr: %p, heap free: %d", (int)(size), new_ptr, esp_get_free_heap_size()); \
             } else { \
                 mdf_mem_remove_record(ptr, TAG, __LINE__); \
                 mdf_mem_add_record(new_ptr, size, TAG, __LINE__); \
@@ -155,7 +233,7 @@ void mdf_mem_print_task(void);
 #define MDF_REALLOC_RETRY(ptr, size) ({ \
         void *new_ptr = NULL; \
         while (size > 0 && !(new_ptr = heap_caps_realloc(ptr, size, MALLOC_CAP_INDICATE))) { \
-            MDF_LOGW("<ESP_ERR_NO_MEM> Realloc size: %d, new_ptr: %p, heap free: %d", (int)size, new_ptr, esp_get_free_heap_size()); \
+            MDF_LOGW("<ESP_ERR_NO_MEM> Realloc size: %d, new_ptr: %p, heap free: %d", (int)(size), new_ptr, esp_get_free_heap_size()); \
             vTaskDelay(pdMS_TO_TICKS(100)); \
         } \
         if (MDF_MEM_DEBUG) { \
@@ -172,10 +250,10 @@ void mdf_mem_print_task(void);
  */
 #define MDF_FREE(ptr) do { \
         if(ptr) { \
-            free(ptr); \
             if (MDF_MEM_DEBUG) { \
                 mdf_mem_remove_record(ptr, TAG, __LINE__); \
             } \
+            free(ptr); \
             ptr = NULL; \
         } \
     } while(0)
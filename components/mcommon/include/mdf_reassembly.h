@@ -0,0 +1,120 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __MDF_REASSEMBLY_H__
+#define __MDF_REASSEMBLY_H__
+
+#include "mdf_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /**< _cplusplus */
+
+#define MDF_REASSEMBLY_SEQ_MAX  (256) /**< Maximum number of fragments of a packet */
+
+/**
+ * @brief Reassembly table of fragmented packets.
+ *
+ *        Fragments of a packet are identified by the source address and the packet magic,
+ *        the magic of a fragment is the packet magic plus its sequence. Fragments of
+ *        packets from different sources may be interleaved and may arrive out of order.
+ *        An incomplete packet is dropped on timeout, or evicted when the table is full.
+ */
+typedef struct mdf_reassembly mdf_reassembly_t;
+
+/**
+ * @brief Configuration of a reassembly table
+ */
+typedef struct {
+    size_t slot_num;                    /**< Number of packets reassembled at the same time */
+    uint32_t timeout_ms;                /**< An incomplete packet is dropped if no fragment of it is received within this time */
+    size_t fragment_size;               /**< Payload length of each fragment but the last one */
+    size_t head_size;                   /**< Length of the header kept with each packet, 0 if none */
+    bool legacy;                        /**< Also join fragments of senders using an unrelated magic for each fragment.
+                                             They are joined only if they arrive in order, after a loss, fragments of
+                                             two packets of the same size from the same source can be joined. Sources
+                                             seen sharing the packet magic, the last `slot_num` of them, are never
+                                             joined this way */
+    uint8_t *(*alloc)(size_t size);     /**< Allocate a packet buffer, MDF_MALLOC() if NULL */
+    void (*free)(uint8_t *buffer);      /**< Free a packet buffer, MDF_FREE() if NULL */
+    void (*drop_cb)(const uint8_t *addr, size_t recv_size, size_t total_size); /**< Called when an incomplete packet is dropped, may be NULL */
+} mdf_reassembly_config_t;
+
+/**
+ * @brief Counters of a reassembly table
+ */
+typedef struct {
+    uint32_t timeouts;                  /**< Number of incomplete packets dropped because of timeout */
+    uint32_t evictions;                 /**< Number of incomplete packets evicted to make room */
+    uint32_t duplicates;                /**< Number of fragments received twice */
+} mdf_reassembly_stats_t;
+
+/**
+ * @brief  Create a reassembly table
+ *
+ * @param  config  Configuration of the table
+ *
+ * @return
+ *     - valid pointer on success
+ *     - NULL when out of memory or the configuration is invalid
+ */
+mdf_reassembly_t *mdf_reassembly_create(const mdf_reassembly_config_t *config);
+
+/**
+ * @brief  Delete a reassembly table, the incomplete packets are freed
+ *
+ * @param  table  Table created by mdf_reassembly_create()
+ */
+void mdf_reassembly_delete(mdf_reassembly_t *table);
+
+/**
+ * @brief  Free the incomplete packets of a reassembly table
+ *
+ * @param  table  Table created by mdf_reassembly_create()
+ */
+void mdf_reassembly_clear(mdf_reassembly_t *table);
+
+/**
+ * @brief  Put a fragment into a reassembly table
+ *
+ * @param  table       Table created by mdf_reassembly_create()
+ * @param  addr        Source address of the fragment
+ * @param  magic       Magic of the fragment, the packet magic plus `seq`
+ * @param  seq         Sequence of the fragment, its offset is `seq` times `fragment_size`
+ * @param  total_size  Total length of the packet
+ * @param  data        Payload of the fragment
+ * @param  size        Length of the payload
+ * @param  head        Header of `head_size` bytes. The header of the first received fragment
+ *                     is kept with the packet, it is copied back to `head` when the packet is complete
+ * @param  packet      Complete packet as output, freed with the `free` of the configuration
+ *
+ * @return
+ *    - true: The packet is complete, the ownership of `*packet` passes to the caller
+ *    - false: The packet is incomplete or the fragment is dropped
+ */
+bool mdf_reassembly_put(mdf_reassembly_t *table, const uint8_t *addr, uint32_t magic, uint8_t seq,
+                        size_t total_size, const uint8_t *data, size_t size, void *head, uint8_t **packet);
+
+/**
+ * @brief  Get the counters of a reassembly table
+ *
+ * @param  table  Table created by mdf_reassembly_create()
+ * @param  stats  Counters as output
+ */
+void mdf_reassembly_get_stats(mdf_reassembly_t *table, mdf_reassembly_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif /**< _cplusplus */
+#endif /**< __MDF_REASSEMBLY_H__ */
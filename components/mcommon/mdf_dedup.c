@@ -0,0 +1,143 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mdf_common.h"
+#include "mdf_dedup.h"
+
+#define MDF_DEDUP_WAYS      (8) /**< Number of records in a set */
+#define MDF_DEDUP_ADDR_LEN  (6)
+
+typedef struct {
+    uint32_t fingerprint;   /**< Hash of the address and magic, 0 if the record is empty */
+    TickType_t ticks;       /**< Time when the packet is received */
+} mdf_dedup_entry_t;
+
+struct mdf_dedup {
+    portMUX_TYPE lock;
+    uint32_t set_mask;
+    TickType_t aging_ticks;
+    mdf_dedup_entry_t entry[0];
+};
+
+static const char *TAG = "mdf_dedup";
+
+/**
+ * @brief FNV-1a hash of the address and magic.
+ *
+ *        The low bits of a FNV-1a hash only depend on the low bits of each byte,
+ *        the magic of consecutive packets then falls in a few sets. The final
+ *        mixing of MurmurHash3 spreads every bit over the set index.
+ */
+static uint32_t mdf_dedup_hash(const uint8_t *addr, uint32_t magic)
+{
+    uint32_t hash = 2166136261;
+
+    for (int i = 0; i < MDF_DEDUP_ADDR_LEN; ++i) {
+        hash = (hash ^ addr[i]) * 16777619;
+    }
+
+    for (int i = 0; i < sizeof(magic); ++i, magic >>= 8) {
+        hash = (hash ^ (magic & 0xff)) * 16777619;
+    }
+
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+
+    return hash ? hash : 1;
+}
+
+mdf_dedup_t *mdf_dedup_create(size_t entry_num, uint32_t aging_ms)
+{
+    size_t set_num     = 1;
+    mdf_dedup_t *dedup = NULL;
+
+    MDF_ERROR_GOTO(!entry_num, EXIT, "Invalid entry_num: %zu", entry_num);
+
+    while (set_num * MDF_DEDUP_WAYS < entry_num) {
+        set_num <<= 1;
+    }
+
+    dedup = MDF_CALLOC(1, sizeof(mdf_dedup_t) + set_num * MDF_DEDUP_WAYS * sizeof(mdf_dedup_entry_t));
+    MDF_ERROR_GOTO(!dedup, EXIT, "Create duplicate filter, entry_num: %zu", entry_num);
+
+    portMUX_TYPE lock  = portMUX_INITIALIZER_UNLOCKED;
+    dedup->lock        = lock;
+    dedup->set_mask    = set_num - 1;
+    dedup->aging_ticks = pdMS_TO_TICKS(aging_ms);
+
+EXIT:
+    return dedup;
+}
+
+void mdf_dedup_delete(mdf_dedup_t *dedup)
+{
+    MDF_FREE(dedup);
+}
+
+void mdf_dedup_reset(mdf_dedup_t *dedup)
+{
+    if (!dedup) {
+        return;
+    }
+
+    portENTER_CRITICAL(&dedup->lock);
+    memset(dedup->entry, 0, (dedup->set_mask + 1) * MDF_DEDUP_WAYS * sizeof(mdf_dedup_entry_t));
+    portEXIT_CRITICAL(&dedup->lock);
+}
+
+bool mdf_dedup_check(mdf_dedup_t *dedup, const uint8_t *addr, uint32_t magic)
+{
+    if (!dedup || !addr) {
+        return false;
+    }
+
+    bool duplicate         = false;
+    uint32_t fingerprint   = mdf_dedup_hash(addr, magic);
+    TickType_t now_ticks   = xTaskGetTickCount();
+    mdf_dedup_entry_t *set = dedup->entry + (fingerprint & dedup->set_mask) * MDF_DEDUP_WAYS;
+    int victim             = MDF_DEDUP_WAYS - 1;
+
+    portENTER_CRITICAL(&dedup->lock);
+
+    /**
+     * @brief The records of a set are kept from the newest to the oldest, so the
+     *        oldest one is replaced even if many packets are received in the same tick
+     */
+    for (int i = 0; i < MDF_DEDUP_WAYS; ++i) {
+        bool aged = now_ticks - set[i].ticks > dedup->aging_ticks;
+
+        if (!set[i].fingerprint || aged) {
+            victim = i;
+            break;
+        }
+
+        if (set[i].fingerprint == fingerprint) {
+            duplicate = true;
+            break;
+        }
+    }
+
+    if (!duplicate) {
+        memmove(set + 1, set, victim * sizeof(mdf_dedup_entry_t));
+        set[0].fingerprint = fingerprint;
+        set[0].ticks       = now_ticks;
+    }
+
+    portEXIT_CRITICAL(&dedup->lock);
+
+    return duplicate;
+}
@@ -199,3 +199,126 @@ void mdf_mem_print_heap(void)
              esp_get_free_heap_size(), esp_get_minimum_free_heap_size());
 #endif /**< CONFIG_SPIRAM_SUPPORT */
 }
+
+struct mdf_mem_pool {
+    portMUX_TYPE lock;
+    size_t block_size;
+    size_t block_num;
+    size_t free_num;
+    size_t min_free_num;
+    void *free_list;        /**< Each free block stores the pointer to the next one */
+    uint8_t *blocks;
+};
+
+mdf_mem_pool_t *mdf_mem_pool_create(size_t block_size, size_t block_num)
+{
+    mdf_mem_pool_t *pool = NULL;
+
+    MDF_ERROR_GOTO(!block_size || !block_num, EXIT, "Invalid pool, block_size: %zu, block_num: %zu",
+                   block_size, block_num);
+
+    block_size = (block_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    pool = MDF_CALLOC(1, sizeof(mdf_mem_pool_t));
+    MDF_ERROR_GOTO(!pool, EXIT, "");
+
+    pool->blocks = MDF_MALLOC(block_size * block_num);
+
+    if (!pool->blocks) {
+        MDF_FREE(pool);
+        goto EXIT;
+    }
+
+    portMUX_TYPE lock  = portMUX_INITIALIZER_UNLOCKED;
+    pool->lock         = lock;
+    pool->block_size   = block_size;
+    pool->block_num    = block_num;
+    pool->free_num     = block_num;
+    pool->min_free_num = block_num;
+
+    for (int i = block_num - 1; i >= 0; --i) {
+        void **block = (void **)(pool->blocks + i * block_size);
+        *block = pool->free_list;
+        pool->free_list = block;
+    }
+
+EXIT:
+    return pool;
+}
+
+void mdf_mem_pool_delete(mdf_mem_pool_t *pool)
+{
+    if (!pool) {
+        return;
+    }
+
+    if (pool->free_num != pool->block_num) {
+        MDF_LOGW("Delete pool with %zu blocks in use", pool->block_num - pool->free_num);
+    }
+
+    MDF_FREE(pool->blocks);
+    MDF_FREE(pool);
+}
+
+void *mdf_mem_pool_alloc(mdf_mem_pool_t *pool)
+{
+    if (!pool) {
+        return NULL;
+    }
+
+    portENTER_CRITICAL(&pool->lock);
+
+    void **block = pool->free_list;
+
+    if (block) {
+        pool->free_list = *block;
+        pool->free_num--;
+        pool->min_free_num = MIN(pool->min_free_num, pool->free_num);
+    }
+
+    portEXIT_CRITICAL(&pool->lock);
+
+    return block;
+}
+
+bool mdf_mem_pool_contains(const mdf_mem_pool_t *pool, const void *ptr)
+{
+    return pool && (const uint8_t *)ptr >= pool->blocks
+           && (const uint8_t *)ptr < pool->blocks + pool->block_size * pool->block_num;
+}
+
+void mdf_mem_pool_free(mdf_mem_pool_t *pool, void *ptr)
+{
+    if (!mdf_mem_pool_contains(pool, ptr)) {
+        MDF_LOGW("Memory is not allocated from the pool, ptr: %p", ptr);
+        return;
+    }
+
+    /**< Round down to the start of the block */
+    size_t index = ((uint8_t *)ptr - pool->blocks) / pool->block_size;
+    void **block = (void **)(pool->blocks + index * pool->block_size);
+
+    portENTER_CRITICAL(&pool->lock);
+    *block = pool->free_list;
+    pool->free_list = block;
+    pool->free_num++;
+    portEXIT_CRITICAL(&pool->lock);
+}
+
+size_t mdf_mem_pool_get_block_size(const mdf_mem_pool_t *pool)
+{
+    return pool ? pool->block_size : 0;
+}
+
+size_t mdf_mem_pool_get_free_num(const mdf_mem_pool_t *pool, size_t *min_free)
+{
+    if (!pool) {
+        return 0;
+    }
+
+    if (min_free) {
+        *min_free = pool->min_free_num;
+    }
+
+    return pool->free_num;
+}
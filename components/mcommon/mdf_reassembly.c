@@ -0,0 +1,300 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mdf_common.h"
+#include "mdf_reassembly.h"
+
+#define MDF_REASSEMBLY_ADDR_LEN  (6)
+
+/**
+ * @brief Reassembly context of a fragmented packet
+ */
+typedef struct {
+    uint8_t addr[MDF_REASSEMBLY_ADDR_LEN]; /**< Source address of the packet */
+    bool magic_matched;                    /**< Another fragment had the same packet magic, the sender isn't legacy */
+    uint32_t magic;                        /**< Packet magic, the magic of the fragment minus its sequence */
+    uint32_t seq_bitmap[MDF_REASSEMBLY_SEQ_MAX / 32]; /**< Bitmap of the received fragments, by sequence */
+    size_t recv_size;                      /**< Length of the received fragments */
+    size_t total_size;                     /**< Total length of the packet */
+    TickType_t update_ticks;               /**< Time of the last received fragment */
+    uint8_t *head;                         /**< Header of the packet, `head_size` bytes */
+    uint8_t *data;                         /**< Packet buffer, NULL if the slot is free */
+} mdf_reassembly_slot_t;
+
+struct mdf_reassembly {
+    SemaphoreHandle_t lock;
+    mdf_reassembly_config_t config;
+    mdf_reassembly_stats_t stats;
+    uint8_t (*source)[MDF_REASSEMBLY_ADDR_LEN]; /**< Sources known to share the packet magic, `slot_num` of them */
+    size_t source_next;                         /**< Entry of `source` replaced next */
+    mdf_reassembly_slot_t slot[0];
+};
+
+static const char *TAG = "mdf_reassembly";
+
+static uint8_t *mdf_reassembly_alloc(mdf_reassembly_t *table, size_t size)
+{
+    return table->config.alloc ? table->config.alloc(size) : MDF_MALLOC(size);
+}
+
+static void mdf_reassembly_drop(mdf_reassembly_t *table, mdf_reassembly_slot_t *slot)
+{
+    if (table->config.drop_cb) {
+        table->config.drop_cb(slot->addr, slot->recv_size, slot->total_size);
+    }
+
+    if (table->config.free) {
+        table->config.free(slot->data);
+        slot->data = NULL;
+    } else {
+        MDF_FREE(slot->data);
+    }
+}
+
+/**
+ * @brief Whether the source is known to share the packet magic between the fragments
+ */
+static bool mdf_reassembly_source_find(const mdf_reassembly_t *table, const uint8_t *addr)
+{
+    for (int i = 0; i < table->config.slot_num; ++i) {
+        if (!memcmp(table->source[i], addr, MDF_REASSEMBLY_ADDR_LEN)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Remember a source sharing the packet magic, the oldest entry is replaced when all are used
+ */
+static void mdf_reassembly_source_add(mdf_reassembly_t *table, const uint8_t *addr)
+{
+    if (mdf_reassembly_source_find(table, addr)) {
+        return;
+    }
+
+    memcpy(table->source[table->source_next], addr, MDF_REASSEMBLY_ADDR_LEN);
+    table->source_next = (table->source_next + 1) % table->config.slot_num;
+}
+
+mdf_reassembly_t *mdf_reassembly_create(const mdf_reassembly_config_t *config)
+{
+    mdf_reassembly_t *table = NULL;
+    uint8_t *head           = NULL;
+
+    MDF_ERROR_GOTO(!config || !config->slot_num || !config->fragment_size, EXIT, "Invalid configuration");
+
+    table = MDF_CALLOC(1, sizeof(mdf_reassembly_t) + config->slot_num
+                       * (sizeof(mdf_reassembly_slot_t) + config->head_size + MDF_REASSEMBLY_ADDR_LEN));
+    MDF_ERROR_GOTO(!table, EXIT, "Create reassembly table, slot_num: %zu", config->slot_num);
+
+    table->lock = xSemaphoreCreateMutex();
+    MDF_ERROR_GOTO(!table->lock, EXIT, "Create reassembly lock");
+
+    /**< The headers are stored after the slots, the known sources after the headers */
+    head = (uint8_t *)(table->slot + config->slot_num);
+
+    for (int i = 0; i < config->slot_num; ++i) {
+        table->slot[i].head = head + i * config->head_size;
+    }
+
+    table->source = (uint8_t (*)[MDF_REASSEMBLY_ADDR_LEN])(head + config->slot_num * config->head_size);
+
+    memcpy(&table->config, config, sizeof(mdf_reassembly_config_t));
+
+    return table;
+
+EXIT:
+    MDF_FREE(table);
+    return NULL;
+}
+
+void mdf_reassembly_delete(mdf_reassembly_t *table)
+{
+    if (!table) {
+        return;
+    }
+
+    mdf_reassembly_clear(table);
+    vSemaphoreDelete(table->lock);
+    MDF_FREE(table);
+}
+
+void mdf_reassembly_clear(mdf_reassembly_t *table)
+{
+    if (!table) {
+        return;
+    }
+
+    xSemaphoreTake(table->lock, portMAX_DELAY);
+
+    for (int i = 0; i < table->config.slot_num; ++i) {
+        if (!table->slot[i].data) {
+            continue;
+        }
+
+        if (table->config.free) {
+            table->config.free(table->slot[i].data);
+            table->slot[i].data = NULL;
+        } else {
+            MDF_FREE(table->slot[i].data);
+        }
+    }
+
+    xSemaphoreGive(table->lock);
+}
+
+void mdf_reassembly_get_stats(mdf_reassembly_t *table, mdf_reassembly_stats_t *stats)
+{
+    if (!table || !stats) {
+        return;
+    }
+
+    xSemaphoreTake(table->lock, portMAX_DELAY);
+    memcpy(stats, &table->stats, sizeof(mdf_reassembly_stats_t));
+    xSemaphoreGive(table->lock);
+}
+
+bool mdf_reassembly_put(mdf_reassembly_t *table, const uint8_t *addr, uint32_t magic, uint8_t seq,
+                        size_t total_size, const uint8_t *data, size_t size, void *head, uint8_t **packet)
+{
+    if (!table || !addr || !data || !packet) {
+        return false;
+    }
+
+    bool ret                          = false;
+    TickType_t now_ticks              = xTaskGetTickCount();
+    size_t offset                     = seq * table->config.fragment_size;
+    mdf_reassembly_slot_t *slot        = NULL;
+    mdf_reassembly_slot_t *free_slot   = NULL;
+    mdf_reassembly_slot_t *lru_slot    = NULL;
+    mdf_reassembly_slot_t *legacy_slot = NULL;
+
+    magic -= seq;
+
+    if (offset >= total_size || size != MIN(total_size - offset, table->config.fragment_size)) {
+        MDF_LOGD("Fragment size error, seq: %d, size: %zu, total_size: %zu", seq, size, total_size);
+        return false;
+    }
+
+    xSemaphoreTake(table->lock, portMAX_DELAY);
+
+    /**
+     * @brief A sender known to share the packet magic is never legacy, its packets are not
+     *        joined by the legacy match even if they are lost or sent out of order
+     */
+    bool legacy = table->config.legacy && !mdf_reassembly_source_find(table, addr);
+
+    for (int i = 0; i < table->config.slot_num; ++i) {
+        mdf_reassembly_slot_t *iter = table->slot + i;
+
+        /**< Drop incomplete packets that have not been updated for a long time */
+        if (iter->data && now_ticks - iter->update_ticks > pdMS_TO_TICKS(table->config.timeout_ms)) {
+            table->stats.timeouts++;
+            MDF_LOGD("Part of the packet is lost, addr: " MACSTR ", recv_size: %zu, total_size: %zu",
+                     MAC2STR(iter->addr), iter->recv_size, iter->total_size);
+            mdf_reassembly_drop(table, iter);
+        }
+
+        if (!iter->data) {
+            free_slot = free_slot ? free_slot : iter;
+            continue;
+        }
+
+        if (!lru_slot || (int32_t)(iter->update_ticks - lru_slot->update_ticks) < 0) {
+            lru_slot = iter;
+        }
+
+        if (memcmp(iter->addr, addr, MDF_REASSEMBLY_ADDR_LEN) || iter->total_size != total_size) {
+            continue;
+        }
+
+        /**
+         * @brief Fragments of the same packet share the packet magic. Packets from legacy
+         *        senders use an unrelated magic for each fragment, they are matched only
+         *        if all the previous fragments have been received in order, and never to
+         *        a packet already known to share its magic.
+         */
+        if (iter->magic == magic) {
+            slot = iter;
+        } else if (legacy && iter->recv_size == offset && !iter->magic_matched) {
+            legacy_slot = iter;
+        }
+    }
+
+    if (slot) {
+        slot->magic_matched = true;
+
+        if (table->config.legacy) {
+            mdf_reassembly_source_add(table, addr);
+        }
+    } else {
+        slot = legacy_slot;
+    }
+
+    if (!slot) {
+        slot = free_slot ? free_slot : lru_slot;
+
+        if (slot->data) {
+            table->stats.evictions++;
+            MDF_LOGD("Reassembly table is full, evict addr: " MACSTR ", recv_size: %zu, total_size: %zu",
+                     MAC2STR(slot->addr), slot->recv_size, slot->total_size);
+            mdf_reassembly_drop(table, slot);
+        }
+
+        slot->data = mdf_reassembly_alloc(table, total_size);
+        MDF_ERROR_GOTO(!slot->data, EXIT, "Allocate packet buffer, total_size: %zu", total_size);
+
+        memcpy(slot->addr, addr, MDF_REASSEMBLY_ADDR_LEN);
+        memset(slot->seq_bitmap, 0, sizeof(slot->seq_bitmap));
+        slot->magic         = magic;
+        slot->magic_matched = false;
+        slot->total_size    = total_size;
+        slot->recv_size     = 0;
+
+        if (head && table->config.head_size) {
+            memcpy(slot->head, head, table->config.head_size);
+        }
+    }
+
+    slot->update_ticks = now_ticks;
+
+    if (slot->seq_bitmap[seq / 32] & BIT(seq % 32)) {
+        table->stats.duplicates++;
+        MDF_LOGD("Received duplicate fragment, seq: %d", seq);
+        goto EXIT;
+    }
+
+    memcpy(slot->data + offset, data, size);
+    slot->seq_bitmap[seq / 32] |= BIT(seq % 32);
+    slot->recv_size += size;
+
+    if (slot->recv_size < slot->total_size) {
+        goto EXIT;
+    }
+
+    /**< The packet is complete, hand the buffer over to the caller */
+    if (head && table->config.head_size) {
+        memcpy(head, slot->head, table->config.head_size);
+    }
+
+    *packet    = slot->data;
+    slot->data = NULL;
+    ret        = true;
+
+EXIT:
+    xSemaphoreGive(table->lock);
+    return ret;
+}
@@ -0,0 +1,200 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mdf_common.h"
+#include "unity.h"
+
+#define TEST_SOURCE_NUM   (16)
+#define TEST_PACKET_NUM   (20000)
+
+static const char *TAG = "test_mdf_dedup";
+
+static void test_source_addr(uint8_t *addr, int source)
+{
+    const uint8_t source_addr[6] = {0x30, 0xae, 0xa4, 0x80, 0x00, source};
+    memcpy(addr, source_addr, sizeof(source_addr));
+}
+
+TEST_CASE("mdf_dedup duplicate", "[mcommon][dedup]")
+{
+    uint8_t addr[2][6]  = {{0}};
+    mdf_dedup_t *dedup  = mdf_dedup_create(MDF_DEDUP_ENTRY_NUM, MDF_DEDUP_AGING_MS);
+
+    TEST_ASSERT_NOT_NULL(dedup);
+    test_source_addr(addr[0], 1);
+    test_source_addr(addr[1], 2);
+
+    TEST_ASSERT_FALSE(mdf_dedup_check(dedup, addr[0], 0x1234));
+    TEST_ASSERT_TRUE(mdf_dedup_check(dedup, addr[0], 0x1234));
+
+    /**< The magic is only unique for a source */
+    TEST_ASSERT_FALSE(mdf_dedup_check(dedup, addr[1], 0x1234));
+    TEST_ASSERT_FALSE(mdf_dedup_check(dedup, addr[0], 0x1235));
+    TEST_ASSERT_TRUE(mdf_dedup_check(dedup, addr[1], 0x1234));
+    TEST_ASSERT_TRUE(mdf_dedup_check(dedup, addr[0], 0x1235));
+
+    mdf_dedup_reset(dedup);
+    TEST_ASSERT_FALSE(mdf_dedup_check(dedup, addr[0], 0x1234));
+
+    mdf_dedup_delete(dedup);
+}
+
+TEST_CASE("mdf_dedup aging", "[mcommon][dedup]")
+{
+    uint8_t addr[6]    = {0};
+    mdf_dedup_t *dedup = mdf_dedup_create(MDF_DEDUP_ENTRY_NUM, 100);
+
+    TEST_ASSERT_NOT_NULL(dedup);
+    test_source_addr(addr, 1);
+
+    TEST_ASSERT_FALSE(mdf_dedup_check(dedup, addr, 0x1234));
+    TEST_ASSERT_TRUE(mdf_dedup_check(dedup, addr, 0x1234));
+
+    /**< A packet received after the aging time is new again */
+    vTaskDelay(pdMS_TO_TICKS(300));
+    TEST_ASSERT_FALSE(mdf_dedup_check(dedup, addr, 0x1234));
+    TEST_ASSERT_TRUE(mdf_dedup_check(dedup, addr, 0x1234));
+
+    mdf_dedup_delete(dedup);
+}
+
+TEST_CASE("mdf_dedup eviction", "[mcommon][dedup]")
+{
+    uint8_t addr[6]    = {0};
+    mdf_dedup_t *dedup = mdf_dedup_create(8, MDF_DEDUP_AGING_MS); /**< A single set of 8 records */
+
+    TEST_ASSERT_NOT_NULL(dedup);
+    test_source_addr(addr, 1);
+
+    for (uint32_t magic = 1; magic <= 9; ++magic) {
+        TEST_ASSERT_FALSE(mdf_dedup_check(dedup, addr, magic));
+    }
+
+    /**< The set is full, the oldest record was replaced by the ninth packet */
+    for (uint32_t magic = 9; magic >= 2; --magic) {
+        TEST_ASSERT_TRUE(mdf_dedup_check(dedup, addr, magic));
+    }
+
+    TEST_ASSERT_FALSE(mdf_dedup_check(dedup, addr, 1));
+
+    mdf_dedup_delete(dedup);
+}
+
+/**
+ * @brief Count the false drops and false accepts of a stream of packets from `TEST_SOURCE_NUM` sources.
+ *        Each packet is received again after `gap` other packets, at 10k packets/s a gap of 64
+ *        is a retransmission 6.4 ms later. Every packet is retransmitted, the worst case.
+ *
+ *        - false drop: a new packet reported as a duplicate, the fingerprints collide
+ *        - false accept: a retransmitted packet not reported as a duplicate, its record was replaced
+ */
+static void test_dedup_rate(size_t entry_num, size_t gap, uint32_t *false_drop, uint32_t *false_accept)
+{
+    uint8_t addr[TEST_SOURCE_NUM][6] = {{0}};
+    uint32_t magic[TEST_SOURCE_NUM]  = {0};
+    uint32_t *history                = MDF_CALLOC(gap, sizeof(uint32_t));
+    uint32_t random                  = 1;
+    mdf_dedup_t *dedup               = mdf_dedup_create(entry_num, MDF_DEDUP_AGING_MS);
+
+    TEST_ASSERT_NOT_NULL(dedup);
+    TEST_ASSERT_NOT_NULL(history);
+
+    *false_drop   = 0;
+    *false_accept = 0;
+
+    for (int i = 0; i < TEST_SOURCE_NUM; ++i) {
+        test_source_addr(addr[i], i);
+        magic[i] = esp_random() & 0xfffff; /**< Leave room for the increments in the 24 bits of the history */
+    }
+
+    for (int i = 0; i < TEST_PACKET_NUM; ++i) {
+        random     = random * 1103515245 + 12345;
+        int source = (random >> 16) % TEST_SOURCE_NUM;
+
+        /**< Each source increases its magic for a new packet, as mwifi and mespnow do */
+        magic[source] += 8;
+        *false_drop   += mdf_dedup_check(dedup, addr[source], magic[source]) ? 1 : 0;
+
+        if (i >= gap) {
+            uint32_t record = history[i % gap];
+            *false_accept  += mdf_dedup_check(dedup, addr[record >> 24], record & 0xffffff) ? 0 : 1;
+        }
+
+        history[i % gap] = (source << 24) | magic[source];
+    }
+
+    MDF_FREE(history);
+    mdf_dedup_delete(dedup);
+}
+
+TEST_CASE("mdf_dedup false drop and false accept rates", "[mcommon][dedup]")
+{
+    const size_t entry_list[] = {MDF_DEDUP_ENTRY_NUM, 256, 1024};
+    uint32_t false_drop       = 0;
+    uint32_t false_accept     = 0;
+
+    printf("entry_num, gap, delay at 10k packets/s (ms), false drop, false accept (%%)\n");
+
+    for (int i = 0; i < sizeof(entry_list) / sizeof(entry_list[0]); ++i) {
+        size_t entry_num = entry_list[i];
+
+        for (size_t gap = entry_num / 16; gap <= entry_num; gap *= 2) {
+            test_dedup_rate(entry_num, gap, &false_drop, &false_accept);
+            float false_accept_rate = false_accept * 100.0 / (TEST_PACKET_NUM - gap);
+
+            printf("%zu, %zu, %.1f, %d, %.2f\n", entry_num, gap, gap / 10.0, false_drop, false_accept_rate);
+
+            /**< The fingerprints of 32 bits rarely collide */
+            TEST_ASSERT_EQUAL(0, false_drop);
+
+            if (entry_num != MDF_DEDUP_ENTRY_NUM) {
+                continue;
+            }
+
+            /**< The bounds documented by MDF_DEDUP_ENTRY_NUM in Kconfig */
+            if (gap <= entry_num / 4) {
+                TEST_ASSERT_LESS_THAN((TEST_PACKET_NUM - gap) / 100, false_accept);
+            } else if (gap <= entry_num / 2) {
+                TEST_ASSERT_LESS_THAN((TEST_PACKET_NUM - gap) * 35 / 100, false_accept);
+            }
+        }
+    }
+}
+
+TEST_CASE("mdf_dedup check time", "[mcommon][dedup]")
+{
+    uint8_t addr[TEST_SOURCE_NUM][6] = {{0}};
+    mdf_dedup_t *dedup               = mdf_dedup_create(MDF_DEDUP_ENTRY_NUM, MDF_DEDUP_AGING_MS);
+
+    TEST_ASSERT_NOT_NULL(dedup);
+
+    for (int i = 0; i < TEST_SOURCE_NUM; ++i) {
+        test_source_addr(addr[i], i);
+    }
+
+    int64_t start_time = esp_timer_get_time();
+
+    for (int i = 0; i < TEST_PACKET_NUM; ++i) {
+        mdf_dedup_check(dedup, addr[i % TEST_SOURCE_NUM], i);
+    }
+
+    int64_t spend_time = esp_timer_get_time() - start_time;
+
+    /**< 10k packets/s leaves 100 us for each packet */
+    printf("mdf_dedup_check: %d checks, %d us, %.2f us per check\n",
+           TEST_PACKET_NUM, (int)spend_time, (double)spend_time / TEST_PACKET_NUM);
+    TEST_ASSERT_LESS_THAN(TEST_PACKET_NUM * 10, spend_time);
+
+    mdf_dedup_delete(dedup);
+}
@@ -0,0 +1,153 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mdf_common.h"
+#include "unity.h"
+
+#define TEST_BLOCK_SIZE   (1456) /**< MWIFI_PAYLOAD_LEN */
+#define TEST_BLOCK_NUM    (8)
+#define TEST_LOOP_NUM     (10000)
+
+static const char *TAG = "test_mdf_mem";
+
+TEST_CASE("mdf_mem_pool alloc and free", "[mcommon][mem]")
+{
+    void *block[TEST_BLOCK_NUM] = {NULL};
+    size_t min_free             = 0;
+    mdf_mem_pool_t *pool        = mdf_mem_pool_create(TEST_BLOCK_SIZE - 1, TEST_BLOCK_NUM);
+
+    TEST_ASSERT_NOT_NULL(pool);
+    TEST_ASSERT_NULL(mdf_mem_pool_create(0, TEST_BLOCK_NUM));
+    TEST_ASSERT_NULL(mdf_mem_pool_create(TEST_BLOCK_SIZE, 0));
+
+    /**< The block size is rounded up to a multiple of the pointer size */
+    TEST_ASSERT_EQUAL(TEST_BLOCK_SIZE, mdf_mem_pool_get_block_size(pool));
+    TEST_ASSERT_EQUAL(TEST_BLOCK_NUM, mdf_mem_pool_get_free_num(pool, &min_free));
+    TEST_ASSERT_EQUAL(TEST_BLOCK_NUM, min_free);
+
+    for (int i = 0; i < TEST_BLOCK_NUM; ++i) {
+        block[i] = mdf_mem_pool_alloc(pool);
+        TEST_ASSERT_NOT_NULL(block[i]);
+        TEST_ASSERT_TRUE(mdf_mem_pool_contains(pool, block[i]));
+        TEST_ASSERT_EQUAL(0, (uintptr_t)block[i] % sizeof(void *));
+        memset(block[i], i, TEST_BLOCK_SIZE);
+    }
+
+    /**< The pool is exhausted, the blocks don't overlap */
+    TEST_ASSERT_NULL(mdf_mem_pool_alloc(pool));
+    TEST_ASSERT_EQUAL(0, mdf_mem_pool_get_free_num(pool, &min_free));
+    TEST_ASSERT_EQUAL(0, min_free);
+
+    for (int i = 0; i < TEST_BLOCK_NUM; ++i) {
+        for (int j = 0; j < TEST_BLOCK_SIZE; ++j) {
+            TEST_ASSERT_EQUAL(i, ((uint8_t *)block[i])[j]);
+        }
+    }
+
+    /**< A pointer into a block frees the whole block */
+    mdf_mem_pool_free(pool, (uint8_t *)block[3] + 100);
+    TEST_ASSERT_EQUAL(1, mdf_mem_pool_get_free_num(pool, NULL));
+    TEST_ASSERT_EQUAL_PTR(block[3], mdf_mem_pool_alloc(pool));
+
+    for (int i = 0; i < TEST_BLOCK_NUM; ++i) {
+        mdf_mem_pool_free(pool, block[i]);
+    }
+
+    TEST_ASSERT_EQUAL(TEST_BLOCK_NUM, mdf_mem_pool_get_free_num(pool, &min_free));
+    TEST_ASSERT_EQUAL(0, min_free);
+
+    mdf_mem_pool_delete(pool);
+}
+
+TEST_CASE("mdf_mem_pool foreign memory", "[mcommon][mem]")
+{
+    uint8_t buffer[TEST_BLOCK_SIZE] = {0};
+    uint8_t *heap                   = MDF_MALLOC(TEST_BLOCK_SIZE);
+    mdf_mem_pool_t *pool            = mdf_mem_pool_create(TEST_BLOCK_SIZE, TEST_BLOCK_NUM);
+    void *block                     = NULL;
+
+    TEST_ASSERT_NOT_NULL(pool);
+    TEST_ASSERT_NOT_NULL(heap);
+
+    block = mdf_mem_pool_alloc(pool);
+    TEST_ASSERT_NOT_NULL(block);
+
+    TEST_ASSERT_FALSE(mdf_mem_pool_contains(pool, buffer));
+    TEST_ASSERT_FALSE(mdf_mem_pool_contains(pool, heap));
+    TEST_ASSERT_FALSE(mdf_mem_pool_contains(pool, NULL));
+    TEST_ASSERT_FALSE(mdf_mem_pool_contains(NULL, block));
+    TEST_ASSERT_FALSE(mdf_mem_pool_contains(pool, (uint8_t *)block - TEST_BLOCK_SIZE * TEST_BLOCK_NUM));
+
+    /**< Memory not allocated from the pool is ignored */
+    mdf_mem_pool_free(pool, heap);
+    mdf_mem_pool_free(pool, buffer);
+    TEST_ASSERT_EQUAL(TEST_BLOCK_NUM - 1, mdf_mem_pool_get_free_num(pool, NULL));
+
+    TEST_ASSERT_NULL(mdf_mem_pool_alloc(NULL));
+    TEST_ASSERT_EQUAL(0, mdf_mem_pool_get_block_size(NULL));
+    TEST_ASSERT_EQUAL(0, mdf_mem_pool_get_free_num(NULL, NULL));
+
+    mdf_mem_pool_free(pool, block);
+    mdf_mem_pool_delete(pool);
+    MDF_FREE(heap);
+}
+
+/**
+ * @brief Receive buffers of mwifi, a fragment sized block and a packet sized one
+ *        are allocated for each packet and freed in a different order
+ */
+TEST_CASE("mdf_mem_pool alloc time", "[mcommon][mem]")
+{
+    const size_t large_size    = 8 * 1024;
+    mdf_mem_pool_t *small_pool = mdf_mem_pool_create(TEST_BLOCK_SIZE, TEST_BLOCK_NUM);
+    mdf_mem_pool_t *large_pool = mdf_mem_pool_create(large_size, TEST_BLOCK_NUM);
+    void *small_block          = NULL;
+    void *large_block          = NULL;
+    int64_t start_time         = 0;
+    int64_t pool_time          = 0;
+    int64_t heap_time          = 0;
+
+    TEST_ASSERT_NOT_NULL(small_pool);
+    TEST_ASSERT_NOT_NULL(large_pool);
+
+    start_time = esp_timer_get_time();
+
+    for (int i = 0; i < TEST_LOOP_NUM; ++i) {
+        small_block = mdf_mem_pool_alloc(small_pool);
+        large_block = mdf_mem_pool_alloc(large_pool);
+        mdf_mem_pool_free(small_pool, small_block);
+        mdf_mem_pool_free(large_pool, large_block);
+    }
+
+    pool_time  = esp_timer_get_time() - start_time;
+    start_time = esp_timer_get_time();
+
+    for (int i = 0; i < TEST_LOOP_NUM; ++i) {
+        small_block = MDF_MALLOC(TEST_BLOCK_SIZE);
+        large_block = MDF_MALLOC(large_size);
+        TEST_ASSERT_NOT_NULL(small_block);
+        TEST_ASSERT_NOT_NULL(large_block);
+        MDF_FREE(small_block);
+        MDF_FREE(large_block);
+    }
+
+    heap_time = esp_timer_get_time() - start_time;
+
+    printf("%d packets, pool: %d us, heap: %d us\n", TEST_LOOP_NUM, (int)pool_time, (int)heap_time);
+    TEST_ASSERT_EQUAL(TEST_BLOCK_NUM, mdf_mem_pool_get_free_num(small_pool, NULL));
+    TEST_ASSERT_EQUAL(TEST_BLOCK_NUM, mdf_mem_pool_get_free_num(large_pool, NULL));
+
+    mdf_mem_pool_delete(small_pool);
+    mdf_mem_pool_delete(large_pool);
+}
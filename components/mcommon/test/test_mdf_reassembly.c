@@ -0,0 +1,398 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mdf_common.h"
+#include "unity.h"
+
+#define TEST_FRAGMENT_SIZE  (100)
+#define TEST_SENDER_NUM     (8)
+#define TEST_FRAGMENT_NUM   (4)
+#define TEST_PACKET_SIZE    (TEST_FRAGMENT_SIZE * (TEST_FRAGMENT_NUM - 1) + 10)
+
+static const char *TAG        = "test_mdf_reassembly";
+static uint8_t g_drop_addr[6] = {0};
+static int g_drop_count       = 0;
+
+static void test_drop_cb(const uint8_t *addr, size_t recv_size, size_t total_size)
+{
+    memcpy(g_drop_addr, addr, sizeof(g_drop_addr));
+    g_drop_count++;
+}
+
+static mdf_reassembly_t *test_reassembly_create(size_t slot_num, uint32_t timeout_ms, bool legacy)
+{
+    mdf_reassembly_config_t config = {
+        .slot_num      = slot_num,
+        .timeout_ms    = timeout_ms,
+        .fragment_size = TEST_FRAGMENT_SIZE,
+        .head_size     = sizeof(uint32_t),
+        .legacy        = legacy,
+        .drop_cb       = test_drop_cb,
+    };
+
+    g_drop_count = 0;
+    return mdf_reassembly_create(&config);
+}
+
+/**
+ * @brief The content of a packet is derived from its source and magic, so a spliced packet is detected
+ */
+static void test_packet_fill(uint8_t *packet, const uint8_t *addr, uint32_t magic)
+{
+    for (int i = 0; i < TEST_PACKET_SIZE; ++i) {
+        packet[i] = addr[5] * 31 + magic * 7 + i;
+    }
+}
+
+static size_t test_fragment_size(int seq)
+{
+    return MIN(TEST_PACKET_SIZE - seq * TEST_FRAGMENT_SIZE, TEST_FRAGMENT_SIZE);
+}
+
+/**
+ * @brief Put fragment `seq` of the packet, the magic of the fragment is the packet magic plus `seq`
+ */
+static bool test_put(mdf_reassembly_t *table, const uint8_t *addr, uint32_t magic, int seq,
+                     const uint8_t *content, uint8_t **packet)
+{
+    uint32_t head = magic;
+
+    return mdf_reassembly_put(table, addr, magic + seq, seq, TEST_PACKET_SIZE,
+                              content + seq * TEST_FRAGMENT_SIZE, test_fragment_size(seq), &head, packet);
+}
+
+TEST_CASE("mdf_reassembly out of order", "[mcommon][reassembly]")
+{
+    uint8_t addr[6]                     = {0x30, 0xae, 0xa4, 0x00, 0x00, 0x01};
+    uint8_t content[TEST_PACKET_SIZE]   = {0};
+    uint8_t *packet                     = NULL;
+    const int order[TEST_FRAGMENT_NUM]  = {2, 0, 3, 1};
+    mdf_reassembly_t *table             = test_reassembly_create(4, 1000, false);
+
+    TEST_ASSERT_NOT_NULL(table);
+    test_packet_fill(content, addr, 0x1000);
+
+    for (int i = 0; i < TEST_FRAGMENT_NUM - 1; ++i) {
+        TEST_ASSERT_FALSE(test_put(table, addr, 0x1000, order[i], content, &packet));
+    }
+
+    TEST_ASSERT_TRUE(test_put(table, addr, 0x1000, order[TEST_FRAGMENT_NUM - 1], content, &packet));
+    TEST_ASSERT_EQUAL_MEMORY(content, packet, TEST_PACKET_SIZE);
+    MDF_FREE(packet);
+
+    /**< The fragment size must match its sequence */
+    TEST_ASSERT_FALSE(mdf_reassembly_put(table, addr, 0x2000, 1, TEST_PACKET_SIZE, content, 10, NULL, &packet));
+    TEST_ASSERT_FALSE(mdf_reassembly_put(table, addr, 0x2004, 4, TEST_PACKET_SIZE, content, 10, NULL, &packet));
+
+    mdf_reassembly_delete(table);
+}
+
+TEST_CASE("mdf_reassembly duplicate fragment", "[mcommon][reassembly]")
+{
+    uint8_t addr[6]                   = {0x30, 0xae, 0xa4, 0x00, 0x00, 0x01};
+    uint8_t content[TEST_PACKET_SIZE] = {0};
+    uint8_t *packet                   = NULL;
+    mdf_reassembly_stats_t stats      = {0};
+    mdf_reassembly_t *table           = test_reassembly_create(4, 1000, false);
+
+    TEST_ASSERT_NOT_NULL(table);
+    test_packet_fill(content, addr, 0x1000);
+
+    TEST_ASSERT_FALSE(test_put(table, addr, 0x1000, 0, content, &packet));
+    TEST_ASSERT_FALSE(test_put(table, addr, 0x1000, 0, content, &packet));
+    TEST_ASSERT_FALSE(test_put(table, addr, 0x1000, 1, content, &packet));
+    TEST_ASSERT_FALSE(test_put(table, addr, 0x1000, 2, content, &packet));
+    TEST_ASSERT_FALSE(test_put(table, addr, 0x1000, 1, content, &packet));
+    TEST_ASSERT_TRUE(test_put(table, addr, 0x1000, 3, content, &packet));
+    TEST_ASSERT_EQUAL_MEMORY(content, packet, TEST_PACKET_SIZE);
+    MDF_FREE(packet);
+
+    mdf_reassembly_get_stats(table, &stats);
+    TEST_ASSERT_EQUAL(2, stats.duplicates);
+    TEST_ASSERT_EQUAL(0, g_drop_count);
+
+    mdf_reassembly_delete(table);
+}
+
+TEST_CASE("mdf_reassembly interleaved senders", "[mcommon][reassembly]")
+{
+    uint8_t addr[TEST_SENDER_NUM][6]                   = {{0}};
+    uint8_t content[TEST_SENDER_NUM][TEST_PACKET_SIZE] = {{0}};
+    uint8_t *packet                                    = NULL;
+    int complete_num                                   = 0;
+    mdf_reassembly_t *table                            = test_reassembly_create(TEST_SENDER_NUM, 1000, false);
+
+    TEST_ASSERT_NOT_NULL(table);
+
+    for (int i = 0; i < TEST_SENDER_NUM; ++i) {
+        uint8_t sender_addr[6] = {0x30, 0xae, 0xa4, 0x00, 0x00, i};
+        memcpy(addr[i], sender_addr, sizeof(sender_addr));
+        test_packet_fill(content[i], addr[i], 0x1000);
+    }
+
+    /**< All the senders use the same magic and size, each sends its fragments in a different order */
+    for (int round = 0; round < TEST_FRAGMENT_NUM; ++round) {
+        for (int i = 0; i < TEST_SENDER_NUM; ++i) {
+            int seq = (round + i) % TEST_FRAGMENT_NUM;
+
+            if (test_put(table, addr[i], 0x1000, seq, content[i], &packet)) {
+                TEST_ASSERT_EQUAL(TEST_FRAGMENT_NUM - 1, round);
+                TEST_ASSERT_EQUAL_MEMORY(content[i], packet, TEST_PACKET_SIZE);
+                MDF_FREE(packet);
+                complete_num++;
+            }
+        }
+    }
+
+    TEST_ASSERT_EQUAL(TEST_SENDER_NUM, complete_num);
+    TEST_ASSERT_EQUAL(0, g_drop_count);
+
+    mdf_reassembly_delete(table);
+}
+
+TEST_CASE("mdf_reassembly eviction", "[mcommon][reassembly]")
+{
+    uint8_t addr[3][6]                   = {{0x30, 0xae, 0xa4, 0x00, 0x00, 0x01},
+        {0x30, 0xae, 0xa4, 0x00, 0x00, 0x02},
+        {0x30, 0xae, 0xa4, 0x00, 0x00, 0x03}
+    };
+    uint8_t content[3][TEST_PACKET_SIZE] = {{0}};
+    uint8_t *packet                      = NULL;
+    mdf_reassembly_stats_t stats         = {0};
+    mdf_reassembly_t *table              = test_reassembly_create(2, 10000, false);
+
+    TEST_ASSERT_NOT_NULL(table);
+
+    for (int i = 0; i < 3; ++i) {
+        test_packet_fill(content[i], addr[i], 0x1000);
+    }
+
+    TEST_ASSERT_FALSE(test_put(table, addr[0], 0x1000, 0, content[0], &packet));
+    vTaskDelay(2);
+    TEST_ASSERT_FALSE(test_put(table, addr[1], 0x1000, 0, content[1], &packet));
+    vTaskDelay(2);
+
+    /**< The table is full, the least recently updated packet is evicted */
+    TEST_ASSERT_FALSE(test_put(table, addr[2], 0x1000, 0, content[2], &packet));
+    mdf_reassembly_get_stats(table, &stats);
+    TEST_ASSERT_EQUAL(1, stats.evictions);
+    TEST_ASSERT_EQUAL(1, g_drop_count);
+    TEST_ASSERT_EQUAL_MEMORY(addr[0], g_drop_addr, sizeof(g_drop_addr));
+
+    for (int seq = 1; seq < TEST_FRAGMENT_NUM - 1; ++seq) {
+        TEST_ASSERT_FALSE(test_put(table, addr[1], 0x1000, seq, content[1], &packet));
+    }
+
+    TEST_ASSERT_TRUE(test_put(table, addr[1], 0x1000, TEST_FRAGMENT_NUM - 1, content[1], &packet));
+    TEST_ASSERT_EQUAL_MEMORY(content[1], packet, TEST_PACKET_SIZE);
+    MDF_FREE(packet);
+
+    mdf_reassembly_delete(table);
+}
+
+TEST_CASE("mdf_reassembly timeout", "[mcommon][reassembly]")
+{
+    uint8_t addr[6]                   = {0x30, 0xae, 0xa4, 0x00, 0x00, 0x01};
+    uint8_t content[TEST_PACKET_SIZE] = {0};
+    uint8_t *packet                   = NULL;
+    mdf_reassembly_stats_t stats      = {0};
+    mdf_reassembly_t *table           = test_reassembly_create(4, 100, false);
+
+    TEST_ASSERT_NOT_NULL(table);
+    test_packet_fill(content, addr, 0x1000);
+
+    TEST_ASSERT_FALSE(test_put(table, addr, 0x1000, 0, content, &packet));
+    vTaskDelay(pdMS_TO_TICKS(300));
+
+    /**< The incomplete packet is dropped, the later fragments start a new one */
+    for (int seq = 1; seq < TEST_FRAGMENT_NUM; ++seq) {
+        TEST_ASSERT_FALSE(test_put(table, addr, 0x1000, seq, content, &packet));
+    }
+
+    mdf_reassembly_get_stats(table, &stats);
+    TEST_ASSERT_EQUAL(1, stats.timeouts);
+    TEST_ASSERT_EQUAL(1, g_drop_count);
+
+    TEST_ASSERT_TRUE(test_put(table, addr, 0x1000, 0, content, &packet));
+    TEST_ASSERT_EQUAL_MEMORY(content, packet, TEST_PACKET_SIZE);
+    MDF_FREE(packet);
+
+    mdf_reassembly_delete(table);
+}
+
+TEST_CASE("mdf_reassembly legacy senders", "[mcommon][reassembly]")
+{
+    uint8_t addr[6]                      = {0x30, 0xae, 0xa4, 0x00, 0x00, 0x01};
+    uint8_t content[2][TEST_PACKET_SIZE] = {{0}};
+    uint8_t *packet                      = NULL;
+    const uint32_t legacy_magic[TEST_FRAGMENT_NUM] = {0x8a3c, 0x1f07, 0x5be2, 0x2d91};
+    mdf_reassembly_t *table              = NULL;
+
+    test_packet_fill(content[0], addr, 0x1000);
+    test_packet_fill(content[1], addr, 0x2000);
+
+    /**
+     * @brief Packet A loses fragment 1, packet B of the same size and source loses fragment 0.
+     *        Fragment 1 of B must not be joined to fragment 0 of A.
+     */
+    table = test_reassembly_create(4, 1000, false);
+    TEST_ASSERT_NOT_NULL(table);
+    TEST_ASSERT_FALSE(test_put(table, addr, 0x1000, 0, content[0], &packet));
+
+    for (int seq = 1; seq < TEST_FRAGMENT_NUM; ++seq) {
+        TEST_ASSERT_FALSE(test_put(table, addr, 0x2000, seq, content[1], &packet));
+    }
+
+    TEST_ASSERT_TRUE(test_put(table, addr, 0x2000, 0, content[1], &packet));
+    TEST_ASSERT_EQUAL_MEMORY(content[1], packet, TEST_PACKET_SIZE);
+    MDF_FREE(packet);
+    mdf_reassembly_delete(table);
+
+    /**< With the legacy match, the fragments of a legacy sender are joined if they arrive in order */
+    table = test_reassembly_create(4, 1000, true);
+    TEST_ASSERT_NOT_NULL(table);
+
+    for (int seq = 0; seq < TEST_FRAGMENT_NUM - 1; ++seq) {
+        TEST_ASSERT_FALSE(mdf_reassembly_put(table, addr, legacy_magic[seq], seq, TEST_PACKET_SIZE,
+                                             content[0] + seq * TEST_FRAGMENT_SIZE, test_fragment_size(seq), NULL, &packet));
+    }
+
+    TEST_ASSERT_TRUE(mdf_reassembly_put(table, addr, legacy_magic[TEST_FRAGMENT_NUM - 1], TEST_FRAGMENT_NUM - 1, TEST_PACKET_SIZE,
+                                        content[0] + (TEST_FRAGMENT_NUM - 1) * TEST_FRAGMENT_SIZE,
+                                        test_fragment_size(TEST_FRAGMENT_NUM - 1), NULL, &packet));
+    TEST_ASSERT_EQUAL_MEMORY(content[0], packet, TEST_PACKET_SIZE);
+    MDF_FREE(packet);
+
+    /**< A packet known to share its magic is never joined by the legacy match */
+    TEST_ASSERT_FALSE(test_put(table, addr, 0x1000, 0, content[0], &packet));
+    TEST_ASSERT_FALSE(test_put(table, addr, 0x1000, 1, content[0], &packet));
+    TEST_ASSERT_FALSE(test_put(table, addr, 0x2000, 2, content[1], &packet));
+    TEST_ASSERT_FALSE(test_put(table, addr, 0x1000, 3, content[0], &packet));
+    TEST_ASSERT_TRUE(test_put(table, addr, 0x1000, 2, content[0], &packet));
+    TEST_ASSERT_EQUAL_MEMORY(content[0], packet, TEST_PACKET_SIZE);
+    MDF_FREE(packet);
+
+    mdf_reassembly_delete(table);
+}
+
+TEST_CASE("mdf_reassembly known sources are never legacy", "[mcommon][reassembly]")
+{
+    uint8_t addr[6]                      = {0x30, 0xae, 0xa4, 0x00, 0x00, 0x01};
+    uint8_t content[3][TEST_PACKET_SIZE] = {{0}};
+    uint8_t *packet                      = NULL;
+    mdf_reassembly_t *table              = test_reassembly_create(4, 1000, true);
+
+    TEST_ASSERT_NOT_NULL(table);
+    test_packet_fill(content[0], addr, 0x1001);
+    test_packet_fill(content[1], addr, 0x2002);
+    test_packet_fill(content[2], addr, 0x3003);
+
+    /**< Packet A shares its magic between two fragments, the sender is known not to be legacy */
+    TEST_ASSERT_FALSE(test_put(table, addr, 0x1001, 0, content[0], &packet));
+    TEST_ASSERT_FALSE(test_put(table, addr, 0x1001, 1, content[0], &packet));
+
+    /**
+     * @brief Only fragment 0 of packet B is received yet, fragment 1 of packet C must not
+     *        be joined to it though it arrives in order
+     */
+    TEST_ASSERT_FALSE(test_put(table, addr, 0x2002, 0, content[1], &packet));
+    TEST_ASSERT_FALSE(test_put(table, addr, 0x3003, 1, content[2], &packet));
+
+    for (int seq = 1; seq < TEST_FRAGMENT_NUM; ++seq) {
+        TEST_ASSERT_EQUAL(seq == TEST_FRAGMENT_NUM - 1, test_put(table, addr, 0x2002, seq, content[1], &packet));
+    }
+
+    TEST_ASSERT_EQUAL_MEMORY(content[1], packet, TEST_PACKET_SIZE);
+    MDF_FREE(packet);
+
+    mdf_reassembly_delete(table);
+}
+
+TEST_CASE("mdf_reassembly interleaved ESP-NOW senders", "[mcommon][reassembly]")
+{
+    const size_t fragment_size = 238;  /**< MESPNOW_PAYLOAD_LEN */
+    const size_t packet_size   = 4000;
+    const int fragment_num     = (packet_size + fragment_size - 1) / fragment_size;
+    const int packet_num       = 3;
+    uint32_t random            = 1;
+    int complete_num           = 0;
+    uint8_t *packet            = NULL;
+    uint8_t *content           = MDF_MALLOC(TEST_SENDER_NUM * packet_size);
+    uint8_t *order             = MDF_MALLOC(TEST_SENDER_NUM * fragment_num);
+    int sent[TEST_SENDER_NUM]  = {0};
+    mdf_reassembly_config_t config = {
+        .slot_num      = TEST_SENDER_NUM,
+        .timeout_ms    = 10000,
+        .fragment_size = fragment_size,
+    };
+    mdf_reassembly_t *table = mdf_reassembly_create(&config);
+
+    TEST_ASSERT_NOT_NULL(table);
+    TEST_ASSERT_NOT_NULL(content);
+    TEST_ASSERT_NOT_NULL(order);
+
+    /**< Each sender writes `packet_num` packets one after the other, the senders write at the same time */
+    for (int p = 0; p < packet_num; ++p) {
+        for (int i = 0; i < TEST_SENDER_NUM; ++i) {
+            uint8_t *sender_order = order + i * fragment_num;
+
+            for (int j = 0; j < packet_size; ++j) {
+                content[i * packet_size + j] = i * 37 + p * 11 + j;
+            }
+
+            /**< The fragments of a packet arrive in a random order */
+            for (int seq = 0; seq < fragment_num; ++seq) {
+                sender_order[seq] = seq;
+            }
+
+            for (int seq = fragment_num - 1; seq > 0; --seq) {
+                random = random * 1103515245 + 12345;
+                int k  = (random >> 16) % (seq + 1);
+                uint8_t tmp = sender_order[seq];
+                sender_order[seq] = sender_order[k];
+                sender_order[k]   = tmp;
+            }
+
+            sent[i] = 0;
+        }
+
+        for (int remain = TEST_SENDER_NUM * fragment_num; remain > 0; --remain) {
+            int i = 0;
+
+            do {
+                random = random * 1103515245 + 12345;
+                i      = (random >> 16) % TEST_SENDER_NUM;
+            } while (sent[i] == fragment_num);
+
+            uint8_t addr[6]     = {0x30, 0xae, 0xa4, 0x00, 0x00, i};
+            int seq             = order[i * fragment_num + sent[i]++];
+            uint32_t magic      = 0x5000 + p * 0x100;
+            size_t offset       = seq * fragment_size;
+
+            if (mdf_reassembly_put(table, addr, magic + seq, seq, packet_size, content + i * packet_size + offset,
+                                   MIN(packet_size - offset, fragment_size), NULL, &packet)) {
+                TEST_ASSERT_EQUAL(fragment_num, sent[i]);
+                TEST_ASSERT_EQUAL_MEMORY(content + i * packet_size, packet, packet_size);
+                MDF_FREE(packet);
+                complete_num++;
+            }
+        }
+    }
+
+    TEST_ASSERT_EQUAL(TEST_SENDER_NUM * packet_num, complete_num);
+
+    MDF_FREE(content);
+    MDF_FREE(order);
+    mdf_reassembly_delete(table);
+}
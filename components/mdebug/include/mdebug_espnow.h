@@ -16,6 +16,7 @@
 #define __MDF_ESPNOW_DEBUG_H__
 
 #include "mdf_common.h"
+#include "mespnow.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,8 +29,15 @@ typedef enum {
     MDEBUG_ESPNOW_COREDUMP = 1, /**< Core dump information */
     MDEBUG_ESPNOW_CONSOLE,      /**< Remotely call local terminal commands */
     MDEBUG_ESPNOW_LOG,          /**< Log information */
+    MDEBUG_ESPNOW_LOG_BATCH,    /**< Log lines packed together, each one ends with '\0' */
 } mdebug_espnow_t;
 
+/**
+ * @brief Length of the data of mdebug_espnow_write() that fits in one ESP-NOW frame,
+ *        the version and the type of the packet take two bytes
+ */
+#define MDEBUG_ESPNOW_PAYLOAD_LEN (MESPNOW_PAYLOAD_LEN - 2)
+
 /**
  * @brief Type of core dump data
  */
@@ -87,7 +95,8 @@ mdf_err_t mdebug_espnow_write(const uint8_t *dest_addr, const void *data, size_t
                               mdebug_espnow_t type, TickType_t wait_ticks);
 
 /**
- * @brief  receive debug data with ESP-NOW
+ * @brief  receive debug data with ESP-NOW.
+ *         A compressed MDEBUG_ESPNOW_LOG_BATCH packet is uncompressed into `data`.
  *
  * @param  src_addr  Destination address
  * @param  data       Point to send data buffer
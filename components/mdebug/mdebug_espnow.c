@@ -19,6 +19,8 @@
 
 #include "mdebug.h"
 
+#include "miniz.h"
+
 typedef struct {
     uint8_t version;
     uint8_t type;
@@ -28,6 +30,9 @@ typedef struct {
 #define MDEBUG_ESPNOW_TIMEOUT_MS (30 * 1000)
 #define MDEBUG_ESPNOW_STORE_KEY  "mdebug_espnow"
 
+/**< Type of a MDEBUG_ESPNOW_LOG_BATCH packet compressed by zlib, only used on air */
+#define MDEBUG_ESPNOW_LOG_BATCH_COMPRESSED (0x80 | MDEBUG_ESPNOW_LOG_BATCH)
+
 static const char *TAG  = "mdebug_espnow";
 static bool g_mdebug_espnow_is_running        = false;
 static TaskHandle_t g_espnow_send_task_handle = NULL;
@@ -52,6 +57,22 @@ mdf_err_t mdebug_espnow_write(const uint8_t *dest_addr, const void *data, size_t
     espnow_data->type = type;
     memcpy(espnow_data->data, data, size);
 
+#ifdef CONFIG_MDEBUG_LOG_BATCH_COMPRESS
+
+    /**< The batch is sent as it is if it can't be compressed */
+    if (type == MDEBUG_ESPNOW_LOG_BATCH) {
+        mz_ulong compress_size = size;
+
+        if (compress2(espnow_data->data, &compress_size, data, size, MZ_BEST_SPEED) == MZ_OK) {
+            espnow_data->type = MDEBUG_ESPNOW_LOG_BATCH_COMPRESSED;
+            size = compress_size;
+        } else {
+            memcpy(espnow_data->data, data, size);
+        }
+    }
+
+#endif /**< CONFIG_MDEBUG_LOG_BATCH_COMPRESS */
+
     /**< Wait for other tasks to be sent before send ESP-WIFI-MESH data */
     if (!xSemaphoreTake(s_espnow_write_lock, wait_ticks)) {
         MDF_FREE(espnow_data);
@@ -79,6 +100,7 @@ mdf_err_t mdebug_espnow_read(uint8_t *src_addr, void *data, size_t *size,
     }
 
     mdf_err_t ret = MDF_OK;
+    size_t buffer_size = *size;
     mdebug_espnow_data_t *espnow_data = MDF_MALLOC(sizeof(mdebug_espnow_data_t) + *size);
     MDF_ERROR_CHECK(!espnow_data, MDF_ERR_NO_MEM, "");
 
@@ -94,6 +116,20 @@ mdf_err_t mdebug_espnow_read(uint8_t *src_addr, void *data, size_t *size,
 
     *type = espnow_data->type;
     *size -= sizeof(mdebug_espnow_data_t);
+
+    /**< Compressed batches are uncompressed whether this device compresses its own or not */
+    if (espnow_data->type == MDEBUG_ESPNOW_LOG_BATCH_COMPRESSED) {
+        mz_ulong uncompress_size = buffer_size;
+        int mz_ret = uncompress(data, &uncompress_size, espnow_data->data, *size);
+
+        ret = (mz_ret == MZ_OK) ? MDF_OK : MDF_FAIL;
+        MDF_ERROR_GOTO(mz_ret != MZ_OK, EXIT, "<%s> Uncompress log batch", mz_error(mz_ret));
+
+        *type = MDEBUG_ESPNOW_LOG_BATCH;
+        *size = uncompress_size;
+        goto EXIT;
+    }
+
     memcpy(data, espnow_data->data, *size);
 
 EXIT:
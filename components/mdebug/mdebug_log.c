@@ -25,12 +25,31 @@
 #define MDEBUG_LOG_TIMEOUT_MS (30 * 1000)
 #define MDEBUG_LOG_QUEUE_BUFFER_MAX_SIZE   (10 * 1024)
 
+#ifdef CONFIG_MDEBUG_LOG_BATCH_COMPRESS
+#define MDEBUG_LOG_BATCH_SIZE CONFIG_MDEBUG_LOG_BATCH_COMPRESS_SIZE
+#else
+#define MDEBUG_LOG_BATCH_SIZE MDEBUG_ESPNOW_PAYLOAD_LEN /**< Fill one ESP-NOW frame */
+#endif /**< CONFIG_MDEBUG_LOG_BATCH_COMPRESS */
+
 static xQueueHandle g_log_queue            = NULL;
 static mdebug_log_config_t *g_log_config   = NULL;
 static TaskHandle_t g_log_send_task_handle = NULL;
 static const char *TAG  = "mdebug_log";
 static uint32_t g_log_queue_buffer_size    = 0;
 
+#ifdef CONFIG_MDEBUG_LOG_BATCH_ENABLE
+/**
+ * @brief Log lines waiting to be sent with ESP-NOW in one packet
+ */
+typedef struct {
+    size_t size;                        /**< Length of the packed lines */
+    TickType_t start_ticks;             /**< Time of the first line */
+    char data[MDEBUG_LOG_BATCH_SIZE];   /**< Lines, each one ends with '\0' */
+} mdebug_log_batch_t;
+
+static mdebug_log_batch_t *g_log_batch     = NULL;
+#endif /**< CONFIG_MDEBUG_LOG_BATCH_ENABLE */
+
 mdf_err_t mdebug_log_get_config(mdebug_log_config_t *config)
 {
     return mdf_info_load(MDEBUG_LOG_STORE_KEY, config, sizeof(mdebug_log_config_t));
@@ -115,11 +134,14 @@ static ssize_t mdebug_log_vprintf(const char *fmt, va_list vp)
 
     vsnprintf((char *)log_data->data, log_size + 1, fmt, vp);
 
-    g_log_queue_buffer_size += log_size;
+    /**< Without the serial port, `log_size` is only the limit of the length */
+    log_data->size = strlen(log_data->data);
+
+    g_log_queue_buffer_size += log_data->size;
 
     if (xQueueSend(g_log_queue, &log_data, 0) == pdFALSE) {
+        g_log_queue_buffer_size -= log_data->size;
         free(log_data);
-        g_log_queue_buffer_size -= log_size;
         goto EXIT;
     }
 
@@ -128,18 +150,75 @@ EXIT:
     return log_size;
 }
 
+#ifdef CONFIG_MDEBUG_LOG_BATCH_ENABLE
+
+static void mdebug_log_batch_flush(void)
+{
+    if (!g_log_batch->size) {
+        return;
+    }
+
+    mdebug_espnow_write(g_log_config->dest_addr, g_log_batch->data, g_log_batch->size,
+                        MDEBUG_ESPNOW_LOG_BATCH, pdMS_TO_TICKS(MDEBUG_LOG_TIMEOUT_MS));
+    g_log_batch->size = 0;
+}
+
+/**
+ * @brief Pack a line with the others, the batch is sent when the line doesn't fit.
+ *        A line longer than a batch is sent on its own.
+ */
+static void mdebug_log_batch_write(const char *data, size_t size)
+{
+    if (g_log_batch->size + size + 1 > MDEBUG_LOG_BATCH_SIZE) {
+        mdebug_log_batch_flush();
+    }
+
+    if (size + 1 > MDEBUG_LOG_BATCH_SIZE) {
+        mdebug_espnow_write(g_log_config->dest_addr, data, size,
+                            MDEBUG_ESPNOW_LOG, pdMS_TO_TICKS(MDEBUG_LOG_TIMEOUT_MS));
+        return;
+    }
+
+    if (!g_log_batch->size) {
+        g_log_batch->start_ticks = xTaskGetTickCount();
+    }
+
+    memcpy(g_log_batch->data + g_log_batch->size, data, size);
+    g_log_batch->data[g_log_batch->size + size] = '\0';
+    g_log_batch->size += size + 1;
+}
+
+#endif /**< CONFIG_MDEBUG_LOG_BATCH_ENABLE */
+
 static void mdebug_log_send_task(void *arg)
 {
     mdebug_log_queue_t *log_data = NULL;
+    TickType_t wait_ticks        = pdMS_TO_TICKS(MDEBUG_LOG_TIMEOUT_MS);
 
     for (; g_log_config;) {
-        if (xQueueReceive(g_log_queue, &log_data, pdMS_TO_TICKS(MDEBUG_LOG_TIMEOUT_MS)) == pdPASS) {
+#ifdef CONFIG_MDEBUG_LOG_BATCH_ENABLE
+        /**< Wait no longer than the flush timeout of the lines already packed */
+        TickType_t batch_ticks = xTaskGetTickCount() - g_log_batch->start_ticks;
+
+        if (g_log_batch->size && batch_ticks >= pdMS_TO_TICKS(CONFIG_MDEBUG_LOG_BATCH_TIMEOUT_MS)) {
+            mdebug_log_batch_flush();
+        }
+
+        wait_ticks = g_log_batch->size ? pdMS_TO_TICKS(CONFIG_MDEBUG_LOG_BATCH_TIMEOUT_MS) - batch_ticks
+                     : pdMS_TO_TICKS(MDEBUG_LOG_TIMEOUT_MS);
+#endif /**< CONFIG_MDEBUG_LOG_BATCH_ENABLE */
+
+        if (xQueueReceive(g_log_queue, &log_data, wait_ticks) == pdPASS) {
             /**
              * @brief Control log data type and use param MDEBUG_LOG_TYPE_ESPNOW and param MDEBUG_LOG_TYPE_FLASH.
              */
             if (log_data->type & MDEBUG_LOG_TYPE_ESPNOW) {
+#ifdef CONFIG_MDEBUG_LOG_BATCH_ENABLE
+                mdebug_log_batch_write(log_data->data, log_data->size);
+#else
                 mdebug_espnow_write(g_log_config->dest_addr, log_data->data,
                                     log_data->size, MDEBUG_ESPNOW_LOG, pdMS_TO_TICKS(MDEBUG_LOG_TIMEOUT_MS));
+#endif /**< CONFIG_MDEBUG_LOG_BATCH_ENABLE */
             }
 
             if (log_data->type & MDEBUG_LOG_TYPE_FLASH && log_data->size > 0) { /**< Valid data only after the data reaches 14 */
@@ -204,6 +283,15 @@ mdf_err_t mdebug_log_init()
         MDF_ERROR_CHECK(!g_log_queue, ESP_FAIL, "g_log_queue create fail");
     }
 
+#ifdef CONFIG_MDEBUG_LOG_BATCH_ENABLE
+
+    if (!g_log_batch) {
+        g_log_batch = MDF_CALLOC(1, sizeof(mdebug_log_batch_t));
+        MDF_ERROR_CHECK(!g_log_batch, MDF_ERR_NO_MEM, "");
+    }
+
+#endif /**< CONFIG_MDEBUG_LOG_BATCH_ENABLE */
+
     if (!g_log_send_task_handle) {
         xTaskCreatePinnedToCore(mdebug_log_send_task, "mdebug_log_send", 3 * 1024,
                                 NULL, CONFIG_MDF_TASK_DEFAULT_PRIOTY - 2,
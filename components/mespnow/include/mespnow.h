@@ -24,6 +24,8 @@ extern "C" {
 
 #define MESPNOW_PAYLOAD_LEN  (238)
 
+#define MESPNOW_ADDR_IS_EMPTY(addr) (((addr)[0] | (addr)[1] | (addr)[2] | (addr)[3] | (addr)[4] | (addr)[5]) == 0x0)
+
 /**
  * @brief Divide espnnow data into multiple pipes
  */
@@ -38,9 +40,31 @@ typedef enum {
 #define MDF_EVENT_MESPNOW_RECV (MDF_EVENT_MESPNOW_BASE + 0x200)
 #define MDF_EVENT_MESPNOW_SEND (MDF_EVENT_MESPNOW_BASE + 0x201)
 
+/**
+ * @brief Transport statistics of a pipe
+ */
+typedef struct {
+    uint32_t tx_packets;     /**< Number of packets written */
+    uint32_t tx_bytes;       /**< Number of bytes written */
+    uint32_t tx_fragments;   /**< Number of fragments sent, including the retransmissions */
+    uint32_t tx_retries;     /**< Number of fragments sent again after a failed send callback */
+    uint32_t tx_failed;      /**< Number of packets which failed to be written */
+    uint32_t rx_packets;     /**< Number of packets read */
+    uint32_t rx_bytes;       /**< Number of bytes read */
+    uint32_t rx_fragments;   /**< Number of fragments queued by the receive callback */
+    uint32_t rx_duplicates;  /**< Number of retransmitted fragments dropped */
+    uint32_t rx_queue_drops; /**< Number of fragments dropped because the receive ring of the pipe is full */
+    uint32_t rx_discarded;   /**< Number of fragments of packets larger than the buffer of mespnow_read() */
+    uint32_t rx_timeouts;    /**< Number of incomplete packets dropped on timeout */
+    uint32_t rx_evictions;   /**< Number of incomplete packets dropped to make room for another one */
+} mespnow_stats_t;
+
 /**
  * @brief  add a peer to espnow peer list based on esp_now_add_peer(...).
  *         It is convenient to use simplified MACRO follows.
+ *         Each call takes a reference to the peer, released by mespnow_del_peer().
+ *         A peer which is already added is only modified if the interface, the channel
+ *         or the key changes.
  *
  * @param  ifx  Wi-Fi interface that peer uses to send/receive ESPNOW data
  * @param  addr peer mac address
@@ -49,11 +73,14 @@ typedef enum {
  * @return
  *     - ESP_OK
  *     - ESP_FAIL
+ *     - ESP_ERR_ESPNOW_FULL: all the peers are in use
  */
 mdf_err_t mespnow_add_peer(wifi_interface_t ifx, const uint8_t *addr, const uint8_t *lmk);
 
 /**
  * @brief  delete a peer from espnow peer list.
+ *         A peer added by mespnow_add_peer() is released. Without a key, it is kept in the
+ *         peer list until it is evicted by other peers, up to CONFIG_MESPNOW_PEER_CACHE_NUM.
  *
  * @param  addr peer mac address
  *
@@ -64,7 +91,10 @@ mdf_err_t mespnow_add_peer(wifi_interface_t ifx, const uint8_t *addr, const uint
 mdf_err_t mespnow_del_peer(const uint8_t *addr);
 
 /**
- * @brief  read data from espnow
+ * @brief  read data from espnow.
+ *         The fragments of the packets from different sources may be interleaved, each packet
+ *         is reassembled on its own. Incomplete packets are kept for the next read, up to
+ *         CONFIG_MESPNOW_REASSEMBLY_SLOT_NUM on each pipe.
  *
  * @param  pipe     mespnow packet type
  * @param  src_addr source address
@@ -80,11 +110,26 @@ mdf_err_t mespnow_del_peer(const uint8_t *addr);
 mdf_err_t mespnow_read(mespnow_trans_pipe_e pipe, uint8_t *src_addr,
                        void *data, size_t *size, TickType_t wait_ticks);
 
+/**
+ * @brief  get the transport statistics of a pipe, counted since mespnow_init()
+ *
+ * @param  pipe  mespnow packet type
+ * @param  stats statistics of the pipe
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ */
+mdf_err_t mespnow_get_stats(mespnow_trans_pipe_e pipe, mespnow_stats_t *stats);
+
 /**
  * @brief  write date package to espnow.
  *         1. It is necessary to add device to espnow_peer befor send data to dest_addr.
  *         2. When data_len to write is too long, it may fail duration some package and
  *         and the return value is the data len that actually sended.
+ *         3. Up to CONFIG_MESPNOW_SEND_WINDOW fragments are sent before the send callback of
+ *         the first one, a failed fragment is sent again on its own, after the following ones.
+ *         With the default of 1 the fragments are sent in order, as receivers of earlier versions require.
  *
  * @param  pipe       Pipe of data from espnnow
  * @param  dest_addr  Destination address
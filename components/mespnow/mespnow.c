@@ -38,10 +38,10 @@
 #define MDF_LOGD( format, ... ) if(LOG_LOCAL_LEVEL >= ESP_LOG_DEBUG) { ets_printf(LOG_FORMAT(D, format), xTaskGetTickCount(), __LINE__, ##__VA_ARGS__); }
 #define MDF_LOGV( format, ... ) if(LOG_LOCAL_LEVEL >= ESP_LOG_VERBOSE) { ets_printf(LOG_FORMAT(V, format), xTaskGetTickCount(), __LINE__, ##__VA_ARGS__); }
 
-#define SEND_CB_OK               BIT0
-#define SEND_CB_FAIL             BIT1
 #define MESPNOW_OUI_LEN          (2)
 #define MESPNOW_SEND_RETRY_NUM   (3)
+#define MESPNOW_SEND_WINDOW      CONFIG_MESPNOW_SEND_WINDOW
+#define MESPNOW_SEND_WINDOW_MAX  (16) /**< Maximum of CONFIG_MESPNOW_SEND_WINDOW */
 
 /**
  * @brief Data format for communication between two devices
@@ -53,30 +53,82 @@ typedef struct {
     uint8_t seq;                     /**< Sequence of espnow package when sending or receiving multiple package */
     uint8_t size;                    /**< The length of this packet of data */
     uint16_t total_size;             /**< Total length of data */
-    uint32_t magic;                  /**< Filter duplicate packets */
+    uint32_t magic;                  /**< Filter duplicate packets, the magic of the packet plus `seq` */
     uint8_t payload[0];              /**< Data */
 } __attribute__((packed)) mespnow_head_data_t;
 
 /**
- * @brief Receive data packet temporarily store in queue
+ * @brief Received frame, stored in a slot of the receive ring of its pipe
  */
 typedef struct {
-    uint8_t addr[ESP_NOW_ETH_ALEN]; /**< source MAC address  */
-    mespnow_head_data_t data[0];    /**< Received data */
-} mespnow_queue_data_t;
+    uint8_t addr[ESP_NOW_ETH_ALEN];     /**< source MAC address  */
+    uint8_t frame[ESP_NOW_MAX_DATA_LEN]; /**< Received data, starts with mespnow_head_data_t */
+} mespnow_ring_slot_t;
+
+/**
+ * @brief Single producer, single consumer ring of the received frames of a pipe.
+ *        The receive callback is the only producer and doesn't allocate or lock,
+ *        the readers of the pipe take `read_lock` to be a single consumer.
+ *        `head` and `tail` count modulo twice the number of slots, a multiple of it,
+ *        so that a full ring differs from an empty one and the slot of a count
+ *        doesn't jump when the count wraps.
+ */
+typedef struct {
+    uint32_t head;                  /**< Count of the frames written, only updated by the receive callback */
+    uint32_t tail;                  /**< Count of the frames read, only updated by the reader */
+    uint32_t slot_num;              /**< Number of slots */
+    mespnow_ring_slot_t *slot;      /**< Slots, preallocated in mespnow_init() */
+    bool waiting;                   /**< The reader waits for `ready` */
+    SemaphoreHandle_t ready;        /**< Given by the receive callback after a frame is written, if the reader waits */
+    SemaphoreHandle_t read_lock;    /**< Serializes the readers of the pipe */
+} mespnow_ring_t;
+
+/**
+ * @brief Result of a sent fragment, reported by the send callback in the order of sending
+ */
+typedef struct {
+    uint8_t addr[ESP_NOW_ETH_ALEN];
+    esp_now_send_status_t status;
+} mespnow_send_status_t;
+
+/**
+ * @brief Fragment waiting for its send callback
+ */
+typedef struct {
+    uint16_t index;                 /**< Index of the fragment, `seq` is its low byte */
+    uint8_t count;                  /**< Times the fragment was sent */
+} mespnow_send_frag_t;
+
+/**
+ * @brief Peer added to the peer list of ESP-NOW by mespnow_add_peer()
+ */
+typedef struct {
+    uint8_t addr[ESP_NOW_ETH_ALEN]; /**< Peer address, all zero if the entry is free */
+    wifi_interface_t ifx;           /**< Wi-Fi interface of the peer */
+    uint8_t channel;                /**< Wi-Fi channel of the peer */
+    bool encrypt;                   /**< The peer has a local master key */
+    uint16_t ref_count;             /**< Number of mespnow_add_peer() not released by mespnow_del_peer() */
+    uint32_t use_seq;               /**< Order of the last use, the least recently used idle peer is evicted */
+} mespnow_peer_t;
 
 static const char *TAG                                     = "mespnow";
 static bool g_espnow_init_flag                             = false;
 static const uint8_t g_oui[MESPNOW_OUI_LEN]                = {0x4E, 0x4F}; /**< 'N', 'O' */
 
-static EventGroupHandle_t g_event_group                    = NULL;
-static xQueueHandle g_espnow_queue[MESPNOW_TRANS_PIPE_MAX] = {NULL};
+static xQueueHandle g_send_queue                           = NULL; /**< Results of the send callback */
+static size_t g_send_stale_num                             = 0;    /**< Fragments in flight when an earlier write failed */
+static mespnow_ring_t g_espnow_ring[MESPNOW_TRANS_PIPE_MAX];
 static uint8_t g_espnow_queue_size[MESPNOW_TRANS_PIPE_MAX] = {CONFIG_MESPNOW_TRANS_PIPE_DEBUG_QUEUE_SIZE,
                                                               CONFIG_MESPNOW_TRANS_PIPE_CONTROL_QUEUE_SIZE,
                                                               CONFIG_MESPNOW_TRANS_PIPE_MCONFIG_QUEUE_SIZE,
                                                               CONFIG_MESPNOW_TRANS_PIPE_RESERVED_QUEUE_SIZE
                                                              };
-static uint32_t g_last_magic[MESPNOW_TRANS_PIPE_MAX]       = {0};
+static mdf_dedup_t *g_espnow_dedup                         = NULL;
+static mdf_reassembly_t *g_reassembly[MESPNOW_TRANS_PIPE_MAX]; /**< Reassembly table of each pipe */
+static mespnow_stats_t g_stats[MESPNOW_TRANS_PIPE_MAX];     /**< Each counter has a single writer, no lock */
+static SemaphoreHandle_t g_peer_lock                       = NULL;
+static mespnow_peer_t g_peer[CONFIG_MESPNOW_PEER_CACHE_NUM];
+static uint32_t g_peer_use_seq                             = 0;
 
 /**< callback function of sending ESPNOW data */
 static void mespnow_send_cb(const uint8_t *addr, esp_now_send_status_t status)
@@ -86,13 +138,30 @@ static void mespnow_send_cb(const uint8_t *addr, esp_now_send_status_t status)
         return;
     }
 
-    if (status == ESP_NOW_SEND_SUCCESS) {
-        xEventGroupSetBits(g_event_group, SEND_CB_OK);
-    } else {
-        xEventGroupSetBits(g_event_group, SEND_CB_FAIL);
+    mespnow_send_status_t send_status = {.status = status};
+    memcpy(send_status.addr, addr, ESP_NOW_ETH_ALEN);
+
+    if (xQueueSend(g_send_queue, &send_status, 0) != pdPASS) {
+        MDF_LOGD("Send queue is full, the result of a fragment is lost");
     }
 }
 
+/**
+ * @brief Count after `count`, see mespnow_ring_t
+ */
+static uint32_t mespnow_ring_next(const mespnow_ring_t *ring, uint32_t count)
+{
+    return (count + 1) % (ring->slot_num * 2);
+}
+
+/**
+ * @brief Number of frames written and not read yet
+ */
+static uint32_t mespnow_ring_used(const mespnow_ring_t *ring, uint32_t head, uint32_t tail)
+{
+    return (head + ring->slot_num * 2 - tail) % (ring->slot_num * 2);
+}
+
 /**< callback function of receiving ESPNOW data */
 static void mespnow_recv_cb(const uint8_t *addr, const uint8_t *data, int size)
 {
@@ -102,78 +171,125 @@ static void mespnow_recv_cb(const uint8_t *addr, const uint8_t *data, int size)
     }
 
     mespnow_head_data_t *espnow_data = (mespnow_head_data_t *)data;
-    xQueueHandle espnow_queue       = NULL;
+    mespnow_ring_t *ring             = NULL;
+    uint32_t head                    = 0;
 
     if (espnow_data->pipe >= MESPNOW_TRANS_PIPE_MAX) {
         MDF_LOGD("Device pipe error");
         return;
     }
 
+    if (size > ESP_NOW_MAX_DATA_LEN || espnow_data->size > size - sizeof(mespnow_head_data_t)) {
+        MDF_LOGD("Receive cb size error, size: %d, fragment size: %d", size, espnow_data->size);
+        return;
+    }
+
     /**< filter unexpect espnow package */
     if (memcmp(espnow_data->oui, g_oui, MESPNOW_OUI_LEN)) {
         MDF_LOGD("Receive cb data fail");
         return; /**< mdf espnow oui field err */
     }
 
-    if (g_last_magic[espnow_data->pipe] == espnow_data->magic) {
-        MDF_LOGD("Receive duplicate packets, magic: 0x%x", espnow_data->magic);
+    if (espnow_data->crc != crc8_le(UINT8_MAX, espnow_data->payload, espnow_data->size)) {
+        MDF_LOGD("Receive cb CRC fail");
         return;
     }
 
-    g_last_magic[espnow_data->pipe] = espnow_data->magic;
-
-    if (espnow_data->crc != crc8_le(UINT8_MAX, espnow_data->payload, espnow_data->size)) {
-        MDF_LOGD("Receive cb CRC fail");
+    /**< Filter retransmitted packets, every packet has a random magic */
+    if (mdf_dedup_check(g_espnow_dedup, addr, espnow_data->magic)) {
+        MDF_LOGD("Receive duplicate packets, magic: 0x%x", espnow_data->magic);
+        g_stats[espnow_data->pipe].rx_duplicates++;
         return;
     }
 
     /**
-     * @brief Received data packet store in special queue
+     * @brief Received data packet store in the ring of its pipe
      */
-    espnow_queue = g_espnow_queue[espnow_data->pipe];
+    ring = g_espnow_ring + espnow_data->pipe;
 
     if (espnow_data->seq == 0 && espnow_data->pipe != MESPNOW_TRANS_PIPE_DEBUG) {
         int pipe_tmp = espnow_data->pipe;
 
         /**< Send MDF_EVENT_MESPNOW_RECV event to the event handler */
-        mdf_event_loop_send(MDF_EVENT_MESPNOW_RECV, (void *)pipe_tmp);
+        mdf_event_loop_send(MDF_EVENT_MESPNOW_RECV, (void *)(intptr_t)pipe_tmp);
     }
 
-    /**< espnow_queue is full */
-    if (!uxQueueSpacesAvailable(espnow_queue)) {
-        MDF_LOGD("espnow_queue is full");
-        return ;
+    /**< The ring is full */
+    head = ring->head;
+
+    if (mespnow_ring_used(ring, head, __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) >= ring->slot_num) {
+        MDF_LOGD("espnow ring is full, pipe: %d", espnow_data->pipe);
+        g_stats[espnow_data->pipe].rx_queue_drops++;
+        return;
     }
 
-    mespnow_queue_data_t *q_data = MDF_MALLOC(sizeof(mespnow_queue_data_t) + size);
+    mespnow_ring_slot_t *slot = ring->slot + head % ring->slot_num;
+    memcpy(slot->addr, addr, ESP_NOW_ETH_ALEN);
+    memcpy(slot->frame, data, size);
 
-    if (!q_data) {
-        return;
+    /**< Publish the slot to the reader, and wake it up only if it waits for a frame */
+    __atomic_store_n(&ring->head, mespnow_ring_next(ring, head), __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&ring->waiting, __ATOMIC_SEQ_CST)) {
+        xSemaphoreGive(ring->ready);
+    }
+
+    g_stats[espnow_data->pipe].rx_fragments++;
+}
+
+/**
+ * @brief Find the entry of a peer, or a free entry if `addr` is NULL
+ */
+static mespnow_peer_t *mespnow_peer_find(const uint8_t *addr)
+{
+    for (int i = 0; i < CONFIG_MESPNOW_PEER_CACHE_NUM; ++i) {
+        if (addr ? !memcmp(g_peer[i].addr, addr, ESP_NOW_ETH_ALEN) : MESPNOW_ADDR_IS_EMPTY(g_peer[i].addr)) {
+            return g_peer + i;
+        }
     }
 
-    memcpy(q_data->data, data, size);
-    memcpy(q_data->addr, addr, ESP_NOW_ETH_ALEN);
+    return NULL;
+}
+
+/**
+ * @brief Remove the least recently used peer that nobody holds from the peer list of ESP-NOW
+ *
+ * @return
+ *    - true: A peer is evicted, its entry is free
+ *    - false: All the peers are in use
+ */
+static bool mespnow_peer_evict(void)
+{
+    mespnow_peer_t *lru_peer = NULL;
+
+    for (int i = 0; i < CONFIG_MESPNOW_PEER_CACHE_NUM; ++i) {
+        if (!MESPNOW_ADDR_IS_EMPTY(g_peer[i].addr) && !g_peer[i].ref_count
+                && (!lru_peer || (int32_t)(g_peer[i].use_seq - lru_peer->use_seq) < 0)) {
+            lru_peer = g_peer + i;
+        }
+    }
 
-    if (xQueueSend(espnow_queue, &q_data, 0) != pdPASS) {
-        MDF_LOGD("Send receive queue failed");
-        MDF_FREE(q_data);
+    if (!lru_peer) {
+        return false;
     }
+
+    MDF_LOGD("Evict peer, addr: " MACSTR, MAC2STR(lru_peer->addr));
+    esp_now_del_peer(lru_peer->addr);
+    memset(lru_peer, 0, sizeof(mespnow_peer_t));
+
+    return true;
 }
 
 mdf_err_t mespnow_add_peer(wifi_interface_t ifx, const uint8_t *addr, const uint8_t *lmk)
 {
     MDF_PARAM_CHECK(addr);
-
-    /**< If peer exists, delete a peer from peer list */
-    if (esp_now_is_peer_exist(addr)) {
-        mdf_err_t ret = esp_now_del_peer(addr);
-        MDF_ERROR_CHECK(ret != ESP_OK, ret, "esp_now_del_peer fail, ret: %d", ret);
-        return MDF_OK;
-    }
+    MDF_PARAM_CHECK(!MESPNOW_ADDR_IS_EMPTY(addr));
+    MDF_ERROR_CHECK(!g_espnow_init_flag, ESP_ERR_ESPNOW_NOT_INIT, "ESPNOW is not initialized");
 
     mdf_err_t ret                  = MDF_OK;
     esp_now_peer_info_t peer       = {0x0};
     wifi_second_chan_t sec_channel = 0;
+    mespnow_peer_t *cache_peer     = NULL;
 
     ret = esp_wifi_get_channel(&peer.channel, &sec_channel);
     MDF_ERROR_CHECK(ret != ESP_OK, ret, "esp_wifi_get_channel, ret: 0x%x", ret);
@@ -186,44 +302,146 @@ mdf_err_t mespnow_add_peer(wifi_interface_t ifx, const uint8_t *addr, const uint
     peer.ifidx = ifx;
     memcpy(peer.peer_addr, addr, ESP_NOW_ETH_ALEN);
 
-    /**< Add a peer to peer list */
-    ret = esp_now_add_peer(&peer);
-    MDF_ERROR_CHECK(ret != ESP_OK, ret, "Add a peer to peer list fail");
+    xSemaphoreTake(g_peer_lock, portMAX_DELAY);
 
-    return MDF_OK;
+    /**
+     * @brief The peer is kept in the peer list of ESP-NOW after it is released, so adding
+     *        it again only takes a reference. It is modified if the interface, the channel
+     *        or the key is not the same.
+     */
+    cache_peer = mespnow_peer_find(addr);
+
+    if (cache_peer) {
+        if (cache_peer->ifx != ifx || cache_peer->channel != peer.channel
+                || cache_peer->encrypt || lmk) {
+            ret = esp_now_mod_peer(&peer);
+            MDF_ERROR_GOTO(ret != ESP_OK, EXIT, "<%s> esp_now_mod_peer", mdf_err_to_name(ret));
+        }
+
+        goto EXIT;
+    }
+
+    /**< Peers added by esp_now_add_peer() directly are left as they are */
+    if (esp_now_is_peer_exist(addr)) {
+        MDF_LOGD("Peer is not added by mespnow, addr: " MACSTR, MAC2STR(addr));
+        goto EXIT;
+    }
+
+    cache_peer = mespnow_peer_find(NULL);
+
+    if (!cache_peer) {
+        ret = ESP_ERR_ESPNOW_FULL;
+        MDF_ERROR_GOTO(!mespnow_peer_evict(), EXIT, "All the peers of mespnow are in use");
+        cache_peer = mespnow_peer_find(NULL);
+    }
+
+    /**< Add a peer to peer list, the peer list of ESP-NOW is shared with other components */
+    while ((ret = esp_now_add_peer(&peer)) == ESP_ERR_ESPNOW_FULL && mespnow_peer_evict());
+
+    MDF_ERROR_GOTO(ret != ESP_OK, EXIT, "<%s> Add a peer to peer list fail", mdf_err_to_name(ret));
+
+    memcpy(cache_peer->addr, addr, ESP_NOW_ETH_ALEN);
+
+EXIT:
+
+    if (ret == ESP_OK && cache_peer) {
+        cache_peer->ifx     = ifx;
+        cache_peer->channel = peer.channel;
+        cache_peer->encrypt = peer.encrypt;
+        cache_peer->use_seq = ++g_peer_use_seq;
+        cache_peer->ref_count++;
+    }
+
+    xSemaphoreGive(g_peer_lock);
+    return ret;
 }
 
 mdf_err_t mespnow_del_peer(const uint8_t *addr)
 {
     MDF_PARAM_CHECK(addr);
+    MDF_PARAM_CHECK(!MESPNOW_ADDR_IS_EMPTY(addr));
+    MDF_ERROR_CHECK(!g_espnow_init_flag, ESP_ERR_ESPNOW_NOT_INIT, "ESPNOW is not initialized");
 
-    mdf_err_t ret = MDF_OK;
+    mdf_err_t ret              = MDF_OK;
+    mespnow_peer_t *cache_peer = NULL;
 
-    /**< If peer exists, delete a peer from peer list */
-    if (esp_now_is_peer_exist(addr)) {
+    xSemaphoreTake(g_peer_lock, portMAX_DELAY);
+
+    /**
+     * @brief A released peer stays in the peer list of ESP-NOW until it is evicted, except
+     *        a peer with a key, which is removed so that the key is not kept.
+     */
+    cache_peer = mespnow_peer_find(addr);
+
+    if (cache_peer) {
+        cache_peer->ref_count -= cache_peer->ref_count ? 1 : 0;
+
+        if (!cache_peer->ref_count && cache_peer->encrypt) {
+            memset(cache_peer, 0, sizeof(mespnow_peer_t));
+            ret = esp_now_del_peer(addr);
+        }
+    } else if (esp_now_is_peer_exist(addr)) {
+        /**< If peer exists, delete a peer from peer list */
         ret = esp_now_del_peer(addr);
-        MDF_ERROR_CHECK(ret != ESP_OK, ret, "esp_now_del_peer fail, ret: %d", ret);
     }
 
+    xSemaphoreGive(g_peer_lock);
+
+    MDF_ERROR_CHECK(ret != ESP_OK, ret, "esp_now_del_peer fail, ret: %d", ret);
+
     return MDF_OK;
 }
 
-mdf_err_t mespnow_write(mespnow_trans_pipe_e pipe, const uint8_t *dest_addr,
-                        const void *data, size_t size, TickType_t wait_ticks)
+/**
+ * @brief Send a fragment of the data, with the magic of the packet plus its sequence,
+ *        so that the retransmissions of a fragment are filtered by the receiver
+ */
+static mdf_err_t mespnow_send_frag(const uint8_t *dest_addr, mespnow_head_data_t *espnow_data,
+                                   const uint8_t *data, uint32_t magic, size_t index)
 {
-    MDF_PARAM_CHECK(dest_addr);
-    MDF_PARAM_CHECK(data);
-    MDF_PARAM_CHECK(size > 0);
-    MDF_PARAM_CHECK(pipe < MESPNOW_TRANS_PIPE_MAX);
-    MDF_ERROR_CHECK(!g_espnow_init_flag, ESP_ERR_ESPNOW_NOT_INIT, "ESPNOW is not initialized");
+    size_t offset = index * MESPNOW_PAYLOAD_LEN;
+
+    espnow_data->seq   = index;
+    espnow_data->size  = MIN(espnow_data->total_size - offset, MESPNOW_PAYLOAD_LEN);
+    espnow_data->crc   = crc8_le(UINT8_MAX, data + offset, espnow_data->size);
+    espnow_data->magic = magic + espnow_data->seq;
+    memcpy(espnow_data->payload, data + offset, espnow_data->size);
+
+    /**< The data is copied by ESP-NOW, the buffer is reused for the next fragment */
+    return esp_now_send(dest_addr, (uint8_t *)espnow_data,
+                        espnow_data->size + sizeof(mespnow_head_data_t));
+}
 
+/**
+ * @brief Send the fragments of a packet with up to `window` of them in flight, see mespnow_write()
+ */
+static mdf_err_t mespnow_write_window(mespnow_trans_pipe_e pipe, const uint8_t *dest_addr,
+                                      const void *data, size_t size, TickType_t wait_ticks, size_t window)
+{
     mdf_err_t ret                        = ESP_FAIL;
     mespnow_head_data_t *espnow_data     = NULL;
-    ssize_t write_size                   = size;
+    size_t frag_num                      = (size + MESPNOW_PAYLOAD_LEN - 1) / MESPNOW_PAYLOAD_LEN;
+    size_t next_index                    = 0;
+    uint32_t magic                       = esp_random();
     TickType_t write_ticks               = 0;
     uint32_t start_ticks                 = xTaskGetTickCount();
     static SemaphoreHandle_t s_send_lock = NULL;
 
+    /**
+     * @brief The fragments are sent without waiting for each other, up to `window` at a time.
+     *        The send callbacks come in the order of sending, so the oldest fragment in flight
+     *        is completed by each one. A failed fragment is sent again on its own, before the
+     *        next ones if `window` is 1.
+     */
+    mespnow_send_frag_t inflight[MESPNOW_SEND_WINDOW_MAX] = {0};
+    size_t inflight_head                                  = 0;
+    size_t inflight_num                                   = 0;
+    mespnow_send_frag_t retry[MESPNOW_SEND_WINDOW_MAX]    = {0};
+    size_t retry_num                                      = 0;
+    mespnow_send_status_t send_status                     = {0};
+
+    window = MIN(MAX(window, 1), MESPNOW_SEND_WINDOW_MAX);
+
     if (!s_send_lock) {
         s_send_lock = xSemaphoreCreateMutex();
     }
@@ -234,68 +452,140 @@ mdf_err_t mespnow_write(mespnow_trans_pipe_e pipe, const uint8_t *dest_addr,
     }
 
     espnow_data = MDF_MALLOC(ESP_NOW_MAX_DATA_LEN);
-    MDF_ERROR_CHECK(!espnow_data, MDF_ERR_NO_MEM, "");
+    ret         = MDF_ERR_NO_MEM;
+    MDF_ERROR_GOTO(!espnow_data, EXIT, "");
 
     espnow_data->pipe       = pipe;
-    espnow_data->seq        = 0;
-    espnow_data->total_size = write_size;
+    espnow_data->total_size = size;
     memcpy(espnow_data->oui, g_oui, MESPNOW_OUI_LEN);
 
-    do {
+    while (next_index < frag_num || retry_num || inflight_num) {
+        /**< Fill the window, the failed fragments first */
+        while (inflight_num < window && (retry_num || next_index < frag_num)) {
+            mespnow_send_frag_t frag = retry_num ? retry[0] : (mespnow_send_frag_t) {
+                .index = next_index
+            };
+
+            ret = mespnow_send_frag(dest_addr, espnow_data, data, magic, frag.index);
+
+            /**< The buffers of ESP-NOW are full, wait for a fragment in flight */
+            if (ret == ESP_ERR_ESPNOW_NO_MEM && inflight_num) {
+                break;
+            }
+
+            MDF_ERROR_GOTO(ret != ESP_OK, EXIT, "<%s> esp_now_send", mdf_err_to_name(ret));
+            g_stats[pipe].tx_fragments++;
+            g_stats[pipe].tx_retries += retry_num ? 1 : 0;
+
+            if (retry_num) {
+                memmove(retry, retry + 1, --retry_num * sizeof(mespnow_send_frag_t));
+            } else {
+                next_index++;
+            }
+
+            frag.count++;
+            inflight[(inflight_head + inflight_num++) % MESPNOW_SEND_WINDOW_MAX] = frag;
+        }
+
         write_ticks = (wait_ticks == portMAX_DELAY) ? portMAX_DELAY :
                       xTaskGetTickCount() - start_ticks < wait_ticks ?
                       wait_ticks - (xTaskGetTickCount() - start_ticks) : 0;
-        espnow_data->size  = MIN(write_size, MESPNOW_PAYLOAD_LEN);
-        espnow_data->crc   = crc8_le(UINT8_MAX, (uint8_t *)data, espnow_data->size);
-        espnow_data->magic = esp_random();
-        memcpy(espnow_data->payload, data, espnow_data->size);
-
-        int retry_count    = CONFIG_MESPNOW_RETRANSMIT_NUM;
-        EventBits_t uxBits = SEND_CB_FAIL;
-        xEventGroupClearBits(g_event_group, SEND_CB_OK | SEND_CB_FAIL);
-
-        do {
-            /**< Send ESPNOW data */
-            ret = esp_now_send(dest_addr, (uint8_t *)espnow_data,
-                               espnow_data->size + sizeof(mespnow_head_data_t));
-            MDF_ERROR_GOTO(ret != ESP_OK, EXIT, "<%s> esp_now_send", mdf_err_to_name(ret));
 
-            /**< Waiting send complete ack from mac layer */
-            uxBits = xEventGroupWaitBits(g_event_group, SEND_CB_OK | SEND_CB_FAIL,
-                                         pdTRUE, pdFALSE, write_ticks);
+        /**< Waiting send complete ack from mac layer */
+        if (xQueueReceive(g_send_queue, &send_status, write_ticks) != pdPASS) {
+            ret = ESP_FAIL;
+            MDF_LOGW("Wait for the send callback timeout, %zu fragments in flight", inflight_num);
+            goto EXIT;
+        }
 
-            write_ticks = (wait_ticks == portMAX_DELAY) ? portMAX_DELAY :
-                          xTaskGetTickCount() - start_ticks < wait_ticks ?
-                          wait_ticks - (xTaskGetTickCount() - start_ticks) : 0;
-        } while ((uxBits & SEND_CB_OK) != SEND_CB_OK && --retry_count);
+        /**< The results of an earlier write which failed come first */
+        if (g_send_stale_num) {
+            g_send_stale_num--;
+            continue;
+        }
+
+        /**< A broadcast is reported with the broadcast address */
+        if (memcmp(send_status.addr, dest_addr, ESP_NOW_ETH_ALEN)) {
+            MDF_LOGD("Send callback of another destination, addr: " MACSTR, MAC2STR(send_status.addr));
+            continue;
+        }
+
+        mespnow_send_frag_t frag = inflight[inflight_head];
+        inflight_head = (inflight_head + 1) % MESPNOW_SEND_WINDOW_MAX;
+        inflight_num--;
+
+        if (send_status.status == ESP_NOW_SEND_SUCCESS) {
+            continue;
+        }
 
-        if ((uxBits & SEND_CB_OK) != SEND_CB_OK) {
+        if (frag.count >= CONFIG_MESPNOW_RETRANSMIT_NUM) {
             ret = ESP_FAIL;
-            MDF_LOGW("Wait SEND_CB_OK fail");
+            MDF_LOGW("Wait SEND_CB_OK fail, seq: %d, count: %d", frag.index, frag.count);
             goto EXIT;
         }
 
-        write_size -= MESPNOW_PAYLOAD_LEN;
-        data       += MESPNOW_PAYLOAD_LEN;
-        espnow_data->seq++;
-    } while (write_size > 0);
+        retry[retry_num++] = frag;
+    }
+
+    ret = MDF_OK;
+    g_stats[pipe].tx_packets++;
+    g_stats[pipe].tx_bytes += size;
 
     if (espnow_data->pipe != MESPNOW_TRANS_PIPE_DEBUG) {
         int pipe_tmp = espnow_data->pipe;
 
         /**< Send MDF_EVENT_MESPNOW_SEND event to the event handler */
-        mdf_event_loop_send(MDF_EVENT_MESPNOW_SEND, (void *)pipe_tmp);
+        mdf_event_loop_send(MDF_EVENT_MESPNOW_SEND, (void *)(intptr_t)pipe_tmp);
     }
 
 EXIT:
     MDF_FREE(espnow_data);
 
+    /**< Their send callbacks are still to come, the next write skips them */
+    g_send_stale_num += inflight_num;
+    g_stats[pipe].tx_failed += (ret != MDF_OK) ? 1 : 0;
+
     /**< ESP-NOW send completed, release send lock */
     xSemaphoreGive(s_send_lock);
 
     return ret;
 }
 
+mdf_err_t mespnow_write(mespnow_trans_pipe_e pipe, const uint8_t *dest_addr,
+                        const void *data, size_t size, TickType_t wait_ticks)
+{
+    MDF_PARAM_CHECK(dest_addr);
+    MDF_PARAM_CHECK(data);
+    MDF_PARAM_CHECK(size > 0);
+    MDF_PARAM_CHECK(pipe < MESPNOW_TRANS_PIPE_MAX);
+    MDF_ERROR_CHECK(!g_espnow_init_flag, ESP_ERR_ESPNOW_NOT_INIT, "ESPNOW is not initialized");
+
+    return mespnow_write_window(pipe, dest_addr, data, size, wait_ticks, MESPNOW_SEND_WINDOW);
+}
+
+/**
+ * @brief Put a fragment into the reassembly table of its pipe, see mdf_reassembly_put()
+ *
+ * @return
+ *    - true: The packet is complete and copied to `packet`
+ *    - false: The packet is incomplete or the fragment is dropped
+ */
+static bool mespnow_reassembly_put(mespnow_trans_pipe_e pipe, const uint8_t *addr,
+                                   const mespnow_head_data_t *espnow_data, uint8_t *packet)
+{
+    uint8_t *data = NULL;
+
+    if (!mdf_reassembly_put(g_reassembly[pipe], addr, espnow_data->magic, espnow_data->seq,
+                            espnow_data->total_size, espnow_data->payload, espnow_data->size, NULL, &data)) {
+        return false;
+    }
+
+    memcpy(packet, data, espnow_data->total_size);
+    MDF_FREE(data);
+
+    return true;
+}
+
 mdf_err_t mespnow_read(mespnow_trans_pipe_e pipe, uint8_t *src_addr,
                        void *data, size_t *size, TickType_t wait_ticks)
 {
@@ -306,73 +596,101 @@ mdf_err_t mespnow_read(mespnow_trans_pipe_e pipe, uint8_t *src_addr,
     MDF_ERROR_CHECK(!g_espnow_init_flag, ESP_ERR_ESPNOW_NOT_INIT, "ESPNOW is not initialized");
 
     mespnow_head_data_t *espnow_data = NULL;
-    mespnow_queue_data_t *q_data     = NULL;
+    mespnow_ring_slot_t *slot        = NULL;
+    bool complete                    = false;
 
     /**
-     * @brief Receive data packet from special queue
+     * @brief Receive data packet from the ring of the pipe
      */
-    xQueueHandle espnow_queue       = g_espnow_queue[pipe];
+    mespnow_ring_t *ring            = g_espnow_ring + pipe;
     uint32_t start_ticks            = xTaskGetTickCount();
-    ssize_t read_size               = 0;
-    size_t total_size               = 0;
     TickType_t recv_ticks           = 0;
 
-    /**< Clear the data in the last buffer space */
-    for (;;) {
+    /**
+     * @brief The fragments of the packets from all the sources are interleaved on a pipe,
+     *        they are reassembled in the table of the pipe until one of the packets is complete.
+     *        The incomplete packets are kept for the next read.
+     */
+    while (!complete) {
         recv_ticks = (wait_ticks == portMAX_DELAY) ? portMAX_DELAY :
                      xTaskGetTickCount() - start_ticks < wait_ticks ?
                      wait_ticks - (xTaskGetTickCount() - start_ticks) : 0;
 
-        if (xQueueReceive(espnow_queue, (void *)&q_data, recv_ticks) != pdPASS) {
+        if (xSemaphoreTake(ring->read_lock, recv_ticks) != pdPASS) {
             MDF_LOGD("Read queue timeout");
             return MDF_ERR_TIMEOUT;
         }
 
-        espnow_data = q_data->data;
+        /**
+         * @brief The ring is empty, wait for the receive callback to write a frame.
+         *        `waiting` is set before checking the ring again, so either the callback
+         *        sees it and gives `ready`, or the frame it writes is seen here.
+         */
+        if (ring->tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&ring->waiting, true, __ATOMIC_SEQ_CST);
 
-        /**< If the first packet data is not, the packet data is discarded. */
-        if (espnow_data->seq == 0 && *size > espnow_data->total_size) {
-            break;
-        }
+            if (ring->tail == __atomic_load_n(&ring->head, __ATOMIC_SEQ_CST)) {
+                xSemaphoreTake(ring->ready, recv_ticks);
+            }
 
-        MDF_LOGD("Expected sequence: 0, receive sequence: %d, size: %d",
-                 espnow_data->seq, espnow_data->total_size);
-        MDF_FREE(q_data);
-    }
+            __atomic_store_n(&ring->waiting, false, __ATOMIC_RELAXED);
+            xSemaphoreGive(ring->read_lock);
 
-    read_size  = espnow_data->size;
-    total_size = espnow_data->total_size;
-    memcpy(src_addr, q_data->addr, ESP_NOW_ETH_ALEN);
-    memcpy(data, espnow_data->payload, espnow_data->size);
-    MDF_FREE(q_data);
+            if (recv_ticks == 0 && ring->tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+                MDF_LOGD("Read queue timeout");
+                return MDF_ERR_TIMEOUT;
+            }
 
-    for (int expect_seq = 1, recv_ticks = 0; read_size < total_size; expect_seq++) {
-        recv_ticks = (wait_ticks == portMAX_DELAY) ? portMAX_DELAY :
-                     xTaskGetTickCount() - start_ticks < wait_ticks ?
-                     wait_ticks - (xTaskGetTickCount() - start_ticks) : 0;
-
-        if (xQueueReceive(espnow_queue, &q_data, recv_ticks) != pdPASS) {
-            MDF_LOGW("Read queue timeout");
-            return MDF_ERR_TIMEOUT;
+            continue;
         }
 
-        espnow_data = q_data->data;
-        MDF_LOGD("total_size: %d, read_total_size: %d, read_size: %d, expect_seq: %d, wait_ticks: %d",
-                 espnow_data->total_size, read_size, espnow_data->size, expect_seq, wait_ticks);
-
-        if (espnow_data->seq != expect_seq) {
-            MDF_FREE(q_data);
-            MDF_LOGW("Receive failed, part of the packet is lost");
-            return ESP_FAIL;
+        /**< The frame is handled in its slot, which is released after */
+        slot        = ring->slot + ring->tail % ring->slot_num;
+        espnow_data = (mespnow_head_data_t *)slot->frame;
+        MDF_LOGD("addr: " MACSTR ", total_size: %d, size: %d, seq: %d", MAC2STR(slot->addr),
+                 espnow_data->total_size, espnow_data->size, espnow_data->seq);
+
+        if (*size <= espnow_data->total_size) {
+            /**< The packet doesn't fit in the buffer, it is discarded */
+            MDF_LOGD("Discard the packet, sequence: %d, size: %d",
+                     espnow_data->seq, espnow_data->total_size);
+            g_stats[pipe].rx_discarded++;
+        } else if (espnow_data->seq == 0 && espnow_data->size == espnow_data->total_size) {
+            /**< A packet of one fragment is copied directly */
+            memcpy(data, espnow_data->payload, espnow_data->size);
+            complete = true;
+        } else {
+            complete = mespnow_reassembly_put(pipe, slot->addr, espnow_data, data);
         }
 
-        memcpy(data + read_size, espnow_data->payload, espnow_data->size);
-        read_size += espnow_data->size;
+        if (complete) {
+            memcpy(src_addr, slot->addr, ESP_NOW_ETH_ALEN);
+            *size = espnow_data->total_size;
+        }
 
-        MDF_FREE(q_data);
+        __atomic_store_n(&ring->tail, mespnow_ring_next(ring, ring->tail), __ATOMIC_RELEASE);
+        xSemaphoreGive(ring->read_lock);
     }
 
-    *size = read_size;
+    g_stats[pipe].rx_packets++;
+    g_stats[pipe].rx_bytes += *size;
+
+    return MDF_OK;
+}
+
+mdf_err_t mespnow_get_stats(mespnow_trans_pipe_e pipe, mespnow_stats_t *stats)
+{
+    MDF_PARAM_CHECK(pipe < MESPNOW_TRANS_PIPE_MAX);
+    MDF_PARAM_CHECK(stats);
+
+    mdf_reassembly_stats_t reassembly_stats = {0};
+
+    memcpy(stats, g_stats + pipe, sizeof(mespnow_stats_t));
+
+    mdf_reassembly_get_stats(g_reassembly[pipe], &reassembly_stats);
+    stats->rx_timeouts  = reassembly_stats.timeouts;
+    stats->rx_evictions = reassembly_stats.evictions;
+
     return MDF_OK;
 }
 
@@ -381,18 +699,26 @@ mdf_err_t mespnow_deinit(void)
     MDF_ERROR_CHECK(!g_espnow_init_flag, ESP_ERR_ESPNOW_NOT_INIT, "ESPNOW is not initialized");
 
     for (int i = 0; i < MESPNOW_TRANS_PIPE_MAX; ++i) {
-        uint8_t *tmp = NULL;
+        mespnow_ring_t *ring = g_espnow_ring + i;
 
-        while (xQueueReceive(g_espnow_queue[i], &tmp, 0)) {
-            MDF_FREE(tmp);
-        }
+        vSemaphoreDelete(ring->ready);
+        vSemaphoreDelete(ring->read_lock);
+        MDF_FREE(ring->slot);
+        memset(ring, 0, sizeof(mespnow_ring_t));
 
-        vQueueDelete(g_espnow_queue[i]);
-        g_espnow_queue[i] = NULL;
+        mdf_reassembly_delete(g_reassembly[i]);
+        g_reassembly[i] = NULL;
     }
 
-    vEventGroupDelete(g_event_group);
-    g_event_group = NULL;
+    vQueueDelete(g_send_queue);
+    g_send_queue = NULL;
+
+    vSemaphoreDelete(g_peer_lock);
+    g_peer_lock = NULL;
+    memset(g_peer, 0, sizeof(g_peer));
+
+    mdf_dedup_delete(g_espnow_dedup);
+    g_espnow_dedup = NULL;
 
     /**< De-initialize ESPNOW function */
     ESP_ERROR_CHECK(esp_now_unregister_recv_cb());
@@ -410,15 +736,41 @@ mdf_err_t mespnow_init()
         return MDF_OK;
     }
 
-    /**< Event group for espnow sent cb */
-    g_event_group = xEventGroupCreate();
-    MDF_ERROR_CHECK(!g_event_group, ESP_FAIL, "Create event group fail");
+    /**< Results of espnow sent cb, one per fragment in flight. The results of a former init are gone */
+    g_send_stale_num = 0;
+    g_send_queue     = xQueueCreate(MESPNOW_SEND_WINDOW_MAX * 2, sizeof(mespnow_send_status_t));
+    MDF_ERROR_CHECK(!g_send_queue, ESP_FAIL, "Create send queue fail");
+
+    g_peer_lock = xSemaphoreCreateMutex();
+    MDF_ERROR_CHECK(!g_peer_lock, ESP_FAIL, "Create peer lock fail");
+
+    g_espnow_dedup = mdf_dedup_create(MDF_DEDUP_ENTRY_NUM, MDF_DEDUP_AGING_MS);
+    MDF_ERROR_CHECK(!g_espnow_dedup, ESP_FAIL, "Create duplicate filter fail");
+
+    mdf_reassembly_config_t reassembly_config = {
+        .slot_num      = CONFIG_MESPNOW_REASSEMBLY_SLOT_NUM,
+        .timeout_ms    = CONFIG_MESPNOW_REASSEMBLY_TIMEOUT_MS,
+        .fragment_size = MESPNOW_PAYLOAD_LEN,
+#ifdef CONFIG_MESPNOW_LEGACY_REASSEMBLY
+        .legacy        = true,
+#endif /**< CONFIG_MESPNOW_LEGACY_REASSEMBLY */
+    };
 
-    /**< Create MESPNOW_TRANS_PIPE_MAX queue to distinguish data and temporarily store */
+    /**< Create MESPNOW_TRANS_PIPE_MAX rings to distinguish data and temporarily store */
     for (int i = 0; i < MESPNOW_TRANS_PIPE_MAX; ++i) {
-        g_espnow_queue[i] = xQueueCreate(g_espnow_queue_size[i],
-                                         sizeof(mespnow_head_data_t *));
-        MDF_ERROR_CHECK(!g_espnow_queue[i], ESP_FAIL, "Create espnow debug queue fail");
+        mespnow_ring_t *ring = g_espnow_ring + i;
+
+        ring->head      = 0;
+        ring->tail      = 0;
+        ring->slot_num  = g_espnow_queue_size[i];
+        ring->slot      = MDF_MALLOC(ring->slot_num * sizeof(mespnow_ring_slot_t));
+        ring->ready     = xSemaphoreCreateBinary();
+        ring->read_lock = xSemaphoreCreateMutex();
+        MDF_ERROR_CHECK(!ring->slot || !ring->ready || !ring->read_lock,
+                        ESP_FAIL, "Create espnow ring fail");
+
+        g_reassembly[i] = mdf_reassembly_create(&reassembly_config);
+        MDF_ERROR_CHECK(!g_reassembly[i], ESP_FAIL, "Create reassembly table fail");
     }
 
     /**< Initialize ESPNOW function */
@@ -343,7 +343,9 @@ mdf_err_t mupgrade_firmware_send(const uint8_t *addrs_list, size_t addrs_num,
                     MDF_ERR_MUPGRADE_FIRMWARE_INCOMPLETE, "mupgrade_firmware_download");
 
     mdf_err_t ret             = MDF_ERR_NO_MEM;
-    mwifi_data_type_t type    = {.upgrade = true, .communicate = MWIFI_COMMUNICATE_MULTICAST};
+    mwifi_data_type_t type    = {
+        .upgrade = true, .communicate = MWIFI_COMMUNICATE_MULTICAST, .priority = MWIFI_PRIORITY_BULK
+    };
     mupgrade_packet_t *packet = MDF_MALLOC(sizeof(mupgrade_packet_t));
     uint8_t *progress_array   = MDF_MALLOC(MUPGRADE_PACKET_MAX_NUM / 8);
     mupgrade_result_t *result = MDF_CALLOC(1, sizeof(mupgrade_result_t));
@@ -457,7 +459,9 @@ mdf_err_t mupgrade_firmware_send(const uint8_t *addrs_list, size_t addrs_num,
                 /**
                  * @brief Send firmware data to unfinished devide.
                  */
+#ifndef CONFIG_MWIFI_FLOW_CONTROL_ENABLE
                 uint64_t start_us = esp_timer_get_time();
+#endif /**< CONFIG_MWIFI_FLOW_CONTROL_ENABLE */
 
                 if ((MWIFI_ADDR_IS_ANY(addrs_list) || MWIFI_ADDR_IS_BROADCAST(addrs_list))
                         && result->successed_num < 2 && addrs_num == 1) {
@@ -477,8 +481,10 @@ mdf_err_t mupgrade_firmware_send(const uint8_t *addrs_list, size_t addrs_num,
                                            packet, sizeof(mupgrade_packet_t), true);
                 }
 
+#ifndef CONFIG_MWIFI_FLOW_CONTROL_ENABLE
                 uint64_t wait = (esp_timer_get_time() - start_us) * CONFIG_MUPGRADE_FLOW_CONTROL_LEVEL / 10;
                 vTaskDelay(pdMS_TO_TICKS(wait / 1000)); // flow control for sending data in ota
+#endif /**< CONFIG_MWIFI_FLOW_CONTROL_ENABLE, otherwise mwifi paces the packets by the occupancy of the mesh queues */
 
                 MDF_ERROR_CONTINUE(ret != ESP_OK, "<%s> Mwifi root write", mdf_err_to_name(ret));
             }
@@ -229,6 +229,16 @@ enum mwifi_communication_method {
     MWIFI_COMMUNICATE_BROADCAST, /**< Send data by broadcast. */
 };
 
+/**
+ * @brief Transmit priority classes, each class has its own transmit queues
+ */
+enum mwifi_priority {
+    MWIFI_PRIORITY_INTERACTIVE = 0, /**< Default class, requests and responses */
+    MWIFI_PRIORITY_CONTROL     = 1, /**< Short commands which must not wait behind other traffic */
+    MWIFI_PRIORITY_BULK        = 2, /**< Telemetry, firmware and other large transfers */
+    MWIFI_PRIORITY_MAX,
+};
+
 /**
  * @brief Mwifi packet type
  */
@@ -242,14 +252,100 @@ typedef struct {
     uint8_t reserved    : 1; /**< reserved */
     uint8_t protocol    : 2; /**< Type of transmitted application protocol */
     uint32_t custom;         /**< Type of transmitted application data */
+
+    /**< The fields above keep the layout of earlier versions, which know only those */
+    uint8_t priority    : 2; /**< Transmit priority class, MWIFI_PRIORITY_INTERACTIVE by default */
+    bool stream         : 1; /**< Stream packet flag, see mwifi_stream_handle() */
+    bool rpc            : 1; /**< RPC packet flag, see mwifi_rpc_handle() */
+    uint8_t reserved2   : 4; /**< reserved */
 } __attribute__((packed)) mwifi_data_type_t;
 
+/**
+ * @brief Scatter-gather element of a vectored write
+ */
+typedef struct {
+    const void *data;   /**< Pointer to the data of this element */
+    size_t size;        /**< Length of the element */
+} mwifi_iovec_t;
+
+#define MWIFI_IOV_MAX           (8) /**< Max number of elements in a vectored write */
+
+#ifndef CONFIG_MWIFI_TX_QUEUE_NUM
+#define CONFIG_MWIFI_TX_QUEUE_NUM   (4)
+#endif  /**< CONFIG_MWIFI_TX_QUEUE_NUM */
+#define MWIFI_TX_QUEUE_NUM CONFIG_MWIFI_TX_QUEUE_NUM /**< Number of transmit queues of each priority class, destinations are hashed to them */
+
+/**
+ * @brief Statistics of a transmit queue
+ */
+typedef struct {
+    uint16_t depth;             /**< Number of packets in the queue, including the one being sent */
+    uint16_t depth_max;         /**< Max number of packets in the queue */
+    uint32_t enqueued;          /**< Number of packets queued */
+    uint32_t rejected;          /**< Number of non-blocking packets rejected because the queue was full */
+    uint32_t sent;              /**< Number of packets sent */
+    uint32_t failed;            /**< Number of packets which failed to be sent */
+    uint32_t latency_avg_ms;    /**< Average time from queuing to the end of sending */
+    uint32_t latency_max_ms;    /**< Max time from queuing to the end of sending */
+} mwifi_tx_queue_stats_t;
+
+#ifndef CONFIG_MWIFI_ROOT_FAIR_QUEUE_NUM
+#define CONFIG_MWIFI_ROOT_FAIR_QUEUE_NUM (8)
+#endif  /**< CONFIG_MWIFI_ROOT_FAIR_QUEUE_NUM */
+#define MWIFI_RX_QUEUE_NUM CONFIG_MWIFI_ROOT_FAIR_QUEUE_NUM /**< Number of flow queues of the root, flows are hashed to them */
+
+/**
+ * @brief Statistics of a flow queue of the root
+ */
+typedef struct {
+    uint8_t addr[MWIFI_ADDR_LEN]; /**< Source of the last packet queued */
+    uint16_t depth;             /**< Number of packets in the queue */
+    uint16_t depth_max;         /**< Max number of packets in the queue */
+    uint32_t enqueued;          /**< Number of packets queued */
+    uint32_t dropped;           /**< Number of packets dropped to make room, the longest queue drops first */
+    uint32_t read;              /**< Number of packets read by mwifi_root_read() */
+    uint32_t latency_avg_ms;    /**< Average time from queuing to reading */
+    uint32_t latency_max_ms;    /**< Max time from queuing to reading */
+} mwifi_rx_queue_stats_t;
+
+#ifndef CONFIG_MWIFI_STATS_PEER_NUM
+#define CONFIG_MWIFI_STATS_PEER_NUM (16)
+#endif  /**< CONFIG_MWIFI_STATS_PEER_NUM */
+#define MWIFI_STATS_PEER_NUM    CONFIG_MWIFI_STATS_PEER_NUM /**< Number of peers counted separately */
+#define MWIFI_STATS_LATENCY_NUM (10)                         /**< Buckets of the send latency histogram */
+
+/**
+ * @brief Transport statistics of a peer, or of all the traffic
+ */
+typedef struct {
+    uint8_t addr[MWIFI_ADDR_LEN];   /**< Destination or source of the packets, MWIFI_ADDR_ANY for all the traffic */
+    uint32_t tx_packets;            /**< Number of packets sent */
+    uint32_t tx_bytes;              /**< Number of bytes sent, including the forwarded address lists */
+    uint32_t tx_fragments;          /**< Number of fragments sent */
+    uint32_t tx_retries;            /**< Number of fragments sent again after ESP_ERR_MESH_NO_MEMORY or ESP_ERR_MESH_QUEUE_FULL */
+    uint32_t tx_failed;             /**< Number of packets which failed to be sent */
+    uint32_t tx_paced_ms;           /**< Time the sender task waited before sending, to keep the ESP-WIFI-MESH queues short */
+    uint32_t tx_held;               /**< Number of messages held for a transmit window of the power save duty cycle */
+    uint32_t rx_packets;            /**< Number of packets received */
+    uint32_t rx_bytes;              /**< Number of bytes received */
+    uint32_t rx_fragments;          /**< Number of fragments received */
+    uint32_t rx_duplicates;         /**< Number of retransmitted fragments dropped */
+    uint32_t rx_reassembly_drops;   /**< Number of incomplete packets dropped on timeout or to make room */
+    uint32_t rx_uncompress_failed;  /**< Number of packets which failed to be uncompressed */
+    uint32_t rx_queue_drops;        /**< Number of packets dropped by the flow queues of the root */
+    uint32_t forwarded;             /**< Number of packets forwarded to children by multicast or flooding */
+    uint32_t forward_dropped;       /**< Number of packets not forwarded because the relay queue was full */
+    uint32_t latency_hist[MWIFI_STATS_LATENCY_NUM]; /**< Time from queuing to the end of sending, bucket `i` counts
+                                                         the packets below 2^i ms, the last one all the slower ones */
+} mwifi_stats_t;
+
 /**
  * @brief Buffer space when reading data
  */
 typedef enum {
     MWIFI_DATA_MEMORY_MALLOC_INTERNAL = 1,  /**< Buffer space is requested by internal when reading data */
     MWIFI_DATA_MEMORY_MALLOC_EXTERNAL = 2,  /**< Buffer space is requested by external when reading data */
+    MWIFI_DATA_MEMORY_POOL            = 3,  /**< Buffer is taken from the receive buffer pool, release it by `mwifi_read_release` */
 } mwifi_data_memory_t;
 
 /**
@@ -411,15 +507,42 @@ void mwifi_print_config();
  *                    If the default configuration is used, this parameter is NULL
  * @param  data       Pointer to a sending wifi mesh packet
  * @param  size       The length of the data
- * @param  block      Whether to block waiting for data transmission results
+ * @param  block      Whether to block waiting for data transmission results.
+ *                    If false, a copy of the packet is queued to the sender task,
+ *                    `data` may be reused once the function returns
  *
  * @return
  *    - MDF_OK
  *    - MDF_ERR_MWIFI_NOT_START
+ *    - ESP_ERR_MESH_QUEUE_FULL: Not blocking and the transmit queue is full
  */
 mdf_err_t mwifi_write(const uint8_t *dest_addrs, const mwifi_data_type_t *data_type,
                       const void *data, size_t size, bool block);
 
+/**
+ * @brief  Send a packet gathered from several buffers to any node in the mesh network.
+ *
+ * @attention 1. The elements are sent in order as one packet, the receiver gets them
+ *               concatenated. Fragments are taken directly from the caller's buffers,
+ *               so e.g. a protocol header and a payload do not need to be merged first.
+ *            2. The total length of all elements must be less than 8096 bytes.
+ *            3. Only a blocking write sends from the caller's buffers. A non-blocking write
+ *               returns before the packet is sent, the elements are copied into one buffer
+ *               that the sender task sends from and frees.
+ *
+ * @param  dest_addrs The address of the final destination of the packet, see mwifi_write()
+ * @param  data_type  The type of the data
+ * @param  iov        Array of buffers to be sent
+ * @param  iovcnt     Number of elements in `iov`, no more than MWIFI_IOV_MAX
+ * @param  block      Whether to block waiting for data transmission results
+ *
+ * @return
+ *    - MDF_OK
+ *    - MDF_ERR_MWIFI_NOT_START
+ */
+mdf_err_t mwifi_writev(const uint8_t *dest_addrs, const mwifi_data_type_t *data_type,
+                       const mwifi_iovec_t *iov, size_t iovcnt, bool block);
+
 /**
  * @brief  Receive a packet targeted to self over the mesh network
  *
@@ -456,6 +579,34 @@ mdf_err_t __mwifi_read(uint8_t *src_addr, mwifi_data_type_t *data_type, void *da
                  + builtin_types_compatible_p(data, char **) * MWIFI_DATA_MEMORY_MALLOC_INTERNAL \
                  + builtin_types_compatible_p(data, uint8_t **) * MWIFI_DATA_MEMORY_MALLOC_INTERNAL)
 
+/**
+ * @brief  Receive a packet targeted to self over the mesh network into a buffer of the receive buffer pool
+ *
+ * @attention 1. The payload is not copied to a new buffer, `data` points to the buffer the packet is received in.
+ *               It must be released by `mwifi_read_release` as soon as possible, the pool is small.
+ *            2. When all the blocks of the pool are in use, the buffer is allocated from the heap,
+ *               `mwifi_read_release` works for both.
+ *
+ * @param  src_addr    The address of the original source of the packet
+ * @param  data_type   The type of the data
+ * @param  data        Set to the buffer holding the received packet, the type must be (char **) or (uint8_t **)
+ * @param  size        Set to the length of the received packet
+ * @param  wait_ticks  Wait time if a packet isn't immediately available
+ *
+ * @return Same as mwifi_read()
+ */
+#define mwifi_read_pool(src_addr, data_type, data, size, wait_ticks) \
+    __mwifi_read(src_addr, data_type, (void *)data, size, wait_ticks, MWIFI_DATA_MEMORY_POOL)
+
+/**
+ * @brief  Release the buffer returned by mwifi_read_pool() or mwifi_root_read_pool()
+ *
+ * @attention Buffers must be released before mwifi_deinit()
+ *
+ * @param  data  Buffer of the received packet, NULL is ignored
+ */
+void mwifi_read_release(void *data);
+
 /**
  * @brief  The root sends a packet to the device in the mesh.
  *
@@ -464,6 +615,8 @@ mdf_err_t __mwifi_read(uint8_t *src_addr, mwifi_data_type_t *data_type, void *da
  *            2. This API is only used at the root node
  *            3. Can send data to multiple devices at the same time
  *            4. Packets are only transmitted down
+ *            5. A packet to MWIFI_ADDR_ANY or MWIFI_ADDR_BROADCAST is flooded down the tree,
+ *               each node receives it once from its parent and forwards it once to each child
  *
  * @param  dest_addrs     The address of the final destination of the packet
  * @param  dest_addrs_num Number of destination addresses
@@ -490,6 +643,34 @@ mdf_err_t mwifi_root_write(const uint8_t *dest_addrs, size_t dest_addrs_num,
                            const mwifi_data_type_t *data_type, const void *data,
                            size_t size, bool block);
 
+/**
+ * @brief  The root sends a packet gathered from several buffers to the devices in the mesh.
+ *
+ * @attention The elements are sent in order as one packet, and only a blocking write
+ *            sends from the caller's buffers, see mwifi_writev()
+ *
+ * @param  dest_addrs     The address of the final destination of the packet
+ * @param  dest_addrs_num Number of destination addresses
+ * @param  data_type      The type of the data
+ * @param  iov            Array of buffers to be sent
+ * @param  iovcnt         Number of elements in `iov`, no more than MWIFI_IOV_MAX
+ * @param  block          Whether to block waiting for data transmission results
+ *
+ * @return
+ *    - MDF_OK
+ *    - MDF_ERR_MWIFI_NOT_START
+ *    - ESP_ERR_MESH_ARGUMENT
+ *    - ESP_ERR_MESH_NOT_START
+ *    - ESP_ERR_MESH_DISCONNECTED
+ *    - ESP_ERR_MESH_NO_MEMORY
+ *    - ESP_ERR_MESH_TIMEOUT
+ *    - ESP_ERR_MESH_QUEUE_FULL
+ *    - ESP_ERR_MESH_NO_ROUTE_FOUND
+ */
+mdf_err_t mwifi_root_writev(const uint8_t *dest_addrs, size_t dest_addrs_num,
+                            const mwifi_data_type_t *data_type,
+                            const mwifi_iovec_t *iov, size_t iovcnt, bool block);
+
 /**
  * @brief  receive a packet targeted to external IP network
  *         root uses this API to receive packets destined to external IP network
@@ -527,6 +708,21 @@ mdf_err_t __mwifi_root_read(uint8_t *src_addr, mwifi_data_type_t *data_type,
                       + builtin_types_compatible_p(data, char **) * MWIFI_DATA_MEMORY_MALLOC_INTERNAL \
                       + builtin_types_compatible_p(data, uint8_t **) * MWIFI_DATA_MEMORY_MALLOC_INTERNAL)
 
+/**
+ * @brief  The root receives a packet targeted to an external IP network into a buffer of the receive buffer pool,
+ *         release it by `mwifi_read_release`. See mwifi_read_pool() for details.
+ *
+ * @param  src_addr    The address of the original source of the packet
+ * @param  data_type   The type of the data
+ * @param  data        Set to the buffer holding the received packet, the type must be (char **) or (uint8_t **)
+ * @param  size        Set to the length of the received packet
+ * @param  wait_ticks  Wait time if a packet isn't immediately available
+ *
+ * @return Same as mwifi_root_read()
+ */
+#define mwifi_root_read_pool(src_addr, data_type, data, size, wait_ticks) \
+    __mwifi_root_read(src_addr, data_type, (void *)data, size, wait_ticks, MWIFI_DATA_MEMORY_POOL)
+
 /**
  * @brief      Post the toDS state to the mesh stack, Usually used to notify the child node, whether the root is successfully connected to the server
  *
@@ -556,6 +752,73 @@ bool mwifi_get_root_status();
  */
 int8_t mwifi_get_parent_rssi();
 
+/**
+ * @brief  Get the statistics of the transmit queues.
+ *
+ * @note   All the packets are sent by one sender task, a packet is sent as a whole
+ *         before the next one. The classes are served by strict priority or by weight,
+ *         the queues of a class round-robin.
+ *
+ * @param  stats      Statistics of each queue, the queues of priority class `p`
+ *                    are at `stats[p * MWIFI_TX_QUEUE_NUM]`
+ * @param  queue_num  Number of elements in stats as input, number of queues copied as output,
+ *                    at most MWIFI_PRIORITY_MAX * MWIFI_TX_QUEUE_NUM
+ *
+ * @return
+ *    - MDF_OK
+ *    - MDF_ERR_INVALID_ARG
+ *    - MDF_ERR_MWIFI_NOT_INIT
+ */
+mdf_err_t mwifi_get_tx_queue_stats(mwifi_tx_queue_stats_t *stats, size_t *queue_num);
+
+/**
+ * @brief  Get the statistics of the flow queues of the root.
+ *
+ * @note   A task of the root receives the packets to the external IP network and queues
+ *         them by flow, mwifi_root_read() serves the flows by deficit round-robin so that
+ *         a busy source or subtree can't delay the others. When the queues are full, the
+ *         oldest packet of the longest queue is dropped.
+ *
+ * @param  stats      Statistics of each queue
+ * @param  queue_num  Number of elements in stats as input, number of queues copied as output,
+ *                    at most MWIFI_RX_QUEUE_NUM
+ *
+ * @return
+ *    - MDF_OK
+ *    - MDF_ERR_INVALID_ARG
+ *    - MDF_ERR_MWIFI_NOT_INIT
+ *    - MDF_ERR_NOT_SUPPORTED: CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE is disabled
+ */
+mdf_err_t mwifi_get_rx_queue_stats(mwifi_rx_queue_stats_t *stats, size_t *queue_num);
+
+/**
+ * @brief  Get the transport statistics.
+ *
+ * @note   The counters are updated without locks, a snapshot taken while packets are
+ *         being sent or received may be slightly inconsistent. The first
+ *         MWIFI_STATS_PEER_NUM peers are counted separately, all of them in total.
+ *
+ * @param  total     Statistics of all the traffic, may be NULL
+ * @param  peers     Statistics of each peer, may be NULL
+ * @param  peer_num  Number of elements in peers as input, number of peers copied as output
+ *
+ * @return
+ *    - MDF_OK
+ *    - MDF_ERR_INVALID_ARG
+ *    - MDF_ERR_NOT_SUPPORTED: CONFIG_MWIFI_STATS_ENABLE is disabled
+ */
+mdf_err_t mwifi_get_stats(mwifi_stats_t *total, mwifi_stats_t *peers, size_t *peer_num);
+
+/**
+ * @brief  Clear the transport statistics. The counters are cleared while the packets are
+ *         counted, the peers keep their entries.
+ *
+ * @return
+ *    - MDF_OK
+ *    - MDF_ERR_NOT_SUPPORTED: CONFIG_MWIFI_STATS_ENABLE is disabled
+ */
+mdf_err_t mwifi_reset_stats();
+
 #ifdef __cplusplus
 }
 #endif /**< _cplusplus */
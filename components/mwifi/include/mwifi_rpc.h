@@ -0,0 +1,107 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __MWIFI_RPC_H__
+#define __MWIFI_RPC_H__
+
+#include "mwifi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /**< _cplusplus */
+
+#ifndef CONFIG_MWIFI_RPC_CALL_NUM
+#define CONFIG_MWIFI_RPC_CALL_NUM   (32)
+#endif  /**< CONFIG_MWIFI_RPC_CALL_NUM */
+#define MWIFI_RPC_CALL_NUM CONFIG_MWIFI_RPC_CALL_NUM /**< Calls waiting for a response at the same time, to all the peers */
+
+/**
+ * @brief  Handler of the received requests
+ *
+ * @param  src_addr   Caller of the request
+ * @param  data_type  Type given to mwifi_rpc_call() by the caller
+ * @param  req_data   Request, only valid during the call
+ * @param  req_size   Length of the request
+ * @param  resp_data  Response allocated by MDF_MALLOC, freed after it is sent, may be left NULL
+ * @param  resp_size  Length of the response
+ *
+ * @return
+ *     - MDF_OK
+ *     - others: Returned by mwifi_rpc_call() of the caller, the response is not sent
+ */
+typedef mdf_err_t (*mwifi_rpc_handler_t)(const uint8_t *src_addr, const mwifi_data_type_t *data_type,
+        const void *req_data, size_t req_size, void **resp_data, size_t *resp_size);
+
+/**
+ * @brief  Set the handler of the received requests
+ *
+ * @param  handler  Handler, NULL to answer the requests with MDF_ERR_NOT_SUPPORTED
+ *
+ * @return
+ *     - MDF_OK
+ */
+mdf_err_t mwifi_rpc_set_handler(mwifi_rpc_handler_t handler);
+
+/**
+ * @brief  Send a request and wait for its response
+ *
+ * @attention 1. Each request carries an ID, the response is given to the task waiting for it.
+ *               Any number of tasks may call at the same time, to the same peer or to different
+ *               ones, up to MWIFI_RPC_CALL_NUM calls in total. The calls share no lock.
+ * @attention 2. The responses arrive through mwifi_read() or mwifi_root_read(), which must keep
+ *               running in another task and pass the RPC packets to mwifi_rpc_handle().
+ * @attention 3. A request is sent once, ESP-WIFI-MESH retransmits the lost packets. A response
+ *               arriving after the timeout is dropped.
+ *
+ * @param  dest_addr   Destination, NULL for mwifi_root_read() of the root
+ * @param  data_type   Type of the request, given to the handler of the destination
+ * @param  req_data    Request
+ * @param  req_size    Length of the request
+ * @param  resp_data   Buffer of the response, may be NULL if no response data is expected
+ * @param  resp_size   Length of the buffer as input, length of the response as output
+ * @param  wait_ticks  Timeout of the call
+ *
+ * @return
+ *     - MDF_OK
+ *     - MDF_ERR_INVALID_ARG
+ *     - MDF_ERR_NO_MEM: MWIFI_RPC_CALL_NUM calls are already waiting
+ *     - MDF_ERR_BUF: The response is larger than the buffer, resp_size is set to its length
+ *     - MDF_ERR_MWIFI_TIMEOUT
+ *     - others: Returned by the handler of the destination, or failed to send the request
+ */
+mdf_err_t mwifi_rpc_call(const uint8_t *dest_addr, const mwifi_data_type_t *data_type,
+                         const void *req_data, size_t req_size,
+                         void *resp_data, size_t *resp_size, TickType_t wait_ticks);
+
+/**
+ * @brief  Handle an RPC packet, call it for every packet whose data_type.rpc is set.
+ *         A request is passed to the handler and answered before returning.
+ *
+ * @param  src_addr   Source of the packet
+ * @param  data_type  Type of the packet
+ * @param  data       Packet
+ * @param  size       Length of the packet
+ *
+ * @return
+ *     - MDF_OK
+ *     - MDF_ERR_INVALID_ARG
+ */
+mdf_err_t mwifi_rpc_handle(const uint8_t *src_addr, const mwifi_data_type_t *data_type,
+                           const void *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif /**< _cplusplus */
+
+#endif /**< __MWIFI_RPC_H__ */
@@ -0,0 +1,140 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __MWIFI_STREAM_H__
+#define __MWIFI_STREAM_H__
+
+#include "mwifi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /**< _cplusplus */
+
+#ifndef CONFIG_MWIFI_STREAM_WINDOW
+#define CONFIG_MWIFI_STREAM_WINDOW          (8)
+#endif  /**< CONFIG_MWIFI_STREAM_WINDOW */
+#define MWIFI_STREAM_WINDOW CONFIG_MWIFI_STREAM_WINDOW /**< Chunks in flight of a stream, also buffered by the receiver */
+
+#ifndef CONFIG_MWIFI_STREAM_RETRANSMIT_MS
+#define CONFIG_MWIFI_STREAM_RETRANSMIT_MS   (1000)
+#endif  /**< CONFIG_MWIFI_STREAM_RETRANSMIT_MS */
+#define MWIFI_STREAM_RETRANSMIT_MS CONFIG_MWIFI_STREAM_RETRANSMIT_MS
+
+#define MWIFI_STREAM_CHUNK_SIZE     (MWIFI_PAYLOAD_LEN - 9) /**< Message bytes in a packet, the rest is the stream header */
+#define MWIFI_STREAM_RETRY_MAX      (5)  /**< Retransmissions without progress before a stream fails */
+#define MWIFI_STREAM_RECV_NUM       (4)  /**< Streams received at the same time */
+
+/**
+ * @brief Handle of a stream being sent
+ */
+typedef struct mwifi_stream mwifi_stream_t;
+
+/**
+ * @brief  Callback of the received stream data, called in order and without gaps
+ *
+ * @param  src_addr    Sender of the stream
+ * @param  data_type   Type given to mwifi_stream_open() by the sender
+ * @param  offset      Offset of the data in the message
+ * @param  data        Part of the message, only valid during the callback
+ * @param  size        Length of the data
+ * @param  total_size  Length of the whole message, the last call has offset + size == total_size
+ *
+ * @return
+ *     - MDF_OK
+ *     - others: Abort the stream, the sender gets MDF_ERR_MWIFI_TIMEOUT
+ */
+typedef mdf_err_t (*mwifi_stream_recv_cb_t)(const uint8_t *src_addr, const mwifi_data_type_t *data_type,
+        size_t offset, const void *data, size_t size, size_t total_size);
+
+/**
+ * @brief  Set the callback of the received streams
+ *
+ * @param  recv_cb  Callback, NULL to refuse the streams
+ *
+ * @return
+ *     - MDF_OK
+ */
+mdf_err_t mwifi_stream_set_recv_cb(mwifi_stream_recv_cb_t recv_cb);
+
+/**
+ * @brief  Open a stream to send a message larger than mwifi_write() allows
+ *
+ * @attention 1. The message is cut into chunks of MWIFI_STREAM_CHUNK_SIZE, each sent as one packet.
+ *               Up to MWIFI_STREAM_WINDOW chunks are in flight, the receiver acknowledges them
+ *               and the lost ones are sent again.
+ * @attention 2. The sender keeps the chunks in flight and the receiver the chunks received out of order,
+ *               MWIFI_STREAM_WINDOW * MWIFI_STREAM_CHUNK_SIZE bytes at most. The nodes in between
+ *               only forward packets and keep nothing.
+ * @attention 3. The acknowledgements arrive through mwifi_read() or mwifi_root_read(), which must keep
+ *               running in another task and pass the stream packets to mwifi_stream_handle().
+ *
+ * @param  dest_addr   Destination, NULL for mwifi_root_read() of the root. Streams are unicast only.
+ * @param  data_type   Type of the message, given to the callback of the receiver
+ * @param  total_size  Length of the whole message
+ * @param  stream      Handle of the stream
+ *
+ * @return
+ *     - MDF_OK
+ *     - MDF_ERR_INVALID_ARG
+ *     - MDF_ERR_NO_MEM
+ */
+mdf_err_t mwifi_stream_open(const uint8_t *dest_addr, const mwifi_data_type_t *data_type,
+                            size_t total_size, mwifi_stream_t **stream);
+
+/**
+ * @brief  Send the next part of the message, blocks while the window is full
+ *
+ * @param  stream  Handle of the stream
+ * @param  data    Next part of the message, any length
+ * @param  size    Length of the data, no more than what is left of total_size
+ *
+ * @return
+ *     - MDF_OK
+ *     - MDF_ERR_INVALID_ARG
+ *     - MDF_ERR_MWIFI_TIMEOUT: The receiver stopped acknowledging, the stream has failed
+ */
+mdf_err_t mwifi_stream_write(mwifi_stream_t *stream, const void *data, size_t size);
+
+/**
+ * @brief  Wait until the receiver has the whole message, then free the stream
+ *
+ * @param  stream  Handle of the stream, freed even if an error is returned
+ *
+ * @return
+ *     - MDF_OK
+ *     - MDF_ERR_MWIFI_ARGUMENT: Closed before the whole message was written
+ *     - MDF_ERR_MWIFI_TIMEOUT: The receiver stopped acknowledging
+ */
+mdf_err_t mwifi_stream_close(mwifi_stream_t *stream);
+
+/**
+ * @brief  Handle a stream packet, call it for every packet whose data_type.stream is set
+ *
+ * @param  src_addr   Source of the packet
+ * @param  data_type  Type of the packet
+ * @param  data       Packet
+ * @param  size       Length of the packet
+ *
+ * @return
+ *     - MDF_OK
+ *     - MDF_ERR_INVALID_ARG
+ */
+mdf_err_t mwifi_stream_handle(const uint8_t *src_addr, const mwifi_data_type_t *data_type,
+                              const void *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif /**< _cplusplus */
+
+#endif /**< __MWIFI_STREAM_H__ */
@@ -17,6 +17,36 @@
 
 #define MWIFI_WAIVE_ROOT_INTERVAL  3 /**< When the root rssi is weak, MWIFI_WAIVE_ROOT_INTERVAL minutes will initiate a re root node selection */
 #define MWIFI_EVET_INFO_SIZE 3
+#define MWIFI_RECV_BUFFER_LARGE_SIZE (8 * 1024) /**< Large enough for any reassembled packet, total_size has 13 bits */
+#define MWIFI_TX_DONE_POOL_SIZE      (4)        /**< Semaphores kept for the blocking writers */
+#define MWIFI_COMPRESS_DICT_DATA_MAX (256)      /**< Larger data gains little from the dictionary with a 512 bytes window */
+#define MWIFI_TX_RATE_MIN            (20)       /**< Fragments per second the sender task is never paced below */
+#define MWIFI_TX_RATE_MAX            (2000)     /**< Fragments per second from which the sender task isn't paced */
+#define MWIFI_TX_RATE_STEP           (10)       /**< Additive increase for each fragment sent while the queues are short */
+#define MWIFI_TX_OCCUPANCY_HIGH      (50)       /**< Percent of the XON queue above which the rate is decreased */
+#define MWIFI_TX_OCCUPANCY_LOW       (25)       /**< Percent of the XON queue below which the rate is increased */
+#define MWIFI_TX_RETRY_INTERVAL_MS   (10)       /**< A queue whose head packet found no room in ESP-WIFI-MESH is served again after this time */
+
+#ifdef CONFIG_MWIFI_FLOW_CONTROL_ENABLE
+#define MWIFI_TX_RETRY_TIMEOUT_MS    CONFIG_MWIFI_FLOW_CONTROL_TIMEOUT_MS
+#else
+#define MWIFI_TX_RETRY_TIMEOUT_MS    (300)      /**< A packet fails when its next fragment has found no room for this long */
+#endif /**< CONFIG_MWIFI_FLOW_CONTROL_ENABLE */
+
+#ifdef CONFIG_MWIFI_COMPRESS_DICT_ENABLE
+#define MWIFI_COMPRESS_DICT_ENABLE true
+#else
+#define MWIFI_COMPRESS_DICT_ENABLE false
+#endif /**< CONFIG_MWIFI_COMPRESS_DICT_ENABLE */
+
+/**
+ * @brief Add to a counter of the statistics, of the peer and of all the traffic
+ */
+#ifdef CONFIG_MWIFI_STATS_ENABLE
+#define MWIFI_STATS_ADD(addr, field, value) mwifi_stats_add(addr, offsetof(mwifi_stats_t, field), value)
+#else
+#define MWIFI_STATS_ADD(addr, field, value) do { (void)(addr); (void)(value); } while (0)
+#endif /**< CONFIG_MWIFI_STATS_ENABLE */
 
 typedef struct {
     uint32_t magic;                   /**< Filter duplicate packets */
@@ -29,9 +59,282 @@ typedef struct {
         size_t total_size_hight : 1;  /**< Total length of the packet */
         uint8_t compress_rate   : 4;  /**< The ratio of the data to the original after compression */
     };
-    mwifi_data_type_t type;           /**< The type of data */
+    mwifi_data_type_t type;           /**< The type of data, `type.reserved` is set if the extension is sent */
+    uint16_t uncompressed_size : 14;  /**< Length of the data before compression, 0 if unknown */
+    bool compress_dict         : 1;   /**< Compressed with the preset dictionary `g_compress_dict` */
+    bool coalesced             : 1;   /**< Small messages packed by mwifi_coalesce_write() or mwifi_ps_batch_write() */
 } __attribute__((packed)) mwifi_data_head_t;
 
+/**
+ * @brief Only the first 13 bytes of the header, the ones earlier versions know, are sent as
+ *        the option of ESP-WIFI-MESH. The remaining bytes, the extension, are sent in front
+ *        of the payload when `type.reserved` is set, see mwifi_data_head_ext_needed().
+ */
+#define MWIFI_DATA_HEAD_LEN         (offsetof(mwifi_data_head_t, type) + offsetof(mwifi_data_type_t, custom) + sizeof(uint32_t))
+#define MWIFI_DATA_HEAD_EXT_LEN     (sizeof(mwifi_data_head_t) - MWIFI_DATA_HEAD_LEN)
+#define MWIFI_DATA_HEAD_EXT(head)   ((uint8_t *)(head) + MWIFI_DATA_HEAD_LEN)
+
+#define MWIFI_UNCOMPRESSED_SIZE_MAX (0x3fff)
+#define MWIFI_EXT_PEER_NUM          (16)     /**< Number of devices remembered to read the header extension */
+
+/**
+ * @brief Header of each message in a coalesced packet
+ */
+typedef struct {
+    mwifi_data_type_t type;           /**< The type of the message */
+    uint16_t size;                    /**< Length of the message following the header */
+} __attribute__((packed)) mwifi_coalesce_record_t;
+
+/**
+ * @brief Preset dictionary for small packets, built from the mlink vocabulary:
+ *        the request names of `g_handles_list` in mlink_handle.c and the keys
+ *        packed by `mlink_json_pack`. The most frequent strings are at the end,
+ *        closest to the data. The LZ window of miniz is only TDEFL_LZ_DICT_SIZE (512)
+ *        bytes, keep it well below that so that the data can still reach it.
+ *
+ * @note  Both ends must use the same dictionary, never modify it, add a new one
+ *        and a new header bit instead.
+ */
+static const char g_compress_dict[] =
+    "\"add_device\"\"set_group\"\"get_group\""
+    "\"idf_version\":\"v\",\"mdf_version\":\"v\",\"mlink_version\":2,\"mlink_trigger\":0,"
+    "\"tsf_time\":\"self_mac\":\"parent_mac\":\"mesh_id\":\"version\":\"layer\":1,\"rssi\":-"
+    "{\"request\":\"get_device_info\"}{\"status_msg\":\"MDF_OK\",\"status_code\":0}"
+    "{\"cid\":0,\"name\":\"on\",\"format\":\"int\",\"perms\":7,\"value\":0,\"min\":0,\"max\":100,\"step\":1},"
+    "{\"request\":\"get_status\",\"cids\":[0,1,2]}"
+    "{\"request\":\"set_status\",\"characteristics\":[{\"cid\":0,\"value\":1},{\"cid\":1,\"value\":";
+
+/**
+ * @brief Compression context kept between packets, allocating one costs
+ *        more than compressing a small packet
+ */
+typedef struct {
+    SemaphoreHandle_t lock;
+    bool inited;
+    mz_stream stream;
+} mwifi_zstream_t;
+
+/**
+ * @brief Reassembly of the packets of a receive queue
+ */
+typedef struct {
+    mdf_dedup_t *dedup;               /**< Filter retransmitted fragments */
+    mdf_reassembly_t *table;          /**< Incomplete fragmented packets */
+} mwifi_reassembly_t;
+
+/**
+ * @brief Entry of the subnet index, maps a downstream node to the child it is reached through
+ */
+typedef struct {
+    mesh_addr_t addr;
+    uint8_t child;                    /**< Index of the child plus one, 0 if the entry is empty */
+} mwifi_subnet_entry_t;
+
+/**
+ * @brief Cache of the subnets of the children, used to split multicast packets.
+ *        Rebuilt on the next multicast after the routing table or the children change.
+ */
+typedef struct {
+    SemaphoreHandle_t lock;
+    volatile uint32_t version;        /**< Increased by the events which change the subnets */
+    uint32_t built_version;           /**< Version of the index, valid only if `built` is true */
+    bool built;
+    size_t child_num;
+    mesh_addr_t child[ESP_WIFI_MAX_CONN_NUM];
+    size_t table_mask;                /**< Open addressing hash table of a power of two size */
+    size_t table_size;                /**< Capacity of `table`, never shrinks */
+    mwifi_subnet_entry_t *table;
+    int nodes_size;                   /**< Capacity of `nodes`, never shrinks */
+    mesh_addr_t *nodes;               /**< Buffer for esp_mesh_get_subnet_nodes_list() */
+} mwifi_subnet_index_t;
+
+/**
+ * @brief Small messages to the root waiting to be sent in one packet
+ */
+typedef struct {
+    SemaphoreHandle_t lock;
+    TimerHandle_t timer;              /**< Flushes the packet CONFIG_MWIFI_COALESCE_FLUSH_MS after its first message */
+    uint8_t *data;                    /**< MWIFI_PAYLOAD_LEN bytes, allocated on first use */
+    size_t size;
+} mwifi_coalesce_t;
+
+/**
+ * @brief Coalesced packet being split by mwifi_read() or mwifi_root_read()
+ */
+typedef struct {
+    SemaphoreHandle_t lock;
+    uint8_t src_addr[MWIFI_ADDR_LEN];
+    uint8_t *data;                    /**< NULL if there is no packet being split */
+    size_t size;
+    size_t offset;                    /**< Offset of the next message */
+} mwifi_coalesce_rx_t;
+
+#ifdef CONFIG_MWIFI_PS_BATCH_ENABLE
+/**
+ * @brief Messages to one destination held for the next transmit window
+ */
+typedef struct {
+    uint8_t dest_addr[MWIFI_ADDR_LEN];
+    bool to_root;                     /**< Read by mwifi_root_read() of the root */
+    uint8_t *data;                    /**< MWIFI_PAYLOAD_LEN bytes, NULL if the batch is free */
+    size_t size;
+} mwifi_ps_batch_t;
+
+/**
+ * @brief Transmit windows of the power save duty cycle
+ */
+typedef struct {
+    SemaphoreHandle_t lock;
+    TimerHandle_t timer;              /**< Opens a transmit window every CONFIG_MWIFI_PS_BATCH_WINDOW_MS */
+    mwifi_ps_batch_t batch[CONFIG_MWIFI_PS_BATCH_DEST_NUM];
+} mwifi_ps_batcher_t;
+#endif /**< CONFIG_MWIFI_PS_BATCH_ENABLE */
+
+/**
+ * @brief Packet waiting in a transmit queue
+ */
+typedef struct mwifi_tx_packet {
+    struct mwifi_tx_packet *next;
+    mesh_addr_t dest_addr;
+    uint8_t tos;
+    int flag;
+    mesh_opt_t opt;                   /**< Points to `data_head` */
+    mwifi_data_head_t data_head;
+    const mwifi_iovec_t *iov;
+    size_t iovcnt;
+    int64_t enqueue_time;             /**< Time of queuing, in microseconds */
+    size_t offset;                    /**< Offset of the next fragment to send */
+    uint32_t packet_magic;            /**< Magic of the packet, set when its first fragment is sent */
+    int64_t retry_time;               /**< Time the next fragment first found no room in ESP-WIFI-MESH, 0 if it didn't */
+    SemaphoreHandle_t done;           /**< Given when a blocking packet is sent, NULL for a queued copy */
+    mdf_err_t ret;
+    mwifi_iovec_t copy_iov;           /**< Points to `copy_data` for a queued copy */
+    uint8_t copy_data[0];
+} mwifi_tx_packet_t;
+
+/**
+ * @brief Transmit queue of the destinations hashed to it
+ */
+typedef struct {
+    mwifi_tx_packet_t *head;
+    mwifi_tx_packet_t *tail;
+    size_t copy_num;                  /**< Number of queued copies of non-blocking packets */
+    int64_t retry_time;               /**< The queue isn't served before this time, in microseconds */
+    uint64_t latency_sum_ms;
+    mwifi_tx_queue_stats_t stats;
+} mwifi_tx_queue_t;
+
+/**
+ * @brief AIMD pacing of the fragments sent by the sender task
+ */
+typedef struct {
+    uint32_t rate;                    /**< Fragments per second, MWIFI_TX_RATE_MAX when not paced */
+    int64_t next_us;                  /**< Earliest time of the next fragment */
+    int64_t decrease_us;              /**< Time of the last decrease */
+} mwifi_tx_rate_t;
+
+/**
+ * @brief Transmit queues and their sender task
+ */
+typedef struct {
+    SemaphoreHandle_t lock;
+    SemaphoreHandle_t pending;        /**< Counts the packets in the queues */
+    TaskHandle_t task;
+    volatile bool exit;
+    size_t next_queue[MWIFI_PRIORITY_MAX]; /**< Next queue of each class to serve, round-robin */
+    int credit[MWIFI_PRIORITY_MAX];        /**< Packets each class may still send in this round, weighted scheduling */
+    size_t done_num;
+    SemaphoreHandle_t done_pool[MWIFI_TX_DONE_POOL_SIZE];
+    mwifi_tx_rate_t rate;             /**< Only used by the sender task */
+    mwifi_tx_queue_t queue[MWIFI_PRIORITY_MAX * MWIFI_TX_QUEUE_NUM]; /**< Queues of class `p` start at `p * MWIFI_TX_QUEUE_NUM` */
+} mwifi_tx_t;
+
+/**
+ * @brief Reassembled packet to be forwarded to the children
+ */
+typedef struct {
+    uint8_t *data;                    /**< Receive buffer, owned by the relay task once queued */
+    size_t size;
+    uint8_t tos;
+    mwifi_data_head_t data_head;
+} mwifi_relay_packet_t;
+
+/**
+ * @brief Relay task, forwards the multicast and flooded packets so that
+ *        the reading task doesn't wait for the children
+ */
+typedef struct {
+    QueueHandle_t queue;
+    TaskHandle_t task;
+    volatile bool exit;
+} mwifi_relay_t;
+
+/**
+ * @brief Packet waiting in a flow queue of the root
+ */
+typedef struct mwifi_fq_packet {
+    struct mwifi_fq_packet *next;
+    uint8_t src_addr[MWIFI_ADDR_LEN];
+    mwifi_data_head_t data_head;
+    uint8_t *data;                    /**< Receive buffer, owned by the queue */
+    size_t size;
+    int64_t enqueue_time;
+} mwifi_fq_packet_t;
+
+/**
+ * @brief Flow queue of the root, the flows hashed to it share its turn
+ */
+typedef struct {
+    mwifi_fq_packet_t *head;
+    mwifi_fq_packet_t *tail;
+    int deficit;                      /**< Bytes the queue may still read in its turn */
+    size_t bytes;                     /**< Bytes of the packets in the queue */
+    uint64_t latency_sum_ms;
+    mwifi_rx_queue_stats_t stats;
+} mwifi_fq_queue_t;
+
+/**
+ * @brief Flow queues of the root and the task filling them
+ */
+typedef struct {
+    SemaphoreHandle_t lock;
+    SemaphoreHandle_t pending;        /**< Counts the packets in the queues */
+    TaskHandle_t task;
+    volatile bool exit;
+    size_t next_queue;                /**< Queue being served, deficit round-robin */
+    size_t packet_num;
+    mwifi_fq_queue_t queue[MWIFI_RX_QUEUE_NUM];
+} mwifi_fq_t;
+
+/**
+ * @brief Statistics of a peer, the entry is claimed by the first packet from or to it.
+ *        The claimer takes the key, then writes the address and sets `ready`, peers with
+ *        the same hash skip the entry until the address can be compared.
+ */
+typedef struct {
+    uint32_t key;                     /**< Hash of the address, 0 if the entry is free */
+    bool ready;                       /**< The address is written */
+    mwifi_stats_t stats;
+} mwifi_stats_peer_t;
+
+/**
+ * @brief Transport statistics, the counters are updated with atomic operations only
+ */
+typedef struct {
+    mwifi_stats_t total;
+    mwifi_stats_peer_t peer[MWIFI_STATS_PEER_NUM];
+} mwifi_stats_table_t;
+
+/**
+ * @brief Devices known to read the header extension, learned from the packets they sent
+ *        with it. The oldest one is replaced when the table is full.
+ */
+typedef struct {
+    SemaphoreHandle_t lock;
+    size_t next;                      /**< Entry replaced by the next device */
+    uint8_t addr[MWIFI_EXT_PEER_NUM][MWIFI_ADDR_LEN];
+} mwifi_ext_peer_t;
+
 static const char *TAG           = "mwifi";
 static bool g_mwifi_inited_flag  = false;
 static bool mwifi_connected_flag = false;
@@ -42,6 +345,97 @@ static bool g_rootless_flag                       = false;
 static mesh_event_toDS_state_t g_toDs_status_flag = false;
 static xTimerHandle g_waive_root_timer;
 static int g_waive_root_interval                  = MWIFI_WAIVE_ROOT_INTERVAL; /**< Avoid frequent triggers waive root*/
+static mwifi_reassembly_t g_read_reassembly      = {0}; /**< Packets received by mwifi_read() */
+static mwifi_reassembly_t g_root_read_reassembly = {0}; /**< Packets received by mwifi_root_read() */
+static mdf_mem_pool_t *g_recv_pool_small         = NULL; /**< Receive buffers of MWIFI_PAYLOAD_LEN */
+static mdf_mem_pool_t *g_recv_pool_large         = NULL; /**< Receive buffers of MWIFI_RECV_BUFFER_LARGE_SIZE */
+static mwifi_zstream_t g_deflate_stream          = {0};
+static mwifi_zstream_t g_inflate_stream          = {0};
+static mwifi_subnet_index_t g_subnet_index       = {0};
+static mwifi_coalesce_t g_coalesce_tx            = {0};
+static mwifi_coalesce_rx_t g_coalesce_rx         = {0}; /**< Packets received by mwifi_root_read() */
+static mwifi_coalesce_rx_t g_coalesce_read_rx    = {0}; /**< Packets received by mwifi_read() */
+#ifdef CONFIG_MWIFI_PS_BATCH_ENABLE
+static mwifi_ps_batcher_t g_ps_batcher           = {0};
+#endif /**< CONFIG_MWIFI_PS_BATCH_ENABLE */
+static mwifi_tx_t g_tx                           = {0};
+static mwifi_relay_t g_relay                     = {0};
+#ifdef CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE
+static mwifi_fq_t g_fq                           = {0};
+#endif /**< CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE */
+#ifdef CONFIG_MWIFI_STATS_ENABLE
+static mwifi_stats_table_t g_stats               = {0};
+#endif /**< CONFIG_MWIFI_STATS_ENABLE */
+#ifdef CONFIG_MWIFI_DATA_HEAD_EXT_LEARN
+static mwifi_ext_peer_t g_ext_peer               = {0};
+#endif /**< CONFIG_MWIFI_DATA_HEAD_EXT_LEARN */
+
+static void mwifi_tx_task(void *arg);
+static void mwifi_tx_stop();
+static void mwifi_relay_task(void *arg);
+static void mwifi_relay_stop();
+#ifdef CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE
+static mdf_err_t mwifi_fq_update();
+static void mwifi_fq_stop();
+#endif /**< CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE */
+
+#ifdef CONFIG_MWIFI_STATS_ENABLE
+/**
+ * @brief Find the statistics of a peer, claim a free entry for a new one.
+ *        Returns NULL if all the entries are taken by other peers, or if the
+ *        entry of the peer is being claimed by another task.
+ */
+static mwifi_stats_t *mwifi_stats_peer(const uint8_t *addr)
+{
+    uint32_t key = 2166136261;
+
+    for (int i = 0; i < MWIFI_ADDR_LEN; ++i) {
+        key = (key ^ addr[i]) * 16777619;
+    }
+
+    key = key ? key : 1;
+
+    for (int i = 0, index = key % MWIFI_STATS_PEER_NUM; i < MWIFI_STATS_PEER_NUM;
+            ++i, index = (index + 1) % MWIFI_STATS_PEER_NUM) {
+        mwifi_stats_peer_t *peer = g_stats.peer + index;
+        uint32_t peer_key        = __atomic_load_n(&peer->key, __ATOMIC_ACQUIRE);
+
+        if (!peer_key && __atomic_compare_exchange_n(&peer->key, &peer_key, key, false,
+                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            memcpy(peer->stats.addr, addr, MWIFI_ADDR_LEN);
+            __atomic_store_n(&peer->ready, true, __ATOMIC_RELEASE);
+            return &peer->stats;
+        }
+
+        if (peer_key != key) {
+            continue;
+        }
+
+        /**< The address is still being written, the packet is only counted in total */
+        if (!__atomic_load_n(&peer->ready, __ATOMIC_ACQUIRE)) {
+            return NULL;
+        }
+
+        /**< Another address with the same hash, go on probing */
+        if (!memcmp(peer->stats.addr, addr, MWIFI_ADDR_LEN)) {
+            return &peer->stats;
+        }
+    }
+
+    return NULL;
+}
+
+static void mwifi_stats_add(const uint8_t *addr, size_t offset, uint32_t value)
+{
+    mwifi_stats_t *peer = addr ? mwifi_stats_peer(addr) : NULL;
+
+    __atomic_fetch_add((uint32_t *)((uint8_t *)&g_stats.total + offset), value, __ATOMIC_RELAXED);
+
+    if (peer) {
+        __atomic_fetch_add((uint32_t *)((uint8_t *)peer + offset), value, __ATOMIC_RELAXED);
+    }
+}
+#endif /**< CONFIG_MWIFI_STATS_ENABLE */
 
 bool mwifi_is_started()
 {
@@ -180,6 +574,10 @@ static void esp_mesh_event_cb(void *arg, esp_event_base_t event_base, int32_t ev
                 g_rootless_flag = false;
             }
 
+#ifdef CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE
+            mwifi_fq_update();
+#endif /**< CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE */
+
             break;
         }
 
@@ -208,18 +606,22 @@ static void esp_mesh_event_cb(void *arg, esp_event_base_t event_base, int32_t ev
             break;
         }
 
+        case MESH_EVENT_LAYER_CHANGE: {
 #ifdef CONFIG_MWIFI_WAIVE_ROOT
 
-        case MESH_EVENT_LAYER_CHANGE: {
             if (!esp_mesh_is_root()) {
                 mwifi_waive_root_timer_delete();
             }
 
+#endif /**< CONFIG_MWIFI_WAIVE_ROOT */
+
+#ifdef CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE
+            mwifi_fq_update();
+#endif /**< CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE */
+
             break;
         }
 
-#endif /**< CONFIG_MWIFI_WAIVE_ROOT */
-
         case MESH_EVENT_STARTED: {
             MDF_LOGI("MESH is started");
             s_disconnected_count = 0;
@@ -232,6 +634,11 @@ static void esp_mesh_event_cb(void *arg, esp_event_base_t event_base, int32_t ev
             MDF_LOGI("MESH is stopped");
             g_mwifi_started_flag = false;
             mwifi_connected_flag = false;
+            g_subnet_index.version++;
+
+#ifdef CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE
+            mwifi_fq_update();
+#endif /**< CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE */
 
             break;
         }
@@ -242,6 +649,7 @@ static void esp_mesh_event_cb(void *arg, esp_event_base_t event_base, int32_t ev
                      routing_table->rt_size_change,
                      routing_table->rt_size_new);
             g_waive_root_interval = MWIFI_WAIVE_ROOT_INTERVAL;
+            g_subnet_index.version++;
             break;
         }
 
@@ -250,9 +658,15 @@ static void esp_mesh_event_cb(void *arg, esp_event_base_t event_base, int32_t ev
             MDF_LOGI("Routing table is changed by removing leave children remove_num: %d, total_num: %d",
                      routing_table->rt_size_change,
                      routing_table->rt_size_new);
+            g_subnet_index.version++;
             break;
         }
 
+        case MESH_EVENT_CHILD_CONNECTED:
+        case MESH_EVENT_CHILD_DISCONNECTED:
+            g_subnet_index.version++;
+            break;
+
         case MESH_EVENT_TODS_STATE: {
             mesh_event_toDS_state_t *tdos_state = (mesh_event_toDS_state_t *)event_data;
             MDF_LOGI("State represents: %d", g_toDs_status_flag);
@@ -290,131 +704,576 @@ static void esp_mesh_event_cb(void *arg, esp_event_base_t event_base, int32_t ev
     evet_info_index = (evet_info_index + 1) % MWIFI_EVET_INFO_SIZE;
 }
 
-mdf_err_t mwifi_init(const mwifi_init_config_t *config)
+/**
+ * @brief Allocate a receive buffer from the pool that fits, fall back to the heap
+ *        when the size is too large or all the blocks are in use.
+ */
+static uint8_t *mwifi_buffer_alloc(size_t size)
 {
-    MDF_PARAM_CHECK(config);
-    MDF_ERROR_CHECK(g_mwifi_inited_flag, MDF_ERR_MWIFI_INITED, "Mwifi has been initialized");
+    uint8_t *buffer = NULL;
 
-    MDF_LOGI("esp-mdf version: %s", mdf_get_version());
+    if (size <= MWIFI_PAYLOAD_LEN) {
+        buffer = mdf_mem_pool_alloc(g_recv_pool_small);
+    }
 
-    if (!g_init_config) {
-        g_init_config = MDF_CALLOC(1, sizeof(mwifi_init_config_t));
-        MDF_ERROR_CHECK(!g_init_config, MDF_ERR_NO_MEM, "");
+    if (!buffer && size <= MWIFI_RECV_BUFFER_LARGE_SIZE) {
+        buffer = mdf_mem_pool_alloc(g_recv_pool_large);
     }
 
-    if (!g_ap_config) {
-        g_ap_config = MDF_CALLOC(1, sizeof(mwifi_config_t));
-        MDF_ERROR_CHECK(!g_ap_config, MDF_ERR_NO_MEM, "");
+    if (!buffer) {
+        buffer = MDF_MALLOC(size);
     }
 
-    memcpy(g_init_config, config, sizeof(mwifi_init_config_t));
-    g_mwifi_inited_flag = true;
+    return buffer;
+}
 
-    /**< Mesh initialization */
-    return esp_mesh_init();
+static void mwifi_buffer_free(uint8_t **buffer)
+{
+    if (mdf_mem_pool_contains(g_recv_pool_small, *buffer)) {
+        mdf_mem_pool_free(g_recv_pool_small, *buffer);
+    } else if (mdf_mem_pool_contains(g_recv_pool_large, *buffer)) {
+        mdf_mem_pool_free(g_recv_pool_large, *buffer);
+    } else {
+        MDF_FREE(*buffer);
+    }
+
+    *buffer = NULL;
 }
 
-void mwifi_print_config()
+void mwifi_read_release(void *data)
 {
-    if (!g_mwifi_inited_flag) {
-        MDF_LOGW("Mwifi is not initialized");
-        return;
+    uint8_t *buffer = data;
+    mwifi_buffer_free(&buffer);
+}
+
+/**
+ * @brief Compress with the cached deflate context, same as `compress()` otherwise.
+ *
+ *        With `dict` the preset dictionary is compressed first to fill the history
+ *        of the compressor and its output is dropped, so the data can refer to
+ *        the dictionary. The zlib trailer covers the dictionary and the data.
+ */
+static int mwifi_compress(uint8_t *dest, size_t *dest_size, const uint8_t *src, size_t src_size, bool dict)
+{
+    int mz_ret          = MZ_OK;
+    size_t dict_size    = 0;
+    mz_stream *stream   = &g_deflate_stream.stream;
+
+    xSemaphoreTake(g_deflate_stream.lock, portMAX_DELAY);
+
+    if (!g_deflate_stream.inited) {
+        memset(stream, 0, sizeof(mz_stream));
+        mz_ret = deflateInit(stream, CONFIG_MWIFI_COMPRESS_LEVEL);
+        MDF_ERROR_GOTO(mz_ret != MZ_OK, EXIT, "<%s> deflateInit", mz_error(mz_ret));
+        g_deflate_stream.inited = true;
+    } else {
+        deflateReset(stream);
     }
 
-    mesh_cfg_t cfg                     = {0};
-    mesh_attempts_t attempts           = {0};
-    int beacon_interval                = 0;
-    mesh_switch_parent_t switch_parent = {0};
-    mesh_rssi_threshold_t rssi_threshoud = {0};
-    const char *bool_str[]             = {"false", "true"};
-    const char *mesh_type_str[]        = {"idle", "root", "node", "leaf", "root_sta"};
+    if (dict) {
+        uint8_t discard[64];
+        stream->next_in  = (const uint8_t *)g_compress_dict;
+        stream->avail_in = sizeof(g_compress_dict) - 1;
 
-    ESP_ERROR_CHECK(esp_mesh_get_config(&cfg));
-    ESP_ERROR_CHECK(esp_mesh_get_attempts(&attempts));
-    ESP_ERROR_CHECK(esp_mesh_get_switch_parent_paras(&switch_parent));
-    ESP_ERROR_CHECK(esp_mesh_get_rssi_threshold(&rssi_threshoud));
+        /**< The sync flush ends the dictionary on a byte boundary */
+        do {
+            stream->next_out  = discard;
+            stream->avail_out = sizeof(discard);
+            mz_ret = deflate(stream, MZ_SYNC_FLUSH);
+        } while (mz_ret == MZ_OK && !stream->avail_out);
 
-    MDF_LOGI("**************** Root config ****************");
-    MDF_LOGI("vote_percentage       : %0.2f", esp_mesh_get_vote_percentage());
-    MDF_LOGI("vote_max_count        : %d", attempts.vote);
-    MDF_LOGI("backoff_rssi          : %d", switch_parent.backoff_rssi);
-    MDF_LOGI("scan_min_count        : %d", attempts.scan);
-    MDF_LOGI("attempt_count         : %d", attempts.fail);
-    MDF_LOGI("monitor_ie_count      : %d", attempts.monitor_ie);
-    MDF_LOGI("root_healing_ms       : %d", esp_mesh_get_root_healing_delay());
-    MDF_LOGI("root_conflicts_enable : %s", bool_str[esp_mesh_is_root_conflicts_allowed()]);
-    MDF_LOGI("fix_root_enable       : %s", bool_str[esp_mesh_is_root_fixed()]);
+        MDF_ERROR_GOTO(mz_ret != MZ_OK || stream->avail_in, EXIT, "<%s> Compress dictionary", mz_error(mz_ret));
+        dict_size = stream->total_out;
+    }
 
-    MDF_LOGI("****************  Capacity   ****************");
-    MDF_LOGI("max_layer             : %d", esp_mesh_get_max_layer());
-    MDF_LOGI("max_connection        : %d", cfg.mesh_ap.max_connection);
-    MDF_LOGI("capacity_num          : %d", esp_mesh_get_capacity_num());
-    MDF_LOGI("topology              : %d", esp_mesh_get_topology());
+    stream->next_in   = src;
+    stream->avail_in  = src_size;
+    stream->next_out  = dest;
+    stream->avail_out = *dest_size;
 
-    MDF_LOGI("****************  Stability  ****************");
-    MDF_LOGI("assoc_expire_ms       : %d", esp_mesh_get_ap_assoc_expire() * 1000);
-    ESP_ERROR_CHECK(esp_mesh_get_beacon_interval(&beacon_interval));
-    MDF_LOGI("beacon_interval_ms    : %d", beacon_interval);
-    MDF_LOGI("passive_scan_ms       : %d", esp_mesh_get_passive_scan_time());
-    MDF_LOGI("monitor_duration_ms   : %d", switch_parent.duration_ms);
-    MDF_LOGI("cnx_rssi              : %d", switch_parent.cnx_rssi);
-    MDF_LOGI("select_rssi           : %d", switch_parent.select_rssi);
-    MDF_LOGI("switch_rssi           : %d", switch_parent.switch_rssi);
-    MDF_LOGI("rssi_threshoud_high   : %d", rssi_threshoud.high);
-    MDF_LOGI("rssi_threshoud_medium : %d", rssi_threshoud.medium);
-    MDF_LOGI("rssi_threshoud_low    : %d", rssi_threshoud.low);
+    mz_ret = deflate(stream, MZ_FINISH);
+    *dest_size = stream->total_out - dict_size;
+    mz_ret = (mz_ret == MZ_STREAM_END) ? MZ_OK : (mz_ret == MZ_OK) ? MZ_BUF_ERROR : mz_ret;
 
-    MDF_LOGI("**************** Transmission ****************");
-    MDF_LOGI("xon_qsize             : %d", esp_mesh_get_xon_qsize());
-    MDF_LOGI("retransmit_enable     : %s", bool_str[g_init_config->retransmit_enable]);
+#ifndef CONFIG_MWIFI_COMPRESS_CONTEXT_CACHE
+    deflateEnd(stream);
+    g_deflate_stream.inited = false;
+#endif /**< CONFIG_MWIFI_COMPRESS_CONTEXT_CACHE */
 
-    MDF_LOGI("**************** Router info  ****************");
-    MDF_LOGI("ssid                  : %s", cfg.router.ssid);
-    MDF_LOGI("password              : %s", cfg.router.password);
-    MDF_LOGI("bssid                 : " MACSTR, MAC2STR(cfg.router.bssid));
-    MDF_LOGI("mesh_type             : %s", mesh_type_str[g_ap_config->mesh_type]);
-    MDF_LOGI("mesh_id               : " MACSTR, MAC2STR(cfg.mesh_id.addr));
-    MDF_LOGI("mesh_password         : %s", cfg.mesh_ap.password);
-    MDF_LOGI("mesh_authmode         : %d", esp_mesh_get_ap_authmode());
-    MDF_LOGI("channel               : %d", cfg.channel);
-    MDF_LOGI("allow_router_switch   : %s", bool_str[cfg.router.allow_router_switch]);
-    MDF_LOGI("allow_channel_switch  : %s", bool_str[cfg.allow_channel_switch]);
+EXIT:
+    xSemaphoreGive(g_deflate_stream.lock);
+    return mz_ret;
 }
 
-mdf_err_t mwifi_start()
+/**
+ * @brief Feed the preset dictionary to the decompressor as a zlib header and a stored block,
+ *        the history is then the same as the one of the compressor after the dictionary.
+ */
+static int mwifi_inflate_dict(mz_stream *stream)
 {
-    if (mwifi_is_started()) {
-        return MDF_OK;
-    }
-
-    MDF_ERROR_CHECK(!g_mwifi_inited_flag, MDF_ERR_MWIFI_NOT_INIT, "Mwifi isn't initialized");
-    MDF_ERROR_CHECK(!g_ap_config, MDF_ERR_MWIFI_NO_CONFIG, "Config information is not set");
+    int mz_ret          = MZ_OK;
+    uint8_t discard[64] = {0};
+    uint16_t dict_len   = sizeof(g_compress_dict) - 1;
+    const uint8_t prefix[] = {
+        0x18, 0x19,                          /**< zlib header with a 512 bytes window */
+        0x00,                                /**< Stored block, not the last one */
+        dict_len & 0xff, dict_len >> 8,
+        ~dict_len & 0xff, (~dict_len >> 8) & 0xff,
+    };
+    const struct {
+        const uint8_t *data;
+        size_t size;
+    } input[] = {
+        {prefix, sizeof(prefix)},
+        {(const uint8_t *)g_compress_dict, dict_len},
+    };
 
-    mesh_cfg_t mesh_config             = MESH_INIT_CONFIG_DEFAULT();
-    mwifi_config_t *ap_config          = g_ap_config;
-    mwifi_init_config_t *init_config   = g_init_config;
-    mesh_attempts_t attempts           = {0};
-    mesh_switch_parent_t switch_parent = {0};
-    mesh_rssi_threshold_t rssi_threshoud = MWIFI_RSSI_THRESHOUD_DEFAULT();
+    for (int i = 0; i < sizeof(input) / sizeof(input[0]) && mz_ret == MZ_OK; ++i) {
+        stream->next_in  = input[i].data;
+        stream->avail_in = input[i].size;
 
-    /** Mesh initialization
-     *  - Check whether Wi-Fi is started.
-     *  - Initialize mesh global variables with default values.
-     */
-    ESP_ERROR_CHECK(esp_mesh_init());
+        do {
+            stream->next_out  = discard;
+            stream->avail_out = sizeof(discard);
+            mz_ret = inflate(stream, MZ_SYNC_FLUSH);
+        } while (mz_ret == MZ_OK && (stream->avail_in || !stream->avail_out));
 
-    switch (ap_config->mesh_type) {
-        case MESH_NODE:
-            /** Enable network Fixed Root Setting
-                 *  - Enabling fixed root disables automatic election of the root node via voting.
-                 *  - All devices in the network shall use the same Fixed Root Setting (enabled or disabled).
-                 *  - If Fixed Root is enabled, users should make sure a root node is designated for the network.
-                 */
-            ESP_ERROR_CHECK(esp_mesh_fix_root(true));
-            break;
+        /**< No more output until more input is supplied */
+        mz_ret = (mz_ret == MZ_BUF_ERROR && !stream->avail_in) ? MZ_OK : mz_ret;
+    }
 
-        case MESH_IDLE:
-            break;
+    return mz_ret;
+}
+
+/**
+ * @brief Uncompress with the cached inflate context, same as `uncompress()` otherwise.
+ *        `dict` must match the one used by mwifi_compress().
+ */
+static int mwifi_uncompress(uint8_t *dest, size_t *dest_size, const uint8_t *src, size_t src_size, bool dict)
+{
+    int mz_ret        = MZ_OK;
+    size_t dict_size  = 0;
+    mz_stream *stream = &g_inflate_stream.stream;
+
+    xSemaphoreTake(g_inflate_stream.lock, portMAX_DELAY);
+
+    if (!g_inflate_stream.inited) {
+        memset(stream, 0, sizeof(mz_stream));
+        mz_ret = inflateInit(stream);
+        MDF_ERROR_GOTO(mz_ret != MZ_OK, EXIT, "<%s> inflateInit", mz_error(mz_ret));
+        g_inflate_stream.inited = true;
+    } else {
+        inflateReset(stream);
+    }
+
+    if (dict) {
+        mz_ret = mwifi_inflate_dict(stream);
+        MDF_ERROR_GOTO(mz_ret != MZ_OK, EXIT, "<%s> Uncompress dictionary", mz_error(mz_ret));
+        dict_size = stream->total_out;
+    }
+
+    stream->next_in   = src;
+    stream->avail_in  = src_size;
+    stream->next_out  = dest;
+    stream->avail_out = *dest_size;
+
+    mz_ret = inflate(stream, MZ_FINISH);
+    *dest_size = stream->total_out - dict_size;
+
+    if (mz_ret == MZ_STREAM_END) {
+        mz_ret = MZ_OK;
+    } else if (mz_ret == MZ_BUF_ERROR && !stream->avail_in) {
+        mz_ret = MZ_DATA_ERROR;
+    } else if (mz_ret == MZ_OK) {
+        mz_ret = MZ_BUF_ERROR;
+    }
+
+#ifndef CONFIG_MWIFI_COMPRESS_CONTEXT_CACHE
+    inflateEnd(stream);
+    g_inflate_stream.inited = false;
+#endif /**< CONFIG_MWIFI_COMPRESS_CONTEXT_CACHE */
+
+EXIT:
+    xSemaphoreGive(g_inflate_stream.lock);
+    return mz_ret;
+}
+
+static void mwifi_zstream_free(void)
+{
+    if (g_deflate_stream.inited) {
+        deflateEnd(&g_deflate_stream.stream);
+        g_deflate_stream.inited = false;
+    }
+
+    if (g_inflate_stream.inited) {
+        inflateEnd(&g_inflate_stream.stream);
+        g_inflate_stream.inited = false;
+    }
+}
+
+/**
+ * @brief Uncompress into a buffer allocated internally. Packets from earlier versions
+ *        don't carry the uncompressed size, the buffer grows from the estimated
+ *        compression rate until it fits.
+ */
+static int mwifi_uncompress_alloc(uint8_t **dest, size_t *dest_size, const uint8_t *src,
+                                  size_t src_size, const mwifi_data_head_t *data_head, bool pool)
+{
+    int mz_ret = MZ_BUF_ERROR;
+
+    /**< The uncompressed size is known, uncompress exactly once */
+    if (data_head->uncompressed_size) {
+        *dest_size = data_head->uncompressed_size;
+        *dest      = pool ? mwifi_buffer_alloc(*dest_size) : MDF_REALLOC_RETRY(*dest, *dest_size);
+
+        if (!*dest) {
+            return MZ_MEM_ERROR;
+        }
+
+        mz_ret = mwifi_uncompress(*dest, dest_size, src, src_size, data_head->compress_dict);
+
+        if (mz_ret != MZ_OK && pool) {
+            mwifi_buffer_free(dest);
+        } else if (mz_ret != MZ_OK) {
+            MDF_FREE(*dest);
+        }
+
+        return mz_ret;
+    }
+
+    /**< Most packets fit in a large block of the pool */
+    if (pool && (*dest = mdf_mem_pool_alloc(g_recv_pool_large))) {
+        *dest_size = mdf_mem_pool_get_block_size(g_recv_pool_large);
+        mz_ret     = mwifi_uncompress(*dest, dest_size, src, src_size, false);
+
+        if (mz_ret == MZ_OK) {
+            return mz_ret;
+        }
+
+        mdf_mem_pool_free(g_recv_pool_large, *dest);
+        *dest = NULL;
+    }
+
+    for (int mz_rate = data_head->compress_rate ? data_head->compress_rate : 5;
+            mz_ret == MZ_BUF_ERROR; mz_rate += 2) {
+        *dest_size = src_size * mz_rate;
+        *dest      = MDF_REALLOC_RETRY(*dest, *dest_size);
+        mz_ret     = mwifi_uncompress(*dest, dest_size, src, src_size, false);
+    }
+
+    if (mz_ret != MZ_OK) {
+        MDF_FREE(*dest);
+    }
+
+    return mz_ret;
+}
+
+static void mwifi_reassembly_free(uint8_t *buffer)
+{
+    mwifi_buffer_free(&buffer);
+}
+
+static void mwifi_reassembly_drop_cb(const uint8_t *src_addr, size_t recv_size, size_t total_size)
+{
+    MWIFI_STATS_ADD(src_addr, rx_reassembly_drops, 1);
+    MDF_LOGW("Part of the packet is lost, src_addr: " MACSTR ", recv_size: %zu, total_size: %zu",
+             MAC2STR(src_addr), recv_size, total_size);
+}
+
+static mdf_err_t mwifi_reassembly_create(mwifi_reassembly_t *reassembly)
+{
+    mdf_reassembly_config_t config = {
+        .slot_num      = CONFIG_MWIFI_REASSEMBLY_SLOT_NUM,
+        .timeout_ms    = CONFIG_MWIFI_REASSEMBLY_TIMEOUT_MS,
+        .fragment_size = MWIFI_PAYLOAD_LEN,
+        .head_size     = MWIFI_DATA_HEAD_LEN,
+#ifdef CONFIG_MWIFI_LEGACY_REASSEMBLY
+        .legacy        = true,
+#endif /**< CONFIG_MWIFI_LEGACY_REASSEMBLY */
+        .alloc         = mwifi_buffer_alloc,
+        .free          = mwifi_reassembly_free,
+        .drop_cb       = mwifi_reassembly_drop_cb,
+    };
+
+    if (!reassembly->table) {
+        reassembly->table = mdf_reassembly_create(&config);
+        MDF_ERROR_CHECK(!reassembly->table, MDF_ERR_NO_MEM, "");
+    }
+
+    return MDF_OK;
+}
+
+static void mwifi_reassembly_clear(mwifi_reassembly_t *reassembly)
+{
+    mdf_reassembly_clear(reassembly->table);
+    mdf_dedup_reset(reassembly->dedup);
+}
+
+/**
+ * @brief Put a fragment into the reassembly table, see mdf_reassembly_put().
+ *        The header of the complete packet is copied back to `data_head`.
+ *
+ * @return
+ *    - true: The packet is complete, the ownership of `*packet` passes to the caller
+ *    - false: The packet is incomplete or the fragment is dropped
+ */
+static bool mwifi_reassembly_put(mwifi_reassembly_t *reassembly, uint8_t *src_addr,
+                                 mwifi_data_head_t *data_head, const uint8_t *data, size_t size,
+                                 uint8_t **packet, size_t *packet_size)
+{
+    size_t total_size = (data_head->total_size_hight << 12) + data_head->total_size_low;
+
+    if (!mdf_reassembly_put(reassembly->table, src_addr, data_head->magic, data_head->packet_seq,
+                            total_size, data, size, data_head, packet)) {
+        return false;
+    }
+
+    *packet_size = total_size;
+    return true;
+}
+
+mdf_err_t mwifi_init(const mwifi_init_config_t *config)
+{
+    MDF_PARAM_CHECK(config);
+    MDF_ERROR_CHECK(g_mwifi_inited_flag, MDF_ERR_MWIFI_INITED, "Mwifi has been initialized");
+
+    MDF_LOGI("esp-mdf version: %s", mdf_get_version());
+
+    if (!g_init_config) {
+        g_init_config = MDF_CALLOC(1, sizeof(mwifi_init_config_t));
+        MDF_ERROR_CHECK(!g_init_config, MDF_ERR_NO_MEM, "");
+    }
+
+    if (!g_ap_config) {
+        g_ap_config = MDF_CALLOC(1, sizeof(mwifi_config_t));
+        MDF_ERROR_CHECK(!g_ap_config, MDF_ERR_NO_MEM, "");
+    }
+
+    MDF_ERROR_CHECK(mwifi_reassembly_create(&g_read_reassembly) != MDF_OK, MDF_ERR_NO_MEM, "");
+    MDF_ERROR_CHECK(mwifi_reassembly_create(&g_root_read_reassembly) != MDF_OK, MDF_ERR_NO_MEM, "");
+
+    if (!g_recv_pool_small && CONFIG_MWIFI_RECV_POOL_SMALL_NUM > 0) {
+        g_recv_pool_small = mdf_mem_pool_create(MWIFI_PAYLOAD_LEN, CONFIG_MWIFI_RECV_POOL_SMALL_NUM);
+        MDF_ERROR_CHECK(!g_recv_pool_small, MDF_ERR_NO_MEM, "");
+    }
+
+    if (!g_recv_pool_large && CONFIG_MWIFI_RECV_POOL_LARGE_NUM > 0) {
+        g_recv_pool_large = mdf_mem_pool_create(MWIFI_RECV_BUFFER_LARGE_SIZE, CONFIG_MWIFI_RECV_POOL_LARGE_NUM);
+        MDF_ERROR_CHECK(!g_recv_pool_large, MDF_ERR_NO_MEM, "");
+    }
+
+    if (!g_deflate_stream.lock) {
+        g_deflate_stream.lock = xSemaphoreCreateMutex();
+        MDF_ERROR_CHECK(!g_deflate_stream.lock, MDF_ERR_NO_MEM, "");
+    }
+
+    if (!g_inflate_stream.lock) {
+        g_inflate_stream.lock = xSemaphoreCreateMutex();
+        MDF_ERROR_CHECK(!g_inflate_stream.lock, MDF_ERR_NO_MEM, "");
+    }
+
+    if (!g_subnet_index.lock) {
+        g_subnet_index.lock = xSemaphoreCreateMutex();
+        MDF_ERROR_CHECK(!g_subnet_index.lock, MDF_ERR_NO_MEM, "");
+    }
+
+#ifdef CONFIG_MWIFI_DATA_HEAD_EXT_LEARN
+
+    if (!g_ext_peer.lock) {
+        g_ext_peer.lock = xSemaphoreCreateMutex();
+        MDF_ERROR_CHECK(!g_ext_peer.lock, MDF_ERR_NO_MEM, "");
+    }
+
+#endif /**< CONFIG_MWIFI_DATA_HEAD_EXT_LEARN */
+
+    if (!g_coalesce_tx.lock) {
+        g_coalesce_tx.lock = xSemaphoreCreateMutex();
+        MDF_ERROR_CHECK(!g_coalesce_tx.lock, MDF_ERR_NO_MEM, "");
+    }
+
+    if (!g_coalesce_rx.lock) {
+        g_coalesce_rx.lock = xSemaphoreCreateMutex();
+        MDF_ERROR_CHECK(!g_coalesce_rx.lock, MDF_ERR_NO_MEM, "");
+    }
+
+    if (!g_coalesce_read_rx.lock) {
+        g_coalesce_read_rx.lock = xSemaphoreCreateMutex();
+        MDF_ERROR_CHECK(!g_coalesce_read_rx.lock, MDF_ERR_NO_MEM, "");
+    }
+
+#ifdef CONFIG_MWIFI_PS_BATCH_ENABLE
+
+    if (!g_ps_batcher.lock) {
+        g_ps_batcher.lock = xSemaphoreCreateMutex();
+        MDF_ERROR_CHECK(!g_ps_batcher.lock, MDF_ERR_NO_MEM, "");
+    }
+
+#endif /**< CONFIG_MWIFI_PS_BATCH_ENABLE */
+
+    if (!g_tx.lock) {
+        g_tx.lock = xSemaphoreCreateMutex();
+        MDF_ERROR_CHECK(!g_tx.lock, MDF_ERR_NO_MEM, "");
+    }
+
+    if (!g_tx.pending) {
+        g_tx.pending = xSemaphoreCreateCounting(UINT16_MAX, 0);
+        MDF_ERROR_CHECK(!g_tx.pending, MDF_ERR_NO_MEM, "");
+    }
+
+    if (!g_tx.task) {
+        g_tx.exit      = false;
+        g_tx.rate.rate = MWIFI_TX_RATE_MAX;
+        xTaskCreatePinnedToCore(mwifi_tx_task, "mwifi_tx", 3 * 1024,
+                                NULL, CONFIG_MDF_TASK_DEFAULT_PRIOTY,
+                                &g_tx.task, CONFIG_MDF_TASK_PINNED_TO_CORE);
+        MDF_ERROR_CHECK(!g_tx.task, MDF_ERR_NO_MEM, "Create the sender task");
+    }
+
+    if (!g_relay.queue) {
+        g_relay.queue = xQueueCreate(CONFIG_MWIFI_RELAY_QUEUE_SIZE, sizeof(mwifi_relay_packet_t));
+        MDF_ERROR_CHECK(!g_relay.queue, MDF_ERR_NO_MEM, "");
+    }
+
+    if (!g_relay.task) {
+        g_relay.exit = false;
+        xTaskCreatePinnedToCore(mwifi_relay_task, "mwifi_relay", 3 * 1024,
+                                NULL, CONFIG_MDF_TASK_DEFAULT_PRIOTY,
+                                &g_relay.task, CONFIG_MDF_TASK_PINNED_TO_CORE);
+        MDF_ERROR_CHECK(!g_relay.task, MDF_ERR_NO_MEM, "Create the relay task");
+    }
+
+    if (!g_read_reassembly.dedup) {
+        g_read_reassembly.dedup = mdf_dedup_create(MDF_DEDUP_ENTRY_NUM, MDF_DEDUP_AGING_MS);
+        MDF_ERROR_CHECK(!g_read_reassembly.dedup, MDF_ERR_NO_MEM, "");
+    }
+
+    if (!g_root_read_reassembly.dedup) {
+        g_root_read_reassembly.dedup = mdf_dedup_create(MDF_DEDUP_ENTRY_NUM, MDF_DEDUP_AGING_MS);
+        MDF_ERROR_CHECK(!g_root_read_reassembly.dedup, MDF_ERR_NO_MEM, "");
+    }
+
+#ifdef CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE
+    if (!g_fq.lock) {
+        g_fq.lock = xSemaphoreCreateMutex();
+        MDF_ERROR_CHECK(!g_fq.lock, MDF_ERR_NO_MEM, "");
+    }
+
+    if (!g_fq.pending) {
+        g_fq.pending = xSemaphoreCreateCounting(UINT16_MAX, 0);
+        MDF_ERROR_CHECK(!g_fq.pending, MDF_ERR_NO_MEM, "");
+    }
+
+    /**< The task filling the queues runs on the root only, see mwifi_fq_update() */
+#endif /**< CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE */
+
+    memcpy(g_init_config, config, sizeof(mwifi_init_config_t));
+    g_mwifi_inited_flag = true;
+
+    /**< Mesh initialization */
+    return esp_mesh_init();
+}
+
+void mwifi_print_config()
+{
+    if (!g_mwifi_inited_flag) {
+        MDF_LOGW("Mwifi is not initialized");
+        return;
+    }
+
+    mesh_cfg_t cfg                     = {0};
+    mesh_attempts_t attempts           = {0};
+    int beacon_interval                = 0;
+    mesh_switch_parent_t switch_parent = {0};
+    mesh_rssi_threshold_t rssi_threshoud = {0};
+    const char *bool_str[]             = {"false", "true"};
+    const char *mesh_type_str[]        = {"idle", "root", "node", "leaf", "root_sta"};
+
+    ESP_ERROR_CHECK(esp_mesh_get_config(&cfg));
+    ESP_ERROR_CHECK(esp_mesh_get_attempts(&attempts));
+    ESP_ERROR_CHECK(esp_mesh_get_switch_parent_paras(&switch_parent));
+    ESP_ERROR_CHECK(esp_mesh_get_rssi_threshold(&rssi_threshoud));
+
+    MDF_LOGI("**************** Root config ****************");
+    MDF_LOGI("vote_percentage       : %0.2f", esp_mesh_get_vote_percentage());
+    MDF_LOGI("vote_max_count        : %d", attempts.vote);
+    MDF_LOGI("backoff_rssi          : %d", switch_parent.backoff_rssi);
+    MDF_LOGI("scan_min_count        : %d", attempts.scan);
+    MDF_LOGI("attempt_count         : %d", attempts.fail);
+    MDF_LOGI("monitor_ie_count      : %d", attempts.monitor_ie);
+    MDF_LOGI("root_healing_ms       : %d", esp_mesh_get_root_healing_delay());
+    MDF_LOGI("root_conflicts_enable : %s", bool_str[esp_mesh_is_root_conflicts_allowed()]);
+    MDF_LOGI("fix_root_enable       : %s", bool_str[esp_mesh_is_root_fixed()]);
+
+    MDF_LOGI("****************  Capacity   ****************");
+    MDF_LOGI("max_layer             : %d", esp_mesh_get_max_layer());
+    MDF_LOGI("max_connection        : %d", cfg.mesh_ap.max_connection);
+    MDF_LOGI("capacity_num          : %d", esp_mesh_get_capacity_num());
+    MDF_LOGI("topology              : %d", esp_mesh_get_topology());
+
+    MDF_LOGI("****************  Stability  ****************");
+    MDF_LOGI("assoc_expire_ms       : %d", esp_mesh_get_ap_assoc_expire() * 1000);
+    ESP_ERROR_CHECK(esp_mesh_get_beacon_interval(&beacon_interval));
+    MDF_LOGI("beacon_interval_ms    : %d", beacon_interval);
+    MDF_LOGI("passive_scan_ms       : %d", esp_mesh_get_passive_scan_time());
+    MDF_LOGI("monitor_duration_ms   : %d", switch_parent.duration_ms);
+    MDF_LOGI("cnx_rssi              : %d", switch_parent.cnx_rssi);
+    MDF_LOGI("select_rssi           : %d", switch_parent.select_rssi);
+    MDF_LOGI("switch_rssi           : %d", switch_parent.switch_rssi);
+    MDF_LOGI("rssi_threshoud_high   : %d", rssi_threshoud.high);
+    MDF_LOGI("rssi_threshoud_medium : %d", rssi_threshoud.medium);
+    MDF_LOGI("rssi_threshoud_low    : %d", rssi_threshoud.low);
+
+    MDF_LOGI("**************** Transmission ****************");
+    MDF_LOGI("xon_qsize             : %d", esp_mesh_get_xon_qsize());
+    MDF_LOGI("retransmit_enable     : %s", bool_str[g_init_config->retransmit_enable]);
+
+    MDF_LOGI("**************** Router info  ****************");
+    MDF_LOGI("ssid                  : %s", cfg.router.ssid);
+    MDF_LOGI("password              : %s", cfg.router.password);
+    MDF_LOGI("bssid                 : " MACSTR, MAC2STR(cfg.router.bssid));
+    MDF_LOGI("mesh_type             : %s", mesh_type_str[g_ap_config->mesh_type]);
+    MDF_LOGI("mesh_id               : " MACSTR, MAC2STR(cfg.mesh_id.addr));
+    MDF_LOGI("mesh_password         : %s", cfg.mesh_ap.password);
+    MDF_LOGI("mesh_authmode         : %d", esp_mesh_get_ap_authmode());
+    MDF_LOGI("channel               : %d", cfg.channel);
+    MDF_LOGI("allow_router_switch   : %s", bool_str[cfg.router.allow_router_switch]);
+    MDF_LOGI("allow_channel_switch  : %s", bool_str[cfg.allow_channel_switch]);
+}
+
+mdf_err_t mwifi_start()
+{
+    if (mwifi_is_started()) {
+        return MDF_OK;
+    }
+
+    MDF_ERROR_CHECK(!g_mwifi_inited_flag, MDF_ERR_MWIFI_NOT_INIT, "Mwifi isn't initialized");
+    MDF_ERROR_CHECK(!g_ap_config, MDF_ERR_MWIFI_NO_CONFIG, "Config information is not set");
+
+    mesh_cfg_t mesh_config             = MESH_INIT_CONFIG_DEFAULT();
+    mwifi_config_t *ap_config          = g_ap_config;
+    mwifi_init_config_t *init_config   = g_init_config;
+    mesh_attempts_t attempts           = {0};
+    mesh_switch_parent_t switch_parent = {0};
+    mesh_rssi_threshold_t rssi_threshoud = MWIFI_RSSI_THRESHOUD_DEFAULT();
+
+    /** Mesh initialization
+     *  - Check whether Wi-Fi is started.
+     *  - Initialize mesh global variables with default values.
+     */
+    ESP_ERROR_CHECK(esp_mesh_init());
+
+    switch (ap_config->mesh_type) {
+        case MESH_NODE:
+            /** Enable network Fixed Root Setting
+                 *  - Enabling fixed root disables automatic election of the root node via voting.
+                 *  - All devices in the network shall use the same Fixed Root Setting (enabled or disabled).
+                 *  - If Fixed Root is enabled, users should make sure a root node is designated for the network.
+                 */
+            ESP_ERROR_CHECK(esp_mesh_fix_root(true));
+            break;
+
+        case MESH_IDLE:
+            break;
 
         default:
             /** Designate device type over the mesh network
@@ -583,9 +1442,56 @@ mdf_err_t mwifi_deinit()
     MDF_ERROR_CHECK(!g_mwifi_inited_flag, MDF_ERR_MWIFI_NOT_INIT, "Mwifi isn't initialized");
     g_mwifi_inited_flag = false;
 
+    mwifi_relay_stop();
+#ifdef CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE
+    mwifi_fq_stop();
+#endif /**< CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE */
+
     MDF_FREE(g_init_config);
     MDF_FREE(g_ap_config);
 
+    mwifi_reassembly_clear(&g_read_reassembly);
+    mwifi_reassembly_clear(&g_root_read_reassembly);
+    mwifi_buffer_free(&g_coalesce_rx.data);
+    mwifi_buffer_free(&g_coalesce_read_rx.data);
+
+    mdf_mem_pool_delete(g_recv_pool_small);
+    g_recv_pool_small = NULL;
+    mdf_mem_pool_delete(g_recv_pool_large);
+    g_recv_pool_large = NULL;
+
+    mwifi_zstream_free();
+    mwifi_tx_stop();
+
+    g_subnet_index.built      = false;
+    g_subnet_index.table_size = 0;
+    g_subnet_index.nodes_size = 0;
+    MDF_FREE(g_subnet_index.table);
+    MDF_FREE(g_subnet_index.nodes);
+
+    if (g_coalesce_tx.timer) {
+        xTimerDelete(g_coalesce_tx.timer, portMAX_DELAY);
+        g_coalesce_tx.timer = NULL;
+    }
+
+    g_coalesce_tx.size = 0;
+    MDF_FREE(g_coalesce_tx.data);
+
+#ifdef CONFIG_MWIFI_PS_BATCH_ENABLE
+
+    if (g_ps_batcher.timer) {
+        xTimerDelete(g_ps_batcher.timer, portMAX_DELAY);
+        g_ps_batcher.timer = NULL;
+    }
+
+    /**< The held messages are lost with the network */
+    for (int i = 0; i < CONFIG_MWIFI_PS_BATCH_DEST_NUM; ++i) {
+        g_ps_batcher.batch[i].size = 0;
+        MDF_FREE(g_ps_batcher.batch[i].data);
+    }
+
+#endif /**< CONFIG_MWIFI_PS_BATCH_ENABLE */
+
     ESP_ERROR_CHECK(esp_mesh_deinit());
 
     return MDF_OK;
@@ -638,177 +1544,1113 @@ mdf_err_t mwifi_get_config(mwifi_config_t *config)
     return MDF_OK;
 }
 
-static bool addrs_remove(mesh_addr_t *addrs_list, size_t *addrs_num, const mesh_addr_t *addr)
+static size_t mwifi_iov_size(const mwifi_iovec_t *iov, size_t iovcnt)
 {
-    for (int i = 0; i < *addrs_num; i++) {
-        if (!memcmp(addrs_list + i, addr, sizeof(mesh_addr_t))) {
-            if (--(*addrs_num)) {
-                memcpy(addrs_list + i, addrs_list + i + 1, (*addrs_num - i) * MWIFI_ADDR_LEN);
-            }
+    size_t size = 0;
 
-            return true;
-        }
+    for (int i = 0; i < iovcnt; ++i) {
+        size += iov[i].size;
+    }
+
+    return size;
+}
+
+/**
+ * @brief Get the fragment [offset, offset + size) of a scatter-gather list.
+ *        If the fragment lies within a single element, the caller's buffer is
+ *        returned directly, otherwise the fragment is gathered into `scratch`.
+ */
+static uint8_t *mwifi_iov_fragment(const mwifi_iovec_t *iov, size_t iovcnt,
+                                   size_t offset, size_t size, uint8_t *scratch)
+{
+    size_t copied_size = 0;
+
+    for (; iovcnt > 0 && offset >= iov->size; iov++, iovcnt--) {
+        offset -= iov->size;
+    }
+
+    if (iovcnt > 0 && offset + size <= iov->size) {
+        return (uint8_t *)iov->data + offset;
+    }
+
+    for (; iovcnt > 0 && copied_size < size; iov++, iovcnt--, offset = 0) {
+        size_t segment_size = MIN(iov->size - offset, size - copied_size);
+        memcpy(scratch + copied_size, (uint8_t *)iov->data + offset, segment_size);
+        copied_size += segment_size;
+    }
+
+    return scratch;
+}
+
+#ifdef CONFIG_MWIFI_DATA_HEAD_EXT_LEARN
+
+/**
+ * @brief Check whether a device is known to read the header extension
+ */
+static bool mwifi_ext_peer_find(const uint8_t *addr)
+{
+    bool found = false;
+
+    xSemaphoreTake(g_ext_peer.lock, portMAX_DELAY);
+
+    for (int i = 0; i < MWIFI_EXT_PEER_NUM && !found; ++i) {
+        found = !memcmp(g_ext_peer.addr[i], addr, MWIFI_ADDR_LEN);
+    }
+
+    xSemaphoreGive(g_ext_peer.lock);
+
+    return found;
+}
+
+/**
+ * @brief Remember a device that sent a packet with the header extension
+ */
+static void mwifi_ext_peer_add(const uint8_t *addr)
+{
+    if (mwifi_ext_peer_find(addr)) {
+        return;
+    }
+
+    xSemaphoreTake(g_ext_peer.lock, portMAX_DELAY);
+    memcpy(g_ext_peer.addr[g_ext_peer.next], addr, MWIFI_ADDR_LEN);
+    g_ext_peer.next = (g_ext_peer.next + 1) % MWIFI_EXT_PEER_NUM;
+    xSemaphoreGive(g_ext_peer.lock);
+}
+
+#endif /**< CONFIG_MWIFI_DATA_HEAD_EXT_LEARN */
+
+/**
+ * @brief Check whether the receiver needs the header extension. Earlier versions don't know
+ *        the extension, a packet carrying it is only sent when they couldn't read it anyway,
+ *        or to a device known to read it. The priority and the uncompressed size are only
+ *        hints, they are dropped otherwise and the receiver takes MWIFI_PRIORITY_INTERACTIVE.
+ */
+static bool mwifi_data_head_ext_needed(const mesh_addr_t *dest_addr, const mwifi_data_head_t *data_head)
+{
+#ifdef CONFIG_MWIFI_DATA_HEAD_EXT_ALWAYS
+    return true;
+#else
+
+    if (data_head->type.stream || data_head->type.rpc || data_head->compress_dict || data_head->coalesced) {
+        return true;
     }
 
+#ifdef CONFIG_MWIFI_DATA_HEAD_EXT_LEARN
+
+    /**< Only the destination reads the packet, forwarded packets may reach earlier versions */
+    if (data_head->type.compression && data_head->uncompressed_size
+            && !data_head->transmit_num && !data_head->transmit_all) {
+        return mwifi_ext_peer_find(dest_addr->addr);
+    }
+
+    /**
+     * @brief The receiver reads the packet or relays it to the devices of the list,
+     *        in the class of the packet, and decides again for each of them
+     */
+    if (data_head->type.priority != MWIFI_PRIORITY_INTERACTIVE && !data_head->transmit_all) {
+        return mwifi_ext_peer_find(dest_addr->addr);
+    }
+
+#endif /**< CONFIG_MWIFI_DATA_HEAD_EXT_LEARN */
+
     return false;
+#endif /**< CONFIG_MWIFI_DATA_HEAD_EXT_ALWAYS */
 }
 
 /**
- * @brief Fragmenting packets for transmission
+ * @brief Take the header extension from the front of a reassembled packet,
+ *        or clear it if the sender didn't send one
  */
-static mdf_err_t mwifi_subcontract_write(const mesh_addr_t *dest_addr, const mesh_data_t *data,
-        int flag, const mesh_opt_t *opt)
+static mdf_err_t mwifi_data_head_ext_pull(const uint8_t *src_addr, mwifi_data_head_t *data_head,
+        uint8_t *data, size_t *size)
 {
-    mdf_err_t ret = MDF_OK;
-    static SemaphoreHandle_t s_mwifi_send_lock = NULL;
-    mwifi_data_head_t *data_head = (mwifi_data_head_t *)opt->val;
-    mesh_data_t mesh_data        = {0x0};
-    data_head->total_size_hight  = data->size >> 12;
-    data_head->total_size_low    = data->size & 0xfff;
-    data_head->packet_seq        = 0;
-    TickType_t wait_ticks        = (flag & MESH_DATA_NONBLOCK) ? 0 : portMAX_DELAY;
+    if (!data_head->type.reserved) {
+        memset(MWIFI_DATA_HEAD_EXT(data_head), 0, MWIFI_DATA_HEAD_EXT_LEN);
+        return MDF_OK;
+    }
+
+    MDF_ERROR_CHECK(*size < MWIFI_DATA_HEAD_EXT_LEN, MDF_ERR_INVALID_ARG,
+                    "The packet is shorter than the header extension, size: %zu", *size);
+
+    memcpy(MWIFI_DATA_HEAD_EXT(data_head), data, MWIFI_DATA_HEAD_EXT_LEN);
+    *size -= MWIFI_DATA_HEAD_EXT_LEN;
+    memmove(data, data + MWIFI_DATA_HEAD_EXT_LEN, *size);
+    data_head->type.reserved = false;
+
+#ifdef CONFIG_MWIFI_DATA_HEAD_EXT_LEARN
+    mwifi_ext_peer_add(src_addr);
+#endif /**< CONFIG_MWIFI_DATA_HEAD_EXT_LEARN */
+
+    return MDF_OK;
+}
+
+static size_t mwifi_tx_queue_index(const mesh_addr_t *addr)
+{
+    uint32_t hash = addr->addr[2] << 24 | addr->addr[3] << 16 | addr->addr[4] << 8 | addr->addr[5];
+    return ((hash * 2654435761U) >> 16) % MWIFI_TX_QUEUE_NUM;
+}
+
+/**
+ * @brief Get a semaphore to wait for a blocking packet, the semaphores are reused
+ */
+static SemaphoreHandle_t mwifi_tx_done_get()
+{
+    SemaphoreHandle_t done = NULL;
+
+    xSemaphoreTake(g_tx.lock, portMAX_DELAY);
+
+    if (g_tx.done_num > 0) {
+        done = g_tx.done_pool[--g_tx.done_num];
+    }
+
+    xSemaphoreGive(g_tx.lock);
+
+    return done ? done : xSemaphoreCreateBinary();
+}
+
+static void mwifi_tx_done_put(SemaphoreHandle_t done)
+{
+    xSemaphoreTake(g_tx.lock, portMAX_DELAY);
+
+    if (g_tx.done_num < MWIFI_TX_DONE_POOL_SIZE) {
+        g_tx.done_pool[g_tx.done_num++] = done;
+        done = NULL;
+    }
+
+    xSemaphoreGive(g_tx.lock);
+
+    if (done) {
+        vSemaphoreDelete(done);
+    }
+}
+
+#ifdef CONFIG_MWIFI_FLOW_CONTROL_ENABLE
+/**
+ * @brief Occupancy of the fullest ESP-WIFI-MESH queue of this node, in percent of its XON size,
+ *        of the transmit queues only unless `rx`
+ */
+static int mwifi_tx_occupancy(bool rx)
+{
+    mesh_tx_pending_t tx_pending = {0};
+    mesh_rx_pending_t rx_pending = {0};
+    int xon_qsize                = esp_mesh_get_xon_qsize();
+
+    if (esp_mesh_get_tx_pending(&tx_pending) != ESP_OK
+            || esp_mesh_get_rx_pending(&rx_pending) != ESP_OK || xon_qsize <= 0) {
+        return 0;
+    }
+
+    int pending = MAX(tx_pending.to_parent + tx_pending.to_parent_p2p,
+                      tx_pending.to_child + tx_pending.to_child_p2p);
+    pending     = rx ? MAX(pending, rx_pending.toDS + rx_pending.toSelf) : pending;
+
+    return pending * 100 / xon_qsize;
+}
+
+/**
+ * @brief Pace the next fragment with an AIMD rate controller, only called by the sender task.
+ *
+ *        The rate is halved when ESP-WIFI-MESH has no buffer, see mwifi_tx_rate_decrease(), and
+ *        cut by a quarter when its queues fill beyond MWIFI_TX_OCCUPANCY_HIGH, at most once per
+ *        queue drained at the current rate. It grows by MWIFI_TX_RATE_STEP per fragment while the
+ *        queues stay below MWIFI_TX_OCCUPANCY_LOW, and pacing stops once it reaches MWIFI_TX_RATE_MAX.
+ *
+ * @return Milliseconds waited
+ */
+static uint32_t mwifi_tx_rate_wait()
+{
+    mwifi_tx_rate_t *rate = &g_tx.rate;
+    int64_t now_us        = esp_timer_get_time();
+    int occupancy         = mwifi_tx_occupancy(true);
+    int64_t drain_us      = 1000000LL * esp_mesh_get_xon_qsize() / rate->rate;
+
+    if (occupancy >= MWIFI_TX_OCCUPANCY_HIGH && now_us - rate->decrease_us >= drain_us) {
+        rate->rate        = MAX(rate->rate * 3 / 4, MWIFI_TX_RATE_MIN);
+        rate->decrease_us = now_us;
+    } else if (occupancy < MWIFI_TX_OCCUPANCY_LOW) {
+        rate->rate = MIN(rate->rate + MWIFI_TX_RATE_STEP, MWIFI_TX_RATE_MAX);
+    }
+
+    if (rate->rate >= MWIFI_TX_RATE_MAX) {
+        rate->next_us = now_us;
+        return 0;
+    }
+
+    /**< Waits shorter than a tick are carried over, a sender idle for a while gets no burst */
+    rate->next_us = MAX(rate->next_us, now_us - portTICK_PERIOD_MS * 1000) + 1000000 / rate->rate;
+    uint32_t wait_ms = (rate->next_us - now_us) / 1000;
+
+    if (wait_ms < portTICK_PERIOD_MS) {
+        return 0;
+    }
 
-    memcpy(&mesh_data, data, sizeof(mesh_data_t));
+    vTaskDelay(wait_ms / portTICK_PERIOD_MS);
 
-    if (!s_mwifi_send_lock) {
-        s_mwifi_send_lock = xSemaphoreCreateMutex();
+    return wait_ms;
+}
+
+/**
+ * @brief Halve the rate after ESP_ERR_MESH_NO_MEMORY, only called by the sender task.
+ *        The buffers are shared by all the destinations, so the next fragment of
+ *        any packet waits for at least a tick.
+ */
+static void mwifi_tx_rate_decrease()
+{
+    mwifi_tx_rate_t *rate = &g_tx.rate;
+    int64_t now_us        = esp_timer_get_time();
+
+    rate->rate        = MAX(rate->rate / 2, MWIFI_TX_RATE_MIN);
+    rate->decrease_us = now_us;
+    rate->next_us     = MAX(rate->next_us, now_us + portTICK_PERIOD_MS * 1000);
+}
+#endif /**< CONFIG_MWIFI_FLOW_CONTROL_ENABLE */
+
+/**
+ * @brief Send the remaining fragments of a packet, only called by the sender task.
+ *
+ *        The fragments are sent without blocking. When ESP-WIFI-MESH has no room for the
+ *        next fragment, the packet keeps its position and is resumed later by the sender
+ *        task, which serves the other queues meanwhile.
+ *
+ * @return
+ *    - MDF_OK: All the fragments are sent
+ *    - ESP_ERR_MESH_QUEUE_FULL / ESP_ERR_MESH_NO_MEMORY: Send the packet again later
+ *    - others: The packet failed
+ */
+static mdf_err_t mwifi_tx_packet_send(mwifi_tx_packet_t *packet)
+{
+    mdf_err_t ret = MDF_OK;
+    static uint8_t s_fragment_buf[MWIFI_PAYLOAD_LEN]; /**< Only used by the sender task */
+    mwifi_data_head_t *data_head = &packet->data_head;
+    size_t ext_size              = data_head->type.reserved ? MWIFI_DATA_HEAD_EXT_LEN : 0;
+    size_t total_size            = ext_size + mwifi_iov_size(packet->iov, packet->iovcnt);
+    mesh_data_t mesh_data        = {.tos = packet->tos};
+    int flag                     = packet->flag | MESH_DATA_NONBLOCK;
+    data_head->total_size_hight  = total_size >> 12;
+    data_head->total_size_low    = total_size & 0xfff;
+
+    /**< A flooded packet keeps its magic on every hop, so that a node reached twice can drop it */
+    if (!packet->offset) {
+        packet->packet_magic = data_head->transmit_all && data_head->magic ? data_head->magic : esp_random();
     }
 
     /** Fragmenting packets for transmission
      *  - The maximum length allowed for each ESP-WIFI-MESH packet is MWIFI_PAYLOAD_LEN
+     *  - Fragments are taken from the caller's buffers without copying, unless
+     *    a fragment spans two elements of the scatter-gather list
      */
-    for (int unwritten_size = data->size; unwritten_size > 0;
-            unwritten_size -= MWIFI_PAYLOAD_LEN) {
-        data_head->magic = esp_random();
-        mesh_data.size   = MIN(unwritten_size, MWIFI_PAYLOAD_LEN);
+    for (; packet->offset < total_size; packet->offset += MWIFI_PAYLOAD_LEN) {
+        /**
+         * @brief The magic of each fragment is different, so that the receiver can filter
+         *        duplicate fragments, and the fragments of a packet can be associated by
+         *        subtracting the sequence from the magic.
+         */
+        data_head->packet_seq = packet->offset / MWIFI_PAYLOAD_LEN;
+        data_head->magic      = packet->packet_magic + data_head->packet_seq;
+        mesh_data.size        = MIN(total_size - packet->offset, MWIFI_PAYLOAD_LEN);
+
+        /**< The header extension is gathered in front of the first fragment */
+        if (!packet->offset && ext_size) {
+            uint8_t *payload = mwifi_iov_fragment(packet->iov, packet->iovcnt, 0,
+                                                  mesh_data.size - ext_size, s_fragment_buf + ext_size);
+            memmove(s_fragment_buf + ext_size, payload, mesh_data.size - ext_size);
+            memcpy(s_fragment_buf, MWIFI_DATA_HEAD_EXT(data_head), ext_size);
+            mesh_data.data = s_fragment_buf;
+        } else {
+            mesh_data.data = mwifi_iov_fragment(packet->iov, packet->iovcnt, packet->offset - ext_size,
+                                                mesh_data.size, s_fragment_buf);
+        }
+
+#ifdef CONFIG_MWIFI_FLOW_CONTROL_ENABLE
 
-        /**< Wait for other tasks to be sent before send ESP-WIFI-MESH data */
-        if (!xSemaphoreTake(s_mwifi_send_lock, wait_ticks)) {
-            return MDF_ERR_TIMEOUT;
+        /**
+         * @brief ESP-WIFI-MESH sends its queue in order, whatever the class. A bulk fragment waits
+         *        as if the queue was full, so that a control packet queued later doesn't find
+         *        a long queue of bulk fragments ahead of it.
+         */
+        if (data_head->type.priority == MWIFI_PRIORITY_BULK
+                && mwifi_tx_occupancy(false) >= CONFIG_MWIFI_TX_BULK_OCCUPANCY_MAX) {
+            MWIFI_STATS_ADD(packet->dest_addr.addr, tx_retries, 1);
+            return ESP_ERR_MESH_QUEUE_FULL;
         }
 
-        int retry_count = 3;
+        MWIFI_STATS_ADD(packet->dest_addr.addr, tx_paced_ms, mwifi_tx_rate_wait());
+#endif /**< CONFIG_MWIFI_FLOW_CONTROL_ENABLE */
 
-        do {
-            /**< Send a packet over the mesh network */
-            ret = esp_mesh_send(dest_addr, &mesh_data, flag, opt, 1);
+        /**< Send a packet over the mesh network */
+        ret = esp_mesh_send(&packet->dest_addr, &mesh_data, flag, &packet->opt, 1);
+
+        if (ret == ESP_ERR_MESH_QUEUE_FULL || ret == ESP_ERR_MESH_NO_MEMORY) {
+            MDF_LOGD("<%s> esp_mesh_send, dest_addr: " MACSTR ", seq: %d",
+                     mdf_err_to_name(ret), MAC2STR(packet->dest_addr.addr), data_head->packet_seq);
+            MWIFI_STATS_ADD(packet->dest_addr.addr, tx_retries, 1);
+
+#ifdef CONFIG_MWIFI_FLOW_CONTROL_ENABLE
 
             if (ret == ESP_ERR_MESH_NO_MEMORY) {
-                MDF_LOGW("<%s> esp_mesh_send", mdf_err_to_name(ret));
-                vTaskDelay(100 / portTICK_PERIOD_MS);
+                mwifi_tx_rate_decrease();
             }
-        } while (ret == ESP_ERR_MESH_NO_MEMORY && --retry_count);
 
-        /**< ESP-WIFI-MESH send completed, release send lock */
-        xSemaphoreGive(s_mwifi_send_lock);
+#endif /**< CONFIG_MWIFI_FLOW_CONTROL_ENABLE */
+
+            return ret;
+        }
+
         MDF_ERROR_CHECK(ret != ESP_OK && !(flag & MESH_DATA_GROUP && ret == ESP_ERR_MESH_DISCARD), ret,
                         "Node failed to send packets, dest_addr: " MACSTR
                         ", flag: 0x%02x, opt->type: 0x%02x, opt->len: %d, data->tos: %d, data: %p, size: %d",
-                        MAC2STR(dest_addr->addr), flag, opt->type, opt->len, mesh_data.tos, mesh_data.data, mesh_data.size);
+                        MAC2STR(packet->dest_addr.addr), flag, packet->opt.type, packet->opt.len,
+                        mesh_data.tos, mesh_data.data, mesh_data.size);
+
+        MWIFI_STATS_ADD(packet->dest_addr.addr, tx_fragments, 1);
+        packet->retry_time = 0;
+    }
+
+    return MDF_OK;
+}
+
+/**
+ * @brief Check whether a packet to the same destination was partly sent and is waiting in another
+ *        queue. A packet isn't started before it is finished, so the receiver gets the fragments of
+ *        the packets from this node one packet after the other, as earlier versions expect.
+ */
+static bool mwifi_tx_dest_busy(const mwifi_tx_packet_t *packet)
+{
+    if (packet->offset) {
+        return false;
+    }
+
+    for (int i = 0; i < MWIFI_PRIORITY_MAX * MWIFI_TX_QUEUE_NUM; ++i) {
+        const mwifi_tx_packet_t *head = g_tx.queue[i].head;
+
+        if (head && head != packet && head->offset
+                && !memcmp(&head->dest_addr, &packet->dest_addr, sizeof(mesh_addr_t))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Take the packet at the head of the next non-empty queue of a class, round-robin.
+ *        Unless `all` is set, the queues waiting to retry and the packets to a busy
+ *        destination are skipped.
+ */
+static mwifi_tx_packet_t *mwifi_tx_class_dequeue(uint8_t priority, bool all, size_t *queue_index)
+{
+    mwifi_tx_packet_t *packet = NULL;
+    size_t *next_queue        = g_tx.next_queue + priority;
+    int64_t now_time          = all ? 0 : esp_timer_get_time();
+
+    for (int i = 0; i < MWIFI_TX_QUEUE_NUM && !packet; ++i) {
+        *queue_index = priority * MWIFI_TX_QUEUE_NUM + *next_queue;
+        *next_queue  = (*next_queue + 1) % MWIFI_TX_QUEUE_NUM;
+
+        mwifi_tx_queue_t *queue = g_tx.queue + *queue_index;
+
+        if (queue->head && (all || (now_time >= queue->retry_time && !mwifi_tx_dest_busy(queue->head)))) {
+            packet      = queue->head;
+            queue->head = packet->next;
+            queue->tail = queue->head ? queue->tail : NULL;
+        }
+    }
+
+    return packet;
+}
+
+/**
+ * @brief Take the next packet to send.
+ *
+ *        Strict scheduling always serves the highest non-empty class. Weighted
+ *        scheduling lets each class send its weight in packets per round, so that
+ *        bulk traffic still progresses while control traffic is busy.
+ *
+ * @param  all          Also take the packets of the queues waiting to retry
+ * @param  queue_index  Queue of the packet as output
+ *
+ * @return The packet, NULL if no queue can be served now
+ */
+static mwifi_tx_packet_t *mwifi_tx_dequeue(bool all, size_t *queue_index)
+{
+    /**< From the highest to the lowest priority */
+    static const uint8_t s_order[MWIFI_PRIORITY_MAX] = {
+        MWIFI_PRIORITY_CONTROL, MWIFI_PRIORITY_INTERACTIVE, MWIFI_PRIORITY_BULK,
+    };
+    mwifi_tx_packet_t *packet = NULL;
+
+    xSemaphoreTake(g_tx.lock, portMAX_DELAY);
+
+#ifdef CONFIG_MWIFI_TX_SCHED_WEIGHTED
+    static const int s_weight[MWIFI_PRIORITY_MAX] = {
+        [MWIFI_PRIORITY_CONTROL]     = CONFIG_MWIFI_TX_WEIGHT_CONTROL,
+        [MWIFI_PRIORITY_INTERACTIVE] = CONFIG_MWIFI_TX_WEIGHT_INTERACTIVE,
+        [MWIFI_PRIORITY_BULK]        = CONFIG_MWIFI_TX_WEIGHT_BULK,
+    };
+
+    /**< A class without credit waits until the backlogged classes have spent theirs */
+    for (int round = 0; round < 2 && !packet; ++round) {
+        for (int i = 0; i < MWIFI_PRIORITY_MAX && !packet; ++i) {
+            if (g_tx.credit[s_order[i]] > 0 && (packet = mwifi_tx_class_dequeue(s_order[i], all, queue_index))) {
+                g_tx.credit[s_order[i]]--;
+            }
+        }
+
+        for (int i = 0; i < MWIFI_PRIORITY_MAX && !packet; ++i) {
+            g_tx.credit[i] = s_weight[i];
+        }
+    }
+#else
+    for (int i = 0; i < MWIFI_PRIORITY_MAX && !packet; ++i) {
+        packet = mwifi_tx_class_dequeue(s_order[i], all, queue_index);
+    }
+#endif /**< CONFIG_MWIFI_TX_SCHED_WEIGHTED */
+
+    xSemaphoreGive(g_tx.lock);
+
+    return packet;
+}
+
+/**
+ * @brief Report the result of a packet, wake up its writer or free the copy
+ */
+static void mwifi_tx_complete(mwifi_tx_packet_t *packet, size_t queue_index)
+{
+    mwifi_tx_queue_t *queue = g_tx.queue + queue_index;
+    uint32_t latency_ms     = (esp_timer_get_time() - packet->enqueue_time) / 1000;
+
+#ifdef CONFIG_MWIFI_STATS_ENABLE
+    int latency_index = 0;
+
+    /**< Bucket `i` of the histogram counts the latencies below 2^i ms */
+    while (latency_index < MWIFI_STATS_LATENCY_NUM - 1 && latency_ms >> latency_index) {
+        latency_index++;
+    }
+
+    MWIFI_STATS_ADD(packet->dest_addr.addr, latency_hist[latency_index], 1);
+#endif /**< CONFIG_MWIFI_STATS_ENABLE */
+
+    if (packet->ret == MDF_OK) {
+        MWIFI_STATS_ADD(packet->dest_addr.addr, tx_packets, 1);
+        MWIFI_STATS_ADD(packet->dest_addr.addr, tx_bytes, mwifi_iov_size(packet->iov, packet->iovcnt));
+    } else {
+        MWIFI_STATS_ADD(packet->dest_addr.addr, tx_failed, 1);
+    }
+
+    xSemaphoreTake(g_tx.lock, portMAX_DELAY);
+
+    queue->stats.depth--;
+    queue->copy_num         -= packet->done ? 0 : 1;
+    queue->latency_sum_ms   += latency_ms;
+    queue->stats.latency_max_ms = MAX(queue->stats.latency_max_ms, latency_ms);
+
+    if (packet->ret == MDF_OK) {
+        queue->stats.sent++;
+    } else {
+        queue->stats.failed++;
+    }
+
+    xSemaphoreGive(g_tx.lock);
+
+    if (packet->done) {
+        xSemaphoreGive(packet->done);
+        return;
+    }
+
+    if (packet->ret != MDF_OK) {
+        MDF_LOGW("<%s> Drop a queued packet, dest_addr: " MACSTR,
+                 mdf_err_to_name(packet->ret), MAC2STR(packet->dest_addr.addr));
+    }
+
+    MDF_FREE(packet);
+}
+
+/**
+ * @brief Stop the sender task, the packets left in the queues fail with MDF_ERR_MWIFI_NOT_INIT
+ */
+static void mwifi_tx_stop()
+{
+    size_t queue_index        = 0;
+    mwifi_tx_packet_t *packet = NULL;
+
+    if (g_tx.task) {
+        g_tx.exit = true;
+        xSemaphoreGive(g_tx.pending);
+
+        while (g_tx.task) {
+            vTaskDelay(10 / portTICK_RATE_MS);
+        }
+    }
+
+    while ((packet = mwifi_tx_dequeue(true, &queue_index))) {
+        packet->ret = MDF_ERR_MWIFI_NOT_INIT;
+        mwifi_tx_complete(packet, queue_index);
+    }
+}
+
+/**
+ * @brief Put a packet which found no room in ESP-WIFI-MESH back at the head of its queue,
+ *        the queue is served again after MWIFI_TX_RETRY_INTERVAL_MS
+ */
+static void mwifi_tx_requeue(mwifi_tx_packet_t *packet, size_t queue_index)
+{
+    mwifi_tx_queue_t *queue = g_tx.queue + queue_index;
+
+    xSemaphoreTake(g_tx.lock, portMAX_DELAY);
+
+    packet->next      = queue->head;
+    queue->head       = packet;
+    queue->tail       = queue->tail ? queue->tail : packet;
+    queue->retry_time = esp_timer_get_time() + MWIFI_TX_RETRY_INTERVAL_MS * 1000;
+
+    xSemaphoreGive(g_tx.lock);
+
+    xSemaphoreGive(g_tx.pending);
+}
+
+static void mwifi_tx_task(void *arg)
+{
+    size_t queue_index        = 0;
+    mwifi_tx_packet_t *packet = NULL;
+    mdf_err_t ret             = MDF_OK;
+
+    while (!g_tx.exit) {
+        if (!xSemaphoreTake(g_tx.pending, portMAX_DELAY)) {
+            continue;
+        }
+
+        packet = mwifi_tx_dequeue(false, &queue_index);
+
+        /**
+         * @brief All the queued packets wait to retry, or the task is stopping. The counts
+         *        of the waiting packets are taken so that only a new packet ends the wait
+         *        before the next retry, then they are given back. A packet queued before
+         *        its count was taken is found by the second dequeue.
+         */
+        if (!packet) {
+            UBaseType_t count = 0;
+
+            while (xSemaphoreTake(g_tx.pending, 0)) {
+                count++;
+            }
+
+            packet = mwifi_tx_dequeue(false, &queue_index);
+
+            if (!packet) {
+                count++;
+
+                if (xSemaphoreTake(g_tx.pending, pdMS_TO_TICKS(MWIFI_TX_RETRY_INTERVAL_MS))) {
+                    count++;
+                }
+            }
+
+            for (; count > 0; --count) {
+                xSemaphoreGive(g_tx.pending);
+            }
+
+            if (!packet) {
+                continue;
+            }
+        }
+
+        ret = mwifi_tx_packet_send(packet);
+
+        /**
+         * @brief The sender task never waits for ESP-WIFI-MESH, a packet which finds no room
+         *        waits in its queue, the other queues are served meanwhile
+         */
+        if (ret == ESP_ERR_MESH_QUEUE_FULL || ret == ESP_ERR_MESH_NO_MEMORY) {
+            int64_t now_time   = esp_timer_get_time();
+            packet->retry_time = packet->retry_time ? packet->retry_time : now_time;
+
+            if (now_time - packet->retry_time < MWIFI_TX_RETRY_TIMEOUT_MS * 1000LL) {
+                mwifi_tx_requeue(packet, queue_index);
+                continue;
+            }
+
+            MDF_LOGW("<%s> Node failed to send packets, dest_addr: " MACSTR,
+                     mdf_err_to_name(ret), MAC2STR(packet->dest_addr.addr));
+        }
+
+        packet->ret = ret;
+        mwifi_tx_complete(packet, queue_index);
+    }
+
+    g_tx.task = NULL;
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Queue a packet to the sender task, which sends it in fragments.
+ *
+ *        A blocking writer waits until the packet is sent, its buffers are not copied.
+ *        A non-blocking writer returns once a copy of the packet is queued, or
+ *        ESP_ERR_MESH_QUEUE_FULL when CONFIG_MWIFI_TX_QUEUE_SIZE copies are already
+ *        waiting in the queue of the destination.
+ */
+static mdf_err_t mwifi_subcontract_write(const mesh_addr_t *dest_addr, uint8_t tos,
+        const mwifi_iovec_t *iov, size_t iovcnt,
+        int flag, const mesh_opt_t *opt)
+{
+    size_t total_size                 = mwifi_iov_size(iov, iovcnt);
+    mwifi_tx_packet_t blocking_packet = {0};
+    mwifi_tx_packet_t *packet         = &blocking_packet;
+    uint8_t priority                  = ((mwifi_data_head_t *)opt->val)->type.priority;
+    mwifi_tx_queue_t *queue           = NULL;
+
+    priority = priority < MWIFI_PRIORITY_MAX ? priority : MWIFI_PRIORITY_INTERACTIVE;
+    queue    = g_tx.queue + priority * MWIFI_TX_QUEUE_NUM + mwifi_tx_queue_index(dest_addr);
+
+    MDF_ERROR_CHECK(!g_tx.task, MDF_ERR_MWIFI_NOT_INIT, "The sender task isn't running");
+
+    if (flag & MESH_DATA_NONBLOCK) {
+        packet = MDF_CALLOC(1, sizeof(mwifi_tx_packet_t) + total_size);
+        MDF_ERROR_CHECK(!packet, MDF_ERR_NO_MEM, "Allocate a queued packet, size: %zu", total_size);
+
+        packet->copy_iov.data = mwifi_iov_fragment(iov, iovcnt, 0, total_size, packet->copy_data);
+        packet->copy_iov.size = total_size;
+
+        if (packet->copy_iov.data != packet->copy_data) {
+            memcpy(packet->copy_data, packet->copy_iov.data, total_size);
+            packet->copy_iov.data = packet->copy_data;
+        }
+
+        packet->iov    = &packet->copy_iov;
+        packet->iovcnt = 1;
+    } else {
+        packet->iov    = iov;
+        packet->iovcnt = iovcnt;
+        packet->done   = mwifi_tx_done_get();
+        MDF_ERROR_CHECK(!packet->done, MDF_ERR_NO_MEM, "Create a semaphore");
+    }
+
+    memcpy(&packet->dest_addr, dest_addr, sizeof(mesh_addr_t));
+    memcpy(&packet->data_head, opt->val, sizeof(mwifi_data_head_t));
+    packet->data_head.type.reserved = mwifi_data_head_ext_needed(dest_addr, &packet->data_head);
+    packet->tos           = tos;
+    packet->flag          = flag;
+    packet->opt.type      = opt->type;
+    packet->opt.len       = MWIFI_DATA_HEAD_LEN;
+    packet->opt.val       = (uint8_t *)&packet->data_head;
+    packet->enqueue_time  = esp_timer_get_time();
+
+    xSemaphoreTake(g_tx.lock, portMAX_DELAY);
+
+    /**< Back-pressure, only the copies are limited, the blocking writers are waiting anyway */
+    if (!packet->done && queue->copy_num >= CONFIG_MWIFI_TX_QUEUE_SIZE) {
+        queue->stats.rejected++;
+        xSemaphoreGive(g_tx.lock);
+        MDF_FREE(packet);
+        return ESP_ERR_MESH_QUEUE_FULL;
+    }
+
+    if (queue->tail) {
+        queue->tail->next = packet;
+    } else {
+        queue->head = packet;
+    }
+
+    queue->tail      = packet;
+    queue->copy_num += packet->done ? 0 : 1;
+    queue->stats.depth++;
+    queue->stats.depth_max = MAX(queue->stats.depth_max, queue->stats.depth);
+    queue->stats.enqueued++;
+
+    xSemaphoreGive(g_tx.lock);
+    xSemaphoreGive(g_tx.pending);
+
+    if (!packet->done) {
+        return MDF_OK;
+    }
+
+    xSemaphoreTake(packet->done, portMAX_DELAY);
+    mwifi_tx_done_put(packet->done);
+
+    return packet->ret;
+}
+
+mdf_err_t mwifi_get_tx_queue_stats(mwifi_tx_queue_stats_t *stats, size_t *queue_num)
+{
+    MDF_PARAM_CHECK(stats);
+    MDF_PARAM_CHECK(queue_num);
+    MDF_ERROR_CHECK(!g_tx.lock, MDF_ERR_MWIFI_NOT_INIT, "Mwifi isn't initialized");
+
+    *queue_num = MIN(*queue_num, MWIFI_PRIORITY_MAX * MWIFI_TX_QUEUE_NUM);
+
+    xSemaphoreTake(g_tx.lock, portMAX_DELAY);
+
+    for (int i = 0; i < *queue_num; ++i) {
+        const mwifi_tx_queue_t *queue = g_tx.queue + i;
+        uint32_t done_num = queue->stats.sent + queue->stats.failed;
+
+        memcpy(stats + i, &queue->stats, sizeof(mwifi_tx_queue_stats_t));
+        stats[i].latency_avg_ms = done_num ? queue->latency_sum_ms / done_num : 0;
+    }
+
+    xSemaphoreGive(g_tx.lock);
+
+    return MDF_OK;
+}
+
+mdf_err_t mwifi_get_rx_queue_stats(mwifi_rx_queue_stats_t *stats, size_t *queue_num)
+{
+    MDF_PARAM_CHECK(stats);
+    MDF_PARAM_CHECK(queue_num);
+
+#ifdef CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE
+    MDF_ERROR_CHECK(!g_fq.lock, MDF_ERR_MWIFI_NOT_INIT, "Mwifi isn't initialized");
+
+    *queue_num = MIN(*queue_num, MWIFI_RX_QUEUE_NUM);
+
+    xSemaphoreTake(g_fq.lock, portMAX_DELAY);
+
+    for (int i = 0; i < *queue_num; ++i) {
+        const mwifi_fq_queue_t *queue = g_fq.queue + i;
+
+        memcpy(stats + i, &queue->stats, sizeof(mwifi_rx_queue_stats_t));
+        stats[i].latency_avg_ms = queue->stats.read ? queue->latency_sum_ms / queue->stats.read : 0;
+    }
+
+    xSemaphoreGive(g_fq.lock);
+
+    return MDF_OK;
+#else
+    return MDF_ERR_NOT_SUPPORTED;
+#endif /**< CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE */
+}
+
+mdf_err_t mwifi_get_stats(mwifi_stats_t *total, mwifi_stats_t *peers, size_t *peer_num)
+{
+    MDF_PARAM_CHECK(!peers || peer_num);
+
+#ifdef CONFIG_MWIFI_STATS_ENABLE
+    uint8_t addr_any[MWIFI_ADDR_LEN] = MWIFI_ADDR_ANY;
+    size_t count = 0;
+
+    if (total) {
+        memcpy(total, &g_stats.total, sizeof(mwifi_stats_t));
+        memcpy(total->addr, addr_any, MWIFI_ADDR_LEN);
+    }
+
+    for (int i = 0; peers && i < MWIFI_STATS_PEER_NUM && count < *peer_num; ++i) {
+        if (__atomic_load_n(&g_stats.peer[i].ready, __ATOMIC_ACQUIRE)) {
+            memcpy(peers + count++, &g_stats.peer[i].stats, sizeof(mwifi_stats_t));
+        }
+    }
+
+    if (peers) {
+        *peer_num = count;
+    }
+
+    return MDF_OK;
+#else
+    return MDF_ERR_NOT_SUPPORTED;
+#endif /**< CONFIG_MWIFI_STATS_ENABLE */
+}
+
+#ifdef CONFIG_MWIFI_STATS_ENABLE
+/**
+ * @brief Clear the counters one by one with atomic operations, the address is kept,
+ *        so that the tasks updating them meanwhile never see a torn counter or entry
+ */
+static void mwifi_stats_clear(mwifi_stats_t *stats)
+{
+    for (size_t offset = offsetof(mwifi_stats_t, tx_packets); offset < sizeof(mwifi_stats_t);
+            offset += sizeof(uint32_t)) {
+        __atomic_store_n((uint32_t *)((uint8_t *)stats + offset), 0, __ATOMIC_RELAXED);
+    }
+}
+#endif /**< CONFIG_MWIFI_STATS_ENABLE */
+
+mdf_err_t mwifi_reset_stats()
+{
+#ifdef CONFIG_MWIFI_STATS_ENABLE
+    mwifi_stats_clear(&g_stats.total);
+
+    for (int i = 0; i < MWIFI_STATS_PEER_NUM; ++i) {
+        mwifi_stats_clear(&g_stats.peer[i].stats);
+    }
+
+    return MDF_OK;
+#else
+    return MDF_ERR_NOT_SUPPORTED;
+#endif /**< CONFIG_MWIFI_STATS_ENABLE */
+}
+
+static size_t mwifi_subnet_hash(const mesh_addr_t *addr, size_t mask)
+{
+    uint32_t hash = addr->addr[2] << 24 | addr->addr[3] << 16 | addr->addr[4] << 8 | addr->addr[5];
+    return (hash * 2654435761U) & mask;
+}
+
+static void mwifi_subnet_index_insert(mwifi_subnet_index_t *index, const mesh_addr_t *addr, uint8_t child)
+{
+    size_t i = mwifi_subnet_hash(addr, index->table_mask);
+
+    for (; index->table[i].child; i = (i + 1) & index->table_mask) {
+        if (!memcmp(&index->table[i].addr, addr, sizeof(mesh_addr_t))) {
+            return;
+        }
+    }
+
+    memcpy(&index->table[i].addr, addr, sizeof(mesh_addr_t));
+    index->table[i].child = child;
+}
+
+/**
+ * @return Index of the child plus one through which the node is reached, 0 if not in the subnets
+ */
+static uint8_t mwifi_subnet_index_lookup(const mwifi_subnet_index_t *index, const mesh_addr_t *addr)
+{
+    if (!index->built) {
+        return 0;
+    }
+
+    for (size_t i = mwifi_subnet_hash(addr, index->table_mask); index->table[i].child;
+            i = (i + 1) & index->table_mask) {
+        if (!memcmp(&index->table[i].addr, addr, sizeof(mesh_addr_t))) {
+            return index->table[i].child;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Rebuild the subnet index if the topology changed since it was built,
+ *        the memory is only reallocated when the subnets grow.
+ *
+ * @note  The children are always updated, the hash table is left invalid
+ *        when out of memory and all the nodes are then looked up as unknown.
+ */
+static void mwifi_subnet_index_update(mwifi_subnet_index_t *index)
+{
+    mdf_err_t ret       = MDF_OK;
+    uint32_t version    = index->version;
+    wifi_sta_list_t sta = {0};
+    int subnet_num[ESP_WIFI_MAX_CONN_NUM] = {0};
+    int subnet_max      = 0;
+    size_t node_num     = 0;
+    size_t table_size   = 16;
+
+    if (index->built && index->built_version == version) {
+        return;
+    }
+
+    index->built = false;
+
+    if (g_ap_config->mesh_type == MESH_LEAF || esp_wifi_ap_get_sta_list(&sta) != MDF_OK) {
+        sta.num = 0;
+    }
+
+    for (int i = 0; i < sta.num; ++i) {
+        memcpy(index->child + i, sta.sta[i].mac, MWIFI_ADDR_LEN);
+
+        if (esp_mesh_get_subnet_nodes_num(index->child + i, subnet_num + i) != ESP_OK) {
+            subnet_num[i] = 0;
+        }
+
+        subnet_max = MAX(subnet_max, subnet_num[i]);
+        node_num  += subnet_num[i] + 1;
+    }
+
+    index->child_num = sta.num;
+
+    /**< Keep the load factor of the hash table below 2/3 */
+    while (table_size < node_num + node_num / 2) {
+        table_size <<= 1;
+    }
+
+    if (table_size > index->table_size) {
+        MDF_FREE(index->table);
+        index->table_size = 0;
+        index->table      = MDF_MALLOC(table_size * sizeof(mwifi_subnet_entry_t));
+        MDF_ERROR_GOTO(!index->table, EXIT, "Allocate the subnet index, node_num: %zu", node_num);
+        index->table_size = table_size;
+    }
+
+    if (subnet_max > index->nodes_size) {
+        MDF_FREE(index->nodes);
+        index->nodes_size = 0;
+        index->nodes      = MDF_MALLOC(subnet_max * sizeof(mesh_addr_t));
+        MDF_ERROR_GOTO(!index->nodes, EXIT, "Allocate the subnet nodes, subnet_num: %d", subnet_max);
+        index->nodes_size = subnet_max;
+    }
+
+    index->table_mask = table_size - 1;
+    memset(index->table, 0, table_size * sizeof(mwifi_subnet_entry_t));
+
+    for (int i = 0; i < index->child_num; ++i) {
+        mwifi_subnet_index_insert(index, index->child + i, i + 1);
+
+        if (!subnet_num[i]) {
+            continue;
+        }
+
+        /**< The subnet may have changed since its size was got, it will be rebuilt on the next event */
+        ret = esp_mesh_get_subnet_nodes_list(index->child + i, index->nodes, subnet_num[i]);
+        MDF_ERROR_CONTINUE(ret != ESP_OK, "<%s> Get the subnet_node_list of nodes in the subnet of a specific child" MACSTR,
+                           mdf_err_to_name(ret), MAC2STR(index->child[i].addr));
+
+        for (int j = 0; j < subnet_num[i]; ++j) {
+            mwifi_subnet_index_insert(index, index->nodes + j, i + 1);
+        }
+    }
+
+    index->built_version = version;
+    index->built         = true;
+
+EXIT:
+    return;
+}
+
+/**
+ * @brief Group the addresses in place by the child they are reached through, in O(n).
+ *        Group 0 holds the addresses which are not in any subnet, group `i + 1` those
+ *        of the child `i`. The address of the child itself is dropped from its group.
+ *
+ * @param group_start  Offset of each group, `index->child_num + 1` entries
+ * @param group_end    End of each group, `index->child_num + 1` entries
+ * @param child_self   Whether each child is itself a destination, `index->child_num` entries
+ */
+static void mwifi_subnet_index_split(const mwifi_subnet_index_t *index, mesh_addr_t *addrs_list, size_t addrs_num,
+                                     size_t *group_start, size_t *group_end, bool *child_self)
+{
+    size_t group_num = index->child_num + 1;
+    mesh_addr_t tmp_addr;
+
+    memset(group_end, 0, group_num * sizeof(size_t));
+
+    for (size_t i = 0; i < addrs_num; ++i) {
+        group_end[mwifi_subnet_index_lookup(index, addrs_list + i)]++;
+    }
+
+    for (size_t k = 0, offset = 0; k < group_num; ++k) {
+        group_start[k] = offset;
+        offset        += group_end[k];
+        group_end[k]   = group_start[k];
+    }
+
+    /**
+     * @brief `group_end` is the next free place of each group, every swap moves
+     *        one address to its group, so each address is moved at most once.
+     */
+    for (size_t k = 0; k < group_num; ++k) {
+        size_t limit = (k + 1 < group_num) ? group_start[k + 1] : addrs_num;
+
+        while (group_end[k] < limit) {
+            uint8_t key = mwifi_subnet_index_lookup(index, addrs_list + group_end[k]);
+
+            if (key != k) {
+                memcpy(&tmp_addr, addrs_list + group_end[key], sizeof(mesh_addr_t));
+                memcpy(addrs_list + group_end[key], addrs_list + group_end[k], sizeof(mesh_addr_t));
+                memcpy(addrs_list + group_end[k], &tmp_addr, sizeof(mesh_addr_t));
+            }
+
+            group_end[key]++;
+        }
+    }
+
+    for (size_t k = 1; k < group_num; ++k) {
+        size_t count      = group_start[k];
+        child_self[k - 1] = false;
+
+        for (size_t i = group_start[k]; i < group_end[k]; ++i) {
+            if (!memcmp(addrs_list + i, index->child + k - 1, sizeof(mesh_addr_t))) {
+                child_self[k - 1] = true;
+            } else {
+                memmove(addrs_list + count++, addrs_list + i, sizeof(mesh_addr_t));
+            }
+        }
 
-        data_head->packet_seq++;
-        mesh_data.data += MWIFI_PAYLOAD_LEN;
+        group_end[k] = count;
     }
-
-    return MDF_OK;
 }
 
 /**
  * @brief Multicast forwarding
  */
-static mdf_err_t mwifi_transmit_write(mesh_addr_t *addrs_list, size_t addrs_num, mesh_data_t *mesh_data,
+static mdf_err_t mwifi_transmit_write(mesh_addr_t *addrs_list, size_t addrs_num, uint8_t tos,
+                                      const mwifi_iovec_t *iov, size_t iovcnt,
                                       int data_flag, mesh_opt_t *mesh_opt)
 {
     mdf_err_t ret          = MDF_OK;
-    wifi_sta_list_t sta    = {0};
-    uint8_t *transmit_data = NULL;
+    size_t child_num       = 0;
+    mesh_addr_t child_addr[ESP_WIFI_MAX_CONN_NUM];
+    bool child_self[ESP_WIFI_MAX_CONN_NUM];
+    size_t group_start[ESP_WIFI_MAX_CONN_NUM + 1];
+    size_t group_end[ESP_WIFI_MAX_CONN_NUM + 1];
+    mwifi_iovec_t transmit_iov[MWIFI_IOV_MAX + 1] = {0};
     mwifi_data_head_t *data_head = (mwifi_data_head_t *)mesh_opt->val;
 
+    MDF_ERROR_CHECK(iovcnt > MWIFI_IOV_MAX, MDF_ERR_INVALID_ARG, "iovcnt: %zu", iovcnt);
+
+    /**
+     * @brief The forwarded address list is sent in front of the payload,
+     *        the payload itself is never copied.
+     */
+    memcpy(transmit_iov + 1, iov, iovcnt * sizeof(mwifi_iovec_t));
+
     /**
      * @brief If the address designation is all nodes or other nodes except the root in the mesh network,
      *  transmit_all should be true to send data to all downstream nodes of the node.
      */
     if (MWIFI_ADDR_IS_ANY(addrs_list->addr) || MWIFI_ADDR_IS_BROADCAST(addrs_list->addr)) {
         data_head->transmit_all = true;
+        data_head->magic        = data_head->magic ? data_head->magic : esp_random();
     }
 
-    if (g_ap_config->mesh_type == MESH_LEAF || esp_wifi_ap_get_sta_list(&sta) != MDF_OK) {
-        sta.num = 0;
-    }
+    /**
+     * @brief Split the address list by the children, the children are copied
+     *        so that the index can be rebuilt while the packets are being sent.
+     */
+    xSemaphoreTake(g_subnet_index.lock, portMAX_DELAY);
+    mwifi_subnet_index_update(&g_subnet_index);
+    child_num = g_subnet_index.child_num;
+    memcpy(child_addr, g_subnet_index.child, child_num * sizeof(mesh_addr_t));
 
     /**
-     * @brief Determine whether there is a destination device in the downstream node of the node.
+     * @brief If the packet not send to all nodes in the mesh network,
+     *  group the destination devices by the child they are downstream of,
+     *  the remaining addresses are not in the subnet of the node.
      */
-    for (int i = 0; i < sta.num && addrs_num > 0; ++i) {
-        mesh_addr_t *child_addr = (mesh_addr_t *)&sta.sta[i].mac;
+    if (!data_head->transmit_all) {
+        mwifi_subnet_index_split(&g_subnet_index, addrs_list, addrs_num, group_start, group_end, child_self);
+        addrs_num = group_end[0];
+    }
+
+    xSemaphoreGive(g_subnet_index.lock);
+
+    for (int i = 0; i < child_num; ++i) {
         MDF_LOGV("data_head->transmit_all: %d, child_addr: " MACSTR,
-                 data_head->transmit_all, MAC2STR(child_addr->addr));
+                 data_head->transmit_all, MAC2STR(child_addr[i].addr));
 
         /**
-         * @brief If the packet not send to all nodes in the mesh network,
-         *  find out if there is a destination device in the downstream node of the node and
-         *  remove all downstream nodes from the address list.
+         * @brief A packet sent to all nodes carries no address list,
+         *        a group address is already in front of the payload.
          */
         if (!data_head->transmit_all) {
-            int subnet_num           = 0;
-            mesh_addr_t *subnet_addr = NULL;
-            data_head->transmit_self = addrs_remove(addrs_list, &addrs_num, child_addr);
-            data_head->transmit_num  = 0;
-
-            /**< Get the number of nodes in the subnet of a specific child */
-            ret = esp_mesh_get_subnet_nodes_num(child_addr, &subnet_num);
-            MDF_ERROR_BREAK(ret != MDF_OK, "<%s> Get the number of nodes in the subnet of a specific child", mdf_err_to_name(ret));
-            transmit_data = MDF_REALLOC_RETRY(transmit_data, mesh_data->size + subnet_num * MWIFI_ADDR_LEN);
-            mesh_addr_t *transmit_addr = (mesh_addr_t *)transmit_data;
-            MDF_LOGV("subnet_num: %d", subnet_num);
-
-            if (subnet_num) {
-                /**< Get nodes in the subnet of a specific child */
-                subnet_addr = MDF_REALLOC_RETRY(NULL, subnet_num * sizeof(mesh_addr_t));
-                ret = esp_mesh_get_subnet_nodes_list(child_addr, subnet_addr, subnet_num);
-                MDF_ERROR_GOTO(ret != ESP_OK, MEM_FREE, "<%s> Get the subnet_node_list of nodes in the subnet of a specific child" MACSTR, mdf_err_to_name(ret), MAC2STR(child_addr->addr));
-            }
-
-            for (int j = 0; j < subnet_num && addrs_num > 0; ++j) {
-                if (addrs_remove(addrs_list, &addrs_num, subnet_addr + j)) {
-                    memcpy(transmit_addr + data_head->transmit_num, subnet_addr + j, sizeof(mesh_addr_t));
-                    data_head->transmit_num++;
-                    MDF_LOGV("count: %d, transmit_addr: " MACSTR,
-                             data_head->transmit_num, MAC2STR(subnet_addr[j].addr));
-                }
-            }
-
-MEM_FREE:
-            MDF_FREE(subnet_addr);
+            data_head->transmit_self = child_self[i];
+            data_head->transmit_num  = group_end[i + 1] - group_start[i + 1];
+            transmit_iov[0].data     = addrs_list + group_start[i + 1];
+            transmit_iov[0].size     = data_head->transmit_num * MWIFI_ADDR_LEN;
         }
 
         /**
          * @brief Send data to child nodes.
          */
         if (data_head->transmit_num || data_head->transmit_self || data_head->transmit_all) {
-            mesh_data_t tmp_data = {0x0};
-
-            if (transmit_data) {
-                memcpy(transmit_data + data_head->transmit_num * MWIFI_ADDR_LEN, mesh_data->data, mesh_data->size);
-                tmp_data.size = mesh_data->size + data_head->transmit_num * MWIFI_ADDR_LEN;
-                tmp_data.data = transmit_data;
-            } else {
-                tmp_data.size = mesh_data->size;
-                tmp_data.data = mesh_data->data;
-            }
-
-            MDF_LOGV("mesh_data->size: %d, transmit_num: %d, child_addr: " MACSTR,
-                     mesh_data->size, data_head->transmit_num, MAC2STR(child_addr->addr));
+            MDF_LOGV("transmit_num: %d, child_addr: " MACSTR,
+                     data_head->transmit_num, MAC2STR(child_addr[i].addr));
 
             /**< Fragmenting packets for transmission */
-            ret = mwifi_subcontract_write(child_addr, &tmp_data, data_flag, mesh_opt);
+            ret = mwifi_subcontract_write(child_addr + i, tos, transmit_iov, iovcnt + 1, data_flag, mesh_opt);
             MDF_ERROR_BREAK(ret != ESP_OK, "<%s> Root node failed to send packets, dest_mac: "MACSTR,
-                            mdf_err_to_name(ret), MAC2STR(child_addr->addr));
+                            mdf_err_to_name(ret), MAC2STR(child_addr[i].addr));
+            MWIFI_STATS_ADD(child_addr[i].addr, forwarded, 1);
         }
     }
 
-    MDF_FREE(transmit_data);
-
     /**
      * @brief Prevent topology changes during the process of sending packets,
      *        such as: the child node becomes the parent node and cannot be found.
@@ -830,7 +2672,7 @@ MEM_FREE:
         data_head->transmit_self = true;
 
         /**< Fragmenting packets for transmission */
-        ret = mwifi_subcontract_write(addrs_list + i, mesh_data, data_flag, mesh_opt);
+        ret = mwifi_subcontract_write(addrs_list + i, tos, iov, iovcnt, data_flag, mesh_opt);
         MDF_ERROR_CONTINUE(ret != ESP_OK, "<%s> Root node failed to send packets, dest_mac: "MACSTR,
                            mdf_err_to_name(ret), MAC2STR((addrs_list + i)->addr));
     }
@@ -838,18 +2680,527 @@ MEM_FREE:
     return ret;
 }
 
+/**
+ * @brief Queue a reassembled packet to the relay task, which takes over the buffer.
+ *        The packet is dropped if the queue is full, the buffer is released anyway.
+ */
+static void mwifi_relay_put(uint8_t **data, size_t size, const mwifi_data_head_t *data_head, uint8_t tos)
+{
+    mwifi_relay_packet_t packet = {
+        .data = *data,
+        .size = size,
+        .tos  = tos,
+    };
+
+    memcpy(&packet.data_head, data_head, sizeof(mwifi_data_head_t));
+
+    if (!g_relay.queue || xQueueSend(g_relay.queue, &packet, 0) != pdTRUE) {
+        MDF_LOGW("Relay queue is full, drop a packet to forward, size: %zu", size);
+        MWIFI_STATS_ADD(NULL, forward_dropped, 1);
+        mwifi_buffer_free(data);
+        return;
+    }
+
+    *data = NULL;
+}
+
+static void mwifi_relay_task(void *arg)
+{
+    mdf_err_t ret                     = MDF_OK;
+    mwifi_relay_packet_t packet       = {0};
+    uint8_t addr_any[MWIFI_ADDR_LEN]  = MWIFI_ADDR_BROADCAST;
+    mesh_opt_t mesh_opt               = {
+        .len  = sizeof(mwifi_data_head_t),
+        .val  = (void *) &packet.data_head,
+        .type = MESH_OPT_RECV_DS_ADDR,
+    };
+
+    while (!g_relay.exit) {
+        if (xQueueReceive(g_relay.queue, &packet, portMAX_DELAY) != pdTRUE || !packet.data) {
+            continue;
+        }
+
+        /**
+         * @brief A packet to all the nodes carries no address list, the others
+         *        carry the addresses downstream of this node before the payload.
+         */
+        mesh_addr_t *transmit_addr = (mesh_addr_t *)packet.data;
+        size_t transmit_num        = packet.data_head.transmit_num;
+        mwifi_iovec_t transmit_iov = {
+            .data = packet.data + transmit_num * MWIFI_ADDR_LEN,
+            .size = packet.size - transmit_num * MWIFI_ADDR_LEN,
+        };
+
+        if (packet.data_head.transmit_all) {
+            transmit_num      = 1;
+            transmit_addr     = (mesh_addr_t *)addr_any;
+            transmit_iov.data = packet.data;
+            transmit_iov.size = packet.size;
+        }
+
+        MDF_LOGV("Data forwarding, size: %zu, transmit_num: %d", transmit_iov.size, packet.data_head.transmit_num);
+
+        /**< Multicast forwarding */
+        ret = mwifi_transmit_write(transmit_addr, transmit_num, packet.tos, &transmit_iov, 1,
+                                   MESH_DATA_P2P, &mesh_opt);
+
+        if (ret != MDF_OK) {
+            MDF_LOGW("<%s> Forward a packet, size: %zu", mdf_err_to_name(ret), transmit_iov.size);
+        }
+
+        mwifi_buffer_free(&packet.data);
+    }
+
+    g_relay.task = NULL;
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Stop the relay task, the packets left in the queue are dropped
+ */
+static void mwifi_relay_stop()
+{
+    mwifi_relay_packet_t packet = {0};
+
+    if (g_relay.task) {
+        g_relay.exit = true;
+        xQueueSendToFront(g_relay.queue, &packet, portMAX_DELAY);
+
+        while (g_relay.task) {
+            vTaskDelay(10 / portTICK_RATE_MS);
+        }
+    }
+
+    while (g_relay.queue && xQueueReceive(g_relay.queue, &packet, 0) == pdTRUE) {
+        mwifi_buffer_free(&packet.data);
+    }
+
+    if (g_relay.queue) {
+        vQueueDelete(g_relay.queue);
+        g_relay.queue = NULL;
+    }
+}
+
+#ifdef CONFIG_MWIFI_COALESCE_ENABLE
+/**
+ * @brief Send the coalesced messages, the lock must be held. The messages
+ *        are kept if the packet can't be sent, so that no message is lost.
+ */
+static mdf_err_t mwifi_coalesce_send(bool block)
+{
+    mdf_err_t ret               = MDF_OK;
+    uint8_t root_addr[]         = MWIFI_ADDR_ROOT;
+    mwifi_data_head_t data_head = {0x0};
+    mwifi_iovec_t iov           = {
+        .data = g_coalesce_tx.data,
+        .size = g_coalesce_tx.size,
+    };
+    mesh_opt_t mesh_opt = {
+        .len  = sizeof(mwifi_data_head_t),
+        .val  = (void *) &data_head,
+        .type = MESH_OPT_RECV_DS_ADDR,
+    };
+    int data_flag = MESH_DATA_TODS;
+    data_flag = (g_init_config->data_drop_enable) ? data_flag | MESH_DATA_DROP : data_flag;
+    data_flag = (!block) ? data_flag | MESH_DATA_NONBLOCK : data_flag;
+
+    if (!g_coalesce_tx.size) {
+        return MDF_OK;
+    }
+
+    data_head.transmit_self = true;
+    data_head.coalesced     = true;
+
+    /**< The packet never exceeds MWIFI_PAYLOAD_LEN, so it is sent in one fragment or not at all */
+    ret = mwifi_subcontract_write((mesh_addr_t *)root_addr, MESH_TOS_P2P, &iov, 1, data_flag, &mesh_opt);
+    MDF_ERROR_CHECK(ret != MDF_OK, ret, "<%s> Send coalesced messages, size: %zu",
+                    mdf_err_to_name(ret), g_coalesce_tx.size);
+
+    g_coalesce_tx.size = 0;
+
+    return MDF_OK;
+}
+
+static void mwifi_coalesce_timercb(TimerHandle_t timer)
+{
+    /**< Never block the timer task, try again later if a writer holds the lock or the queue is full */
+    if (!xSemaphoreTake(g_coalesce_tx.lock, 0)) {
+        xTimerReset(timer, 0);
+        return;
+    }
+
+    if (mwifi_coalesce_send(false) != MDF_OK) {
+        xTimerReset(timer, 0);
+    }
+
+    xSemaphoreGive(g_coalesce_tx.lock);
+}
+
+/**
+ * @brief Send the coalesced messages now, called before a message to the root
+ *        which is not coalesced, so that the messages stay in order.
+ */
+static mdf_err_t mwifi_coalesce_flush(bool block)
+{
+    mdf_err_t ret = MDF_OK;
+
+    xSemaphoreTake(g_coalesce_tx.lock, portMAX_DELAY);
+
+    if (g_coalesce_tx.size) {
+        ret = mwifi_coalesce_send(block);
+
+        if (ret == MDF_OK) {
+            xTimerStop(g_coalesce_tx.timer, 0);
+        }
+    }
+
+    xSemaphoreGive(g_coalesce_tx.lock);
+
+    return ret;
+}
+
+/**
+ * @brief Append a small message to the packet to the root, the packet is sent when
+ *        the next message doesn't fit in it or CONFIG_MWIFI_COALESCE_FLUSH_MS after
+ *        its first message, whichever comes first.
+ */
+static mdf_err_t mwifi_coalesce_write(const mwifi_data_type_t *data_type,
+                                      const mwifi_iovec_t *iov, size_t iovcnt, size_t size, bool block)
+{
+    mdf_err_t ret                  = MDF_OK;
+    mwifi_coalesce_record_t record = {.size = size};
+    memcpy(&record.type, data_type, sizeof(mwifi_data_type_t));
+
+    xSemaphoreTake(g_coalesce_tx.lock, portMAX_DELAY);
+
+    if (!g_coalesce_tx.data) {
+        g_coalesce_tx.data = MDF_MALLOC(MWIFI_PAYLOAD_LEN);
+        ret = MDF_ERR_NO_MEM;
+        MDF_ERROR_GOTO(!g_coalesce_tx.data, EXIT, "Allocate the coalescing buffer");
+    }
+
+    if (!g_coalesce_tx.timer) {
+        g_coalesce_tx.timer = xTimerCreate("mwifi_coalesce", pdMS_TO_TICKS(CONFIG_MWIFI_COALESCE_FLUSH_MS),
+                                           false, NULL, mwifi_coalesce_timercb);
+        ret = MDF_FAIL;
+        MDF_ERROR_GOTO(!g_coalesce_tx.timer, EXIT, "Create the coalescing timer");
+    }
+
+    if (g_coalesce_tx.size + sizeof(mwifi_coalesce_record_t) + size > MWIFI_PAYLOAD_LEN) {
+        ret = mwifi_coalesce_send(block);
+        MDF_ERROR_GOTO(ret != MDF_OK, EXIT, "<%s> Send coalesced messages", mdf_err_to_name(ret));
+    }
+
+    /**< The deadline starts from the first message of the packet */
+    if (!g_coalesce_tx.size) {
+        xTimerReset(g_coalesce_tx.timer, 0);
+    }
+
+    memcpy(g_coalesce_tx.data + g_coalesce_tx.size, &record, sizeof(mwifi_coalesce_record_t));
+    g_coalesce_tx.size += sizeof(mwifi_coalesce_record_t);
+
+    for (int i = 0; i < iovcnt; ++i) {
+        memcpy(g_coalesce_tx.data + g_coalesce_tx.size, iov[i].data, iov[i].size);
+        g_coalesce_tx.size += iov[i].size;
+    }
+
+    ret = MDF_OK;
+
+EXIT:
+    xSemaphoreGive(g_coalesce_tx.lock);
+    return ret;
+}
+#endif /**< CONFIG_MWIFI_COALESCE_ENABLE */
+
+#ifdef CONFIG_MWIFI_PS_BATCH_ENABLE
+/**
+ * @brief Whether a message may wait for the next transmit window. Only the small unicast
+ *        messages of the bulk class are held, and of the interactive class if configured;
+ *        compressed, stream and RPC messages are sent at once.
+ */
+static bool mwifi_ps_batch_holdable(const uint8_t *dest_addr, const mwifi_data_type_t *data_type, size_t size)
+{
+#ifdef CONFIG_MWIFI_PS_BATCH_INTERACTIVE
+    bool holdable_priority = data_type->priority == MWIFI_PRIORITY_BULK
+                             || data_type->priority == MWIFI_PRIORITY_INTERACTIVE;
+#else
+    bool holdable_priority = data_type->priority == MWIFI_PRIORITY_BULK;
+#endif /**< CONFIG_MWIFI_PS_BATCH_INTERACTIVE */
+
+    return holdable_priority && size <= CONFIG_MWIFI_PS_BATCH_SIZE_MAX
+           && !data_type->compression && !data_type->stream && !data_type->rpc && !data_type->group
+           && data_type->communicate == MWIFI_COMMUNICATE_UNICAST
+           && !MWIFI_ADDR_IS_ANY(dest_addr) && !MWIFI_ADDR_IS_BROADCAST(dest_addr);
+}
+
+/**
+ * @brief Send the messages held for a destination, the lock must be held. The
+ *        messages are kept if the packet can't be sent, so that no message is lost.
+ */
+static mdf_err_t mwifi_ps_batch_send(mwifi_ps_batch_t *batch, bool block)
+{
+    mdf_err_t ret               = MDF_OK;
+    uint8_t root_addr[]         = MWIFI_ADDR_ROOT;
+    mwifi_data_head_t data_head = {0x0};
+    mwifi_iovec_t iov           = {
+        .data = batch->data,
+        .size = batch->size,
+    };
+    mesh_opt_t mesh_opt = {
+        .len  = sizeof(mwifi_data_head_t),
+        .val  = (void *) &data_head,
+        .type = MESH_OPT_RECV_DS_ADDR,
+    };
+    int data_flag = batch->to_root ? MESH_DATA_TODS : MESH_DATA_P2P;
+    data_flag = (g_init_config->data_drop_enable) ? data_flag | MESH_DATA_DROP : data_flag;
+    data_flag = (!block) ? data_flag | MESH_DATA_NONBLOCK : data_flag;
+
+    if (!batch->size) {
+        return MDF_OK;
+    }
+
+    data_head.transmit_self        = true;
+    data_head.coalesced            = true;
+    data_head.type.communicate     = MWIFI_COMMUNICATE_UNICAST;
+    data_head.type.priority        = MWIFI_PRIORITY_BULK;
+
+    ret = mwifi_subcontract_write((mesh_addr_t *)(batch->to_root ? root_addr : batch->dest_addr),
+                                  MESH_TOS_P2P, &iov, 1, data_flag, &mesh_opt);
+    MDF_ERROR_CHECK(ret != MDF_OK, ret, "<%s> Send held messages, dest_addr: " MACSTR ", size: %d",
+                    mdf_err_to_name(ret), MAC2STR(batch->dest_addr), batch->size);
+
+    batch->size = 0;
+
+    return MDF_OK;
+}
+
+/**
+ * @brief Send the messages held for all the destinations, the lock must be held
+ */
+static mdf_err_t mwifi_ps_batch_send_all(bool block)
+{
+    mdf_err_t ret = MDF_OK;
+
+    for (int i = 0; i < CONFIG_MWIFI_PS_BATCH_DEST_NUM; ++i) {
+        mdf_err_t batch_ret = mwifi_ps_batch_send(g_ps_batcher.batch + i, block);
+        ret = (ret == MDF_OK) ? batch_ret : ret;
+    }
+
+    return ret;
+}
+
+static void mwifi_ps_batch_timercb(TimerHandle_t timer)
+{
+    /**< Never block the timer task, a writer holding the lock sends the messages itself */
+    if (!xSemaphoreTake(g_ps_batcher.lock, 0)) {
+        return;
+    }
+
+    /**< A packet which can't be queued now waits for the next window */
+    mwifi_ps_batch_send_all(false);
+
+    xSemaphoreGive(g_ps_batcher.lock);
+}
+
+/**
+ * @brief Send the held messages now, called before a message which is not held.
+ *        The radio is woken up for that message anyway, and the messages to each
+ *        destination stay in order.
+ */
+static mdf_err_t mwifi_ps_batch_flush(bool block)
+{
+    mdf_err_t ret = MDF_OK;
+
+    xSemaphoreTake(g_ps_batcher.lock, portMAX_DELAY);
+    ret = mwifi_ps_batch_send_all(block);
+    xSemaphoreGive(g_ps_batcher.lock);
+
+    return ret;
+}
+
+/**
+ * @brief Hold a message until the next transmit window, appended to the packet of its
+ *        destination. The packet is sent early only when it is full, or when all the
+ *        batches hold messages to other destinations, then a window is opened at once.
+ */
+static mdf_err_t mwifi_ps_batch_write(const uint8_t *dest_addr, bool to_root, const mwifi_data_type_t *data_type,
+                                      const mwifi_iovec_t *iov, size_t iovcnt, size_t size, bool block)
+{
+    mdf_err_t ret                  = MDF_OK;
+    mwifi_ps_batch_t *batch        = NULL;
+    mwifi_ps_batch_t *free_batch   = NULL;
+    mwifi_coalesce_record_t record = {.size = size};
+    memcpy(&record.type, data_type, sizeof(mwifi_data_type_t));
+
+    xSemaphoreTake(g_ps_batcher.lock, portMAX_DELAY);
+
+    if (!g_ps_batcher.timer) {
+        g_ps_batcher.timer = xTimerCreate("mwifi_ps_batch", pdMS_TO_TICKS(CONFIG_MWIFI_PS_BATCH_WINDOW_MS),
+                                          true, NULL, mwifi_ps_batch_timercb);
+        ret = MDF_FAIL;
+        MDF_ERROR_GOTO(!g_ps_batcher.timer, EXIT, "Create the transmit window timer");
+        xTimerStart(g_ps_batcher.timer, 0);
+    }
+
+    for (int i = 0; i < CONFIG_MWIFI_PS_BATCH_DEST_NUM && !batch; ++i) {
+        mwifi_ps_batch_t *entry = g_ps_batcher.batch + i;
+
+        if (entry->size && entry->to_root == to_root && !memcmp(entry->dest_addr, dest_addr, MWIFI_ADDR_LEN)) {
+            batch = entry;
+        } else if (!entry->size && !free_batch) {
+            free_batch = entry;
+        }
+    }
+
+    if (!batch && !free_batch) {
+        ret = mwifi_ps_batch_send_all(block);
+        MDF_ERROR_GOTO(ret != MDF_OK, EXIT, "<%s> Send held messages", mdf_err_to_name(ret));
+        free_batch = g_ps_batcher.batch;
+    }
+
+    if (!batch) {
+        batch = free_batch;
+
+        if (!batch->data) {
+            batch->data = MDF_MALLOC(MWIFI_PAYLOAD_LEN);
+            ret = MDF_ERR_NO_MEM;
+            MDF_ERROR_GOTO(!batch->data, EXIT, "Allocate the batch of a destination");
+        }
+
+        batch->to_root = to_root;
+        memcpy(batch->dest_addr, dest_addr, MWIFI_ADDR_LEN);
+    }
+
+    if (batch->size + sizeof(mwifi_coalesce_record_t) + size > MWIFI_PAYLOAD_LEN) {
+        ret = mwifi_ps_batch_send(batch, block);
+        MDF_ERROR_GOTO(ret != MDF_OK, EXIT, "<%s> Send held messages", mdf_err_to_name(ret));
+    }
+
+    memcpy(batch->data + batch->size, &record, sizeof(mwifi_coalesce_record_t));
+    batch->size += sizeof(mwifi_coalesce_record_t);
+
+    for (int i = 0; i < iovcnt; ++i) {
+        memcpy(batch->data + batch->size, iov[i].data, iov[i].size);
+        batch->size += iov[i].size;
+    }
+
+    MWIFI_STATS_ADD(dest_addr, tx_held, 1);
+    ret = MDF_OK;
+
+EXIT:
+    xSemaphoreGive(g_ps_batcher.lock);
+    return ret;
+}
+#endif /**< CONFIG_MWIFI_PS_BATCH_ENABLE */
+
+/**
+ * @brief  Take the next message of the coalesced packet being split, the memory
+ *         of the message is handled as mwifi_read() or mwifi_root_read() does for a packet.
+ *
+ * @return
+ *     - MDF_ERR_NOT_FOUND: No message left
+ *     - MDF_ERR_BUF: The buffer is too small, the message is dropped
+ */
+static mdf_err_t mwifi_coalesce_pop(mwifi_coalesce_rx_t *rx, uint8_t *src_addr, mwifi_data_type_t *data_type,
+                                    void *data, size_t *size, uint8_t type)
+{
+    mdf_err_t ret                  = MDF_ERR_NOT_FOUND;
+    mwifi_coalesce_record_t record = {0};
+    uint8_t *buffer                = NULL;
+
+    xSemaphoreTake(rx->lock, portMAX_DELAY);
+
+    if (!rx->data) {
+        goto EXIT;
+    }
+
+    memcpy(&record, rx->data + rx->offset, sizeof(mwifi_coalesce_record_t));
+
+    if (rx->offset + sizeof(mwifi_coalesce_record_t) + record.size > rx->size) {
+        MDF_LOGW("Malformed coalesced packet, src_addr: " MACSTR ", offset: %zu, size: %zu",
+                 MAC2STR(rx->src_addr), rx->offset, rx->size);
+        mwifi_buffer_free(&rx->data);
+        goto EXIT;
+    }
+
+    memcpy(src_addr, rx->src_addr, MWIFI_ADDR_LEN);
+    memcpy(data_type, &record.type, sizeof(mwifi_data_type_t));
+    rx->offset += sizeof(mwifi_coalesce_record_t);
+
+    if (type == MWIFI_DATA_MEMORY_MALLOC_INTERNAL) {
+        *((uint8_t **)data) = MDF_REALLOC_RETRY(NULL, record.size);
+        memcpy(*((uint8_t **)data), rx->data + rx->offset, record.size);
+        ret = MDF_OK;
+    } else if (type == MWIFI_DATA_MEMORY_POOL) {
+        buffer = mwifi_buffer_alloc(record.size);
+        ret    = buffer ? MDF_OK : MDF_ERR_NO_MEM;
+
+        if (buffer) {
+            memcpy(buffer, rx->data + rx->offset, record.size);
+            *((uint8_t **)data) = buffer;
+        }
+    } else if (*size < record.size) {
+        MDF_LOGW("Buffer is too small, size: %zu, the expected size is: %d", *size, record.size);
+        ret = MDF_ERR_BUF;
+    } else {
+        memcpy(data, rx->data + rx->offset, record.size);
+        ret = MDF_OK;
+    }
+
+    *size                 = (ret == MDF_OK) ? record.size : *size;
+    rx->offset += record.size;
+
+    if (rx->offset + sizeof(mwifi_coalesce_record_t) > rx->size) {
+        mwifi_buffer_free(&rx->data);
+    }
+
+EXIT:
+    xSemaphoreGive(rx->lock);
+    return ret;
+}
+
+/**
+ * @brief Take over a received packet of coalesced messages, which are then read one by one
+ */
+static void mwifi_coalesce_split(mwifi_coalesce_rx_t *rx, const uint8_t *src_addr, uint8_t **data, size_t size)
+{
+    xSemaphoreTake(rx->lock, portMAX_DELAY);
+    mwifi_buffer_free(&rx->data);
+    memcpy(rx->src_addr, src_addr, MWIFI_ADDR_LEN);
+    rx->data   = *data;
+    rx->size   = size;
+    rx->offset = 0;
+    *data      = NULL;
+    xSemaphoreGive(rx->lock);
+}
+
 mdf_err_t mwifi_write(const uint8_t *dest_addrs, const mwifi_data_type_t *data_type,
                       const void *data, size_t size, bool block)
 {
-    MDF_PARAM_CHECK(data_type);
     MDF_PARAM_CHECK(data);
-    MDF_PARAM_CHECK(size > 0 && size < 8096);
+
+    mwifi_iovec_t iov = {
+        .data = data,
+        .size = size,
+    };
+
+    return mwifi_writev(dest_addrs, data_type, &iov, 1, block);
+}
+
+mdf_err_t mwifi_writev(const uint8_t *dest_addrs, const mwifi_data_type_t *data_type,
+                       const mwifi_iovec_t *iov, size_t iovcnt, bool block)
+{
+    MDF_PARAM_CHECK(data_type);
+    MDF_PARAM_CHECK(iov);
+    MDF_PARAM_CHECK(iovcnt > 0 && iovcnt <= MWIFI_IOV_MAX);
+    MDF_PARAM_CHECK(mwifi_iov_size(iov, iovcnt) > 0 && mwifi_iov_size(iov, iovcnt) < 8096);
     MDF_PARAM_CHECK(!dest_addrs || !MWIFI_ADDR_IS_EMPTY(dest_addrs));
     MDF_ERROR_CHECK(!mwifi_is_started(), MDF_ERR_MWIFI_NOT_START, "Mwifi isn't started");
 
     mdf_err_t ret          = MDF_OK;
     int data_flag          = 0;
-    mz_ulong compress_size = 0;
+    size_t size            = mwifi_iov_size(iov, iovcnt);
+    size_t compress_size   = 0;
     uint8_t *compress_data = NULL;
     uint8_t root_addr[]    = MWIFI_ADDR_ROOT;
     uint8_t empty_addr[]   = MWIFI_ADDR_NONE;
@@ -857,6 +3208,15 @@ mdf_err_t mwifi_write(const uint8_t *dest_addrs, const mwifi_data_type_t *data_t
     uint8_t addr_broadcast[] = MWIFI_ADDR_BROADCAST;
     uint8_t self_addr[MWIFI_ADDR_LEN] = {0};
 
+    /**
+     * @brief The first element is reserved for the group address,
+     *        the payload elements are referenced without copying.
+     */
+    mwifi_iovec_t send_iov[MWIFI_IOV_MAX + 1] = {0};
+    mwifi_iovec_t *payload_iov = send_iov + 1;
+    size_t payload_iovcnt      = iovcnt;
+    memcpy(payload_iov, iov, iovcnt * sizeof(mwifi_iovec_t));
+
     /**
      * @brief  If the destination address is NULL, it is received by the mwifi_root_read of the root node.
      *         If the destination address is MWIFI_ADDR_ROOT, it is received by the mwifi_read of the root node.
@@ -866,11 +3226,7 @@ mdf_err_t mwifi_write(const uint8_t *dest_addrs, const mwifi_data_type_t *data_t
     dest_addrs   = to_root ? root_addr : dest_addrs;
 
     mwifi_data_head_t data_head = {0x0};
-    mesh_data_t mesh_data       = {
-        .tos   = data_type->communicate == MWIFI_COMMUNICATE_BROADCAST ? MESH_TOS_DEF : MESH_TOS_P2P,
-        .data  = (uint8_t *)data,
-        .size  = size,
-    };
+    uint8_t tos                 = data_type->communicate == MWIFI_COMMUNICATE_BROADCAST ? MESH_TOS_DEF : MESH_TOS_P2P;
     mesh_opt_t mesh_opt   = {
         .len  = sizeof(mwifi_data_head_t),
         .val  = (void *) &data_head,
@@ -886,6 +3242,33 @@ mdf_err_t mwifi_write(const uint8_t *dest_addrs, const mwifi_data_type_t *data_t
     memcpy(&data_head.type, data_type, sizeof(mwifi_data_type_t));
     MDF_ERROR_CHECK(to_root && g_rootless_flag, MDF_ERR_MWIFI_NO_ROOT, "Current network has no root");
 
+#ifdef CONFIG_MWIFI_PS_BATCH_ENABLE
+
+    if (mwifi_ps_batch_holdable(dest_addrs, data_type, size)) {
+        return mwifi_ps_batch_write(dest_addrs, to_root, data_type, iov, iovcnt, size, block);
+    }
+
+    /**< The radio wakes up for this message, the held messages go with it */
+    ret = mwifi_ps_batch_flush(block);
+    MDF_ERROR_CHECK(ret != MDF_OK, ret, "<%s> Send held messages", mdf_err_to_name(ret));
+
+#endif /**< CONFIG_MWIFI_PS_BATCH_ENABLE */
+
+#ifdef CONFIG_MWIFI_COALESCE_ENABLE
+
+    if (to_root) {
+        if (!data_type->compression && data_type->priority != MWIFI_PRIORITY_CONTROL
+                && size <= CONFIG_MWIFI_COALESCE_SIZE_MAX) {
+            return mwifi_coalesce_write(data_type, iov, iovcnt, size, block);
+        }
+
+        /**< Keep the messages to the root in order */
+        ret = mwifi_coalesce_flush(block);
+        MDF_ERROR_CHECK(ret != MDF_OK, ret, "<%s> Send coalesced messages", mdf_err_to_name(ret));
+    }
+
+#endif /**< CONFIG_MWIFI_COALESCE_ENABLE */
+
     if (!data_type->group && data_type->communicate == MWIFI_COMMUNICATE_BROADCAST
             && !memcmp(dest_addrs, addr_broadcast, MWIFI_ADDR_LEN)) {
         dest_addrs = addr_any;
@@ -906,56 +3289,62 @@ mdf_err_t mwifi_write(const uint8_t *dest_addrs, const mwifi_data_type_t *data_t
         }
     }
 
-    MDF_LOGD("esp_mesh_send dest_addr: " MACSTR ", mesh_data.size: %d, data: %.*s",
-             MAC2STR(dest_addrs), mesh_data.size, mesh_data.size, mesh_data.data);
+    MDF_LOGD("esp_mesh_send dest_addr: " MACSTR ", size: %zu, iovcnt: %zu, data: %.*s",
+             MAC2STR(dest_addrs), size, iovcnt, (int)iov->size, (char *)iov->data);
 
     /**
      * @brief data compression
      */
     if (data_head.type.compression) {
+        uint8_t *raw_data  = NULL;
+        bool compress_dict = false;
+
         ret = MDF_ERR_NO_MEM;
         compress_size = compressBound(size);
         compress_data = MDF_MALLOC(compress_size);
         MDF_ERROR_GOTO(!compress_data, EXIT, "");
 
-        ret = compress(compress_data, &compress_size, mesh_data.data, mesh_data.size);
+        /**< Deflate needs contiguous input, gather the payload only if it is scattered */
+        if (iovcnt > 1) {
+            raw_data = MDF_MALLOC(size);
+            MDF_ERROR_GOTO(!raw_data, EXIT, "");
+        }
+
+        compress_dict = MWIFI_COMPRESS_DICT_ENABLE && size <= MWIFI_COMPRESS_DICT_DATA_MAX;
+        ret = mwifi_compress(compress_data, &compress_size,
+                             mwifi_iov_fragment(iov, iovcnt, 0, size, raw_data), size, compress_dict);
+        MDF_FREE(raw_data);
         MDF_ERROR_GOTO(ret != MZ_OK, EXIT, "Compressed whitelist failed, ret: 0x%x", -ret);
         MDF_LOGD("compress, size: %zu, compress_size: %d, rate: %d%%",
-                 size, (int)compress_size, (int)compress_size * 100 / size);
+                 size, (int)compress_size, (int)(compress_size * 100 / size));
 
         if (compress_size > size) {
             data_head.type.compression = false;
         } else {
             data_head.compress_rate = (size / compress_size + 1) >= 15 ? 15 : (size / compress_size + 1);
-            mesh_data.data = compress_data;
-            mesh_data.size = compress_size;
+            data_head.uncompressed_size = (size <= MWIFI_UNCOMPRESSED_SIZE_MAX) ? size : 0;
+            data_head.compress_dict     = compress_dict;
+            payload_iov[0].data = compress_data;
+            payload_iov[0].size = compress_size;
+            payload_iovcnt      = 1;
         }
     }
 
     /**< Send a package as a group */
     if (!to_root && data_head.type.group && data_type->communicate != MWIFI_COMMUNICATE_BROADCAST) {
-        ret = MDF_ERR_NO_MEM;
-        uint8_t *group_data = MDF_MALLOC(mesh_data.size + MWIFI_ADDR_LEN);
-        MDF_ERROR_GOTO(!group_data, EXIT, "");
-
-        memcpy(group_data, dest_addrs, MWIFI_ADDR_LEN);
-        memcpy(group_data + MWIFI_ADDR_LEN, mesh_data.data, mesh_data.size);
-        mesh_data.tos  = MESH_TOS_P2P;
-        mesh_data.size += MWIFI_ADDR_LEN;
-        mesh_data.data = group_data;
+        send_iov[0].data = dest_addrs;
+        send_iov[0].size = MWIFI_ADDR_LEN;
+        payload_iov      = send_iov;
+        payload_iovcnt++;
+
+        tos = MESH_TOS_P2P;
         data_head.transmit_num = 1;
         data_head.transmit_all = true;
         dest_addrs = empty_addr;
-
-        MDF_FREE(compress_data);
-        compress_data = group_data;
     }
 
-    data_head.total_size_hight = mesh_data.size >> 12;
-    data_head.total_size_low   = mesh_data.size & 0xFFF;
-
     /**< Fragmenting packets for transmission */
-    ret = mwifi_subcontract_write((mesh_addr_t *)dest_addrs, &mesh_data, data_flag, &mesh_opt);
+    ret = mwifi_subcontract_write((mesh_addr_t *)dest_addrs, tos, payload_iov, payload_iovcnt, data_flag, &mesh_opt);
     MDF_ERROR_GOTO(ret != ESP_OK, EXIT, "<%s> Node failed to send packets, data_flag: 0x%x, dest_mac: " MACSTR,
                    mdf_err_to_name(ret), data_flag, MAC2STR(dest_addrs));
 
@@ -972,9 +3361,10 @@ mdf_err_t __mwifi_read(uint8_t *src_addr, mwifi_data_type_t *data_type,
     MDF_PARAM_CHECK(data_type);
     MDF_PARAM_CHECK(data);
     MDF_PARAM_CHECK(size);
-    MDF_PARAM_CHECK(type == MWIFI_DATA_MEMORY_MALLOC_INTERNAL || *size > 0);
+    MDF_PARAM_CHECK(type != MWIFI_DATA_MEMORY_MALLOC_EXTERNAL || *size > 0);
     MDF_ERROR_CHECK(!mwifi_is_started(), MDF_ERR_MWIFI_NOT_START, "Mwifi isn't started");
-    MDF_ERROR_CHECK(type != MWIFI_DATA_MEMORY_MALLOC_EXTERNAL && type != MWIFI_DATA_MEMORY_MALLOC_INTERNAL, MDF_ERR_INVALID_ARG,
+    MDF_ERROR_CHECK(type != MWIFI_DATA_MEMORY_MALLOC_EXTERNAL && type != MWIFI_DATA_MEMORY_MALLOC_INTERNAL
+                    && type != MWIFI_DATA_MEMORY_POOL, MDF_ERR_INVALID_ARG,
                     "To apply for buffer space externally, set the type of the data parameter to be (char *) or (uint8_t *)\n"
                     "To apply for buffer space internally, set the type of the data parameter to be (char **) or (uint8_t **)");
 
@@ -984,27 +3374,38 @@ mdf_err_t __mwifi_read(uint8_t *src_addr, mwifi_data_type_t *data_type,
     size_t total_size            = 0;
     int data_flag                = 0;
     bool self_data_flag          = false;
-    static uint32_t s_data_magic = 0;
+    bool relay_flag              = false;
     TickType_t start_ticks       = xTaskGetTickCount();
+    uint8_t flood_addr[]         = MWIFI_ADDR_BROADCAST;
     mwifi_data_head_t data_head  = {0x0};
     mesh_data_t mesh_data        = {0x0};
     mesh_opt_t mesh_opt          = {
-        .len  = sizeof(mwifi_data_head_t),
+        .len  = MWIFI_DATA_HEAD_LEN,
         .val  = (void *) &data_head,
         .type = MESH_OPT_RECV_DS_ADDR,
     };
 
+    /**< The remaining messages of a packet held for a transmit window are read first */
+    ret = mwifi_coalesce_pop(&g_coalesce_read_rx, src_addr, data_type, data, size, type);
+
+    if (ret != MDF_ERR_NOT_FOUND) {
+        return ret;
+    }
+
     for (;;) {
-        recv_size  = 0;
-        total_size = 0;
-        recv_data  = MDF_REALLOC_RETRY(recv_data, MWIFI_PAYLOAD_LEN);
+        /**< The buffer of a forwarded packet may be smaller than a fragment, start over */
+        mwifi_buffer_free(&recv_data);
+        recv_data = mwifi_buffer_alloc(MWIFI_PAYLOAD_LEN);
+        ret = MDF_ERR_NO_MEM;
+        MDF_ERROR_GOTO(!recv_data, EXIT, "Allocate receive buffer");
 
-        for (int expect_seq = 0, recv_ticks = 0; !recv_size || recv_size < total_size; expect_seq++) {
-            mesh_data.size = recv_size ? total_size - recv_size : MWIFI_PAYLOAD_LEN;
-            mesh_data.data = recv_data + recv_size;
-            recv_ticks     = (wait_ticks == portMAX_DELAY) ? portMAX_DELAY :
-                             xTaskGetTickCount() - start_ticks < wait_ticks ?
-                             wait_ticks - (xTaskGetTickCount() - start_ticks) : 0;
+        for (int recv_ticks = 0;;) {
+            uint8_t *packet = NULL;
+            mesh_data.size  = MWIFI_PAYLOAD_LEN;
+            mesh_data.data  = recv_data;
+            recv_ticks      = (wait_ticks == portMAX_DELAY) ? portMAX_DELAY :
+                              xTaskGetTickCount() - start_ticks < wait_ticks ?
+                              wait_ticks - (xTaskGetTickCount() - start_ticks) : 0;
 
             MDF_LOGV("wait_ticks: %d, start_ticks: %d, recv_ticks: %d", wait_ticks, start_ticks, recv_ticks);
 
@@ -1026,68 +3427,60 @@ mdf_err_t __mwifi_read(uint8_t *src_addr, mwifi_data_type_t *data_type,
                 goto EXIT;
             }
 
+            MWIFI_STATS_ADD(src_addr, rx_fragments, 1);
+
             /**
-             * @brief Discard this packet if there is a packet loss in the middle
+             * @brief Filter retransmitted packets, a flooded packet is filtered by its magic
+             *        alone, as it may arrive again from a new parent after the topology changes.
              */
-            if (data_head.packet_seq != expect_seq) {
-                MDF_LOGW("Part of the packet is lost, expect_seq: %d, recv_seq: %d",
-                         expect_seq, data_head.packet_seq);
-
-                recv_size  = 0;
-                expect_seq = -1;
+            if (mdf_dedup_check(g_read_reassembly.dedup, data_head.transmit_all ? flood_addr : src_addr,
+                                data_head.magic)) {
+                MDF_LOGD("Received duplicate packets, src_addr: " MACSTR ", magic: 0x%x",
+                         MAC2STR(src_addr), data_head.magic);
+                MWIFI_STATS_ADD(src_addr, rx_duplicates, 1);
+                continue;
+            }
 
-                if (data_head.packet_seq != 0) {
-                    continue;
-                }
+            total_size = (data_head.total_size_hight << 12) + data_head.total_size_low;
 
-                memcpy(recv_data, mesh_data.data, mesh_data.size);
+            /**< The packet is not fragmented, use the receive buffer directly */
+            if (data_head.packet_seq == 0 && mesh_data.size == total_size) {
+                recv_size = total_size;
+                break;
             }
 
-            /**
-             * @brief Filter retransmitted packets
-             */
-            if (data_head.magic == s_data_magic) {
-                expect_seq--;
-                MDF_LOGD("Received duplicate packets, sequence: %d", s_data_magic);
-                continue;
+            /**< Wait for the remaining fragments of the packet */
+            if (mwifi_reassembly_put(&g_read_reassembly, src_addr, &data_head,
+                                     mesh_data.data, mesh_data.size, &packet, &recv_size)) {
+                mwifi_buffer_free(&recv_data);
+                recv_data = packet;
+                break;
             }
-
-            s_data_magic = data_head.magic;
-            total_size   = (data_head.total_size_hight << 12) + data_head.total_size_low;
-            recv_size   += mesh_data.size;
-            recv_data    = MDF_REALLOC_RETRY(recv_data, total_size);
         }
 
+        MWIFI_STATS_ADD(src_addr, rx_packets, 1);
+        MWIFI_STATS_ADD(src_addr, rx_bytes, recv_size);
+
+        ret = mwifi_data_head_ext_pull(src_addr, &data_head, recv_data, &recv_size);
+        MDF_ERROR_CONTINUE(ret != MDF_OK, "<%s> Drop the packet, src_addr: " MACSTR,
+                           mdf_err_to_name(ret), MAC2STR(src_addr));
+
         self_data_flag = data_head.transmit_self;
         mesh_data.data = recv_data;
         mesh_data.size = recv_size;
 
         /**
-         * @brief Existing data needs to be forwarded
+         * @brief Existing data needs to be forwarded, the relay task forwards it
+         *        so that reading doesn't wait for the children.
          */
-        if (data_head.transmit_num || data_head.transmit_all) {
-            mesh_addr_t *transmit_addr       = NULL;
-            size_t transmit_num              = data_head.transmit_num;
-            uint8_t addr_any[MWIFI_ADDR_LEN] = MWIFI_ADDR_BROADCAST;
-            data_flag = MESH_DATA_P2P;
-
-            if (data_head.transmit_all) {
-                transmit_num  = 1;
-                transmit_addr = (mesh_addr_t *)addr_any;
-            } else {
-                transmit_addr  = (mesh_addr_t *)recv_data;
-                mesh_data.data = recv_data + data_head.transmit_num * MWIFI_ADDR_LEN;
-                mesh_data.size = recv_size - data_head.transmit_num * MWIFI_ADDR_LEN;
-            }
-
-            MDF_LOGV("Data forwarding, size: %d, recv_size: %d, flag: %d, transmit_num: %d, data: %.*s",
-                     mesh_data.size, recv_size, data_flag, data_head.transmit_num, mesh_data.size, mesh_data.data);
+        relay_flag = data_head.transmit_num || data_head.transmit_all;
 
-            /**< Multicast forwarding */
-            ret = mwifi_transmit_write(transmit_addr, transmit_num, &mesh_data,
-                                       data_flag, &mesh_opt);
-            MDF_ERROR_GOTO(ret != MDF_OK, EXIT, "<%s> mwifi_root_write, size: %d",
-                           mdf_err_to_name(ret), mesh_data.size);
+        if (data_head.transmit_all) {
+            /**< Forward with the magic of the first fragment, as the flooding root sent it */
+            data_head.magic -= data_head.packet_seq;
+        } else {
+            mesh_data.data = recv_data + data_head.transmit_num * MWIFI_ADDR_LEN;
+            mesh_data.size = recv_size - data_head.transmit_num * MWIFI_ADDR_LEN;
         }
 
         /**
@@ -1111,33 +3504,50 @@ mdf_err_t __mwifi_read(uint8_t *src_addr, mwifi_data_type_t *data_type,
         if (self_data_flag) {
             break;
         }
+
+        /**< Not for this node, hand the buffer over to the relay task without copying */
+        if (relay_flag) {
+            relay_flag = false;
+            mwifi_relay_put(&recv_data, recv_size, &data_head, mesh_data.tos);
+        }
+    }
+
+    /**< Split a packet of held messages, a unicast packet is never forwarded */
+    if (data_head.coalesced && !relay_flag) {
+        mwifi_coalesce_split(&g_coalesce_read_rx, src_addr, &recv_data, recv_size);
+
+        ret = mwifi_coalesce_pop(&g_coalesce_read_rx, src_addr, data_type, data, size, type);
+        ret = (ret == MDF_ERR_NOT_FOUND) ? MDF_FAIL : ret;
+        goto EXIT;
     }
 
     memcpy(data_type, &data_head.type, sizeof(mwifi_data_type_t));
 
     if (data_type->compression) {
-        int mz_ret  = MZ_OK;
-        int mz_rate = data_head.compress_rate;
+        int mz_ret = MZ_OK;
 
-        if (type == MWIFI_DATA_MEMORY_MALLOC_INTERNAL) {
-            do {
-                mz_rate = (!mz_rate) ? 5 : mz_rate;
-                *size = mesh_data.size * mz_rate;
-                *((uint8_t **)data) = MDF_REALLOC_RETRY(*((uint8_t **)data), *size);
-                mz_ret = uncompress(*((uint8_t **)data), (mz_ulong *)size, mesh_data.data, mesh_data.size);
-                mz_rate += 2;
-                ret = MDF_FAIL;
-            } while (mz_ret == MZ_BUF_ERROR);
+        if (type != MWIFI_DATA_MEMORY_MALLOC_EXTERNAL) {
+            mz_ret = mwifi_uncompress_alloc((uint8_t **)data, size, mesh_data.data, mesh_data.size,
+                                            &data_head, type == MWIFI_DATA_MEMORY_POOL);
+            ret = MDF_FAIL;
 
             if (mz_ret != MZ_OK) {
-                ret = MDF_FAIL;
-                MDF_LOGW("<%s> Uncompress, size: %d", mz_error(mz_ret), mesh_data.size);
-                MDF_FREE(*((uint8_t **)data));
-                goto EXIT;
+                MWIFI_STATS_ADD(src_addr, rx_uncompress_failed, 1);
             }
+
+            MDF_ERROR_GOTO(mz_ret != MZ_OK, EXIT, "<%s> Uncompress, size: %d", mz_error(mz_ret), mesh_data.size);
         } else {
-            mz_ret = uncompress((uint8_t *)data, (mz_ulong *)size, mesh_data.data, mesh_data.size);
+            ret = MDF_ERR_BUF;
+            MDF_ERROR_GOTO(*size < data_head.uncompressed_size, EXIT,
+                           "Buffer is too small, size: %zu, the expected size is: %d", *size, data_head.uncompressed_size);
+
+            mz_ret = mwifi_uncompress((uint8_t *)data, size, mesh_data.data, mesh_data.size, data_head.compress_dict);
             ret = (mz_ret == MZ_BUF_ERROR) ? MDF_ERR_BUF : MDF_FAIL;
+
+            if (mz_ret != MZ_OK) {
+                MWIFI_STATS_ADD(src_addr, rx_uncompress_failed, 1);
+            }
+
             MDF_ERROR_GOTO(mz_ret != MZ_OK, EXIT, "<%s> Uncompress, size: %d", mz_error(mz_ret), mesh_data.size);
         }
     } else {
@@ -1145,48 +3555,79 @@ mdf_err_t __mwifi_read(uint8_t *src_addr, mwifi_data_type_t *data_type,
             *size = mesh_data.size;
             *((uint8_t **)data) = MDF_REALLOC_RETRY(NULL, mesh_data.size);
             memcpy(*((uint8_t **)data), mesh_data.data, mesh_data.size);
+        } else if (type == MWIFI_DATA_MEMORY_POOL && relay_flag) {
+            /**< The receive buffer is still to be forwarded, the caller gets a copy */
+            ret = MDF_ERR_NO_MEM;
+            *((uint8_t **)data) = mwifi_buffer_alloc(mesh_data.size);
+            MDF_ERROR_GOTO(!*((uint8_t **)data), EXIT, "Allocate receive buffer");
+            memcpy(*((uint8_t **)data), mesh_data.data, mesh_data.size);
+            *size = mesh_data.size;
+        } else if (type == MWIFI_DATA_MEMORY_POOL) {
+            /**< Hand the receive buffer over to the caller, no copy to a new buffer */
+            memmove(recv_data, mesh_data.data, mesh_data.size);
+            *size = mesh_data.size;
+            *((uint8_t **)data) = recv_data;
+            recv_data = NULL;
         } else {
             ret = (*size < mesh_data.size) ? MDF_ERR_BUF : MDF_FAIL;
             MDF_ERROR_GOTO(*size < mesh_data.size, EXIT,
-                           "Buffer is too small, size: %d, the expected size is: %d", *size, mesh_data.size);
+                           "Buffer is too small, size: %zu, the expected size is: %d", *size, mesh_data.size);
             *size = mesh_data.size;
             memcpy(data, mesh_data.data, mesh_data.size);
         }
     }
 
     ret = MDF_OK;
-    MDF_LOGD("esp_mesh_recv, src_addr: " MACSTR ", size: %d, data: %.*s",
-             MAC2STR(src_addr), *size, *size, (type == MWIFI_DATA_MEMORY_MALLOC_INTERNAL) ? * ((char **)data) : (char *)data);
+    MDF_LOGD("esp_mesh_recv, src_addr: " MACSTR ", size: %zu, data: %.*s",
+             MAC2STR(src_addr), *size, (int)*size, (type != MWIFI_DATA_MEMORY_MALLOC_EXTERNAL) ? * ((char **)data) : (char *)data);
 
 EXIT:
-    MDF_FREE(recv_data);
+    /**< The packet is also for this node, it is forwarded once delivered, even if delivering failed */
+    if (relay_flag && recv_data) {
+        mwifi_relay_put(&recv_data, recv_size, &data_head, mesh_data.tos);
+    }
+
+    mwifi_buffer_free(&recv_data);
     return ret;
 }
 
 mdf_err_t mwifi_root_write(const uint8_t *addrs_list, size_t addrs_num,
                            const mwifi_data_type_t *data_type, const void *data,
                            size_t size, bool block)
+{
+    MDF_PARAM_CHECK(data);
+
+    mwifi_iovec_t iov = {
+        .data = data,
+        .size = size,
+    };
+
+    return mwifi_root_writev(addrs_list, addrs_num, data_type, &iov, 1, block);
+}
+
+mdf_err_t mwifi_root_writev(const uint8_t *addrs_list, size_t addrs_num,
+                            const mwifi_data_type_t *data_type,
+                            const mwifi_iovec_t *iov, size_t iovcnt, bool block)
 {
     MDF_PARAM_CHECK(addrs_list);
     MDF_PARAM_CHECK(addrs_num > 0);
     MDF_PARAM_CHECK(data_type);
-    MDF_PARAM_CHECK(data);
+    MDF_PARAM_CHECK(iov);
+    MDF_PARAM_CHECK(iovcnt > 0 && iovcnt <= MWIFI_IOV_MAX);
     MDF_PARAM_CHECK(!MWIFI_ADDR_IS_EMPTY(addrs_list));
-    MDF_PARAM_CHECK(size > 0 && size < 8096);
+    MDF_PARAM_CHECK(mwifi_iov_size(iov, iovcnt) > 0 && mwifi_iov_size(iov, iovcnt) < 8096);
     MDF_ERROR_CHECK(!mwifi_is_started(), MDF_ERR_MWIFI_NOT_START, "Mwifi isn't started");
 
     mdf_err_t ret = MDF_OK;
     int data_flag = MESH_DATA_FROMDS;
+    size_t size   = mwifi_iov_size(iov, iovcnt);
     uint8_t *compress_data = NULL;
     uint8_t *tmp_addrs = NULL;
+    uint8_t tos        = !block || !g_init_config->retransmit_enable ? MESH_TOS_DEF : MESH_TOS_P2P;
     mwifi_data_head_t data_head = {
         .transmit_self = true,
     };
-    mesh_data_t mesh_data = {
-        .tos   = !block || !g_init_config->retransmit_enable ? MESH_TOS_DEF : MESH_TOS_P2P,
-        .data  = (uint8_t *)data,
-        .size  = size,
-    };
+    mwifi_iovec_t compress_iov = {0};
     mesh_opt_t mesh_opt   = {
         .len  = sizeof(mwifi_data_head_t),
         .val  = (void *) &data_head,
@@ -1201,9 +3642,9 @@ mdf_err_t mwifi_root_write(const uint8_t *addrs_list, size_t addrs_num,
      */
     if (data_head.type.group && data_type->communicate != MWIFI_COMMUNICATE_BROADCAST) {
         for (int i = 0; i < addrs_num; ++i) {
-            MDF_LOGD("count: %d, dest_addr: " MACSTR ", mesh_data.size: %d, data: %.*s",
-                     i, MAC2STR(addrs_list + 6 * i), mesh_data.size, mesh_data.size, mesh_data.data);
-            ret = mwifi_write(addrs_list + 6 * i, data_type, data, size, block);
+            MDF_LOGD("count: %d, dest_addr: " MACSTR ", size: %zu, iovcnt: %zu",
+                     i, MAC2STR(addrs_list + 6 * i), size, iovcnt);
+            ret = mwifi_writev(addrs_list + 6 * i, data_type, iov, iovcnt, block);
             MDF_ERROR_BREAK(ret != ESP_OK, "<%s> Root node failed to send packets, dest_mac: " MACSTR,
                             mdf_err_to_name(ret), MAC2STR(addrs_list));
         }
@@ -1215,81 +3656,78 @@ mdf_err_t mwifi_root_write(const uint8_t *addrs_list, size_t addrs_num,
      * @brief data compression
      */
     if (data_head.type.compression) {
+        uint8_t *raw_data  = NULL;
+        bool compress_dict = false;
+
         ret = MDF_ERR_NO_MEM;
-        mz_ulong compress_size = compressBound(size);
+        size_t compress_size = compressBound(size);
         compress_data = MDF_MALLOC(compress_size);
         MDF_ERROR_GOTO(!compress_data, EXIT, "");
 
-        ret = compress(compress_data, &compress_size, (uint8_t *)data, size);
+        /**< Deflate needs contiguous input, gather the payload only if it is scattered */
+        if (iovcnt > 1) {
+            raw_data = MDF_MALLOC(size);
+            MDF_ERROR_GOTO(!raw_data, EXIT, "");
+        }
+
+        compress_dict = MWIFI_COMPRESS_DICT_ENABLE && size <= MWIFI_COMPRESS_DICT_DATA_MAX;
+        ret = mwifi_compress(compress_data, &compress_size,
+                             mwifi_iov_fragment(iov, iovcnt, 0, size, raw_data), size, compress_dict);
+        MDF_FREE(raw_data);
         MDF_ERROR_GOTO(ret != MZ_OK, EXIT, "Compressed whitelist failed, ret: 0x%x", -ret);
 
-        MDF_LOGD("compress, size: %d, compress_size: %d, rate: %d%%",
-                 size, (int)compress_size, (int)compress_size * 100 / size);
+        MDF_LOGD("compress, size: %zu, compress_size: %d, rate: %d%%",
+                 size, (int)compress_size, (int)(compress_size * 100 / size));
 
         if (compress_size > size) {
             data_head.type.compression = false;
         } else {
-            mesh_data.data = compress_data;
-            mesh_data.size = compress_size;
+            compress_iov.data = compress_data;
+            compress_iov.size = compress_size;
+            iov    = &compress_iov;
+            iovcnt = 1;
             data_head.compress_rate = (size / compress_size + 1) >= 15 ? 15 : (size / compress_size + 1);
+            data_head.uncompressed_size = (size <= MWIFI_UNCOMPRESSED_SIZE_MAX) ? size : 0;
+            data_head.compress_dict     = compress_dict;
         }
     }
 
-    if (data_type->communicate == MWIFI_COMMUNICATE_UNICAST) {
-        /**
-         * @brief If destination adress is any device or other device expect root, get all nodes adress.
-         */
-        if (MWIFI_ADDR_IS_ANY(addrs_list) || MWIFI_ADDR_IS_BROADCAST(addrs_list)) {
-            ret = MDF_ERR_NO_MEM;
-            addrs_num  = esp_mesh_get_routing_table_size();
-            tmp_addrs = MDF_MALLOC(addrs_num * sizeof(mesh_addr_t));
-            MDF_ERROR_GOTO(!tmp_addrs, EXIT, "");
-            ESP_ERROR_CHECK(esp_mesh_get_routing_table((mesh_addr_t *)tmp_addrs,
-                            addrs_num * sizeof(mesh_addr_t), (int *)&addrs_num));
-
-            if (MWIFI_ADDR_IS_BROADCAST(addrs_list)) {
-                uint8_t root_mac[6] = {0x0};
-                ESP_ERROR_CHECK(esp_wifi_get_mac(ESP_IF_WIFI_STA, root_mac));
-                addrs_remove((mesh_addr_t *)tmp_addrs, &addrs_num, (mesh_addr_t *)root_mac);
-                MDF_ERROR_GOTO(addrs_num > 2048 || addrs_num <= 0, EXIT, "dest_addrs_num: %d", addrs_num);
-            }
-
-            addrs_list = tmp_addrs;
-        }
-
+    if (data_type->communicate == MWIFI_COMMUNICATE_UNICAST
+            && !MWIFI_ADDR_IS_ANY(addrs_list) && !MWIFI_ADDR_IS_BROADCAST(addrs_list)) {
         /**
          * @brief Send each device by p2p
          */
         for (int i = 0; i < addrs_num; ++i) {
-            MDF_LOGD("count: %d, dest_addr: " MACSTR" mesh_data.size: %d, data: %.*s",
-                     i, MAC2STR(addrs_list + 6 * i), mesh_data.size, mesh_data.size, mesh_data.data);
+            MDF_LOGD("count: %d, dest_addr: " MACSTR" size: %zu, iovcnt: %zu",
+                     i, MAC2STR(addrs_list + 6 * i), size, iovcnt);
 
             /**< Fragmenting packets for transmission */
-            ret = mwifi_subcontract_write((mesh_addr_t *)addrs_list + i, &mesh_data, data_flag, &mesh_opt);
+            ret = mwifi_subcontract_write((mesh_addr_t *)addrs_list + i, tos, iov, iovcnt, data_flag, &mesh_opt);
             MDF_ERROR_BREAK(ret != ESP_OK, "<%s> Root node failed to send packets, dest_mac: "MACSTR,
                             mdf_err_to_name(ret), MAC2STR(addrs_list));
         }
-    } else if (data_type->communicate == MWIFI_COMMUNICATE_MULTICAST) {
+    } else if (data_type->communicate != MWIFI_COMMUNICATE_BROADCAST || addrs_num > 1) {
+        /**
+         * @brief Multicast, and unicast or broadcast to several devices, are forwarded down
+         *        the tree. A packet to any device is flooded: the root sends it once to each
+         *        child, and each node forwards it once to each of its children.
+         */
         ret = MDF_ERR_NO_MEM;
         tmp_addrs = MDF_MALLOC(addrs_num * sizeof(mesh_addr_t));
         MDF_ERROR_GOTO(!tmp_addrs, EXIT, "");
         memcpy(tmp_addrs, addrs_list, addrs_num * sizeof(mesh_addr_t));
-        MDF_LOGD("addrs_num: %d, addrs_list: " MACSTR ", mesh_data.size: %d",
-                 addrs_num, MAC2STR(tmp_addrs), mesh_data.size);
+        MDF_LOGD("addrs_num: %zu, addrs_list: " MACSTR ", size: %zu",
+                 addrs_num, MAC2STR(tmp_addrs), size);
 
         /**< Multicast forwarding */
-        ret = mwifi_transmit_write((mesh_addr_t *)tmp_addrs, addrs_num, &mesh_data,
+        ret = mwifi_transmit_write((mesh_addr_t *)tmp_addrs, addrs_num, tos, iov, iovcnt,
                                    data_flag, &mesh_opt);
         MDF_ERROR_GOTO(ret != MDF_OK, EXIT, "Mwifi_transmit_write");
-    } else if (data_type->communicate == MWIFI_COMMUNICATE_BROADCAST && addrs_num == 1) {
-
+    } else {
         /**< Fragmenting packets for transmission */
-        ret = mwifi_subcontract_write((mesh_addr_t *)addrs_list, &mesh_data, data_flag, &mesh_opt);
+        ret = mwifi_subcontract_write((mesh_addr_t *)addrs_list, tos, iov, iovcnt, data_flag, &mesh_opt);
         MDF_ERROR_GOTO(ret != ESP_OK, EXIT, "<%s> Root node failed to send packets, dest_mac: " MACSTR,
                        mdf_err_to_name(ret), MAC2STR(addrs_list));
-    } else {
-        MDF_LOGE("<MDF_ERR_NOT_SUPPORTED> The current version does not support broadcasting.");
-        return MDF_ERR_NOT_SUPPORTED;
     }
 
 EXIT:
@@ -1298,41 +3736,40 @@ EXIT:
     return ret;
 }
 
-mdf_err_t __mwifi_root_read(uint8_t *src_addr, mwifi_data_type_t *data_type,
-                            void *data, size_t *size, TickType_t wait_ticks, uint8_t type)
+/**
+ * @brief Receive the next packet to the external IP network, the retransmitted
+ *        fragments are filtered and the others reassembled
+ *
+ * @param  data  Receive buffer of the packet as output, freed with mwifi_buffer_free()
+ */
+static mdf_err_t mwifi_root_recv(uint8_t *src_addr, mwifi_data_head_t *data_head,
+                                 uint8_t **data, size_t *size, TickType_t wait_ticks)
 {
-    MDF_PARAM_CHECK(src_addr);
-    MDF_PARAM_CHECK(data_type);
-    MDF_PARAM_CHECK(data);
-    MDF_PARAM_CHECK(size);
-    MDF_PARAM_CHECK(type == MWIFI_DATA_MEMORY_MALLOC_INTERNAL || *size > 0);
-    MDF_ERROR_CHECK(!mwifi_is_started(), MDF_ERR_MWIFI_NOT_START, "Mwifi isn't started");
-    MDF_ERROR_CHECK(type != MWIFI_DATA_MEMORY_MALLOC_EXTERNAL && type != MWIFI_DATA_MEMORY_MALLOC_INTERNAL, MDF_ERR_INVALID_ARG,
-                    "To apply for buffer space externally, set the type of the data parameter to be (char *) or (uint8_t *)\n"
-                    "To apply for buffer space internally, set the type of the data parameter to be (char **) or (uint8_t **)");
+    mdf_err_t ret          = MDF_OK;
+    int data_flag          = 0;
+    mesh_addr_t dest_addr  = {0};
+    TickType_t start_ticks = xTaskGetTickCount();
+    size_t recv_size       = 0;
+    uint8_t *recv_data     = NULL;
+    size_t total_size      = 0;
 
-    mdf_err_t ret               = MDF_OK;
-    int data_flag               = 0;
-    mesh_addr_t dest_addr       = {0};
-    mwifi_data_head_t data_head = {0x0};
-    TickType_t start_ticks      = xTaskGetTickCount();
-    ssize_t recv_size           = 0;
-    uint8_t *recv_data          = MDF_REALLOC_RETRY(NULL, MWIFI_PAYLOAD_LEN);
-    size_t total_size           = 0;
+    recv_data = mwifi_buffer_alloc(MWIFI_PAYLOAD_LEN);
+    MDF_ERROR_CHECK(!recv_data, MDF_ERR_NO_MEM, "Allocate receive buffer");
 
     mesh_data_t mesh_data = {0x0};
     mesh_opt_t mesh_opt   = {
-        .len  = sizeof(mwifi_data_head_t),
-        .val  = (void *) &data_head,
+        .len  = MWIFI_DATA_HEAD_LEN,
+        .val  = (void *) data_head,
         .type = MESH_OPT_RECV_DS_ADDR,
     };
 
-    for (int expect_seq = 0, recv_ticks = 0; !expect_seq || recv_size < total_size; expect_seq++) {
-        mesh_data.size = !expect_seq ? MWIFI_PAYLOAD_LEN : total_size - recv_size;
-        mesh_data.data = recv_data + recv_size;
-        recv_ticks     = (wait_ticks == portMAX_DELAY) ? portMAX_DELAY :
-                         xTaskGetTickCount() - start_ticks < wait_ticks ?
-                         wait_ticks - (xTaskGetTickCount() - start_ticks) : 0;
+    for (int recv_ticks = 0;;) {
+        uint8_t *packet = NULL;
+        mesh_data.size  = MWIFI_PAYLOAD_LEN;
+        mesh_data.data  = recv_data;
+        recv_ticks      = (wait_ticks == portMAX_DELAY) ? portMAX_DELAY :
+                          xTaskGetTickCount() - start_ticks < wait_ticks ?
+                          wait_ticks - (xTaskGetTickCount() - start_ticks) : 0;
 
         MDF_LOGV("wait_ticks: %d, start_ticks: %d, recv_ticks: %d", wait_ticks, start_ticks, recv_ticks);
 
@@ -1349,77 +3786,437 @@ mdf_err_t __mwifi_root_read(uint8_t *src_addr, mwifi_data_type_t *data_type,
             goto EXIT;
         }
 
-        MDF_ERROR_GOTO(ret != ESP_OK || mesh_data.size <= 0, EXIT, "<%s> Node failed to receive packets", mdf_err_to_name(ret));
+        ret = (ret == ESP_OK && mesh_data.size <= 0) ? MDF_FAIL : ret;
+        MDF_ERROR_GOTO(ret != ESP_OK, EXIT, "<%s> Node failed to receive packets", mdf_err_to_name(ret));
+        MWIFI_STATS_ADD(src_addr, rx_fragments, 1);
 
         /**
-         * @brief Discard this packet if there is a packet loss in the middle
+         * @brief Filter retransmitted packets
          */
-        if (data_head.packet_seq != expect_seq) {
-            MDF_LOGW("Part of the packet is lost, expect_seq: %d, recv_seq: %d",
-                     expect_seq, data_head.packet_seq);
+        if (mdf_dedup_check(g_root_read_reassembly.dedup, src_addr, data_head->magic)) {
+            MDF_LOGD("Received duplicate packets, src_addr: " MACSTR ", magic: 0x%x",
+                     MAC2STR(src_addr), data_head->magic);
+            MWIFI_STATS_ADD(src_addr, rx_duplicates, 1);
+            continue;
+        }
 
-            recv_size  = 0;
-            expect_seq = -1;
+        total_size = (data_head->total_size_hight << 12) + data_head->total_size_low;
 
-            if (data_head.packet_seq != 0) {
-                continue;
+        /**< The packet is not fragmented, use the receive buffer directly */
+        if (data_head->packet_seq == 0 && mesh_data.size == total_size) {
+            recv_size = total_size;
+            break;
+        }
+
+        /**< Wait for the remaining fragments of the packet */
+        if (mwifi_reassembly_put(&g_root_read_reassembly, src_addr, data_head,
+                                 mesh_data.data, mesh_data.size, &packet, &recv_size)) {
+            mwifi_buffer_free(&recv_data);
+            recv_data = packet;
+            break;
+        }
+    }
+
+    MWIFI_STATS_ADD(src_addr, rx_packets, 1);
+    MWIFI_STATS_ADD(src_addr, rx_bytes, recv_size);
+
+    ret = mwifi_data_head_ext_pull(src_addr, data_head, recv_data, &recv_size);
+    MDF_ERROR_GOTO(ret != MDF_OK, EXIT, "<%s> Drop the packet, src_addr: " MACSTR,
+                   mdf_err_to_name(ret), MAC2STR(src_addr));
+
+    *data     = recv_data;
+    *size     = recv_size;
+    recv_data = NULL;
+
+EXIT:
+    mwifi_buffer_free(&recv_data);
+    return ret;
+}
+
+#ifdef CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE
+/**
+ * @brief Flow queue of a source, the lock must be held.
+ *
+ *        By address, a source keeps the queue holding its packets, otherwise it takes
+ *        its hashed queue or an empty one, so that the sources only share a queue when
+ *        there are more busy sources than queues. By subtree, the children of the root
+ *        are served in turn and a source outside the subnets is hashed by its address.
+ */
+static mwifi_fq_queue_t *mwifi_fq_queue(const uint8_t *src_addr, uint8_t child)
+{
+    uint32_t hash           = src_addr[2] << 24 | src_addr[3] << 16 | src_addr[4] << 8 | src_addr[5];
+    mwifi_fq_queue_t *queue = g_fq.queue + ((hash * 2654435761U) >> 16) % MWIFI_RX_QUEUE_NUM;
+
+    if (child) {
+        return g_fq.queue + (child - 1) % MWIFI_RX_QUEUE_NUM;
+    }
+
+#ifdef CONFIG_MWIFI_ROOT_FAIR_QUEUE_BY_SOURCE
+    for (int i = 0; i < MWIFI_RX_QUEUE_NUM; ++i) {
+        for (mwifi_fq_packet_t *packet = g_fq.queue[i].head; packet; packet = packet->next) {
+            if (!memcmp(packet->src_addr, src_addr, MWIFI_ADDR_LEN)) {
+                return g_fq.queue + i;
+            }
+        }
+
+        queue = (!queue->head || g_fq.queue[i].head) ? queue : g_fq.queue + i;
+    }
+#endif /**< CONFIG_MWIFI_ROOT_FAIR_QUEUE_BY_SOURCE */
+
+    return queue;
+}
+
+/**
+ * @brief Queue a received packet. When its queue or all the queues are full, the oldest
+ *        packet of its queue or of the longest queue, in bytes, is dropped.
+ */
+static void mwifi_fq_put(const uint8_t *src_addr, const mwifi_data_head_t *data_head,
+                         uint8_t **data, size_t size)
+{
+    uint8_t child                = 0;
+    mwifi_fq_queue_t *queue      = NULL;
+    mwifi_fq_queue_t *drop_queue = NULL;
+    mwifi_fq_packet_t *drop      = NULL;
+    mwifi_fq_packet_t *packet    = MDF_MALLOC(sizeof(mwifi_fq_packet_t));
+
+    if (!packet) {
+        MDF_LOGW("Allocate a queued packet, size: %zu", size);
+        MWIFI_STATS_ADD(src_addr, rx_queue_drops, 1);
+        mwifi_buffer_free(data);
+        return;
+    }
+
+    packet->next         = NULL;
+    packet->data         = *data;
+    packet->size         = size;
+    packet->enqueue_time = esp_timer_get_time();
+    memcpy(packet->src_addr, src_addr, MWIFI_ADDR_LEN);
+    memcpy(&packet->data_head, data_head, sizeof(mwifi_data_head_t));
+    *data = NULL;
+
+#ifdef CONFIG_MWIFI_ROOT_FAIR_QUEUE_BY_SUBTREE
+    xSemaphoreTake(g_subnet_index.lock, portMAX_DELAY);
+    mwifi_subnet_index_update(&g_subnet_index);
+    child = mwifi_subnet_index_lookup(&g_subnet_index, (const mesh_addr_t *)src_addr);
+    xSemaphoreGive(g_subnet_index.lock);
+#endif /**< CONFIG_MWIFI_ROOT_FAIR_QUEUE_BY_SUBTREE */
+
+    xSemaphoreTake(g_fq.lock, portMAX_DELAY);
+
+    queue = mwifi_fq_queue(src_addr, child);
+
+    /**< Queued first, so that the new packet counts for the longest queue */
+    if (queue->tail) {
+        queue->tail->next = packet;
+    } else {
+        queue->head = packet;
+    }
+
+    queue->tail   = packet;
+    queue->bytes += size;
+    queue->stats.depth++;
+    queue->stats.depth_max = MAX(queue->stats.depth_max, queue->stats.depth);
+    queue->stats.enqueued++;
+    memcpy(queue->stats.addr, src_addr, MWIFI_ADDR_LEN);
+    g_fq.packet_num++;
+
+    if (queue->stats.depth > CONFIG_MWIFI_ROOT_FAIR_QUEUE_SIZE) {
+        drop_queue = queue;
+    } else if (g_fq.packet_num > CONFIG_MWIFI_ROOT_FAIR_QUEUE_TOTAL) {
+        drop_queue = queue;
+
+        for (int i = 0; i < MWIFI_RX_QUEUE_NUM; ++i) {
+            if (g_fq.queue[i].bytes > drop_queue->bytes) {
+                drop_queue = g_fq.queue + i;
             }
+        }
+    }
+
+    if (drop_queue) {
+        drop              = drop_queue->head;
+        drop_queue->head  = drop->next;
+        drop_queue->tail  = drop_queue->head ? drop_queue->tail : NULL;
+        drop_queue->bytes -= drop->size;
+        drop_queue->stats.depth--;
+        drop_queue->stats.dropped++;
+        g_fq.packet_num--;
+    } else {
+        xSemaphoreGive(g_fq.pending);
+    }
+
+    xSemaphoreGive(g_fq.lock);
+
+    if (drop) {
+        MDF_LOGD("Flow queues are full, drop a packet, src_addr: " MACSTR ", size: %zu",
+                 MAC2STR(drop->src_addr), drop->size);
+        MWIFI_STATS_ADD(drop->src_addr, rx_queue_drops, 1);
+        mwifi_buffer_free(&drop->data);
+        MDF_FREE(drop);
+    }
+}
+
+/**
+ * @brief Take the next packet by deficit round-robin, the lock must be held and a packet queued.
+ *
+ *        A queue reads packets while its deficit covers them, then the next non-empty
+ *        queue gets MWIFI_PAYLOAD_LEN bytes more, so each flow reads about the same
+ *        number of bytes whatever the size of its packets.
+ */
+static mwifi_fq_packet_t *mwifi_fq_dequeue()
+{
+    mwifi_fq_queue_t *queue = g_fq.queue + g_fq.next_queue;
+
+    while (!queue->head || queue->deficit < (int)queue->head->size) {
+        if (!queue->head) {
+            queue->deficit = 0;
+        }
+
+        g_fq.next_queue = (g_fq.next_queue + 1) % MWIFI_RX_QUEUE_NUM;
+        queue           = g_fq.queue + g_fq.next_queue;
+
+        if (queue->head) {
+            queue->deficit += MWIFI_PAYLOAD_LEN;
+        }
+    }
+
+    mwifi_fq_packet_t *packet = queue->head;
+    queue->head     = packet->next;
+    queue->tail     = queue->head ? queue->tail : NULL;
+    queue->deficit -= packet->size;
+    queue->bytes   -= packet->size;
+    queue->stats.depth--;
+    g_fq.packet_num--;
+
+    uint32_t latency_ms = (esp_timer_get_time() - packet->enqueue_time) / 1000;
+    queue->stats.read++;
+    queue->stats.latency_max_ms = MAX(queue->stats.latency_max_ms, latency_ms);
+    queue->latency_sum_ms      += latency_ms;
+
+    return packet;
+}
+
+/**
+ * @brief Read the next packet of the flow queues
+ */
+static mdf_err_t mwifi_fq_get(uint8_t *src_addr, mwifi_data_head_t *data_head,
+                              uint8_t **data, size_t *size, TickType_t wait_ticks)
+{
+    mwifi_fq_packet_t *packet = NULL;
+
+    if (!xSemaphoreTake(g_fq.pending, wait_ticks)) {
+        MDF_LOGD("<MDF_ERR_MWIFI_TIMEOUT> Node failed to receive packets");
+        return ESP_ERR_MESH_TIMEOUT;
+    }
+
+    /**< The queues may have been flushed by a role change since the packet was counted */
+    xSemaphoreTake(g_fq.lock, portMAX_DELAY);
+    packet = g_fq.packet_num ? mwifi_fq_dequeue() : NULL;
+    xSemaphoreGive(g_fq.lock);
+
+    if (!packet) {
+        return ESP_ERR_MESH_TIMEOUT;
+    }
+
+    memcpy(src_addr, packet->src_addr, MWIFI_ADDR_LEN);
+    memcpy(data_head, &packet->data_head, sizeof(mwifi_data_head_t));
+    *data = packet->data;
+    *size = packet->size;
+    MDF_FREE(packet);
+
+    return MDF_OK;
+}
+
+static void mwifi_fq_task(void *arg)
+{
+    mdf_err_t ret                    = MDF_OK;
+    uint8_t src_addr[MWIFI_ADDR_LEN] = {0};
+    mwifi_data_head_t data_head      = {0};
+    uint8_t *data                    = NULL;
+    size_t size                      = 0;
+
+    while (!g_fq.exit) {
+        /**< A short wait, so that the task notices when it is stopped */
+        ret = mwifi_root_recv(src_addr, &data_head, &data, &size, 100 / portTICK_RATE_MS);
+
+        if (ret == MDF_OK) {
+            mwifi_fq_put(src_addr, &data_head, &data, size);
+        } else if (ret != ESP_ERR_MESH_TIMEOUT) {
+            vTaskDelay(10 / portTICK_RATE_MS);
+        }
+    }
+
+    g_fq.task = NULL;
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Stop the flow queue task, the packets left in the queues are dropped
+ */
+static void mwifi_fq_stop()
+{
+    size_t drop_num = 0;
+
+    if (g_fq.task) {
+        g_fq.exit = true;
+
+        while (g_fq.task) {
+            vTaskDelay(10 / portTICK_RATE_MS);
+        }
+    }
+
+    if (!g_fq.lock) {
+        return;
+    }
 
-            memcpy(recv_data, mesh_data.data, mesh_data.size);
+    xSemaphoreTake(g_fq.lock, portMAX_DELAY);
+
+    for (int i = 0; i < MWIFI_RX_QUEUE_NUM; ++i) {
+        for (mwifi_fq_packet_t *packet = g_fq.queue[i].head, *next = NULL; packet; packet = next) {
+            next = packet->next;
+            drop_num++;
+            MWIFI_STATS_ADD(packet->src_addr, rx_queue_drops, 1);
+            mwifi_buffer_free(&packet->data);
+            MDF_FREE(packet);
         }
+    }
+
+    memset(g_fq.queue, 0, sizeof(g_fq.queue));
+    g_fq.packet_num = 0;
+    g_fq.next_queue = 0;
+
+    while (xSemaphoreTake(g_fq.pending, 0) == pdTRUE) {
+    }
+
+    xSemaphoreGive(g_fq.lock);
+
+    if (drop_num) {
+        MDF_LOGD("Flow queues are stopped, drop %zu packets", drop_num);
+    }
+}
+
+/**
+ * @brief Run the flow queue task while this device is the root of a started mesh. It is
+ *        called on the events changing the role, the packets queued by a former root are dropped.
+ */
+static mdf_err_t mwifi_fq_update()
+{
+    if (!g_fq.lock || !mwifi_is_started() || !esp_mesh_is_root()) {
+        mwifi_fq_stop();
+        return MDF_OK;
+    }
+
+    /**< Receives the packets to the external IP network, the dedup table and the reassembly are its own */
+    if (!g_fq.task) {
+        g_fq.exit = false;
+        xTaskCreatePinnedToCore(mwifi_fq_task, "mwifi_fq", 3 * 1024,
+                                NULL, CONFIG_MDF_TASK_DEFAULT_PRIOTY,
+                                &g_fq.task, CONFIG_MDF_TASK_PINNED_TO_CORE);
+        MDF_ERROR_CHECK(!g_fq.task, MDF_ERR_NO_MEM, "Create the flow queue task");
+    }
+
+    return MDF_OK;
+}
+#endif /**< CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE */
+
+mdf_err_t __mwifi_root_read(uint8_t *src_addr, mwifi_data_type_t *data_type,
+                            void *data, size_t *size, TickType_t wait_ticks, uint8_t type)
+{
+    MDF_PARAM_CHECK(src_addr);
+    MDF_PARAM_CHECK(data_type);
+    MDF_PARAM_CHECK(data);
+    MDF_PARAM_CHECK(size);
+    MDF_PARAM_CHECK(type != MWIFI_DATA_MEMORY_MALLOC_EXTERNAL || *size > 0);
+    MDF_ERROR_CHECK(!mwifi_is_started(), MDF_ERR_MWIFI_NOT_START, "Mwifi isn't started");
+    MDF_ERROR_CHECK(type != MWIFI_DATA_MEMORY_MALLOC_EXTERNAL && type != MWIFI_DATA_MEMORY_MALLOC_INTERNAL
+                    && type != MWIFI_DATA_MEMORY_POOL, MDF_ERR_INVALID_ARG,
+                    "To apply for buffer space externally, set the type of the data parameter to be (char *) or (uint8_t *)\n"
+                    "To apply for buffer space internally, set the type of the data parameter to be (char **) or (uint8_t **)");
+
+    mdf_err_t ret               = MDF_OK;
+    mwifi_data_head_t data_head = {0x0};
+    size_t recv_size            = 0;
+    uint8_t *recv_data          = NULL;
+
+    /**< The remaining messages of a coalesced packet are read first */
+    ret = mwifi_coalesce_pop(&g_coalesce_rx, src_addr, data_type, data, size, type);
+
+    if (ret != MDF_ERR_NOT_FOUND) {
+        return ret;
+    }
 
-        total_size = (data_head.total_size_hight << 12) + data_head.total_size_low;
-        recv_size += mesh_data.size;
-        recv_data  = MDF_REALLOC_RETRY(recv_data, total_size);
+#ifdef CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE
+    ret = mwifi_fq_get(src_addr, &data_head, &recv_data, &recv_size, wait_ticks);
+#else
+    ret = mwifi_root_recv(src_addr, &data_head, &recv_data, &recv_size, wait_ticks);
+#endif /**< CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE */
+
+    if (ret != MDF_OK) {
+        return ret;
+    }
+
+    /**< Split a packet of coalesced messages, which are then read one by one */
+    if (data_head.coalesced) {
+        mwifi_coalesce_split(&g_coalesce_rx, src_addr, &recv_data, recv_size);
+
+        ret = mwifi_coalesce_pop(&g_coalesce_rx, src_addr, data_type, data, size, type);
+        ret = (ret == MDF_ERR_NOT_FOUND) ? MDF_FAIL : ret;
+        goto EXIT;
     }
 
     memcpy(data_type, &data_head.type, sizeof(mwifi_data_type_t));
 
     if (data_type->compression) {
-        int mz_ret  = MZ_OK;
-        int mz_rate = data_head.compress_rate;
+        int mz_ret = MZ_OK;
 
-        if (type == MWIFI_DATA_MEMORY_MALLOC_INTERNAL) {
-            do {
-                mz_rate = (!mz_rate) ? 5 : mz_rate;
-                *size = recv_size * mz_rate;
-                *((uint8_t **)data) = MDF_REALLOC_RETRY(*((uint8_t **)data), *size);
-                mz_ret = uncompress(*((uint8_t **)data), (mz_ulong *)size, recv_data, recv_size);
-                mz_rate += 2;
-                ret = MDF_FAIL;
-            } while (mz_ret == MZ_BUF_ERROR);
+        if (type != MWIFI_DATA_MEMORY_MALLOC_EXTERNAL) {
+            mz_ret = mwifi_uncompress_alloc((uint8_t **)data, size, recv_data, recv_size,
+                                            &data_head, type == MWIFI_DATA_MEMORY_POOL);
+            ret = MDF_FAIL;
 
             if (mz_ret != MZ_OK) {
-                ret = MDF_FAIL;
-                MDF_LOGW("<%s> Uncompress, size: %d", mz_error(mz_ret), *size);
-                MDF_FREE(*((uint8_t **)data));
-                goto EXIT;
+                MWIFI_STATS_ADD(src_addr, rx_uncompress_failed, 1);
             }
+
+            MDF_ERROR_GOTO(mz_ret != MZ_OK, EXIT, "<%s> Uncompress, size: %zu", mz_error(mz_ret), recv_size);
         } else {
-            mz_ret = uncompress((uint8_t *)data, (mz_ulong *)size, recv_data, recv_size);
+            ret = MDF_ERR_BUF;
+            MDF_ERROR_GOTO(*size < data_head.uncompressed_size, EXIT,
+                           "Buffer is too small, size: %zu, the expected size is: %d", *size, data_head.uncompressed_size);
+
+            mz_ret = mwifi_uncompress((uint8_t *)data, size, recv_data, recv_size, data_head.compress_dict);
             ret = (mz_ret == MZ_BUF_ERROR) ? MDF_ERR_BUF : MDF_FAIL;
-            MDF_ERROR_GOTO(mz_ret != MZ_OK, EXIT, "<%s> Uncompress, size: %d", mz_error(mz_ret), recv_size);
+
+            if (mz_ret != MZ_OK) {
+                MWIFI_STATS_ADD(src_addr, rx_uncompress_failed, 1);
+            }
+
+            MDF_ERROR_GOTO(mz_ret != MZ_OK, EXIT, "<%s> Uncompress, size: %zu", mz_error(mz_ret), recv_size);
         }
     } else {
         if (type == MWIFI_DATA_MEMORY_MALLOC_INTERNAL) {
             *size = recv_size;
             *((uint8_t **)data) = MDF_REALLOC_RETRY(NULL, recv_size);
             memcpy(*((uint8_t **)data), recv_data, recv_size);
+        } else if (type == MWIFI_DATA_MEMORY_POOL) {
+            /**< Hand the receive buffer over to the caller, no copy to a new buffer */
+            *size = recv_size;
+            *((uint8_t **)data) = recv_data;
+            recv_data = NULL;
         } else {
             ret = (*size < recv_size) ? MDF_ERR_BUF : MDF_FAIL;
             MDF_ERROR_GOTO(*size < recv_size, EXIT,
-                           "Buffer is too small, size: %d, the expected size is: %d", *size, recv_size);
+                           "Buffer is too small, size: %zu, the expected size is: %zu", *size, recv_size);
             *size = recv_size;
             memcpy(data, recv_data, recv_size);
         }
     }
 
     ret = MDF_OK;
-    MDF_LOGD("esp_mesh_recv_toDS, src_addr: " MACSTR ", size: %d, data: %.*s",
-             MAC2STR(src_addr), *size, *size, (type == MWIFI_DATA_MEMORY_MALLOC_INTERNAL) ? * ((char **)data) : (char *)data);
+    MDF_LOGD("esp_mesh_recv_toDS, src_addr: " MACSTR ", size: %zu, data: %.*s",
+             MAC2STR(src_addr), *size, (int)*size, (type != MWIFI_DATA_MEMORY_MALLOC_EXTERNAL) ? * ((char **)data) : (char *)data);
 
 EXIT:
-    MDF_FREE(recv_data);
+    mwifi_buffer_free(&recv_data);
     return ret;
 }
 
@@ -0,0 +1,277 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mwifi.h"
+#include "mwifi_rpc.h"
+
+#define MWIFI_RPC_TYPE_REQUEST      (0x1)
+#define MWIFI_RPC_TYPE_RESPONSE     (0x2)
+
+#define MWIFI_RPC_INDEX_BITS        (8)     /**< The low bits of an ID are the index of the call */
+
+/**
+ * @brief Header in front of every RPC packet, 9 bytes
+ */
+typedef struct {
+    uint8_t type;           /**< MWIFI_RPC_TYPE_REQUEST or MWIFI_RPC_TYPE_RESPONSE */
+    uint32_t id;            /**< Request ID, chosen by the caller and copied to the response */
+    int32_t ret;            /**< Response: return value of the handler */
+} __attribute__((packed)) mwifi_rpc_head_t;
+
+/**
+ * @brief Call waiting for a response. The entry is claimed by a caller with an atomic
+ *        exchange of `busy`, a response is only written after the atomic exchange of
+ *        `waiting_id`, so the calls share no lock.
+ */
+typedef struct {
+    uint32_t busy;          /**< Claimed by a caller */
+    uint32_t waiting_id;    /**< ID of the request waiting for a response, 0 if none */
+    SemaphoreHandle_t done; /**< Given when the response is written, created on first use */
+    uint8_t dest_addr[MWIFI_ADDR_LEN];
+    bool to_root;           /**< The response may come from any address of the root */
+    uint8_t *resp_data;
+    size_t resp_size;       /**< Length of the buffer as input, of the response as output */
+    mdf_err_t ret;
+} mwifi_rpc_call_t;
+
+#if MWIFI_RPC_CALL_NUM > (1 << MWIFI_RPC_INDEX_BITS)
+#error "MWIFI_RPC_CALL_NUM is too large"
+#endif /**< MWIFI_RPC_CALL_NUM */
+
+static const char *TAG                   = "mwifi_rpc";
+static uint32_t g_rpc_seq                = 0;
+static mwifi_rpc_handler_t g_rpc_handler = NULL;
+static mwifi_rpc_call_t g_rpc_call[MWIFI_RPC_CALL_NUM];
+
+mdf_err_t mwifi_rpc_set_handler(mwifi_rpc_handler_t handler)
+{
+    __atomic_store_n(&g_rpc_handler, handler, __ATOMIC_RELEASE);
+
+    return MDF_OK;
+}
+
+/**
+ * @brief Claim a free call entry and give it a new ID, starting from a different
+ *        entry each time so that the callers rarely contend for the same one
+ */
+static mwifi_rpc_call_t *mwifi_rpc_call_claim(uint32_t *id)
+{
+    uint32_t seq = __atomic_add_fetch(&g_rpc_seq, 1, __ATOMIC_RELAXED);
+
+    /**< Start from a random sequence, so that a restarted caller doesn't reuse a recent ID */
+    if (seq == 1) {
+        seq = __atomic_add_fetch(&g_rpc_seq, esp_random() >> MWIFI_RPC_INDEX_BITS, __ATOMIC_RELAXED);
+    }
+
+    for (int i = 0; i < MWIFI_RPC_CALL_NUM; ++i) {
+        int index              = (seq + i) % MWIFI_RPC_CALL_NUM;
+        mwifi_rpc_call_t *call = g_rpc_call + index;
+        uint32_t expected      = 0;
+
+        if (__atomic_compare_exchange_n(&call->busy, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            /**< An ID is never 0, which marks an entry with no request waiting */
+            *id = ((seq << MWIFI_RPC_INDEX_BITS) ? seq << MWIFI_RPC_INDEX_BITS : 1 << MWIFI_RPC_INDEX_BITS) | index;
+            return call;
+        }
+    }
+
+    return NULL;
+}
+
+static void mwifi_rpc_call_release(mwifi_rpc_call_t *call)
+{
+    __atomic_store_n(&call->busy, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Stop waiting for the response of a call
+ *
+ * @return true if no response was written, false if one is being written and
+ *         `done` is about to be given
+ */
+static bool mwifi_rpc_call_cancel(mwifi_rpc_call_t *call, uint32_t id)
+{
+    return __atomic_compare_exchange_n(&call->waiting_id, &id, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+mdf_err_t mwifi_rpc_call(const uint8_t *dest_addr, const mwifi_data_type_t *data_type,
+                         const void *req_data, size_t req_size,
+                         void *resp_data, size_t *resp_size, TickType_t wait_ticks)
+{
+    MDF_PARAM_CHECK(data_type);
+    MDF_PARAM_CHECK(req_data || !req_size);
+    MDF_PARAM_CHECK(!resp_data || resp_size);
+    MDF_PARAM_CHECK(!dest_addr || (!MWIFI_ADDR_IS_EMPTY(dest_addr) && !MWIFI_ADDR_IS_ANY(dest_addr)
+                                   && !MWIFI_ADDR_IS_BROADCAST(dest_addr)));
+
+    mdf_err_t ret                = MDF_OK;
+    uint32_t id                  = 0;
+    mwifi_rpc_call_t *call       = mwifi_rpc_call_claim(&id);
+    mwifi_data_type_t req_type   = *data_type;
+    mwifi_rpc_head_t head        = {
+        .type = MWIFI_RPC_TYPE_REQUEST,
+    };
+    mwifi_iovec_t iov[2] = {
+        {.data = &head, .size = sizeof(mwifi_rpc_head_t)},
+        {.data = req_data, .size = req_size},
+    };
+
+    MDF_ERROR_CHECK(!call, MDF_ERR_NO_MEM, "%d calls are already waiting", MWIFI_RPC_CALL_NUM);
+
+    if (!call->done) {
+        call->done = xSemaphoreCreateBinary();
+
+        if (!call->done) {
+            MDF_LOGW("Create the semaphore of a call");
+            mwifi_rpc_call_release(call);
+            return MDF_ERR_NO_MEM;
+        }
+    }
+
+    call->to_root   = !dest_addr;
+    call->resp_data = resp_data;
+    call->resp_size = resp_data ? *resp_size : 0;
+    call->ret       = MDF_OK;
+
+    if (dest_addr) {
+        memcpy(call->dest_addr, dest_addr, MWIFI_ADDR_LEN);
+    }
+
+    /**< Published before the request is sent, the response may arrive before mwifi_writev() returns */
+    __atomic_store_n(&call->waiting_id, id, __ATOMIC_RELEASE);
+
+    head.id              = id;
+    req_type.rpc         = true;
+    req_type.stream      = false;
+    req_type.group       = false;
+    req_type.communicate = MWIFI_COMMUNICATE_UNICAST;
+
+    ret = mwifi_writev(dest_addr, &req_type, iov, req_size ? 2 : 1, true);
+
+    if (ret != MDF_OK && mwifi_rpc_call_cancel(call, id)) {
+        MDF_LOGW("<%s> Send request 0x%x", mdf_err_to_name(ret), id);
+        mwifi_rpc_call_release(call);
+        return ret;
+    }
+
+    if (!xSemaphoreTake(call->done, wait_ticks)) {
+        if (mwifi_rpc_call_cancel(call, id)) {
+            MDF_LOGD("Request 0x%x is not answered", id);
+            mwifi_rpc_call_release(call);
+            return MDF_ERR_MWIFI_TIMEOUT;
+        }
+
+        /**< The response arrived meanwhile, wait until it is written */
+        xSemaphoreTake(call->done, portMAX_DELAY);
+    }
+
+    ret = call->ret;
+
+    if (resp_size && (ret == MDF_OK || ret == MDF_ERR_BUF)) {
+        *resp_size = call->resp_size;
+    }
+
+    mwifi_rpc_call_release(call);
+
+    return ret;
+}
+
+static void mwifi_rpc_recv_response(const uint8_t *src_addr, const mwifi_rpc_head_t *head,
+                                    const uint8_t *data, size_t size)
+{
+    uint32_t index         = head->id & ((1 << MWIFI_RPC_INDEX_BITS) - 1);
+    mwifi_rpc_call_t *call = g_rpc_call + index;
+
+    if (index >= MWIFI_RPC_CALL_NUM
+            || __atomic_load_n(&call->waiting_id, __ATOMIC_ACQUIRE) != head->id
+            || (!call->to_root && memcmp(call->dest_addr, src_addr, MWIFI_ADDR_LEN))) {
+        MDF_LOGD("Drop the response 0x%x from " MACSTR ", the call is over", head->id, MAC2STR(src_addr));
+        return;
+    }
+
+    /**< The call may time out between the check and here, the exchange decides */
+    if (!mwifi_rpc_call_cancel(call, head->id)) {
+        return;
+    }
+
+    call->ret = head->ret;
+
+    if (call->ret == MDF_OK && size > call->resp_size) {
+        call->ret = MDF_ERR_BUF;
+    } else if (call->ret == MDF_OK && size > 0) {
+        memcpy(call->resp_data, data, size);
+    }
+
+    call->resp_size = size;
+    xSemaphoreGive(call->done);
+}
+
+static void mwifi_rpc_recv_request(const uint8_t *src_addr, const mwifi_data_type_t *data_type,
+                                   const mwifi_rpc_head_t *head, const uint8_t *data, size_t size)
+{
+    mdf_err_t ret                 = MDF_OK;
+    void *resp_data               = NULL;
+    size_t resp_size              = 0;
+    mwifi_rpc_handler_t handler   = __atomic_load_n(&g_rpc_handler, __ATOMIC_ACQUIRE);
+    mwifi_data_type_t resp_type   = *data_type;
+    mwifi_rpc_head_t resp_head    = {
+        .type = MWIFI_RPC_TYPE_RESPONSE,
+        .id   = head->id,
+    };
+
+    resp_head.ret = handler ? handler(src_addr, data_type, data, size, &resp_data, &resp_size)
+                    : MDF_ERR_NOT_SUPPORTED;
+
+    mwifi_iovec_t iov[2] = {
+        {.data = &resp_head, .size = sizeof(mwifi_rpc_head_t)},
+        {.data = resp_data, .size = resp_size},
+    };
+
+    resp_type.rpc         = true;
+    resp_type.stream      = false;
+    resp_type.group       = false;
+    resp_type.communicate = MWIFI_COMMUNICATE_UNICAST;
+
+    ret = mwifi_writev(src_addr, &resp_type, iov, (resp_head.ret == MDF_OK && resp_data && resp_size) ? 2 : 1, true);
+
+    if (ret != MDF_OK) {
+        MDF_LOGW("<%s> Answer request 0x%x of " MACSTR, mdf_err_to_name(ret), head->id, MAC2STR(src_addr));
+    }
+
+    MDF_FREE(resp_data);
+}
+
+mdf_err_t mwifi_rpc_handle(const uint8_t *src_addr, const mwifi_data_type_t *data_type,
+                           const void *data, size_t size)
+{
+    MDF_PARAM_CHECK(src_addr);
+    MDF_PARAM_CHECK(data_type);
+    MDF_PARAM_CHECK(data);
+    MDF_PARAM_CHECK(size >= sizeof(mwifi_rpc_head_t));
+
+    mwifi_rpc_head_t head = {0};
+    memcpy(&head, data, sizeof(mwifi_rpc_head_t));
+
+    if (head.type == MWIFI_RPC_TYPE_REQUEST) {
+        mwifi_rpc_recv_request(src_addr, data_type, &head, (uint8_t *)data + sizeof(mwifi_rpc_head_t),
+                               size - sizeof(mwifi_rpc_head_t));
+    } else if (head.type == MWIFI_RPC_TYPE_RESPONSE) {
+        mwifi_rpc_recv_response(src_addr, &head, (uint8_t *)data + sizeof(mwifi_rpc_head_t),
+                                size - sizeof(mwifi_rpc_head_t));
+    } else {
+        MDF_LOGW("Unknown RPC packet, type: %d", head.type);
+    }
+
+    return MDF_OK;
+}
@@ -0,0 +1,532 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mwifi.h"
+#include "mwifi_stream.h"
+
+#define MWIFI_STREAM_TYPE_DATA      (0x1)
+#define MWIFI_STREAM_TYPE_ACK       (0x2)
+#define MWIFI_STREAM_TYPE_ABORT     (0x3)
+
+#define MWIFI_STREAM_CHUNK_MAX      (0xffff)
+#define MWIFI_STREAM_RECV_AGING_MS  (MWIFI_STREAM_RETRANSMIT_MS * (MWIFI_STREAM_RETRY_MAX + 1))
+
+/**
+ * @brief Header in front of every stream packet, 9 bytes
+ */
+typedef struct {
+    uint8_t type;           /**< MWIFI_STREAM_TYPE_DATA, MWIFI_STREAM_TYPE_ACK or MWIFI_STREAM_TYPE_ABORT */
+    uint16_t id;            /**< Stream ID, chosen by the sender */
+    uint16_t seq;           /**< Data: sequence of the chunk. Ack: next chunk expected in order */
+    uint32_t total_size;    /**< Data: length of the message. Ack: bitmap of the chunks received after seq */
+} __attribute__((packed)) mwifi_stream_head_t;
+
+typedef struct {
+    uint16_t size;          /**< Length of the chunk */
+    bool acked;             /**< Acknowledged selectively, ahead of the in-order ones */
+    bool resent;            /**< Sent again since the last timeout */
+} mwifi_stream_slot_t;
+
+struct mwifi_stream {
+    struct mwifi_stream *next;
+    uint8_t dest_addr[MWIFI_ADDR_LEN];
+    bool to_root;                       /**< Sent to mwifi_root_read() of the root */
+    mwifi_data_type_t data_type;
+    uint16_t id;
+    size_t total_size;
+    size_t offset;                      /**< Bytes of the message written */
+    uint16_t chunk_num;
+    uint16_t base;                      /**< Oldest chunk not acknowledged in order */
+    uint16_t next_seq;                  /**< Next chunk to send */
+    TickType_t progress_ticks;          /**< Time when base moved last */
+    QueueHandle_t ack_queue;
+    uint8_t *data;                      /**< Chunk seq is kept at (seq % MWIFI_STREAM_WINDOW) * MWIFI_STREAM_CHUNK_SIZE */
+    mwifi_stream_slot_t slot[MWIFI_STREAM_WINDOW];
+};
+
+typedef struct {
+    bool used;
+    bool done;                          /**< Delivered or aborted, kept to answer the retransmissions */
+    bool aborted;
+    uint8_t src_addr[MWIFI_ADDR_LEN];
+    uint16_t id;
+    mwifi_data_type_t data_type;
+    size_t total_size;
+    uint16_t chunk_num;
+    uint16_t expected;                  /**< Next chunk to deliver */
+    uint32_t bitmap;                    /**< Bit i is set if chunk expected + 1 + i is buffered */
+    uint16_t unacked;                   /**< Chunks delivered since the last acknowledgement */
+    TickType_t active_ticks;
+    uint8_t *data;                      /**< Chunks received out of order, allocated on first use */
+} mwifi_stream_recv_t;
+
+static const char *TAG                          = "mwifi_stream";
+static SemaphoreHandle_t g_stream_lock          = NULL;
+static portMUX_TYPE g_stream_lock_init          = portMUX_INITIALIZER_UNLOCKED;
+static mwifi_stream_t *g_stream_list            = NULL;
+static uint16_t g_stream_id                     = 0;
+static mwifi_stream_recv_cb_t g_stream_recv_cb  = NULL;
+static mwifi_stream_recv_t g_stream_recv[MWIFI_STREAM_RECV_NUM];
+
+/**
+ * @brief Recursive, so that the receive callback can open a stream
+ */
+static void mwifi_stream_lock(void)
+{
+    if (!g_stream_lock) {
+        SemaphoreHandle_t lock = xSemaphoreCreateRecursiveMutex();
+        MDF_ERROR_ASSERT(lock ? MDF_OK : MDF_ERR_NO_MEM);
+
+        portENTER_CRITICAL(&g_stream_lock_init);
+
+        if (!g_stream_lock) {
+            g_stream_lock = lock;
+            lock          = NULL;
+        }
+
+        portEXIT_CRITICAL(&g_stream_lock_init);
+
+        if (lock) {
+            vSemaphoreDelete(lock);
+        }
+    }
+
+    xSemaphoreTakeRecursive(g_stream_lock, portMAX_DELAY);
+}
+
+static void mwifi_stream_unlock(void)
+{
+    xSemaphoreGiveRecursive(g_stream_lock);
+}
+
+mdf_err_t mwifi_stream_set_recv_cb(mwifi_stream_recv_cb_t recv_cb)
+{
+    mwifi_stream_lock();
+    g_stream_recv_cb = recv_cb;
+    mwifi_stream_unlock();
+
+    return MDF_OK;
+}
+
+static mdf_err_t mwifi_stream_send_chunk(mwifi_stream_t *stream, uint16_t seq)
+{
+    mdf_err_t ret                = MDF_OK;
+    mwifi_stream_slot_t *slot    = stream->slot + seq % MWIFI_STREAM_WINDOW;
+    mwifi_stream_head_t head     = {
+        .type       = MWIFI_STREAM_TYPE_DATA,
+        .id         = stream->id,
+        .seq        = seq,
+        .total_size = stream->total_size,
+    };
+    mwifi_iovec_t iov[2] = {
+        {.data = &head, .size = sizeof(mwifi_stream_head_t)},
+        {.data = stream->data + (seq % MWIFI_STREAM_WINDOW) * MWIFI_STREAM_CHUNK_SIZE, .size = slot->size},
+    };
+
+    /**< A chunk which can't be sent is treated as lost and sent again later */
+    ret = mwifi_writev(stream->to_root ? NULL : stream->dest_addr, &stream->data_type, iov, 2, true);
+    MDF_ERROR_CHECK(ret != MDF_OK, ret, "Send chunk %d of stream %d", seq, stream->id);
+
+    return MDF_OK;
+}
+
+/**
+ * @brief Move the window, then send again the chunks lost before the last one received
+ */
+static void mwifi_stream_recv_ack(mwifi_stream_t *stream, const mwifi_stream_head_t *ack)
+{
+    uint16_t expected = MIN(ack->seq, stream->next_seq);
+    uint32_t bitmap   = ack->total_size;
+    uint16_t last_seq = expected;
+
+    if (expected > stream->base) {
+        stream->base           = expected;
+        stream->progress_ticks = xTaskGetTickCount();
+    }
+
+    for (uint16_t seq = expected + 1; bitmap && seq < stream->next_seq; ++seq, bitmap >>= 1) {
+        /**< An old acknowledgement must not mark the chunks now in the same slots */
+        if ((bitmap & 0x1) && seq >= stream->base) {
+            stream->slot[seq % MWIFI_STREAM_WINDOW].acked = true;
+            last_seq = seq;
+        }
+    }
+
+    for (uint16_t seq = stream->base; seq < last_seq; ++seq) {
+        mwifi_stream_slot_t *slot = stream->slot + seq % MWIFI_STREAM_WINDOW;
+
+        if (!slot->acked && !slot->resent) {
+            slot->resent = true;
+            mwifi_stream_send_chunk(stream, seq);
+        }
+    }
+}
+
+/**
+ * @brief Wait until the chunks before seq are acknowledged
+ */
+static mdf_err_t mwifi_stream_wait(mwifi_stream_t *stream, uint16_t seq)
+{
+    mwifi_stream_head_t ack = {0};
+    int retry_count         = 0;
+
+    while (stream->base < seq) {
+        TickType_t timeout_ticks = stream->progress_ticks + MWIFI_STREAM_RETRANSMIT_MS / portTICK_RATE_MS;
+        TickType_t now_ticks     = xTaskGetTickCount();
+        TickType_t wait_ticks    = (int32_t)(timeout_ticks - now_ticks) > 0 ? timeout_ticks - now_ticks : 0;
+
+        if (xQueueReceive(stream->ack_queue, &ack, wait_ticks) == pdTRUE) {
+            MDF_ERROR_CHECK(ack.type == MWIFI_STREAM_TYPE_ABORT, MDF_ERR_MWIFI_TIMEOUT,
+                            "Stream %d is aborted by the receiver", stream->id);
+
+            uint16_t base = stream->base;
+            mwifi_stream_recv_ack(stream, &ack);
+            retry_count = (stream->base != base) ? 0 : retry_count;
+            continue;
+        }
+
+        MDF_ERROR_CHECK(++retry_count > MWIFI_STREAM_RETRY_MAX, MDF_ERR_MWIFI_TIMEOUT,
+                        "Stream %d, chunk %d is not acknowledged", stream->id, stream->base);
+
+        /**< The retransmission makes the receiver report what else is missing */
+        for (uint16_t i = stream->base; i < stream->next_seq; ++i) {
+            stream->slot[i % MWIFI_STREAM_WINDOW].resent = false;
+        }
+
+        stream->slot[stream->base % MWIFI_STREAM_WINDOW].resent = true;
+        stream->progress_ticks = xTaskGetTickCount();
+        mwifi_stream_send_chunk(stream, stream->base);
+    }
+
+    return MDF_OK;
+}
+
+mdf_err_t mwifi_stream_open(const uint8_t *dest_addr, const mwifi_data_type_t *data_type,
+                            size_t total_size, mwifi_stream_t **stream)
+{
+    MDF_PARAM_CHECK(data_type);
+    MDF_PARAM_CHECK(stream);
+    MDF_PARAM_CHECK(total_size > 0 && total_size <= MWIFI_STREAM_CHUNK_MAX * MWIFI_STREAM_CHUNK_SIZE);
+    MDF_PARAM_CHECK(!dest_addr || (!MWIFI_ADDR_IS_EMPTY(dest_addr) && !MWIFI_ADDR_IS_ANY(dest_addr)
+                                   && !MWIFI_ADDR_IS_BROADCAST(dest_addr)));
+
+    mwifi_stream_t *new_stream = MDF_CALLOC(1, sizeof(mwifi_stream_t));
+    MDF_ERROR_CHECK(!new_stream, MDF_ERR_NO_MEM, "");
+
+    new_stream->data      = MDF_MALLOC(MWIFI_STREAM_WINDOW * MWIFI_STREAM_CHUNK_SIZE);
+    new_stream->ack_queue = xQueueCreate(MWIFI_STREAM_WINDOW, sizeof(mwifi_stream_head_t));
+
+    if (!new_stream->data || !new_stream->ack_queue) {
+        MDF_LOGW("Create stream, total_size: %d", total_size);
+
+        if (new_stream->ack_queue) {
+            vQueueDelete(new_stream->ack_queue);
+        }
+
+        MDF_FREE(new_stream->data);
+        MDF_FREE(new_stream);
+        return MDF_ERR_NO_MEM;
+    }
+
+    new_stream->to_root                 = !dest_addr;
+    new_stream->total_size              = total_size;
+    new_stream->chunk_num               = (total_size + MWIFI_STREAM_CHUNK_SIZE - 1) / MWIFI_STREAM_CHUNK_SIZE;
+    new_stream->progress_ticks          = xTaskGetTickCount();
+    new_stream->data_type               = *data_type;
+    new_stream->data_type.stream        = true;
+    new_stream->data_type.group         = false;
+    new_stream->data_type.communicate   = MWIFI_COMMUNICATE_UNICAST;
+
+    if (dest_addr) {
+        memcpy(new_stream->dest_addr, dest_addr, MWIFI_ADDR_LEN);
+    }
+
+    mwifi_stream_lock();
+
+    /**< Start from a random ID, so that a restarted sender doesn't reuse a recent one */
+    g_stream_id    = g_stream_id ? g_stream_id : esp_random();
+    new_stream->id = ++g_stream_id;
+    new_stream->next = g_stream_list;
+    g_stream_list    = new_stream;
+
+    mwifi_stream_unlock();
+
+    MDF_LOGD("Open stream %d to " MACSTR ", total_size: %d, chunk_num: %d", new_stream->id,
+             MAC2STR(new_stream->dest_addr), total_size, new_stream->chunk_num);
+
+    *stream = new_stream;
+    return MDF_OK;
+}
+
+mdf_err_t mwifi_stream_write(mwifi_stream_t *stream, const void *data, size_t size)
+{
+    MDF_PARAM_CHECK(stream);
+    MDF_PARAM_CHECK(data || !size);
+    MDF_PARAM_CHECK(size <= stream->total_size - stream->offset);
+
+    mdf_err_t ret = MDF_OK;
+
+    while (size > 0) {
+        uint16_t seq        = stream->offset / MWIFI_STREAM_CHUNK_SIZE;
+        size_t chunk_offset = stream->offset % MWIFI_STREAM_CHUNK_SIZE;
+        size_t chunk_size   = MIN(stream->total_size - seq * MWIFI_STREAM_CHUNK_SIZE, MWIFI_STREAM_CHUNK_SIZE);
+        size_t copy_size    = MIN(size, chunk_size - chunk_offset);
+
+        /**< The slot of a new chunk is free once the chunk a window before it is acknowledged */
+        if (!chunk_offset && seq >= MWIFI_STREAM_WINDOW) {
+            ret = mwifi_stream_wait(stream, seq - MWIFI_STREAM_WINDOW + 1);
+            MDF_ERROR_CHECK(ret != MDF_OK, ret, "<%s> mwifi_stream_wait", mdf_err_to_name(ret));
+        }
+
+        memcpy(stream->data + (seq % MWIFI_STREAM_WINDOW) * MWIFI_STREAM_CHUNK_SIZE + chunk_offset,
+               data, copy_size);
+        stream->offset += copy_size;
+        data            = (uint8_t *)data + copy_size;
+        size           -= copy_size;
+
+        if (chunk_offset + copy_size == chunk_size) {
+            mwifi_stream_slot_t *slot = stream->slot + seq % MWIFI_STREAM_WINDOW;
+            slot->size       = chunk_size;
+            slot->acked      = false;
+            slot->resent     = false;
+            stream->next_seq = seq + 1;
+            mwifi_stream_send_chunk(stream, seq);
+        }
+    }
+
+    return MDF_OK;
+}
+
+mdf_err_t mwifi_stream_close(mwifi_stream_t *stream)
+{
+    MDF_PARAM_CHECK(stream);
+
+    mdf_err_t ret = MDF_ERR_MWIFI_ARGUMENT;
+
+    if (stream->offset == stream->total_size) {
+        ret = mwifi_stream_wait(stream, stream->chunk_num);
+    } else {
+        MDF_LOGW("Stream %d is closed after %d of %d bytes", stream->id, stream->offset, stream->total_size);
+    }
+
+    mwifi_stream_lock();
+
+    for (mwifi_stream_t **iter = &g_stream_list; *iter; iter = &(*iter)->next) {
+        if (*iter == stream) {
+            *iter = stream->next;
+            break;
+        }
+    }
+
+    mwifi_stream_unlock();
+
+    vQueueDelete(stream->ack_queue);
+    MDF_FREE(stream->data);
+    MDF_FREE(stream);
+
+    return ret;
+}
+
+static void mwifi_stream_send_ack(mwifi_stream_recv_t *recv)
+{
+    mdf_err_t ret                = MDF_OK;
+    mwifi_data_type_t data_type  = {
+        .stream   = true,
+        .priority = MWIFI_PRIORITY_CONTROL,
+    };
+    mwifi_stream_head_t ack      = {
+        .type       = recv->aborted ? MWIFI_STREAM_TYPE_ABORT : MWIFI_STREAM_TYPE_ACK,
+        .id         = recv->id,
+        .seq        = recv->expected,
+        .total_size = recv->bitmap,
+    };
+
+    recv->unacked = 0;
+    ret = mwifi_write(recv->src_addr, &data_type, &ack, sizeof(mwifi_stream_head_t), true);
+
+    if (ret != MDF_OK) {
+        MDF_LOGW("<%s> Acknowledge stream %d", mdf_err_to_name(ret), recv->id);
+    }
+}
+
+static mwifi_stream_recv_t *mwifi_stream_recv_find(const uint8_t *src_addr, const mwifi_data_type_t *data_type,
+        const mwifi_stream_head_t *head)
+{
+    mwifi_stream_recv_t *recv = NULL;
+    TickType_t now_ticks      = xTaskGetTickCount();
+
+    for (int i = 0; i < MWIFI_STREAM_RECV_NUM; ++i) {
+        mwifi_stream_recv_t *iter = g_stream_recv + i;
+
+        if (iter->used && iter->id == head->id && !memcmp(iter->src_addr, src_addr, MWIFI_ADDR_LEN)) {
+            return iter;
+        }
+
+        /**< Reuse a free record, or one which has been idle for longer than the sender retries */
+        if (!recv && (!iter->used || now_ticks - iter->active_ticks > pdMS_TO_TICKS(MWIFI_STREAM_RECV_AGING_MS))) {
+            recv = iter;
+        }
+    }
+
+    if (!recv) {
+        MDF_LOGW("Receiving too many streams, drop stream %d from " MACSTR, head->id, MAC2STR(src_addr));
+        return NULL;
+    }
+
+    if (recv->used && !recv->done) {
+        MDF_LOGW("Stream %d from " MACSTR " timed out after %d of %d bytes", recv->id,
+                 MAC2STR(recv->src_addr), recv->expected * MWIFI_STREAM_CHUNK_SIZE, recv->total_size);
+    }
+
+    MDF_FREE(recv->data);
+    memset(recv, 0, sizeof(mwifi_stream_recv_t));
+    memcpy(recv->src_addr, src_addr, MWIFI_ADDR_LEN);
+    recv->used       = true;
+    recv->id         = head->id;
+    recv->data_type  = *data_type;
+    recv->total_size = head->total_size;
+    recv->chunk_num  = (head->total_size + MWIFI_STREAM_CHUNK_SIZE - 1) / MWIFI_STREAM_CHUNK_SIZE;
+
+    return recv;
+}
+
+/**
+ * @brief Pass a chunk to the callback, abort the stream if it fails
+ */
+static void mwifi_stream_deliver(mwifi_stream_recv_t *recv, const uint8_t *data, size_t size)
+{
+    mdf_err_t ret = MDF_ERR_NOT_SUPPORTED;
+    size_t offset = recv->expected * MWIFI_STREAM_CHUNK_SIZE;
+
+    if (g_stream_recv_cb) {
+        ret = g_stream_recv_cb(recv->src_addr, &recv->data_type, offset, data, size, recv->total_size);
+    }
+
+    recv->expected++;
+    recv->unacked++;
+
+    if (ret != MDF_OK) {
+        MDF_LOGW("<%s> Abort stream %d from " MACSTR, mdf_err_to_name(ret), recv->id, MAC2STR(recv->src_addr));
+        recv->aborted = true;
+    }
+
+    if (recv->aborted || recv->expected == recv->chunk_num) {
+        recv->done   = true;
+        recv->bitmap = 0;
+        MDF_FREE(recv->data);
+    }
+}
+
+static void mwifi_stream_recv_data(const uint8_t *src_addr, const mwifi_data_type_t *data_type,
+                                   const mwifi_stream_head_t *head, const uint8_t *data, size_t size)
+{
+    mwifi_stream_recv_t *recv = mwifi_stream_recv_find(src_addr, data_type, head);
+
+    if (!recv) {
+        return;
+    }
+
+    recv->active_ticks = xTaskGetTickCount();
+
+    if (recv->done || head->seq < recv->expected) {
+        mwifi_stream_send_ack(recv);
+        return;
+    }
+
+    if (head->total_size != recv->total_size || head->seq >= recv->chunk_num
+            || size != MIN(recv->total_size - head->seq * MWIFI_STREAM_CHUNK_SIZE, MWIFI_STREAM_CHUNK_SIZE)) {
+        MDF_LOGW("Stream %d, chunk %d, size: %d, total_size: %d is invalid",
+                 head->id, head->seq, size, head->total_size);
+        return;
+    }
+
+    if (head->seq >= recv->expected + MWIFI_STREAM_WINDOW) {
+        MDF_LOGD("Stream %d, chunk %d is out of the window, expected: %d", head->id, head->seq, recv->expected);
+        return;
+    }
+
+    if (head->seq > recv->expected) {
+        if (!recv->data) {
+            recv->data = MDF_MALLOC(MWIFI_STREAM_WINDOW * MWIFI_STREAM_CHUNK_SIZE);
+
+            if (!recv->data) {
+                return;
+            }
+        }
+
+        memcpy(recv->data + (head->seq % MWIFI_STREAM_WINDOW) * MWIFI_STREAM_CHUNK_SIZE, data, size);
+        recv->bitmap |= 1U << (head->seq - recv->expected - 1);
+
+        /**< Report the gap at once, the sender resends the chunks missing */
+        mwifi_stream_send_ack(recv);
+        return;
+    }
+
+    mwifi_stream_deliver(recv, data, size);
+
+    for (bool next = true; next && !recv->done;) {
+        next          = recv->bitmap & 0x1;
+        recv->bitmap >>= 1;
+
+        if (next) {
+            size = MIN(recv->total_size - recv->expected * MWIFI_STREAM_CHUNK_SIZE, MWIFI_STREAM_CHUNK_SIZE);
+            mwifi_stream_deliver(recv, recv->data + (recv->expected % MWIFI_STREAM_WINDOW) * MWIFI_STREAM_CHUNK_SIZE,
+                                 size);
+        }
+    }
+
+    if (recv->done || recv->bitmap || recv->unacked >= MWIFI_STREAM_WINDOW / 2) {
+        mwifi_stream_send_ack(recv);
+    }
+}
+
+static void mwifi_stream_recv_ack_packet(const uint8_t *src_addr, const mwifi_stream_head_t *head)
+{
+    for (mwifi_stream_t *iter = g_stream_list; iter; iter = iter->next) {
+        if (iter->id == head->id && (iter->to_root || !memcmp(iter->dest_addr, src_addr, MWIFI_ADDR_LEN))) {
+            if (xQueueSend(iter->ack_queue, head, 0) != pdTRUE) {
+                MDF_LOGD("Stream %d, the acknowledgement queue is full", head->id);
+            }
+
+            return;
+        }
+    }
+}
+
+mdf_err_t mwifi_stream_handle(const uint8_t *src_addr, const mwifi_data_type_t *data_type,
+                              const void *data, size_t size)
+{
+    MDF_PARAM_CHECK(src_addr);
+    MDF_PARAM_CHECK(data_type);
+    MDF_PARAM_CHECK(data);
+    MDF_PARAM_CHECK(size >= sizeof(mwifi_stream_head_t));
+
+    mwifi_stream_head_t head = {0};
+    memcpy(&head, data, sizeof(mwifi_stream_head_t));
+
+    mwifi_stream_lock();
+
+    if (head.type == MWIFI_STREAM_TYPE_DATA) {
+        mwifi_stream_recv_data(src_addr, data_type, &head, (uint8_t *)data + sizeof(mwifi_stream_head_t),
+                               size - sizeof(mwifi_stream_head_t));
+    } else if (head.type == MWIFI_STREAM_TYPE_ACK || head.type == MWIFI_STREAM_TYPE_ABORT) {
+        mwifi_stream_recv_ack_packet(src_addr, &head);
+    } else {
+        MDF_LOGW("Unknown stream packet, type: %d", head.type);
+    }
+
+    mwifi_stream_unlock();
+
+    return MDF_OK;
+}
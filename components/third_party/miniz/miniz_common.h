@@ -54,7 +54,7 @@ typedef struct mz_dummy_time_t_tag {
 #define MZ_MALLOC(x) ({                                                         \
     void* p = malloc(x);                                                        \
     if (p == NULL)                                                              \
-        printf("%s: %u malloc size %zu bytes failed\n", __FILE__, __LINE__, x); \
+        printf("%s: %u malloc size %zu bytes failed\n", __FILE__, __LINE__, (size_t)(x)); \
     p;                                                                          \
 })
 #ifdef CONFIG_MINIZ_MINIMIZE_STACK_CONSUME
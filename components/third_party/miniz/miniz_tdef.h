@@ -92,8 +92,13 @@ enum
     TDEFL_LZ_CODE_BUF_SIZE = 512,
     TDEFL_OUT_BUF_SIZE = (TDEFL_LZ_CODE_BUF_SIZE * 13) / 10,
     TDEFL_MAX_HUFF_SYMBOLS = 288,
+#ifdef CONFIG_MINIZ_LOW_MEMORY
+    TDEFL_LZ_HASH_BITS = 8,
+    TDEFL_LEVEL1_HASH_SIZE_MASK = 255,
+#else
     TDEFL_LZ_HASH_BITS = 10,
     TDEFL_LEVEL1_HASH_SIZE_MASK = 1024,
+#endif
     TDEFL_LZ_HASH_SHIFT = (TDEFL_LZ_HASH_BITS + 2) / 3,
     TDEFL_LZ_HASH_SIZE = 1 << TDEFL_LZ_HASH_BITS
 };
@@ -108,7 +108,11 @@ enum
     TINFL_MAX_HUFF_SYMBOLS_0 = 288,
     TINFL_MAX_HUFF_SYMBOLS_1 = 32,
     TINFL_MAX_HUFF_SYMBOLS_2 = 19,
+#ifdef CONFIG_MINIZ_LOW_MEMORY
+    TINFL_FAST_LOOKUP_BITS = 8,
+#else
     TINFL_FAST_LOOKUP_BITS = 10,
+#endif
     TINFL_FAST_LOOKUP_SIZE = 1 << TINFL_FAST_LOOKUP_BITS
 };
 
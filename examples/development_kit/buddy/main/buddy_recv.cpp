@@ -219,6 +219,17 @@ static void espnow_recv_task(void *arg)
                     break;
                 }
 
+                case MDEBUG_ESPNOW_LOG_BATCH: {
+                    /**< Each line of the batch ends with '\0' */
+                    for (size_t offset = 0, line_size = 0; offset < recv_size; offset += line_size + 1) {
+                        line_size = strnlen((char *)recv_data + offset, recv_size - offset);
+                        printf("[" MACSTR "] %.*s\n", MAC2STR(src_addr), line_size, recv_data + offset);
+                        log_analysis(src_addr, recv_data + offset);
+                    }
+
+                    break;
+                }
+
                 default:
                     break;
             }
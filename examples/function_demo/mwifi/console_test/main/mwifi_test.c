@@ -25,6 +25,7 @@ enum {
     IPERF_BANDWIDTH,
     IPERF_BANDWIDTH_STOP,
     IPERF_PING,
+    IPERF_BENCH_START,
 };
 
 struct mesh_iperf_cfg {
@@ -34,10 +35,44 @@ struct mesh_iperf_cfg {
     uint32_t ping_count;
     uint16_t report_interval;
     uint8_t addr[6];
+    uint8_t bench_mode;
+    bool compress;
+    bool json;
 } g_mesh_iperf_cfg = {
     .finish = true,
 };
 
+/**
+ * @brief Tests of the mesh_bench command
+ */
+enum {
+    MESH_BENCH_TX,      /**< Throughput from this node to the server */
+    MESH_BENCH_BIDIR,   /**< Throughput of the packets echoed back by the server */
+    MESH_BENCH_MANY,    /**< All the nodes send to the root at the same time */
+    MESH_BENCH_BCAST,   /**< The root sends to all the nodes */
+    MESH_BENCH_RATE,    /**< Rate of small messages from this node to the server */
+    MESH_BENCH_RTT,     /**< Round-trip time percentiles by hop count */
+    MESH_BENCH_MAX,
+};
+
+static const char *const g_mesh_bench_name[MESH_BENCH_MAX] = {
+    "tx", "bidir", "many", "bcast", "rate", "rtt",
+};
+
+/**
+ * @brief Payload of IPERF_BENCH_START, asks the server to send to the requester
+ */
+typedef struct {
+    uint16_t transmit_time;
+    uint16_t packet_len;
+    bool compress;
+} mesh_bench_start_t;
+
+typedef struct {
+    uint8_t addr[MWIFI_ADDR_LEN];
+    mesh_bench_start_t start;
+} mesh_bench_send_arg_t;
+
 static const char *TAG = "mwifi_test";
 esp_netif_t *sta_netif;
 
@@ -467,6 +502,51 @@ static void mesh_iperf_client_task(void *arg)
     vTaskDelete(NULL);
 }
 
+/**
+ * @brief Text-like payload, so that the compressed tests have something to compress
+ */
+static void mesh_bench_fill(uint8_t *buffer, size_t size)
+{
+    const char pattern[] = "{\"type\":\"mesh_bench\",\"value\":0123456789}";
+
+    for (size_t i = 0; i < size; ++i) {
+        buffer[i] = pattern[i % (sizeof(pattern) - 1)];
+    }
+}
+
+static void mesh_bench_send_task(void *arg)
+{
+    mdf_err_t ret                   = MDF_OK;
+    mesh_bench_send_arg_t *send_arg = (mesh_bench_send_arg_t *)arg;
+    size_t packet_len               = MAX(send_arg->start.packet_len, 1);
+    uint8_t *buffer                 = MDF_MALLOC(packet_len);
+    MDF_ERROR_GOTO(!buffer, EXIT, "");
+
+    mwifi_data_type_t data_type = {
+        .protocol    = IPERF_BANDWIDTH,
+        .compression = send_arg->start.compress,
+    };
+
+    mesh_bench_fill(buffer, packet_len);
+
+    for (TickType_t end_ticks = xTaskGetTickCount() + send_arg->start.transmit_time * 1000 / portTICK_RATE_MS;
+            xTaskGetTickCount() < end_ticks && !g_mesh_iperf_cfg.finish; data_type.custom++) {
+        ret = mwifi_write(send_arg->addr, &data_type, buffer, packet_len, true);
+        MDF_ERROR_BREAK(ret != MDF_OK, "<%s> mwifi_write", mdf_err_to_name(ret));
+    }
+
+    /**< The count of the sent packets is in data_type.custom */
+    data_type.protocol = IPERF_BANDWIDTH_STOP;
+    buffer[0]          = esp_mesh_get_layer();
+    ret = mwifi_write(send_arg->addr, &data_type, buffer, 1, true);
+    MDF_ERROR_GOTO(ret != MDF_OK, EXIT, "<%s> mwifi_write", mdf_err_to_name(ret));
+
+EXIT:
+    MDF_FREE(buffer);
+    MDF_FREE(send_arg);
+    vTaskDelete(NULL);
+}
+
 static void mesh_iperf_server_task(void *arg)
 {
     mdf_err_t ret     = MDF_OK;
@@ -519,15 +599,31 @@ static void mesh_iperf_server_task(void *arg)
             double total_len     = (total_count * g_mesh_iperf_cfg.packet_len) / 1e6;
             uint32_t spend_time  = (xTaskGetTickCount() - start_ticks) * portTICK_RATE_MS;
 
-            MDF_LOGI("[ ID] Interval      Transfer       Bandwidth      Jitter   Lost/Total Datagrams");
-            MDF_LOGI("[000] %2d-%2d sec    %2.2f MBytes    %0.2f Mbits/sec    %d ms    %d/%d (%d%%)",
-                     0, spend_time / 1000, total_len, total_len * 8 * 1000 / spend_time, spend_time / recv_count,
-                     lost_count, total_count, lost_count * 100 / total_count);
+            if (total_count && recv_count && spend_time) {
+                MDF_LOGI("[ ID] Interval      Transfer       Bandwidth      Jitter   Lost/Total Datagrams");
+                MDF_LOGI("[000] %2d-%2d sec    %2.2f MBytes    %0.2f Mbits/sec    %d ms    %d/%d (%d%%)",
+                         0, spend_time / 1000, total_len, total_len * 8 * 1000 / spend_time, spend_time / recv_count,
+                         lost_count, total_count, lost_count * 100 / total_count);
+            }
 
             data_type.custom = recv_count;
             MDF_LOGD("data_type.custom: %d",  data_type.custom);
-            ret = mwifi_write(g_mesh_iperf_cfg.addr, &data_type, &ret, 1, true);
+            uint8_t layer = esp_mesh_get_layer();
+            ret = mwifi_write(g_mesh_iperf_cfg.addr, &data_type, &layer, 1, true);
             MDF_ERROR_CONTINUE(ret != MDF_OK, "<%s> mwifi_write", mdf_err_to_name(ret));
+        } else if (data_type.protocol == IPERF_BENCH_START && buffer_len == sizeof(mesh_bench_start_t)) {
+            mesh_bench_send_arg_t *send_arg = MDF_MALLOC(sizeof(mesh_bench_send_arg_t));
+            const uint8_t root_addr[]       = MWIFI_ADDR_ROOT;
+            MDF_ERROR_GOTO(!send_arg, FREE_MEM, "");
+
+            /**< Only the root asks, the source of a flooded packet is the parent forwarding it */
+            memcpy(send_arg->addr, root_addr, MWIFI_ADDR_LEN);
+            memcpy(&send_arg->start, buffer, sizeof(mesh_bench_start_t));
+            MDF_LOGI("Send to " MACSTR " for %d sec", MAC2STR(send_arg->addr), send_arg->start.transmit_time);
+
+            xTaskCreatePinnedToCore(mesh_bench_send_task, "mesh_bench_send", 4 * 1024,
+                                    send_arg, CONFIG_MDF_TASK_DEFAULT_PRIOTY,
+                                    NULL, CONFIG_MDF_TASK_PINNED_TO_CORE);
         }
 
 FREE_MEM:
@@ -726,6 +822,780 @@ static void register_mesh_iperf()
     ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
 }
 
+#define MESH_BENCH_REPLY_TIMEOUT_MS (3000)
+#define MESH_BENCH_HOP_NUM          (26)
+
+typedef struct {
+    uint8_t addr[MWIFI_ADDR_LEN];
+    int hops;               /**< Layer distance to the peer, exact when one side is the root, -1 if unknown */
+    uint32_t sent;
+    uint32_t received;
+    uint64_t bytes;         /**< Bytes carried by the received packets */
+    uint32_t spend_ms;
+    uint32_t rtt_us[3];     /**< p50, p95, p99 of the round-trip time */
+} mesh_bench_result_t;
+
+typedef struct {
+    uint16_t hops;
+    uint32_t rtt_us;
+} mesh_bench_sample_t;
+
+static struct {
+    bool exit;
+    bool running;
+    int64_t start_time;
+    mesh_bench_result_t *result;
+} g_mesh_bench_recv;
+
+static void mesh_bench_print(const mesh_bench_result_t *result)
+{
+    const char *fmt = g_mesh_iperf_cfg.json ?
+                      "{\"test\":\"%s\",\"peer\":\"" MACSTR "\",\"hops\":%d,\"len\":%u,\"compress\":%d,"
+                      "\"time_ms\":%u,\"sent\":%u,\"received\":%u,\"loss_pct\":%.1f,\"pps\":%.1f,\"mbps\":%.3f,"
+                      "\"rtt_p50_ms\":%.2f,\"rtt_p95_ms\":%.2f,\"rtt_p99_ms\":%.2f}\n" :
+                      "%s," MACSTR ",%d,%u,%d,%u,%u,%u,%.1f,%.1f,%.3f,%.2f,%.2f,%.2f\n";
+
+    uint32_t lost = result->sent - MIN(result->sent, result->received);
+    double loss   = result->sent ? lost * 100.0 / result->sent : 0;
+    double pps    = result->spend_ms ? result->received * 1000.0 / result->spend_ms : 0;
+    double mbps   = result->spend_ms ? result->bytes * 8.0 / result->spend_ms / 1000 : 0;
+
+    printf(fmt, g_mesh_bench_name[g_mesh_iperf_cfg.bench_mode], MAC2STR(result->addr), result->hops,
+           g_mesh_iperf_cfg.packet_len, g_mesh_iperf_cfg.compress, result->spend_ms, result->sent,
+           result->received, loss, pps, mbps, result->rtt_us[0] / 1000.0,
+           result->rtt_us[1] / 1000.0, result->rtt_us[2] / 1000.0);
+}
+
+static int mesh_bench_hops(uint8_t peer_layer)
+{
+    return abs((int)peer_layer - esp_mesh_get_layer());
+}
+
+static int mesh_bench_sample_cmp(const void *a, const void *b)
+{
+    const mesh_bench_sample_t *sample_a = a;
+    const mesh_bench_sample_t *sample_b = b;
+
+    if (sample_a->hops != sample_b->hops) {
+        return sample_a->hops - sample_b->hops;
+    }
+
+    return (sample_a->rtt_us > sample_b->rtt_us) - (sample_a->rtt_us < sample_b->rtt_us);
+}
+
+/**
+ * @brief Fill in the percentiles of samples sorted by mesh_bench_sample_cmp()
+ */
+static void mesh_bench_percentile(const mesh_bench_sample_t *samples, size_t num, mesh_bench_result_t *result)
+{
+    const uint8_t percent[] = {50, 95, 99};
+
+    for (int i = 0; i < sizeof(percent) && num; ++i) {
+        result->rtt_us[i] = samples[(num - 1) * percent[i] / 100].rtt_us;
+    }
+}
+
+/**
+ * @brief Get the nodes of the routing table except this node
+ */
+static mesh_addr_t *mesh_bench_routing_table(int *node_num)
+{
+    int table_size     = esp_mesh_get_routing_table_size();
+    mesh_addr_t *table = MDF_MALLOC(MAX(table_size, 1) * sizeof(mesh_addr_t));
+    uint8_t self_mac[MWIFI_ADDR_LEN] = {0};
+    MDF_ERROR_GOTO(!table, EXIT, "");
+
+    esp_wifi_get_mac(ESP_IF_WIFI_STA, self_mac);
+    esp_mesh_get_routing_table(table, table_size * sizeof(mesh_addr_t), &table_size);
+    *node_num = 0;
+
+    for (int i = 0; i < table_size; ++i) {
+        if (memcmp(table[i].addr, self_mac, MWIFI_ADDR_LEN)) {
+            table[(*node_num)++] = table[i];
+        }
+    }
+
+EXIT:
+    return table;
+}
+
+static mesh_bench_result_t *mesh_bench_result_find(mesh_bench_result_t *results, int num, const uint8_t *addr)
+{
+    for (int i = 0; i < num; ++i) {
+        if (!memcmp(results[i].addr, addr, MWIFI_ADDR_LEN)) {
+            return results + i;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Print one row for each node and a row with the sum to MWIFI_ADDR_BROADCAST
+ */
+static void mesh_bench_print_all(const mesh_bench_result_t *results, int num)
+{
+    mesh_bench_result_t total = {
+        .addr = MWIFI_ADDR_BROADCAST,
+        .hops = -1,
+    };
+
+    for (int i = 0; i < num; ++i) {
+        mesh_bench_print(results + i);
+        total.sent     += results[i].sent;
+        total.received += results[i].received;
+        total.bytes    += results[i].bytes;
+        total.spend_ms  = MAX(total.spend_ms, results[i].spend_ms);
+    }
+
+    mesh_bench_print(&total);
+}
+
+/**
+ * @brief Send for transmit_time, then ask the server how many packets it received
+ */
+static mdf_err_t mesh_bench_tx(uint8_t *buffer)
+{
+    mdf_err_t ret               = MDF_OK;
+    uint8_t *recv_data          = NULL;
+    size_t recv_size            = 0;
+    mesh_bench_result_t result  = {.hops = -1};
+    mwifi_data_type_t data_type = {
+        .protocol    = IPERF_BANDWIDTH,
+        .compression = g_mesh_iperf_cfg.compress,
+    };
+
+    memcpy(result.addr, g_mesh_iperf_cfg.addr, MWIFI_ADDR_LEN);
+
+    TickType_t start_ticks = xTaskGetTickCount();
+    TickType_t end_ticks   = start_ticks + g_mesh_iperf_cfg.transmit_time * 1000 / portTICK_RATE_MS;
+
+    for (; xTaskGetTickCount() < end_ticks && !g_mesh_iperf_cfg.finish; data_type.custom++) {
+        ret = mwifi_write(g_mesh_iperf_cfg.addr, &data_type, buffer, g_mesh_iperf_cfg.packet_len, true);
+        MDF_ERROR_BREAK(ret != MDF_OK, "<%s> mwifi_write", mdf_err_to_name(ret));
+    }
+
+    result.sent        = data_type.custom;
+    result.spend_ms    = (xTaskGetTickCount() - start_ticks) * portTICK_RATE_MS;
+    data_type.protocol = IPERF_BANDWIDTH_STOP;
+
+    for (int retry_count = 3; retry_count > 0; --retry_count) {
+        data_type.custom = result.sent;
+        ret = mwifi_write(g_mesh_iperf_cfg.addr, &data_type, buffer, 1, true);
+        MDF_ERROR_CONTINUE(ret != MDF_OK, "<%s> mwifi_write", mdf_err_to_name(ret));
+
+        ret = mwifi_read(result.addr, &data_type, &recv_data, &recv_size,
+                         MESH_BENCH_REPLY_TIMEOUT_MS / portTICK_RATE_MS);
+
+        if (ret == MDF_OK && data_type.protocol == IPERF_BANDWIDTH_STOP) {
+            result.received = data_type.custom;
+            result.bytes    = (uint64_t)result.received * g_mesh_iperf_cfg.packet_len;
+            result.hops     = mesh_bench_hops(recv_data[0]);
+            MDF_FREE(recv_data);
+            break;
+        }
+
+        MDF_FREE(recv_data);
+    }
+
+    MDF_ERROR_CHECK(ret != MDF_OK, ret, "<%s> Receive server response", mdf_err_to_name(ret));
+    mesh_bench_print(&result);
+
+    return MDF_OK;
+}
+
+static void mesh_bench_recv_task(void *arg)
+{
+    mdf_err_t ret               = MDF_OK;
+    uint8_t *recv_data          = NULL;
+    size_t recv_size            = 0;
+    uint8_t src_addr[MWIFI_ADDR_LEN] = {0};
+    mwifi_data_type_t data_type = {0};
+    mesh_bench_result_t *result = g_mesh_bench_recv.result;
+
+    while (!g_mesh_bench_recv.exit) {
+        ret = mwifi_read(src_addr, &data_type, &recv_data, &recv_size, 100 / portTICK_RATE_MS);
+
+        if (ret != MDF_OK) {
+            continue;
+        }
+
+        if (data_type.protocol == IPERF_PING && !memcmp(src_addr, result->addr, MWIFI_ADDR_LEN)) {
+            /**< Each echoed packet crossed the path once in each direction */
+            result->received++;
+            result->bytes   += recv_size * 2;
+            result->hops     = mesh_bench_hops(recv_data[0]);
+            result->spend_ms = (esp_timer_get_time() - g_mesh_bench_recv.start_time) / 1000;
+        }
+
+        MDF_FREE(recv_data);
+    }
+
+    g_mesh_bench_recv.running = false;
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Send without waiting for the replies, the server echoes each packet back
+ */
+static mdf_err_t mesh_bench_bidir(uint8_t *buffer)
+{
+    mdf_err_t ret               = MDF_OK;
+    mesh_bench_result_t result  = {.hops = -1};
+    mwifi_data_type_t data_type = {
+        .protocol    = IPERF_PING,
+        .compression = g_mesh_iperf_cfg.compress,
+    };
+
+    memcpy(result.addr, g_mesh_iperf_cfg.addr, MWIFI_ADDR_LEN);
+    g_mesh_bench_recv.exit       = false;
+    g_mesh_bench_recv.running    = true;
+    g_mesh_bench_recv.result     = &result;
+    g_mesh_bench_recv.start_time = esp_timer_get_time();
+
+    xTaskCreatePinnedToCore(mesh_bench_recv_task, "mesh_bench_recv", 4 * 1024,
+                            NULL, CONFIG_MDF_TASK_DEFAULT_PRIOTY,
+                            NULL, CONFIG_MDF_TASK_PINNED_TO_CORE);
+
+    for (TickType_t end_ticks = xTaskGetTickCount() + g_mesh_iperf_cfg.transmit_time * 1000 / portTICK_RATE_MS;
+            xTaskGetTickCount() < end_ticks && !g_mesh_iperf_cfg.finish; data_type.custom++) {
+        ret = mwifi_write(g_mesh_iperf_cfg.addr, &data_type, buffer, g_mesh_iperf_cfg.packet_len, true);
+        MDF_ERROR_BREAK(ret != MDF_OK, "<%s> mwifi_write", mdf_err_to_name(ret));
+    }
+
+    result.sent = data_type.custom;
+
+    /**< Wait for the echoes still in flight */
+    vTaskDelay(MESH_BENCH_REPLY_TIMEOUT_MS / portTICK_RATE_MS);
+    g_mesh_bench_recv.exit = true;
+
+    while (g_mesh_bench_recv.running) {
+        vTaskDelay(10 / portTICK_RATE_MS);
+    }
+
+    mesh_bench_print(&result);
+
+    return MDF_OK;
+}
+
+/**
+ * @brief Ask all the nodes to send to the root, count what arrives from each of them
+ */
+static mdf_err_t mesh_bench_many(uint8_t *buffer)
+{
+    mdf_err_t ret                = MDF_OK;
+    int node_num                 = 0;
+    int done_num                 = 0;
+    uint8_t *recv_data           = NULL;
+    size_t recv_size             = 0;
+    uint8_t src_addr[MWIFI_ADDR_LEN] = {0};
+    const uint8_t dest_addr[]    = MWIFI_ADDR_BROADCAST;
+    mwifi_data_type_t data_type  = {.protocol = IPERF_BENCH_START};
+    mesh_bench_result_t *results = NULL;
+    mesh_addr_t *table           = NULL;
+    mesh_bench_start_t start     = {
+        .transmit_time = g_mesh_iperf_cfg.transmit_time,
+        .packet_len    = g_mesh_iperf_cfg.packet_len,
+        .compress      = g_mesh_iperf_cfg.compress,
+    };
+
+    MDF_ERROR_CHECK(!esp_mesh_is_root(), MDF_ERR_NOT_SUPPORTED, "Only the root can run this test");
+
+    table = mesh_bench_routing_table(&node_num);
+    MDF_ERROR_CHECK(!table, MDF_ERR_NO_MEM, "");
+    results = MDF_CALLOC(MAX(node_num, 1), sizeof(mesh_bench_result_t));
+    MDF_ERROR_GOTO(!results, EXIT, "");
+
+    for (int i = 0; i < node_num; ++i) {
+        memcpy(results[i].addr, table[i].addr, MWIFI_ADDR_LEN);
+        results[i].hops     = -1;
+        results[i].spend_ms = g_mesh_iperf_cfg.transmit_time * 1000;
+    }
+
+    ret = mwifi_root_write(dest_addr, 1, &data_type, &start, sizeof(mesh_bench_start_t), true);
+    MDF_ERROR_GOTO(ret != MDF_OK, EXIT, "<%s> mwifi_root_write", mdf_err_to_name(ret));
+
+    for (TickType_t end_ticks = xTaskGetTickCount() + (g_mesh_iperf_cfg.transmit_time * 1000
+                                + MESH_BENCH_REPLY_TIMEOUT_MS) / portTICK_RATE_MS;
+            done_num < node_num && xTaskGetTickCount() < end_ticks && !g_mesh_iperf_cfg.finish;) {
+        ret = mwifi_read(src_addr, &data_type, &recv_data, &recv_size, 100 / portTICK_RATE_MS);
+
+        if (ret != MDF_OK) {
+            continue;
+        }
+
+        mesh_bench_result_t *result = mesh_bench_result_find(results, node_num, src_addr);
+
+        if (result && data_type.protocol == IPERF_BANDWIDTH) {
+            result->received++;
+            result->bytes += recv_size;
+        } else if (result && data_type.protocol == IPERF_BANDWIDTH_STOP && result->hops < 0) {
+            result->sent = data_type.custom;
+            result->hops = mesh_bench_hops(recv_data[0]);
+            done_num++;
+        }
+
+        MDF_FREE(recv_data);
+    }
+
+    if (done_num < node_num) {
+        MDF_LOGW("%d nodes did not report, is 'mesh_iperf -s' running on them?", node_num - done_num);
+    }
+
+    mesh_bench_print_all(results, node_num);
+    ret = MDF_OK;
+
+EXIT:
+    MDF_FREE(table);
+    MDF_FREE(results);
+    return ret;
+}
+
+/**
+ * @brief Send to all the nodes, then ask each of them how many packets it received
+ */
+static mdf_err_t mesh_bench_bcast(uint8_t *buffer)
+{
+    mdf_err_t ret                = MDF_OK;
+    int node_num                 = 0;
+    int done_num                 = 0;
+    uint32_t sent                = 0;
+    uint32_t spend_ms            = 0;
+    uint8_t *recv_data           = NULL;
+    size_t recv_size             = 0;
+    uint8_t src_addr[MWIFI_ADDR_LEN] = {0};
+    const uint8_t dest_addr[]    = MWIFI_ADDR_BROADCAST;
+    mesh_bench_result_t *results = NULL;
+    mesh_addr_t *table           = NULL;
+    mwifi_data_type_t data_type  = {
+        .protocol    = IPERF_BANDWIDTH,
+        .compression = g_mesh_iperf_cfg.compress,
+    };
+
+    MDF_ERROR_CHECK(!esp_mesh_is_root(), MDF_ERR_NOT_SUPPORTED, "Only the root can run this test");
+
+    table = mesh_bench_routing_table(&node_num);
+    MDF_ERROR_CHECK(!table, MDF_ERR_NO_MEM, "");
+    results = MDF_CALLOC(MAX(node_num, 1), sizeof(mesh_bench_result_t));
+    MDF_ERROR_GOTO(!results, EXIT, "");
+
+    TickType_t start_ticks = xTaskGetTickCount();
+    TickType_t end_ticks   = start_ticks + g_mesh_iperf_cfg.transmit_time * 1000 / portTICK_RATE_MS;
+
+    for (; xTaskGetTickCount() < end_ticks && !g_mesh_iperf_cfg.finish; data_type.custom++) {
+        ret = mwifi_root_write(dest_addr, 1, &data_type, buffer, g_mesh_iperf_cfg.packet_len, true);
+        MDF_ERROR_BREAK(ret != MDF_OK, "<%s> mwifi_root_write", mdf_err_to_name(ret));
+    }
+
+    sent     = data_type.custom;
+    spend_ms = (xTaskGetTickCount() - start_ticks) * portTICK_RATE_MS;
+
+    for (int i = 0; i < node_num; ++i) {
+        memcpy(results[i].addr, table[i].addr, MWIFI_ADDR_LEN);
+        results[i].hops     = -1;
+        results[i].sent     = sent;
+        results[i].spend_ms = spend_ms;
+    }
+
+    /**
+     * @brief The end is sent to each node, which replies to the source of the packet:
+     *        the source of a flooded packet is the parent forwarding it
+     */
+    data_type.protocol = IPERF_BANDWIDTH_STOP;
+
+    for (int i = 0; i < node_num; ++i) {
+        ret = mwifi_write(table[i].addr, &data_type, buffer, 1, true);
+        MDF_ERROR_GOTO(ret != MDF_OK, EXIT, "<%s> mwifi_write", mdf_err_to_name(ret));
+    }
+
+    for (TickType_t end_ticks = xTaskGetTickCount() + MESH_BENCH_REPLY_TIMEOUT_MS / portTICK_RATE_MS;
+            done_num < node_num && xTaskGetTickCount() < end_ticks && !g_mesh_iperf_cfg.finish;) {
+        ret = mwifi_read(src_addr, &data_type, &recv_data, &recv_size, 100 / portTICK_RATE_MS);
+
+        if (ret != MDF_OK) {
+            continue;
+        }
+
+        mesh_bench_result_t *result = mesh_bench_result_find(results, node_num, src_addr);
+
+        if (result && data_type.protocol == IPERF_BANDWIDTH_STOP && result->hops < 0) {
+            result->received = data_type.custom;
+            result->bytes    = (uint64_t)result->received * g_mesh_iperf_cfg.packet_len;
+            result->hops     = mesh_bench_hops(recv_data[0]);
+            done_num++;
+        }
+
+        MDF_FREE(recv_data);
+    }
+
+    if (done_num < node_num) {
+        MDF_LOGW("%d nodes did not report, is 'mesh_iperf -s' running on them?", node_num - done_num);
+    }
+
+    mesh_bench_print_all(results, node_num);
+    ret = MDF_OK;
+
+EXIT:
+    MDF_FREE(table);
+    MDF_FREE(results);
+    return ret;
+}
+
+/**
+ * @brief Ping a node ping_count times, append the round-trip times to samples
+ *
+ * @return Number of the replies received
+ */
+static size_t mesh_bench_ping(const uint8_t *addr, uint8_t *buffer, mesh_bench_sample_t *samples)
+{
+    mdf_err_t ret      = MDF_OK;
+    size_t recv_num    = 0;
+    uint8_t *recv_data = NULL;
+    size_t recv_size   = 0;
+    uint8_t src_addr[MWIFI_ADDR_LEN] = {0};
+
+    for (int seq = 0; seq < g_mesh_iperf_cfg.ping_count && !g_mesh_iperf_cfg.finish; ++seq) {
+        mwifi_data_type_t data_type = {
+            .protocol    = IPERF_PING,
+            .compression = g_mesh_iperf_cfg.compress,
+            .custom      = seq,
+        };
+
+        int64_t start_time = esp_timer_get_time();
+        ret = mwifi_write(addr, &data_type, buffer, g_mesh_iperf_cfg.packet_len, true);
+        MDF_ERROR_CONTINUE(ret != MDF_OK, "<%s> mwifi_write", mdf_err_to_name(ret));
+
+        /**< Drop the late replies of the previous pings */
+        for (;;) {
+            ret = mwifi_read(src_addr, &data_type, &recv_data, &recv_size,
+                             MESH_BENCH_REPLY_TIMEOUT_MS / portTICK_RATE_MS);
+
+            if (ret != MDF_OK || (data_type.protocol == IPERF_PING && data_type.custom == seq
+                                  && !memcmp(src_addr, addr, MWIFI_ADDR_LEN))) {
+                break;
+            }
+
+            MDF_FREE(recv_data);
+        }
+
+        if (ret != MDF_OK) {
+            MDF_LOGD("seq=%d Destination Host Unreachable", seq);
+            continue;
+        }
+
+        samples[recv_num].hops   = mesh_bench_hops(recv_data[0]);
+        samples[recv_num].rtt_us = esp_timer_get_time() - start_time;
+        recv_num++;
+        MDF_FREE(recv_data);
+    }
+
+    return recv_num;
+}
+
+/**
+ * @brief Ping the server, or every node of the routing table and group the results by hop count
+ */
+static mdf_err_t mesh_bench_rtt(uint8_t *buffer, bool all_nodes)
+{
+    mdf_err_t ret                    = MDF_OK;
+    int node_num                     = 1;
+    size_t sample_num                = 0;
+    uint32_t unreachable_num         = 0;
+    uint32_t sent[MESH_BENCH_HOP_NUM] = {0};
+    mesh_addr_t *table               = NULL;
+    mesh_bench_sample_t *samples     = NULL;
+
+    if (all_nodes) {
+        table = mesh_bench_routing_table(&node_num);
+        MDF_ERROR_CHECK(!table, MDF_ERR_NO_MEM, "");
+    }
+
+    samples = MDF_MALLOC(MAX(node_num * g_mesh_iperf_cfg.ping_count, 1) * sizeof(mesh_bench_sample_t));
+    MDF_ERROR_GOTO(!samples, EXIT, "");
+
+    for (int i = 0; i < node_num && !g_mesh_iperf_cfg.finish; ++i) {
+        const uint8_t *addr = all_nodes ? table[i].addr : g_mesh_iperf_cfg.addr;
+        size_t recv_num     = mesh_bench_ping(addr, buffer, samples + sample_num);
+
+        if (!recv_num) {
+            MDF_LOGW(MACSTR " is unreachable", MAC2STR(addr));
+            unreachable_num++;
+            continue;
+        }
+
+        sent[MIN(samples[sample_num].hops, MESH_BENCH_HOP_NUM - 1)] += g_mesh_iperf_cfg.ping_count;
+        sample_num += recv_num;
+    }
+
+    qsort(samples, sample_num, sizeof(mesh_bench_sample_t), mesh_bench_sample_cmp);
+
+    for (size_t begin = 0, end = 0; begin < sample_num; begin = end) {
+        mesh_bench_result_t result = {
+            .addr = MWIFI_ADDR_BROADCAST,
+            .hops = samples[begin].hops,
+        };
+
+        for (end = begin; end < sample_num && samples[end].hops == result.hops; ++end) {
+            result.spend_ms += samples[end].rtt_us / 1000;
+        }
+
+        if (!all_nodes) {
+            memcpy(result.addr, g_mesh_iperf_cfg.addr, MWIFI_ADDR_LEN);
+        }
+
+        result.received = end - begin;
+        result.sent     = sent[MIN(result.hops, MESH_BENCH_HOP_NUM - 1)];
+        result.bytes    = (uint64_t)result.received * g_mesh_iperf_cfg.packet_len * 2;
+        mesh_bench_percentile(samples + begin, result.received, &result);
+        mesh_bench_print(&result);
+    }
+
+    if (unreachable_num) {
+        MDF_LOGW("%d nodes are unreachable, is 'mesh_iperf -s' running on them?", unreachable_num);
+    }
+
+EXIT:
+    MDF_FREE(table);
+    MDF_FREE(samples);
+    return ret;
+}
+
+static void mesh_bench_task(void *arg)
+{
+    mdf_err_t ret   = MDF_OK;
+    bool all_nodes  = (bool)arg;
+    uint8_t *buffer = MDF_MALLOC(g_mesh_iperf_cfg.packet_len);
+    MDF_ERROR_GOTO(!buffer, EXIT, "");
+
+    mesh_bench_fill(buffer, g_mesh_iperf_cfg.packet_len);
+
+    if (!g_mesh_iperf_cfg.json) {
+        printf("test,peer,hops,len,compress,time_ms,sent,received,loss_pct,pps,mbps,rtt_p50_ms,rtt_p95_ms,rtt_p99_ms\n");
+    }
+
+    switch (g_mesh_iperf_cfg.bench_mode) {
+        case MESH_BENCH_TX:
+        case MESH_BENCH_RATE:
+            ret = mesh_bench_tx(buffer);
+            break;
+
+        case MESH_BENCH_BIDIR:
+            ret = mesh_bench_bidir(buffer);
+            break;
+
+        case MESH_BENCH_MANY:
+            ret = mesh_bench_many(buffer);
+            break;
+
+        case MESH_BENCH_BCAST:
+            ret = mesh_bench_bcast(buffer);
+            break;
+
+        case MESH_BENCH_RTT:
+            ret = mesh_bench_rtt(buffer, all_nodes);
+            break;
+
+        default:
+            break;
+    }
+
+    MDF_ERROR_GOTO(ret != MDF_OK, EXIT, "<%s> mesh_bench %s", mdf_err_to_name(ret),
+                   g_mesh_bench_name[g_mesh_iperf_cfg.bench_mode]);
+
+EXIT:
+    MDF_FREE(buffer);
+    g_mesh_iperf_cfg.finish = true;
+    vTaskDelete(NULL);
+}
+
+static struct {
+    struct arg_str *mode;
+    struct arg_str *client;
+    struct arg_int *len;
+    struct arg_int *time;
+    struct arg_int *count;
+    struct arg_lit *compress;
+    struct arg_lit *json;
+    struct arg_lit *abort;
+    struct arg_end *end;
+} mesh_bench_args;
+
+static int mesh_bench_func(int argc, char **argv)
+{
+    if (arg_parse(argc, argv, (void **) &mesh_bench_args) != ESP_OK) {
+        arg_print_errors(stderr, mesh_bench_args.end, argv[0]);
+        return MDF_FAIL;
+    }
+
+    if (mesh_bench_args.abort->count) {
+        g_mesh_iperf_cfg.finish = true;
+        return MDF_OK;
+    }
+
+    if (!g_mesh_iperf_cfg.finish) {
+        MDF_LOGW("Mesh iperf is running");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    int mode = MESH_BENCH_MAX;
+
+    for (int i = 0; i < MESH_BENCH_MAX && mesh_bench_args.mode->count; ++i) {
+        if (!strcmp(mesh_bench_args.mode->sval[0], g_mesh_bench_name[i])) {
+            mode = i;
+        }
+    }
+
+    MDF_ERROR_CHECK(mode == MESH_BENCH_MAX, ESP_ERR_INVALID_ARG,
+                    "The test should be one of tx, bidir, many, bcast, rate and rtt");
+
+    bool all_nodes = !mesh_bench_args.client->count;
+    MDF_ERROR_CHECK(all_nodes && (mode == MESH_BENCH_TX || mode == MESH_BENCH_BIDIR || mode == MESH_BENCH_RATE),
+                    ESP_ERR_INVALID_ARG, "The test %s needs the address of the server", g_mesh_bench_name[mode]);
+
+    if (!all_nodes && !mac_str2hex(mesh_bench_args.client->sval[0], g_mesh_iperf_cfg.addr)) {
+        MDF_LOGW("The format of the address is incorrect. Please enter the format as xx:xx:xx:xx:xx:xx");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    g_mesh_iperf_cfg.bench_mode    = mode;
+    g_mesh_iperf_cfg.packet_len    = (mode == MESH_BENCH_RATE) ? 32 : (mode == MESH_BENCH_RTT) ? 64 : MWIFI_PAYLOAD_LEN;
+    g_mesh_iperf_cfg.transmit_time = 10;
+    g_mesh_iperf_cfg.ping_count    = 32;
+    g_mesh_iperf_cfg.compress      = mesh_bench_args.compress->count;
+    g_mesh_iperf_cfg.json          = mesh_bench_args.json->count;
+
+    if (mesh_bench_args.len->count) {
+        MDF_ERROR_CHECK(mesh_bench_args.len->ival[0] < 1, ESP_ERR_INVALID_ARG, "The length should be at least 1");
+        g_mesh_iperf_cfg.packet_len = mesh_bench_args.len->ival[0];
+    }
+
+    if (mesh_bench_args.time->count) {
+        g_mesh_iperf_cfg.transmit_time = mesh_bench_args.time->ival[0];
+    }
+
+    if (mesh_bench_args.count->count) {
+        g_mesh_iperf_cfg.ping_count = mesh_bench_args.count->ival[0];
+    }
+
+    g_mesh_iperf_cfg.finish = false;
+
+    xTaskCreatePinnedToCore(mesh_bench_task, "mesh_bench", 4 * 1024,
+                            (void *)all_nodes, CONFIG_MDF_TASK_DEFAULT_PRIOTY,
+                            NULL, CONFIG_MDF_TASK_PINNED_TO_CORE);
+
+    return MDF_OK;
+}
+
+static void register_mesh_bench()
+{
+    mesh_bench_args.mode     = arg_str1("m", "mode", "<tx|bidir|many|bcast|rate|rtt>", "test to run");
+    mesh_bench_args.client   = arg_str0("c", "client", "<host (xx:xx:xx:xx:xx:xx)>", "server to test, all the nodes of the routing table if omitted");
+    mesh_bench_args.len      = arg_int0("l", "len", "<len (Bytes)>", "length of the packets (default 1456 Bytes, 32 for rate, 64 for rtt)");
+    mesh_bench_args.time     = arg_int0("t", "time", "<time (sec)>", "time in seconds to transmit for (default 10 secs)");
+    mesh_bench_args.count    = arg_int0("n", "count", "<count>", "number of pings to each node in the rtt test (default 32)");
+    mesh_bench_args.compress = arg_lit0("z", "compress", "compress the packets");
+    mesh_bench_args.json     = arg_lit0("j", "json", "print the results as JSON lines instead of CSV");
+    mesh_bench_args.abort    = arg_lit0("a", "abort", "abort running mesh_bench");
+    mesh_bench_args.end      = arg_end(8);
+
+    const esp_console_cmd_t cmd = {
+        .command  = "mesh_bench",
+        .help     = "ESP-WIFI-MESH benchmarks against the nodes running 'mesh_iperf -s', results in CSV or JSON",
+        .hint     = NULL,
+        .func     = &mesh_bench_func,
+        .argtable = &mesh_bench_args,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
+
+static struct {
+    struct arg_lit *reset;
+    struct arg_end *end;
+} mesh_stats_args;
+
+static void mesh_stats_print(const mwifi_stats_t *stats)
+{
+    char hist_str[MWIFI_STATS_LATENCY_NUM * 11 + 1] = {0};
+
+    for (int i = 0, len = 0; i < MWIFI_STATS_LATENCY_NUM; ++i) {
+        len += sprintf(hist_str + len, " %u", stats->latency_hist[i]);
+    }
+
+    MDF_LOGI("addr: " MACSTR, MAC2STR(stats->addr));
+    MDF_LOGI("tx packets: %u, bytes: %u, fragments: %u, retries: %u, failed: %u, paced: %u ms, held: %u, forwarded: %u, forward dropped: %u",
+             stats->tx_packets, stats->tx_bytes, stats->tx_fragments, stats->tx_retries,
+             stats->tx_failed, stats->tx_paced_ms, stats->tx_held, stats->forwarded, stats->forward_dropped);
+    MDF_LOGI("rx packets: %u, bytes: %u, fragments: %u, duplicates: %u, reassembly drops: %u, uncompress failed: %u, queue drops: %u",
+             stats->rx_packets, stats->rx_bytes, stats->rx_fragments, stats->rx_duplicates,
+             stats->rx_reassembly_drops, stats->rx_uncompress_failed, stats->rx_queue_drops);
+    MDF_LOGI("send latency (<1, <2, <4 ... ms):%s", hist_str);
+}
+
+static int mesh_stats_func(int argc, char **argv)
+{
+    if (arg_parse(argc, argv, (void **) &mesh_stats_args) != ESP_OK) {
+        arg_print_errors(stderr, mesh_stats_args.end, argv[0]);
+        return MDF_FAIL;
+    }
+
+    mdf_err_t ret          = MDF_OK;
+    mwifi_stats_t total    = {0};
+    size_t peer_num        = MWIFI_STATS_PEER_NUM;
+    mwifi_stats_t *peers   = NULL;
+
+    if (mesh_stats_args.reset->count) {
+        ret = mwifi_reset_stats();
+        MDF_ERROR_CHECK(ret != MDF_OK, ret, "Reset the statistics");
+        return MDF_OK;
+    }
+
+    peers = MDF_MALLOC(peer_num * sizeof(mwifi_stats_t));
+    MDF_ERROR_CHECK(!peers, MDF_ERR_NO_MEM, "");
+
+    ret = mwifi_get_stats(&total, peers, &peer_num);
+    MDF_ERROR_GOTO(ret != MDF_OK, EXIT, "Get the statistics");
+
+    mesh_stats_print(&total);
+
+    for (int i = 0; i < peer_num; ++i) {
+        mesh_stats_print(peers + i);
+    }
+
+    /**< The flow queues of the root, only with CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE */
+    mwifi_rx_queue_stats_t queue_stats[MWIFI_RX_QUEUE_NUM] = {0};
+    size_t queue_num = MWIFI_RX_QUEUE_NUM;
+
+    if (esp_mesh_is_root() && mwifi_get_rx_queue_stats(queue_stats, &queue_num) == MDF_OK) {
+        for (int i = 0; i < queue_num; ++i) {
+            MDF_LOGI("rx queue: %d, last src: " MACSTR ", depth: %u, depth max: %u, enqueued: %u, dropped: %u, read: %u, latency avg: %u ms, max: %u ms",
+                     i, MAC2STR(queue_stats[i].addr), queue_stats[i].depth, queue_stats[i].depth_max,
+                     queue_stats[i].enqueued, queue_stats[i].dropped, queue_stats[i].read,
+                     queue_stats[i].latency_avg_ms, queue_stats[i].latency_max_ms);
+        }
+    }
+
+EXIT:
+    MDF_FREE(peers);
+    return ret;
+}
+
+static void register_mesh_stats()
+{
+    mesh_stats_args.reset = arg_lit0("r", "reset", "Clear the statistics");
+    mesh_stats_args.end   = arg_end(1);
+
+    const esp_console_cmd_t cmd = {
+        .command  = "mesh_stats",
+        .help     = "Print the transport statistics of ESP-WIFI-MESH, in total and of each peer",
+        .hint     = NULL,
+        .func     = &mesh_stats_func,
+        .argtable = &mesh_stats_args,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
+
 static mdf_err_t wifi_init()
 {
     mdf_err_t ret          = nvs_flash_init();
@@ -846,6 +1716,8 @@ void app_main()
     register_mesh_status();
     register_mesh_scan();
     register_mesh_iperf();
+    register_mesh_bench();
+    register_mesh_stats();
 
     printf("\n");
     MDF_LOGI(" ==================================================");
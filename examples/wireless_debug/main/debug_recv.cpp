@@ -106,6 +106,21 @@ static esp_err_t log_analysis(const uint8_t *mac, const uint8_t *data)
     return ESP_OK;
 }
 
+static void log_write(const uint8_t *src_addr, const uint8_t *data, size_t size)
+{
+    printf("[" MACSTR "] %.*s\n", MAC2STR(src_addr), size, data);
+    log_analysis(src_addr, data);
+
+    if (sdcard_is_mount()) {
+        char *buffer       = NULL;
+        char file_name[32] = {0x0};
+        sprintf(file_name, "%02x-%02x-%02x-%02x-%02x-%02x.log", MAC2STR(src_addr));
+        size_t buff_size = asprintf(&buffer, "%.*s\r\n", size, data);
+        sdcard_write_file(file_name, UINT32_MAX, buffer, buff_size);
+        free(buffer);
+    }
+}
+
 static mdf_err_t lcd_initialize()
 {
     /** Initialize LCD */
@@ -285,16 +300,15 @@ static void espnow_recv_task(void *arg)
                 }
 
                 case MDEBUG_ESPNOW_LOG: {
-                    printf("[" MACSTR "] %.*s\n", MAC2STR(src_addr), recv_size, recv_data);
-                    log_analysis(src_addr, recv_data);
-
-                    if (sdcard_is_mount()) {
-                        char *buffer       = NULL;
-                        char file_name[32] = {0x0};
-                        sprintf(file_name, "%02x-%02x-%02x-%02x-%02x-%02x.log", MAC2STR(src_addr));
-                        size_t buff_size = asprintf(&buffer, "%.*s\r\n", recv_size, recv_data);
-                        sdcard_write_file(file_name, UINT32_MAX, buffer, buff_size);
-                        free(buffer);
+                    log_write(src_addr, recv_data, recv_size);
+                    break;
+                }
+
+                case MDEBUG_ESPNOW_LOG_BATCH: {
+                    /**< Each line of the batch ends with '\0' */
+                    for (size_t offset = 0, line_size = 0; offset < recv_size; offset += line_size + 1) {
+                        line_size = strnlen((char *)recv_data + offset, recv_size - offset);
+                        log_write(src_addr, recv_data + offset, line_size);
                     }
 
                     break;
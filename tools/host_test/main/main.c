@@ -0,0 +1,58 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "unity.h"
+
+static host_test_desc_t *g_test_list = NULL;
+static host_test_desc_t **g_test_tail = &g_test_list;
+
+void host_test_register(host_test_desc_t *desc)
+{
+    *g_test_tail = desc;
+    g_test_tail  = &desc->next;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+/**
+ * @brief Run the test cases whose name or tags contain the argument, all of them without argument
+ *
+ *        ./host_test "[dedup]"
+ */
+int main(int argc, char **argv)
+{
+    const char *filter = argc > 1 ? argv[1] : NULL;
+
+    UNITY_BEGIN();
+
+    for (host_test_desc_t *test = g_test_list; test; test = test->next) {
+        if (filter && !strstr(test->name, filter) && !strstr(test->desc, filter)) {
+            continue;
+        }
+
+        Unity.TestFile = test->file;
+        UnityDefaultTestRun(test->fn, test->name, test->line);
+    }
+
+    return UNITY_END();
+}
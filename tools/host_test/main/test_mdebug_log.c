@@ -0,0 +1,255 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @brief The static functions of the log batches are tested, the source is included. The
+ *        packets of mdebug_espnow_write() are recorded instead of being sent.
+ */
+#include "sdkconfig.h"
+
+#ifndef CONFIG_MDEBUG_LOG_BATCH_ENABLE
+#define CONFIG_MDEBUG_LOG_BATCH_ENABLE 1
+#define CONFIG_MDEBUG_LOG_BATCH_TIMEOUT_MS 100
+#endif
+
+#include "mdebug.h"
+
+#define mdebug_espnow_write test_log_espnow_write
+
+mdf_err_t test_log_espnow_write(const uint8_t *dest_addr, const void *data, size_t size,
+                                mdebug_espnow_t type, TickType_t wait_ticks);
+
+#include "mdebug_log.c"
+#include "unity.h"
+
+#define TEST_LOG_PACKET_NUM (64)
+
+typedef struct {
+    mdebug_espnow_t type;
+    size_t size;
+    char data[MDEBUG_LOG_MAX_SIZE];
+} test_log_packet_t;
+
+static const uint8_t g_test_dest_addr[] = {0x30, 0xae, 0xa4, 0x80, 0x00, 0x02};
+static test_log_packet_t g_test_packet[TEST_LOG_PACKET_NUM];
+static volatile int g_test_packet_num = 0;
+
+mdf_err_t test_log_espnow_write(const uint8_t *dest_addr, const void *data, size_t size,
+                                mdebug_espnow_t type, TickType_t wait_ticks)
+{
+    test_log_packet_t *packet = g_test_packet + g_test_packet_num;
+
+    TEST_ASSERT_EQUAL_MEMORY(g_test_dest_addr, dest_addr, sizeof(g_test_dest_addr));
+    TEST_ASSERT_LESS_THAN(TEST_LOG_PACKET_NUM, g_test_packet_num);
+    TEST_ASSERT_LESS_OR_EQUAL(sizeof(packet->data), size);
+
+    packet->type = type;
+    packet->size = size;
+    memcpy(packet->data, data, size);
+    __atomic_add_fetch(&g_test_packet_num, 1, __ATOMIC_RELEASE);
+
+    return MDF_OK;
+}
+
+static void test_log_init(void)
+{
+    if (!g_log_config) {
+        g_log_config = MDF_CALLOC(1, sizeof(mdebug_log_config_t));
+        g_log_batch  = MDF_CALLOC(1, sizeof(mdebug_log_batch_t));
+        TEST_ASSERT_NOT_NULL(g_log_config);
+        TEST_ASSERT_NOT_NULL(g_log_batch);
+    }
+
+    g_log_config->log_espnow_enable = true;
+    memcpy(g_log_config->dest_addr, g_test_dest_addr, sizeof(g_test_dest_addr));
+
+    g_log_batch->size = 0;
+    g_test_packet_num = 0;
+}
+
+/**
+ * @brief A line of `size` bytes, told apart from the others by `index`
+ */
+static void test_log_line(char *line, int index, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        line[i] = 'a' + (index + i) % 26;
+    }
+}
+
+/**
+ * @brief The packets sent from `packet_index` hold the lines `line_index` and on, in order,
+ *        each one whole and ended by '\0'. Return the index of the next line.
+ */
+static int test_log_batch_expect(int packet_index, int line_index, size_t line_size)
+{
+    char line[MDEBUG_LOG_MAX_SIZE];
+
+    for (int i = packet_index; i < g_test_packet_num; ++i) {
+        test_log_packet_t *packet = g_test_packet + i;
+
+        TEST_ASSERT_EQUAL(MDEBUG_ESPNOW_LOG_BATCH, packet->type);
+        TEST_ASSERT_LESS_OR_EQUAL(MDEBUG_LOG_BATCH_SIZE, packet->size);
+        TEST_ASSERT_EQUAL(0, packet->size % (line_size + 1));
+
+        for (size_t offset = 0; offset < packet->size; offset += line_size + 1, ++line_index) {
+            test_log_line(line, line_index, line_size);
+            TEST_ASSERT_EQUAL_MEMORY(line, packet->data + offset, line_size);
+            TEST_ASSERT_EQUAL('\0', packet->data[offset + line_size]);
+        }
+    }
+
+    return line_index;
+}
+
+TEST_CASE("mdebug log packs the lines into one packet", "[mdebug][batch]")
+{
+    char line[MDEBUG_LOG_MAX_SIZE];
+
+    test_log_init();
+
+    /**< An empty batch sends nothing */
+    mdebug_log_batch_flush();
+    TEST_ASSERT_EQUAL(0, g_test_packet_num);
+
+    for (int i = 0; i < 5; ++i) {
+        test_log_line(line, i, 20);
+        mdebug_log_batch_write(line, 20);
+    }
+
+    TEST_ASSERT_EQUAL(0, g_test_packet_num);
+
+    mdebug_log_batch_flush();
+    TEST_ASSERT_EQUAL(1, g_test_packet_num);
+    TEST_ASSERT_EQUAL(5 * 21, g_test_packet[0].size);
+    TEST_ASSERT_EQUAL(5, test_log_batch_expect(0, 0, 20));
+
+    mdebug_log_batch_flush();
+    TEST_ASSERT_EQUAL(1, g_test_packet_num);
+}
+
+TEST_CASE("mdebug log sends a full batch before the line that doesn't fit", "[mdebug][batch]")
+{
+    const size_t line_size = 50;
+    const int line_num     = 23;
+    const int batch_lines  = MDEBUG_LOG_BATCH_SIZE / (line_size + 1);
+    char line[MDEBUG_LOG_MAX_SIZE];
+
+    test_log_init();
+
+    for (int i = 0; i < line_num; ++i) {
+        test_log_line(line, i, line_size);
+        mdebug_log_batch_write(line, line_size);
+
+        /**< A batch leaves the room of less than a line */
+        TEST_ASSERT_EQUAL(i / batch_lines, g_test_packet_num);
+    }
+
+    for (int i = 0; i < g_test_packet_num; ++i) {
+        TEST_ASSERT_EQUAL(batch_lines * (line_size + 1), g_test_packet[i].size);
+        TEST_ASSERT_LESS_THAN(line_size + 1, MDEBUG_LOG_BATCH_SIZE - g_test_packet[i].size);
+    }
+
+    mdebug_log_batch_flush();
+    TEST_ASSERT_EQUAL(line_num, test_log_batch_expect(0, 0, line_size));
+
+    /**< A line filling the batch with its '\0' is packed */
+    test_log_init();
+    test_log_line(line, 0, MDEBUG_LOG_BATCH_SIZE - 1);
+    mdebug_log_batch_write(line, MDEBUG_LOG_BATCH_SIZE - 1);
+    TEST_ASSERT_EQUAL(0, g_test_packet_num);
+    mdebug_log_batch_flush();
+    TEST_ASSERT_EQUAL(1, test_log_batch_expect(0, 0, MDEBUG_LOG_BATCH_SIZE - 1));
+
+    /**< A line which fits without its '\0' is not */
+    test_log_init();
+    test_log_line(line, 0, 100);
+    mdebug_log_batch_write(line, 100);
+    test_log_line(line, 1, MDEBUG_LOG_BATCH_SIZE - 101);
+    mdebug_log_batch_write(line, MDEBUG_LOG_BATCH_SIZE - 101);
+    TEST_ASSERT_EQUAL(1, g_test_packet_num);
+    TEST_ASSERT_EQUAL(101, g_test_packet[0].size);
+    TEST_ASSERT_EQUAL(MDEBUG_LOG_BATCH_SIZE - 100, g_log_batch->size);
+}
+
+TEST_CASE("mdebug log sends a line longer than a batch on its own", "[mdebug][batch]")
+{
+    const size_t long_size = MDEBUG_LOG_BATCH_SIZE + 100;
+    char line[MDEBUG_LOG_MAX_SIZE];
+
+    test_log_init();
+
+    test_log_line(line, 0, 30);
+    mdebug_log_batch_write(line, 30);
+    test_log_line(line, 1, long_size);
+    mdebug_log_batch_write(line, long_size);
+
+    /**< The lines packed before are sent first, the long one is not split */
+    TEST_ASSERT_EQUAL(2, g_test_packet_num);
+    TEST_ASSERT_EQUAL(MDEBUG_ESPNOW_LOG_BATCH, g_test_packet[0].type);
+    TEST_ASSERT_EQUAL(31, g_test_packet[0].size);
+    TEST_ASSERT_EQUAL(MDEBUG_ESPNOW_LOG, g_test_packet[1].type);
+    TEST_ASSERT_EQUAL(long_size, g_test_packet[1].size);
+    TEST_ASSERT_EQUAL_MEMORY(line, g_test_packet[1].data, long_size);
+    TEST_ASSERT_EQUAL(0, g_log_batch->size);
+
+    /**< Alone, the long line flushes nothing */
+    mdebug_log_batch_write(line, long_size);
+    TEST_ASSERT_EQUAL(3, g_test_packet_num);
+    TEST_ASSERT_EQUAL(MDEBUG_ESPNOW_LOG, g_test_packet[2].type);
+}
+
+TEST_CASE("mdebug log sends the packed lines after the timeout", "[mdebug][batch]")
+{
+    const char *lines[] = {"I (10) test: first", "I (11) test: second"};
+    int64_t start_us    = 0;
+
+    test_log_init();
+    g_log_queue = xQueueCreate(MDEBUG_LOG_QUEUE_SIZE, sizeof(mdebug_log_queue_t *));
+    TEST_ASSERT_NOT_NULL(g_log_queue);
+    xTaskCreate(mdebug_log_send_task, "mdebug_log_send", 3 * 1024, NULL, 5, &g_log_send_task_handle);
+    TEST_ASSERT_NOT_NULL(g_log_send_task_handle);
+
+    start_us = esp_timer_get_time();
+
+    for (int i = 0; i < 2; ++i) {
+        mdebug_log_queue_t *log_data = MDF_MALLOC(sizeof(mdebug_log_queue_t) + strlen(lines[i]) + 1);
+
+        TEST_ASSERT_NOT_NULL(log_data);
+        log_data->size = strlen(lines[i]);
+        log_data->type = MDEBUG_LOG_TYPE_ESPNOW;
+        strcpy(log_data->data, lines[i]);
+        TEST_ASSERT_EQUAL(pdTRUE, xQueueSend(g_log_queue, &log_data, 0));
+    }
+
+    /**< The lines wait for more */
+    vTaskDelay(pdMS_TO_TICKS(CONFIG_MDEBUG_LOG_BATCH_TIMEOUT_MS / 4));
+    TEST_ASSERT_EQUAL(0, __atomic_load_n(&g_test_packet_num, __ATOMIC_ACQUIRE));
+
+    for (int i = 0; i < 100 && !__atomic_load_n(&g_test_packet_num, __ATOMIC_ACQUIRE); ++i) {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_MDEBUG_LOG_BATCH_TIMEOUT_MS / 10));
+    }
+
+    TEST_ASSERT_GREATER_OR_EQUAL(CONFIG_MDEBUG_LOG_BATCH_TIMEOUT_MS * 1000, esp_timer_get_time() - start_us);
+    TEST_ASSERT_EQUAL(1, g_test_packet_num);
+    TEST_ASSERT_EQUAL(MDEBUG_ESPNOW_LOG_BATCH, g_test_packet[0].type);
+    TEST_ASSERT_EQUAL(strlen(lines[0]) + strlen(lines[1]) + 2, g_test_packet[0].size);
+    TEST_ASSERT_EQUAL_STRING(lines[0], g_test_packet[0].data);
+    TEST_ASSERT_EQUAL_STRING(lines[1], g_test_packet[0].data + strlen(lines[0]) + 1);
+
+    vTaskDelete(g_log_send_task_handle);
+    g_log_send_task_handle = NULL;
+    vQueueDelete(g_log_queue);
+    g_log_queue = NULL;
+}
@@ -0,0 +1,622 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @brief The static functions of mespnow are tested, the source is included
+ */
+#include "mespnow.c"
+#include "host_espnow.h"
+#include "unity.h"
+
+#define TEST_PIPE            (MESPNOW_TRANS_PIPE_RESERVED)
+#define TEST_PACKET_SIZE     (1000)  /**< 5 fragments */
+#define TEST_FRAGMENT_NUM    ((TEST_PACKET_SIZE + MESPNOW_PAYLOAD_LEN - 1) / MESPNOW_PAYLOAD_LEN)
+#define TEST_SENT_MAX_NUM    (256)
+#define TEST_READ_MAX_NUM    (64)
+#define TEST_BENCH_PACKET_NUM (40)
+
+static const uint8_t g_test_dest_addr[ESP_NOW_ETH_ALEN] = {0x30, 0xae, 0xa4, 0x80, 0x00, 0x02};
+
+static uint8_t g_test_sent_seq[TEST_SENT_MAX_NUM];
+static uint32_t g_test_sent_magic[TEST_SENT_MAX_NUM];
+static int g_test_sent_num = 0;
+
+static uint8_t g_test_read_id[TEST_READ_MAX_NUM];
+static volatile int g_test_read_num   = 0;
+static volatile int g_test_read_error = 0;
+static SemaphoreHandle_t g_test_read_done = NULL;
+
+/**
+ * @brief Record the sequence and the magic of each fragment sent
+ */
+static void test_sniffer_cb(const uint8_t *dest_addr, const uint8_t *data, int size)
+{
+    const mespnow_head_data_t *espnow_data = (const mespnow_head_data_t *)data;
+
+    if (g_test_sent_num < TEST_SENT_MAX_NUM) {
+        g_test_sent_seq[g_test_sent_num]   = espnow_data->seq;
+        g_test_sent_magic[g_test_sent_num] = espnow_data->magic;
+    }
+
+    g_test_sent_num++;
+}
+
+static mdf_err_t test_event_loop_cb(mdf_event_loop_t event, void *ctx)
+{
+    return MDF_OK;
+}
+
+static void test_mespnow_init(const host_espnow_link_t *link)
+{
+    static bool s_event_loop_inited = false;
+
+    /**< mespnow sends its events to the event loop */
+    if (!s_event_loop_inited) {
+        TEST_ASSERT_EQUAL(MDF_OK, mdf_event_loop_init(test_event_loop_cb));
+        s_event_loop_inited = true;
+    }
+
+    host_espnow_set_link(link);
+    host_espnow_set_sniffer(test_sniffer_cb);
+    g_test_sent_num = 0;
+
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_init());
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_add_peer(ESP_IF_WIFI_STA, g_test_dest_addr, NULL));
+}
+
+static void test_mespnow_deinit(void)
+{
+    host_espnow_wait_idle();
+    host_espnow_set_sniffer(NULL);
+    mespnow_del_peer(g_test_dest_addr);
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_deinit());
+}
+
+static void test_packet_fill(uint8_t *data, size_t size, int id)
+{
+    for (int i = 0; i < size; ++i) {
+        data[i] = (uint8_t)(i * 7 + id);
+    }
+}
+
+/**
+ * @brief Read the packets sent to this device itself until none comes for 200 ms,
+ *        check their content and record their ids
+ */
+static void test_read_task(void *arg)
+{
+    uint8_t src_addr[ESP_NOW_ETH_ALEN] = {0};
+    uint8_t expect[TEST_PACKET_SIZE]   = {0};
+    uint8_t *data                      = MDF_MALLOC(TEST_PACKET_SIZE + 1);
+    size_t size                        = 0;
+
+    for (g_test_read_num = 0; data; ) {
+        size = TEST_PACKET_SIZE + 1;
+
+        if (mespnow_read(TEST_PIPE, src_addr, data, &size, pdMS_TO_TICKS(200)) != MDF_OK) {
+            break;
+        }
+
+        /**< The first byte of a packet is its id */
+        test_packet_fill(expect, sizeof(expect), data[0]);
+        g_test_read_error += size != TEST_PACKET_SIZE || memcmp(expect, data, TEST_PACKET_SIZE);
+
+        if (g_test_read_num < TEST_READ_MAX_NUM) {
+            g_test_read_id[g_test_read_num] = data[0];
+        }
+
+        g_test_read_num++;
+    }
+
+    MDF_FREE(data);
+    xSemaphoreGive(g_test_read_done);
+    vTaskDelete(NULL);
+}
+
+static void test_read_start(void)
+{
+    g_test_read_error = 0;
+    g_test_read_num   = 0;
+
+    if (!g_test_read_done) {
+        g_test_read_done = xSemaphoreCreateBinary();
+    }
+
+    xTaskCreate(test_read_task, "test_read", 4096, NULL, 5, NULL);
+}
+
+/**
+ * @brief Wait for the read task to exit, the packets written successfully are all read,
+ *        in order. A failed write may have been received too, if only its acks were lost.
+ */
+static void test_read_check(const bool *written, int num)
+{
+    int read_index = 0;
+
+    xSemaphoreTake(g_test_read_done, portMAX_DELAY);
+    TEST_ASSERT_EQUAL(0, g_test_read_error);
+    TEST_ASSERT_LESS_OR_EQUAL(TEST_READ_MAX_NUM, g_test_read_num);
+
+    for (int i = 1; i < g_test_read_num; ++i) {
+        TEST_ASSERT_GREATER_THAN(g_test_read_id[i - 1], g_test_read_id[i]);
+    }
+
+    for (int id = 0; id < num; ++id) {
+        for (; read_index < g_test_read_num && g_test_read_id[read_index] < id; ++read_index);
+
+        if (written[id]) {
+            TEST_ASSERT_LESS_THAN(g_test_read_num, read_index);
+            TEST_ASSERT_EQUAL(id, g_test_read_id[read_index]);
+        }
+    }
+}
+
+static mdf_err_t test_packet_write(int id, TickType_t wait_ticks, size_t window)
+{
+    uint8_t data[TEST_PACKET_SIZE] = {0};
+
+    test_packet_fill(data, sizeof(data), id);
+
+    return mespnow_write_window(TEST_PIPE, g_test_dest_addr, data, sizeof(data), wait_ticks, window);
+}
+
+TEST_CASE("mespnow write and read a packet of several fragments", "[mespnow]")
+{
+    host_espnow_link_t link = HOST_ESPNOW_LINK_DEFAULT();
+
+    bool written[4]         = {0};
+
+    test_mespnow_init(&link);
+    test_read_start();
+
+    for (int i = 0; i < 4; ++i) {
+        TEST_ASSERT_EQUAL(MDF_OK, test_packet_write(i, portMAX_DELAY, MESPNOW_SEND_WINDOW));
+        written[i] = true;
+    }
+
+    test_read_check(written, 4);
+    TEST_ASSERT_EQUAL(4, g_test_read_num);
+
+    TEST_ASSERT_EQUAL(4 * TEST_FRAGMENT_NUM, g_test_sent_num);
+
+    test_mespnow_deinit();
+}
+
+TEST_CASE("mespnow sends the fragments in order with a window of 1", "[mespnow]")
+{
+    host_espnow_link_t link = HOST_ESPNOW_LINK_DEFAULT();
+    bool written[16]        = {0};
+    link.loss_percent       = 20;
+    link.ack_loss_percent   = 10;
+
+    test_mespnow_init(&link);
+    test_read_start();
+
+    for (int i = 0; i < 16; ++i) {
+        g_test_sent_num = 0;
+        written[i]      = test_packet_write(i, portMAX_DELAY, 1) == MDF_OK;
+
+        /**
+         * @brief Receivers of earlier versions need the fragments in order: each fragment
+         *        is the one sent before, sent again, or the next one
+         */
+        TEST_ASSERT_EQUAL(0, g_test_sent_seq[0]);
+
+        for (int j = 1; j < g_test_sent_num && j < TEST_SENT_MAX_NUM; ++j) {
+            TEST_ASSERT(g_test_sent_seq[j] == g_test_sent_seq[j - 1]
+                        || g_test_sent_seq[j] == g_test_sent_seq[j - 1] + 1);
+        }
+    }
+
+    test_read_check(written, 16);
+    test_mespnow_deinit();
+}
+
+TEST_CASE("mespnow window sends only the failed fragments again", "[mespnow]")
+{
+    host_espnow_link_t link   = HOST_ESPNOW_LINK_DEFAULT();
+    mespnow_stats_t stats[2]  = {0};
+    bool written[16]          = {0};
+    int fragment_num          = 0;
+    link.loss_percent         = 15;
+    link.ack_loss_percent     = 10;
+
+    test_mespnow_init(&link);
+    mespnow_get_stats(TEST_PIPE, stats);
+    test_read_start();
+
+    for (int i = 0; i < 16; ++i) {
+        written[i] = test_packet_write(i, portMAX_DELAY, 4) == MDF_OK;
+    }
+
+    test_read_check(written, 16);
+    mespnow_get_stats(TEST_PIPE, stats + 1);
+    TEST_ASSERT_LESS_OR_EQUAL(TEST_SENT_MAX_NUM, g_test_sent_num);
+
+    /**< The magic of a fragment is the same when it is sent again */
+    for (int i = 0; i < g_test_sent_num; ++i) {
+        int j = 0;
+
+        for (j = 0; j < i && g_test_sent_magic[j] != g_test_sent_magic[i]; ++j);
+
+        fragment_num += (j == i);
+    }
+
+    /**< Every fragment sent is either a new one or the retry of a failed one */
+    TEST_ASSERT_EQUAL(stats[1].tx_fragments - stats[0].tx_fragments, g_test_sent_num);
+    TEST_ASSERT_EQUAL(g_test_sent_num - fragment_num, stats[1].tx_retries - stats[0].tx_retries);
+    TEST_ASSERT_GREATER_THAN(0, stats[1].tx_retries - stats[0].tx_retries);
+
+    /**< Fragments received but reported as failed are received again, and filtered */
+    TEST_ASSERT_GREATER_THAN(0, stats[1].rx_duplicates - stats[0].rx_duplicates);
+    TEST_ASSERT_EQUAL(g_test_read_num, stats[1].rx_packets - stats[0].rx_packets);
+
+    test_mespnow_deinit();
+}
+
+TEST_CASE("mespnow skips the send callbacks of a failed write", "[mespnow]")
+{
+    host_espnow_link_t link  = HOST_ESPNOW_LINK_DEFAULT();
+    mespnow_stats_t stats[2] = {0};
+    bool written[2]          = {false, true};
+    link.cb_latency_us       = 50 * 1000;
+    link.loss_percent        = 100;
+
+    test_mespnow_init(&link);
+
+    /**< The write times out with 4 fragments in flight, their callbacks report failures later */
+    TEST_ASSERT_NOT_EQUAL(MDF_OK, test_packet_write(0, pdMS_TO_TICKS(10), 4));
+
+    link.cb_latency_us = 0;
+    link.loss_percent  = 0;
+    host_espnow_set_link(&link);
+    mespnow_get_stats(TEST_PIPE, stats);
+    g_test_sent_num = 0;
+
+    /**< The failures of the earlier write are not taken for the fragments of this one */
+    test_read_start();
+    TEST_ASSERT_EQUAL(MDF_OK, test_packet_write(1, portMAX_DELAY, 4));
+    test_read_check(written, 2);
+    TEST_ASSERT_EQUAL(1, g_test_read_num);
+
+    mespnow_get_stats(TEST_PIPE, stats + 1);
+    TEST_ASSERT_EQUAL(TEST_FRAGMENT_NUM, g_test_sent_num);
+    TEST_ASSERT_EQUAL(0, stats[1].tx_retries - stats[0].tx_retries);
+
+    /**< The callbacks still to come when mespnow is deinitialized are not skipped after init */
+    link.cb_latency_us = 50 * 1000;
+    link.loss_percent  = 100;
+    host_espnow_set_link(&link);
+    TEST_ASSERT_NOT_EQUAL(MDF_OK, test_packet_write(2, pdMS_TO_TICKS(10), 4));
+    test_mespnow_deinit();
+
+    link.cb_latency_us = 0;
+    link.loss_percent  = 0;
+    test_mespnow_init(&link);
+    TEST_ASSERT_EQUAL(MDF_OK, test_packet_write(3, pdMS_TO_TICKS(1000), 4));
+
+    test_mespnow_deinit();
+}
+
+/**
+ * @brief Throughput of mespnow_write() with a link where a frame takes 500 us on air
+ *        and its send callback comes 1 ms after it, as in a busy Wi-Fi task
+ */
+/**
+ * @brief Hand a packet of one fragment to the receive callback, as ESP-NOW does,
+ *        its payload is `id` followed by TEST_RING_PAYLOAD_LEN - 1 bytes
+ */
+#define TEST_RING_PAYLOAD_LEN (16)
+
+static void test_ring_recv(uint32_t magic, uint8_t id)
+{
+    uint8_t frame[sizeof(mespnow_head_data_t) + TEST_RING_PAYLOAD_LEN] = {0};
+    mespnow_head_data_t *espnow_data = (mespnow_head_data_t *)frame;
+
+    memcpy(espnow_data->oui, g_oui, MESPNOW_OUI_LEN);
+    espnow_data->pipe       = TEST_PIPE;
+    espnow_data->size       = TEST_RING_PAYLOAD_LEN;
+    espnow_data->total_size = TEST_RING_PAYLOAD_LEN;
+    espnow_data->magic      = magic;
+    test_packet_fill(espnow_data->payload, TEST_RING_PAYLOAD_LEN, id);
+    espnow_data->payload[0] = id;
+    espnow_data->crc        = crc8_le(UINT8_MAX, espnow_data->payload, TEST_RING_PAYLOAD_LEN);
+
+    mespnow_recv_cb(g_test_dest_addr, frame, sizeof(frame));
+}
+
+/**
+ * @brief Read the packet of test_ring_recv() with the id `id`, or none if `id` is -1
+ */
+static void test_ring_read_expect(int id)
+{
+    uint8_t src_addr[ESP_NOW_ETH_ALEN]     = {0};
+    uint8_t data[TEST_RING_PAYLOAD_LEN + 1] = {0};
+    uint8_t expect[TEST_RING_PAYLOAD_LEN]  = {0};
+    size_t size                            = sizeof(data);
+    mdf_err_t ret                          = mespnow_read(TEST_PIPE, src_addr, data, &size, 0);
+
+    if (id < 0) {
+        TEST_ASSERT_EQUAL(MDF_ERR_TIMEOUT, ret);
+        return;
+    }
+
+    test_packet_fill(expect, sizeof(expect), id);
+    expect[0] = id;
+
+    TEST_ASSERT_EQUAL(MDF_OK, ret);
+    TEST_ASSERT_EQUAL(TEST_RING_PAYLOAD_LEN, size);
+    TEST_ASSERT_EQUAL_MEMORY(g_test_dest_addr, src_addr, ESP_NOW_ETH_ALEN);
+    TEST_ASSERT_EQUAL_MEMORY(expect, data, TEST_RING_PAYLOAD_LEN);
+}
+
+TEST_CASE("mespnow receive ring drops the frames beyond its slots", "[mespnow][ring]")
+{
+    host_espnow_link_t link  = HOST_ESPNOW_LINK_DEFAULT();
+    mespnow_stats_t start    = {0};
+    mespnow_stats_t stats    = {0};
+    const uint32_t slot_num  = CONFIG_MESPNOW_TRANS_PIPE_RESERVED_QUEUE_SIZE;
+
+    test_mespnow_init(&link);
+    TEST_ASSERT_EQUAL(slot_num, g_espnow_ring[TEST_PIPE].slot_num);
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_get_stats(TEST_PIPE, &start));
+
+    /**< Nobody reads, the frames beyond the slots are dropped and counted */
+    for (int i = 0; i < slot_num + 3; ++i) {
+        test_ring_recv(0x51000 + i, i);
+    }
+
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_get_stats(TEST_PIPE, &stats));
+    TEST_ASSERT_EQUAL(3, stats.rx_queue_drops - start.rx_queue_drops);
+    TEST_ASSERT_EQUAL(slot_num, stats.rx_fragments - start.rx_fragments);
+
+    /**< The oldest frames are kept, in order */
+    for (int i = 0; i < slot_num; ++i) {
+        test_ring_read_expect(i);
+    }
+
+    test_ring_read_expect(-1);
+
+    /**< A slot read is free again */
+    test_ring_recv(0x52000, 100);
+    test_ring_read_expect(100);
+    test_ring_read_expect(-1);
+
+    /**< A frame longer than ESP-NOW sends is dropped, not copied to a slot */
+    uint8_t frame[ESP_NOW_MAX_DATA_LEN + 1] = {0};
+    memcpy(((mespnow_head_data_t *)frame)->oui, g_oui, MESPNOW_OUI_LEN);
+    ((mespnow_head_data_t *)frame)->pipe = TEST_PIPE;
+    mespnow_recv_cb(g_test_dest_addr, frame, sizeof(frame));
+    test_ring_read_expect(-1);
+
+    test_mespnow_deinit();
+}
+
+TEST_CASE("mespnow receive ring keeps the order when its counts wrap", "[mespnow][ring]")
+{
+    host_espnow_link_t link = HOST_ESPNOW_LINK_DEFAULT();
+    mespnow_ring_t *ring    = NULL;
+    uint32_t magic          = 0x53000;
+    uint8_t id              = 0;
+
+    test_mespnow_init(&link);
+    ring = g_espnow_ring + TEST_PIPE;
+
+    /**< Full and drained many times, the counts wrap at each turn */
+    for (int turn = 0; turn < 7; ++turn) {
+        for (int i = 0; i < ring->slot_num; ++i) {
+            test_ring_recv(magic++, id + i);
+        }
+
+        test_ring_recv(magic++, 0xff);
+        TEST_ASSERT_EQUAL(ring->head, (ring->tail + ring->slot_num) % (2 * ring->slot_num));
+
+        for (int i = 0; i < ring->slot_num; ++i) {
+            test_ring_read_expect(id++);
+        }
+
+        test_ring_read_expect(-1);
+        TEST_ASSERT_EQUAL(ring->head, ring->tail);
+    }
+
+    /**< Partly full across the wrap of the counts, no frame is overwritten */
+    for (int turn = 0; turn < 4 * ring->slot_num; ++turn) {
+        test_ring_recv(magic++, id);
+        test_ring_recv(magic++, id + 1);
+        TEST_ASSERT_LESS_THAN(2 * ring->slot_num, ring->head);
+        test_ring_read_expect(id);
+        test_ring_read_expect(id + 1);
+        id += 2;
+    }
+
+    test_mespnow_deinit();
+}
+
+static void test_peer_addr(uint8_t addr[ESP_NOW_ETH_ALEN], int i)
+{
+    const uint8_t base[ESP_NOW_ETH_ALEN] = {0x30, 0xae, 0xa4, 0x80, 0x10, 0x00};
+
+    memcpy(addr, base, ESP_NOW_ETH_ALEN);
+    addr[5] = i;
+}
+
+/**
+ * @brief Take and release a peer, as mdebug_espnow_write() does for each message
+ */
+static void test_peer_use(int i)
+{
+    uint8_t addr[ESP_NOW_ETH_ALEN] = {0};
+
+    test_peer_addr(addr, i);
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_add_peer(ESP_IF_WIFI_STA, addr, NULL));
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_del_peer(addr));
+}
+
+static bool test_peer_exist(int i)
+{
+    uint8_t addr[ESP_NOW_ETH_ALEN] = {0};
+
+    test_peer_addr(addr, i);
+
+    return esp_now_is_peer_exist(addr);
+}
+
+TEST_CASE("mespnow peer cache evicts the least recently used idle peer", "[mespnow][peer]")
+{
+    host_espnow_link_t link        = HOST_ESPNOW_LINK_DEFAULT();
+    uint8_t addr[ESP_NOW_ETH_ALEN] = {0};
+
+    /**< g_test_dest_addr is held by the test and takes an entry */
+    test_mespnow_init(&link);
+
+    /**< Released peers stay in the peer list of ESP-NOW */
+    for (int i = 0; i < CONFIG_MESPNOW_PEER_CACHE_NUM - 1; ++i) {
+        test_peer_use(i);
+        TEST_ASSERT_TRUE(test_peer_exist(i));
+    }
+
+    /**< The cache is full, peer 0 is the least recently used once peer 1 is used again */
+    test_peer_use(1);
+    test_peer_use(0);
+    test_peer_use(1);
+    test_peer_use(100);
+    TEST_ASSERT_TRUE(test_peer_exist(100));
+    TEST_ASSERT_FALSE(test_peer_exist(2));
+    TEST_ASSERT_TRUE(test_peer_exist(0));
+    TEST_ASSERT_TRUE(test_peer_exist(1));
+    TEST_ASSERT_TRUE(esp_now_is_peer_exist(g_test_dest_addr));
+
+    /**< A held peer is never evicted, the add fails when every entry is held */
+    for (int i = 0; i < CONFIG_MESPNOW_PEER_CACHE_NUM; ++i) {
+        if (!MESPNOW_ADDR_IS_EMPTY(g_peer[i].addr) && !g_peer[i].ref_count) {
+            TEST_ASSERT_EQUAL(MDF_OK, mespnow_add_peer(ESP_IF_WIFI_STA, g_peer[i].addr, NULL));
+        }
+    }
+
+    test_peer_addr(addr, 101);
+    TEST_ASSERT_EQUAL(ESP_ERR_ESPNOW_FULL, mespnow_add_peer(ESP_IF_WIFI_STA, addr, NULL));
+    TEST_ASSERT_FALSE(test_peer_exist(101));
+
+    /**< The one released makes room */
+    test_peer_addr(addr, 3);
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_del_peer(addr));
+    test_peer_use(101);
+    TEST_ASSERT_FALSE(test_peer_exist(3));
+    TEST_ASSERT_TRUE(test_peer_exist(101));
+
+    test_mespnow_deinit();
+}
+
+TEST_CASE("mespnow peer cache counts the references of a peer", "[mespnow][peer]")
+{
+    host_espnow_link_t link        = HOST_ESPNOW_LINK_DEFAULT();
+    uint8_t addr[ESP_NOW_ETH_ALEN] = {0};
+    uint8_t lmk[ESP_NOW_KEY_LEN]   = {0x5a};
+    esp_now_peer_info_t peer       = {0};
+    mespnow_peer_t *cache_peer     = NULL;
+
+    test_mespnow_init(&link);
+    test_peer_addr(addr, 0);
+
+    /**< Added twice, released twice, kept after, a release too many changes nothing */
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_add_peer(ESP_IF_WIFI_STA, addr, NULL));
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_add_peer(ESP_IF_WIFI_STA, addr, NULL));
+    cache_peer = mespnow_peer_find(addr);
+    TEST_ASSERT_NOT_NULL(cache_peer);
+    TEST_ASSERT_EQUAL(2, cache_peer->ref_count);
+
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_del_peer(addr));
+    TEST_ASSERT_EQUAL(1, cache_peer->ref_count);
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_del_peer(addr));
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_del_peer(addr));
+    TEST_ASSERT_EQUAL(0, cache_peer->ref_count);
+    TEST_ASSERT_TRUE(esp_now_is_peer_exist(addr));
+
+    /**< A peer with a key is removed once released, the key is not kept */
+    test_peer_addr(addr, 1);
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_add_peer(ESP_IF_WIFI_STA, addr, lmk));
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_add_peer(ESP_IF_WIFI_STA, addr, lmk));
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_del_peer(addr));
+    TEST_ASSERT_TRUE(esp_now_is_peer_exist(addr));
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_del_peer(addr));
+    TEST_ASSERT_FALSE(esp_now_is_peer_exist(addr));
+    TEST_ASSERT_NULL(mespnow_peer_find(addr));
+
+    /**< A peer added to ESP-NOW directly is not taken into the cache */
+    test_peer_addr(peer.peer_addr, 2);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_now_add_peer(&peer));
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_add_peer(ESP_IF_WIFI_STA, peer.peer_addr, NULL));
+    TEST_ASSERT_NULL(mespnow_peer_find(peer.peer_addr));
+    TEST_ASSERT_TRUE(esp_now_is_peer_exist(peer.peer_addr));
+
+    /**< The peer list of ESP-NOW is full of other peers, an idle cached peer makes room */
+    for (int i = 3; esp_now_add_peer(&peer) != ESP_ERR_ESPNOW_FULL; ++i) {
+        test_peer_addr(peer.peer_addr, i);
+    }
+
+    test_peer_addr(addr, 200);
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_add_peer(ESP_IF_WIFI_STA, addr, NULL));
+    TEST_ASSERT_TRUE(esp_now_is_peer_exist(addr));
+    TEST_ASSERT_FALSE(test_peer_exist(0));
+    TEST_ASSERT_TRUE(esp_now_is_peer_exist(g_test_dest_addr));
+    TEST_ASSERT_EQUAL(MDF_OK, mespnow_del_peer(addr));
+
+    test_mespnow_deinit();
+}
+
+TEST_CASE("mespnow write throughput by window and loss", "[mespnow][bench]")
+{
+    const size_t window_list[]      = {1, 2, 4, 8};
+    const uint8_t loss_list[]       = {0, 5, 20};
+    host_espnow_link_t link         = HOST_ESPNOW_LINK_DEFAULT();
+    float throughput[2]             = {0};
+    link.air_time_us                = 500;
+    link.cb_latency_us              = 1000;
+
+    printf("window, loss (%%), packets written, packets read, throughput (KB/s)\n");
+
+    for (int i = 0; i < sizeof(loss_list) / sizeof(loss_list[0]); ++i) {
+        for (int j = 0; j < sizeof(window_list) / sizeof(window_list[0]); ++j) {
+            bool written[TEST_BENCH_PACKET_NUM] = {0};
+            int write_num                       = 0;
+
+            link.loss_percent = loss_list[i];
+            test_mespnow_init(&link);
+            test_read_start();
+
+            int64_t start_time = esp_timer_get_time();
+
+            for (int k = 0; k < TEST_BENCH_PACKET_NUM; ++k) {
+                written[k] = test_packet_write(k, portMAX_DELAY, window_list[j]) == MDF_OK;
+                write_num += written[k];
+            }
+
+            int64_t spend_time = esp_timer_get_time() - start_time;
+            float kbps         = write_num * TEST_PACKET_SIZE * 1000.0 / spend_time;
+
+            test_read_check(written, TEST_BENCH_PACKET_NUM);
+            printf("%zu, %d, %d, %d, %.1f\n", window_list[j], loss_list[i], write_num, g_test_read_num, kbps);
+            test_mespnow_deinit();
+
+            if (!loss_list[i] && window_list[j] == 1) {
+                throughput[0] = kbps;
+            } else if (!loss_list[i] && window_list[j] == 4) {
+                throughput[1] = kbps;
+            }
+        }
+    }
+
+    /**< Four fragments in flight at least double the throughput of stop-and-wait */
+    TEST_ASSERT_GREATER_THAN((int)(2 * throughput[0]), (int)throughput[1]);
+}
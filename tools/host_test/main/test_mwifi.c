@@ -0,0 +1,1280 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @brief The static functions of mwifi are tested, the source is included.
+ *        The flow queues of the root and the coalescing of small messages are disabled
+ *        by default, they are tested too.
+ */
+#define CONFIG_MWIFI_ROOT_FAIR_QUEUE_ENABLE    1
+#define CONFIG_MWIFI_ROOT_FAIR_QUEUE_BY_SOURCE 1
+#define CONFIG_MWIFI_ROOT_FAIR_QUEUE_NUM       8
+#define CONFIG_MWIFI_ROOT_FAIR_QUEUE_SIZE      8
+#define CONFIG_MWIFI_ROOT_FAIR_QUEUE_TOTAL     16
+#define CONFIG_MWIFI_COALESCE_ENABLE           1
+#define CONFIG_MWIFI_COALESCE_SIZE_MAX         128
+#define CONFIG_MWIFI_COALESCE_FLUSH_MS         20
+
+#include "mwifi.c"
+#include "host_heap.h"
+#include "host_mesh.h"
+#include "unity.h"
+
+#define TEST_CHILD_NUM    (4)
+#define TEST_SUBNET_NUM   (HOST_MESH_SUBNET_MAX_NUM)
+#define TEST_FRAGMENT_NUM (16)
+
+/**
+ * @brief A fragment handed to esp_mesh_send()
+ */
+typedef struct {
+    mesh_addr_t to;
+    const uint8_t *data;
+    uint16_t size;
+    uint16_t transmit_num;
+    bool ext;                         /**< The header extension is in front of the payload */
+    uint8_t copy[MWIFI_PAYLOAD_LEN];
+} test_fragment_t;
+
+static test_fragment_t g_test_fragment[TEST_FRAGMENT_NUM];
+static int g_test_fragment_num = 0;
+
+static void test_node_addr(mesh_addr_t *addr, int child, int node)
+{
+    const uint8_t node_addr[6] = {0x30, 0xae, 0xa4, 0x80, child, node};
+    memcpy(addr->addr, node_addr, sizeof(node_addr));
+}
+
+static void test_mwifi_init(void)
+{
+    mwifi_init_config_t init_config = MWIFI_INIT_CONFIG_DEFAULT();
+
+    if (!g_mwifi_inited_flag) {
+        TEST_ASSERT_EQUAL(MDF_OK, mwifi_init(&init_config));
+    }
+}
+
+/**
+ * @brief The child `i` has `i * i` nodes in its subnet, the node 0 of each child is itself
+ */
+static void test_subnet_create(void)
+{
+    mesh_addr_t child  = {0};
+    mesh_addr_t subnet[TEST_SUBNET_NUM];
+
+    host_mesh_clear_children();
+
+    for (int i = 0; i < TEST_CHILD_NUM; ++i) {
+        test_node_addr(&child, i, 0);
+
+        for (int j = 0; j < i * i; ++j) {
+            test_node_addr(subnet + j, i, j + 1);
+        }
+
+        TEST_ASSERT_EQUAL(ESP_OK, host_mesh_add_child(&child, subnet, i * i));
+    }
+}
+
+static void test_subnet_index_free(mwifi_subnet_index_t *index)
+{
+    MDF_FREE(index->table);
+    MDF_FREE(index->nodes);
+}
+
+TEST_CASE("mwifi subnet index lookup", "[mwifi][subnet]")
+{
+    mwifi_subnet_index_t index = {0};
+    mesh_addr_t addr           = {0};
+
+    test_mwifi_init();
+    test_subnet_create();
+
+    /**< An index never built knows no node */
+    test_node_addr(&addr, 1, 0);
+    TEST_ASSERT_EQUAL(0, mwifi_subnet_index_lookup(&index, &addr));
+
+    mwifi_subnet_index_update(&index);
+    TEST_ASSERT_TRUE(index.built);
+    TEST_ASSERT_EQUAL(TEST_CHILD_NUM, index.child_num);
+
+    for (int i = 0; i < TEST_CHILD_NUM; ++i) {
+        for (int j = 0; j <= i * i; ++j) {
+            test_node_addr(&addr, i, j);
+            TEST_ASSERT_EQUAL(i + 1, mwifi_subnet_index_lookup(&index, &addr));
+        }
+
+        test_node_addr(&addr, i, i * i + 1);
+        TEST_ASSERT_EQUAL(0, mwifi_subnet_index_lookup(&index, &addr));
+    }
+
+    /**< The index is only rebuilt when the version changes */
+    host_mesh_clear_children();
+    mwifi_subnet_index_update(&index);
+    test_node_addr(&addr, 2, 4);
+    TEST_ASSERT_EQUAL(3, mwifi_subnet_index_lookup(&index, &addr));
+
+    index.version++;
+    mwifi_subnet_index_update(&index);
+    TEST_ASSERT_EQUAL(0, index.child_num);
+    TEST_ASSERT_EQUAL(0, mwifi_subnet_index_lookup(&index, &addr));
+
+    test_subnet_index_free(&index);
+}
+
+TEST_CASE("mwifi subnet index split", "[mwifi][subnet]")
+{
+    mwifi_subnet_index_t index = {0};
+    mesh_addr_t addrs_list[64] = {{{0}}};
+    size_t addrs_num           = 0;
+    size_t group_start[ESP_WIFI_MAX_CONN_NUM + 1];
+    size_t group_end[ESP_WIFI_MAX_CONN_NUM + 1];
+    bool child_self[ESP_WIFI_MAX_CONN_NUM];
+
+    test_mwifi_init();
+    test_subnet_create();
+    mwifi_subnet_index_update(&index);
+
+    /**
+     * @brief The children 1 and 3 are destinations, the child 2 only through its subnet,
+     *        the nodes of the child 0xff are not in any subnet. The groups are interleaved.
+     */
+    for (int j = 0; j < 9; ++j) {
+        test_node_addr(addrs_list + addrs_num++, 3, j);
+        test_node_addr(addrs_list + addrs_num++, 0xff, j);
+
+        if (j < 4) {
+            test_node_addr(addrs_list + addrs_num++, 2, j + 1);
+        }
+
+        if (j < 2) {
+            test_node_addr(addrs_list + addrs_num++, 1, j);
+        }
+    }
+
+    mwifi_subnet_index_split(&index, addrs_list, addrs_num, group_start, group_end, child_self);
+
+    TEST_ASSERT_EQUAL(0, group_start[0]);
+    TEST_ASSERT_EQUAL(9, group_end[0]);
+    TEST_ASSERT_EQUAL(0, group_end[1] - group_start[1]);
+    TEST_ASSERT_EQUAL(1, group_end[2] - group_start[2]);
+    TEST_ASSERT_EQUAL(4, group_end[3] - group_start[3]);
+    TEST_ASSERT_EQUAL(8, group_end[4] - group_start[4]);
+    TEST_ASSERT_FALSE(child_self[0]);
+    TEST_ASSERT_TRUE(child_self[1]);
+    TEST_ASSERT_FALSE(child_self[2]);
+    TEST_ASSERT_TRUE(child_self[3]);
+
+    for (int k = 0; k <= TEST_CHILD_NUM; ++k) {
+        for (size_t i = group_start[k]; i < group_end[k]; ++i) {
+            TEST_ASSERT_EQUAL(k, mwifi_subnet_index_lookup(&index, addrs_list + i));
+            TEST_ASSERT_EQUAL(k ? k - 1 : 0xff, addrs_list[i].addr[4]);
+            TEST_ASSERT_NOT_EQUAL(0, k ? addrs_list[i].addr[5] : 1);
+        }
+    }
+
+    test_subnet_index_free(&index);
+}
+
+static esp_err_t test_mesh_send_record(const mesh_addr_t *to, const mesh_data_t *data,
+                                       int flag, const mesh_opt_t opt[], int opt_count)
+{
+    test_fragment_t *fragment = g_test_fragment + g_test_fragment_num;
+
+    TEST_ASSERT_LESS_THAN(TEST_FRAGMENT_NUM, g_test_fragment_num);
+    TEST_ASSERT_EQUAL(1, opt_count);
+    TEST_ASSERT_EQUAL(MWIFI_DATA_HEAD_LEN, opt->len);
+
+    memcpy(&fragment->to, to, sizeof(mesh_addr_t));
+    memcpy(fragment->copy, data->data, data->size);
+    fragment->data         = data->data;
+    fragment->size         = data->size;
+    fragment->transmit_num = ((mwifi_data_head_t *)opt->val)->transmit_num;
+    fragment->ext          = ((mwifi_data_head_t *)opt->val)->type.reserved;
+    g_test_fragment_num++;
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Check the fragments of one packet against the buffers it was sent from. A fragment
+ *        inside one buffer must be that memory, only a fragment spanning two buffers is copied.
+ *
+ * @return Number of fragments taken from the buffers without copying
+ */
+static int test_fragment_check(const test_fragment_t *fragment, int fragment_num,
+                               const mwifi_iovec_t *iov, size_t iovcnt)
+{
+    size_t offset    = 0;
+    int direct_num   = 0;
+    size_t iov_index = 0;
+    size_t iov_start = 0;
+
+    for (int i = 0; i < fragment_num; ++i, ++fragment) {
+        const uint8_t *expect = NULL;
+        size_t copied_size    = 0;
+
+        while (offset >= iov_start + iov[iov_index].size) {
+            iov_start += iov[iov_index++].size;
+        }
+
+        if (offset + fragment->size <= iov_start + iov[iov_index].size) {
+            expect = (const uint8_t *)iov[iov_index].data + offset - iov_start;
+            TEST_ASSERT_EQUAL_PTR(expect, fragment->data);
+            direct_num++;
+        } else {
+            for (size_t j = 0; j < iovcnt; ++j) {
+                TEST_ASSERT_FALSE(fragment->data >= (const uint8_t *)iov[j].data
+                                  && fragment->data < (const uint8_t *)iov[j].data + iov[j].size);
+            }
+        }
+
+        /**< The content is that of the buffers in both cases */
+        for (size_t j = iov_index, start = iov_start; copied_size < fragment->size; start += iov[j++].size) {
+            size_t segment_offset = offset + copied_size - start;
+            size_t segment_size   = MIN(iov[j].size - segment_offset, fragment->size - copied_size);
+
+            TEST_ASSERT_EQUAL_MEMORY((const uint8_t *)iov[j].data + segment_offset,
+                                     fragment->copy + copied_size, segment_size);
+            copied_size += segment_size;
+        }
+
+        offset += fragment->size;
+    }
+
+    return direct_num;
+}
+
+TEST_CASE("mwifi writev sends from the caller's buffers", "[mwifi][writev]")
+{
+    static uint8_t payload[2][5000];
+    uint8_t header[10]         = {0};
+    mwifi_data_head_t data_head = {0};
+    mesh_addr_t dest_addr       = {0};
+    mesh_opt_t opt              = {
+        .type = MESH_OPT_RECV_DS_ADDR,
+        .len  = MWIFI_DATA_HEAD_LEN,
+        .val  = (uint8_t *) &data_head,
+    };
+
+    /**
+     * @brief Fragments: [0, 1456) spans the header and the first payload,
+     *        [4368, 5824) spans the two payloads, the others are inside one buffer
+     */
+    mwifi_iovec_t iov[] = {
+        {.data = header, .size = sizeof(header)},
+        {.data = payload[0], .size = 5000},
+        {.data = payload[1], .size = 1000},
+    };
+
+    test_mwifi_init();
+    test_node_addr(&dest_addr, 1, 0);
+
+    for (int i = 0; i < sizeof(payload); ++i) {
+        ((uint8_t *)payload)[i] = esp_random();
+    }
+
+    g_test_fragment_num = 0;
+    host_mesh_set_send_cb(test_mesh_send_record);
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_subcontract_write(&dest_addr, MESH_TOS_P2P, iov, 3, MESH_DATA_P2P, &opt));
+    host_mesh_set_send_cb(NULL);
+
+    TEST_ASSERT_EQUAL(5, g_test_fragment_num);
+    TEST_ASSERT_EQUAL(3, test_fragment_check(g_test_fragment, g_test_fragment_num, iov, 3));
+}
+
+TEST_CASE("mwifi non-blocking writev sends from one copy", "[mwifi][writev]")
+{
+    static uint8_t payload[2][3000];
+    static uint8_t expect[6000];
+    mwifi_data_head_t data_head = {0};
+    mesh_addr_t dest_addr       = {0};
+    mesh_opt_t opt              = {
+        .type = MESH_OPT_RECV_DS_ADDR,
+        .len  = MWIFI_DATA_HEAD_LEN,
+        .val  = (uint8_t *) &data_head,
+    };
+    mwifi_iovec_t iov[] = {
+        {.data = payload[0], .size = 3000},
+        {.data = payload[1], .size = 3000},
+    };
+
+    test_mwifi_init();
+    test_node_addr(&dest_addr, 1, 0);
+
+    for (int i = 0; i < sizeof(payload); ++i) {
+        ((uint8_t *)payload)[i] = esp_random();
+    }
+
+    memcpy(expect, payload, sizeof(expect));
+
+    g_test_fragment_num = 0;
+    host_mesh_set_send_cb(test_mesh_send_record);
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_subcontract_write(&dest_addr, MESH_TOS_P2P, iov, 2,
+                      MESH_DATA_P2P | MESH_DATA_NONBLOCK, &opt));
+
+    /**< The caller may reuse its buffers at once */
+    memset(payload, 0, sizeof(payload));
+
+    for (int i = 0; i < 100 && g_test_fragment_num < 5; ++i) {
+        vTaskDelay(10 / portTICK_RATE_MS);
+    }
+
+    host_mesh_set_send_cb(NULL);
+
+    /**< Sent from the copy, not from the caller's buffers */
+    TEST_ASSERT_EQUAL(5, g_test_fragment_num);
+
+    for (int i = 0, offset = 0; i < g_test_fragment_num; offset += g_test_fragment[i++].size) {
+        TEST_ASSERT_FALSE(g_test_fragment[i].data >= (uint8_t *)payload
+                          && g_test_fragment[i].data < (uint8_t *)payload + sizeof(payload));
+        TEST_ASSERT_EQUAL_MEMORY(expect + offset, g_test_fragment[i].copy, g_test_fragment[i].size);
+    }
+}
+
+static esp_err_t test_mesh_send_full(const mesh_addr_t *to, const mesh_data_t *data,
+                                     int flag, const mesh_opt_t opt[], int opt_count)
+{
+    return ESP_ERR_MESH_QUEUE_FULL;
+}
+
+TEST_CASE("mwifi non-blocking writes are rejected when the queue is full", "[mwifi][tx]")
+{
+    uint8_t payload[100]        = {0};
+    mwifi_data_head_t data_head = {0};
+    mesh_addr_t dest_addr       = {0};
+    mwifi_iovec_t iov           = {.data = payload, .size = sizeof(payload)};
+    mwifi_tx_queue_t *queue     = NULL;
+    mesh_opt_t opt              = {
+        .type = MESH_OPT_RECV_DS_ADDR,
+        .len  = MWIFI_DATA_HEAD_LEN,
+        .val  = (uint8_t *) &data_head,
+    };
+
+    test_mwifi_init();
+    test_node_addr(&dest_addr, 1, 2);
+    data_head.type.priority = MWIFI_PRIORITY_BULK;
+    queue = g_tx.queue + MWIFI_PRIORITY_BULK * MWIFI_TX_QUEUE_NUM + mwifi_tx_queue_index(&dest_addr);
+    uint32_t rejected = queue->stats.rejected;
+
+    /**< ESP-WIFI-MESH has no room, the first packet keeps retrying */
+    host_mesh_set_send_cb(test_mesh_send_full);
+
+    for (int i = 0; i < CONFIG_MWIFI_TX_QUEUE_SIZE; ++i) {
+        payload[0] = i;
+        TEST_ASSERT_EQUAL(MDF_OK, mwifi_subcontract_write(&dest_addr, MESH_TOS_P2P, &iov, 1,
+                          MESH_DATA_P2P | MESH_DATA_NONBLOCK, &opt));
+    }
+
+    TEST_ASSERT_EQUAL(ESP_ERR_MESH_QUEUE_FULL, mwifi_subcontract_write(&dest_addr, MESH_TOS_P2P, &iov, 1,
+                      MESH_DATA_P2P | MESH_DATA_NONBLOCK, &opt));
+    TEST_ASSERT_EQUAL(rejected + 1, queue->stats.rejected);
+
+    /**< Once there is room again, the queued copies are sent in order */
+    g_test_fragment_num = 0;
+    host_mesh_set_send_cb(test_mesh_send_record);
+
+    for (int i = 0; i < 100 && g_test_fragment_num < CONFIG_MWIFI_TX_QUEUE_SIZE; ++i) {
+        vTaskDelay(10 / portTICK_RATE_MS);
+    }
+
+    host_mesh_set_send_cb(NULL);
+    TEST_ASSERT_EQUAL(CONFIG_MWIFI_TX_QUEUE_SIZE, g_test_fragment_num);
+    TEST_ASSERT_EQUAL(0, queue->copy_num);
+
+    for (int i = 0; i < CONFIG_MWIFI_TX_QUEUE_SIZE; ++i) {
+        TEST_ASSERT_EQUAL(i, g_test_fragment[i].copy[0]);
+    }
+
+    /**< Room again for a copy */
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_subcontract_write(&dest_addr, MESH_TOS_P2P, &iov, 1,
+                      MESH_DATA_P2P | MESH_DATA_NONBLOCK, &opt));
+
+    for (int i = 0; i < 100 && queue->copy_num; ++i) {
+        vTaskDelay(10 / portTICK_RATE_MS);
+    }
+
+    TEST_ASSERT_EQUAL(0, queue->copy_num);
+}
+
+#define TEST_TX_BULK    (0xb1)  /**< First byte of the fragments of the bulk packet */
+#define TEST_TX_CONTROL (0xc1)  /**< Of the control packet to the same destination */
+#define TEST_TX_OTHER   (0xc2)  /**< Of the control packet to another destination */
+
+static uint8_t g_test_tx_payload[3][5000];
+static int g_test_tx_send_num = 0;
+
+/**
+ * @brief The third fragment of the bulk packet finds no room. Meanwhile a control packet
+ *        to the same destination and one to another destination are queued.
+ */
+static esp_err_t test_mesh_send_interrupt(const mesh_addr_t *to, const mesh_data_t *data,
+                                          int flag, const mesh_opt_t opt[], int opt_count)
+{
+    mwifi_data_head_t data_head = {.type.priority = MWIFI_PRIORITY_CONTROL};
+    mesh_opt_t control_opt      = {
+        .type = MESH_OPT_RECV_DS_ADDR,
+        .len  = MWIFI_DATA_HEAD_LEN,
+        .val  = (uint8_t *) &data_head,
+    };
+    mwifi_iovec_t iov[2] = {
+        {.data = g_test_tx_payload[1], .size = 3000},
+        {.data = g_test_tx_payload[2], .size = 100},
+    };
+    mesh_addr_t other_addr = {0};
+
+    if (++g_test_tx_send_num != 3) {
+        return test_mesh_send_record(to, data, flag, opt, opt_count);
+    }
+
+    test_node_addr(&other_addr, 2, 3);
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_subcontract_write(to, MESH_TOS_P2P, iov, 1,
+                      MESH_DATA_P2P | MESH_DATA_NONBLOCK, &control_opt));
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_subcontract_write(&other_addr, MESH_TOS_P2P, iov + 1, 1,
+                      MESH_DATA_P2P | MESH_DATA_NONBLOCK, &control_opt));
+
+    return ESP_ERR_MESH_QUEUE_FULL;
+}
+
+TEST_CASE("mwifi packets to a destination are never interleaved", "[mwifi][tx]")
+{
+    mwifi_data_head_t data_head = {.type.priority = MWIFI_PRIORITY_BULK};
+    mesh_addr_t dest_addr       = {0};
+    mwifi_iovec_t iov           = {.data = g_test_tx_payload[0], .size = 5000};
+    mesh_opt_t opt              = {
+        .type = MESH_OPT_RECV_DS_ADDR,
+        .len  = MWIFI_DATA_HEAD_LEN,
+        .val  = (uint8_t *) &data_head,
+    };
+    const uint8_t expect[] = {
+        TEST_TX_BULK, TEST_TX_BULK, TEST_TX_OTHER, TEST_TX_BULK, TEST_TX_BULK,
+        TEST_TX_CONTROL, TEST_TX_CONTROL, TEST_TX_CONTROL,
+    };
+
+    test_mwifi_init();
+    test_node_addr(&dest_addr, 1, 3);
+    memset(g_test_tx_payload[0], TEST_TX_BULK, sizeof(g_test_tx_payload[0]));
+    memset(g_test_tx_payload[1], TEST_TX_CONTROL, sizeof(g_test_tx_payload[1]));
+    memset(g_test_tx_payload[2], TEST_TX_OTHER, sizeof(g_test_tx_payload[2]));
+
+    g_test_fragment_num = 0;
+    g_test_tx_send_num  = 0;
+    host_mesh_set_send_cb(test_mesh_send_interrupt);
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_subcontract_write(&dest_addr, MESH_TOS_P2P, &iov, 1, MESH_DATA_P2P, &opt));
+
+    for (int i = 0; i < 100 && g_test_fragment_num < sizeof(expect); ++i) {
+        vTaskDelay(10 / portTICK_RATE_MS);
+    }
+
+    host_mesh_set_send_cb(NULL);
+
+    /**
+     * @brief The control packet to another destination is sent while the bulk packet waits,
+     *        the one to the same destination only after the last fragment of the bulk packet
+     */
+    TEST_ASSERT_EQUAL(sizeof(expect), g_test_fragment_num);
+
+    for (int i = 0; i < sizeof(expect); ++i) {
+        TEST_ASSERT_EQUAL(expect[i], g_test_fragment[i].copy[0]);
+    }
+}
+
+TEST_CASE("mwifi destination is busy while a packet to it is partly sent", "[mwifi][tx]")
+{
+    mwifi_tx_packet_t sending = {0};
+    mwifi_tx_packet_t waiting = {0};
+    mwifi_tx_packet_t other   = {0};
+
+    test_mwifi_init();
+    test_node_addr(&sending.dest_addr, 1, 4);
+    test_node_addr(&waiting.dest_addr, 1, 4);
+    test_node_addr(&other.dest_addr, 1, 5);
+
+    xSemaphoreTake(g_tx.lock, portMAX_DELAY);
+
+    mwifi_tx_queue_t *queue = g_tx.queue + MWIFI_PRIORITY_BULK * MWIFI_TX_QUEUE_NUM;
+    mwifi_tx_packet_t *head = queue->head;
+    queue->head = &sending;
+
+    TEST_ASSERT_FALSE(mwifi_tx_dest_busy(&waiting));
+    sending.offset = MWIFI_PAYLOAD_LEN;
+    TEST_ASSERT_TRUE(mwifi_tx_dest_busy(&waiting));
+    TEST_ASSERT_FALSE(mwifi_tx_dest_busy(&other));
+
+    /**< The packet partly sent itself goes on */
+    TEST_ASSERT_FALSE(mwifi_tx_dest_busy(&sending));
+
+    queue->head = head;
+    xSemaphoreGive(g_tx.lock);
+}
+
+TEST_CASE("mwifi multicast forwarding sends from the caller's buffers", "[mwifi][writev]")
+{
+    static uint8_t payload[4000];
+    mesh_addr_t addrs_list[4]   = {{{0}}};
+    mwifi_data_head_t data_head = {0};
+    mwifi_iovec_t iov           = {.data = payload, .size = sizeof(payload)};
+    mesh_opt_t opt              = {
+        .type = MESH_OPT_RECV_DS_ADDR,
+        .len  = MWIFI_DATA_HEAD_LEN,
+        .val  = (uint8_t *) &data_head,
+    };
+
+    test_mwifi_init();
+    test_subnet_create();
+    g_subnet_index.version++;
+
+    for (int i = 0; i < sizeof(payload); ++i) {
+        payload[i] = esp_random();
+    }
+
+    /**< Two nodes below the child 2, two below the child 3 */
+    test_node_addr(addrs_list + 0, 2, 1);
+    test_node_addr(addrs_list + 1, 3, 5);
+    test_node_addr(addrs_list + 2, 2, 4);
+    test_node_addr(addrs_list + 3, 3, 9);
+
+    g_test_fragment_num = 0;
+    host_mesh_set_send_cb(test_mesh_send_record);
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_transmit_write(addrs_list, 4, MESH_TOS_P2P, &iov, 1, MESH_DATA_P2P, &opt));
+    host_mesh_set_send_cb(NULL);
+
+    /**< One packet to each child, the address list of its nodes in front of the payload */
+    TEST_ASSERT_EQUAL(6, g_test_fragment_num);
+
+    for (int i = 0; i < 2; ++i) {
+        const test_fragment_t *fragment = g_test_fragment + i * 3;
+        mwifi_iovec_t transmit_iov[2]   = {
+            {.data = fragment->copy, .size = fragment->transmit_num * MWIFI_ADDR_LEN},
+            {.data = payload, .size = sizeof(payload)},
+        };
+
+        TEST_ASSERT_EQUAL(2, fragment->transmit_num);
+        TEST_ASSERT_EQUAL(2 + i, fragment->to.addr[4]);
+
+        for (int j = 0; j < fragment->transmit_num; ++j) {
+            TEST_ASSERT_EQUAL(2 + i, fragment->copy[j * MWIFI_ADDR_LEN + 4]);
+        }
+
+        /**< The address list was checked above, only its place in front of the payload is checked */
+        TEST_ASSERT_EQUAL(2, test_fragment_check(fragment, 3, transmit_iov, 2));
+    }
+}
+
+TEST_CASE("mwifi compressed packets carry the uncompressed size to known devices", "[mwifi][ext]")
+{
+    uint8_t payload[100]        = {0};
+    uint8_t ext[MWIFI_DATA_HEAD_EXT_LEN + 1] = {0};
+    size_t ext_size             = sizeof(ext);
+    mesh_addr_t dest_addr       = {0};
+    mwifi_data_head_t data_head = {0};
+    mwifi_data_head_t recv_head = {0};
+    mwifi_iovec_t iov           = {.data = payload, .size = sizeof(payload)};
+    mesh_opt_t opt              = {
+        .type = MESH_OPT_RECV_DS_ADDR,
+        .len  = MWIFI_DATA_HEAD_LEN,
+        .val  = (uint8_t *) &data_head,
+    };
+
+    test_mwifi_init();
+    test_node_addr(&dest_addr, 3, 7);
+    memset(g_ext_peer.addr, 0, sizeof(g_ext_peer.addr));
+
+    data_head.type.compression = true;
+    data_head.uncompressed_size = 3000;
+
+    /**< Not known yet, it may run an earlier version */
+    g_test_fragment_num = 0;
+    host_mesh_set_send_cb(test_mesh_send_record);
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_subcontract_write(&dest_addr, MESH_TOS_P2P, &iov, 1, MESH_DATA_P2P, &opt));
+    TEST_ASSERT_EQUAL(1, g_test_fragment_num);
+    TEST_ASSERT_FALSE(g_test_fragment[0].ext);
+    TEST_ASSERT_EQUAL(sizeof(payload), g_test_fragment[0].size);
+
+    /**< A packet it sent with the extension, e.g. a stream */
+    recv_head.type.reserved = true;
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_data_head_ext_pull(dest_addr.addr, &recv_head, ext, &ext_size));
+    TEST_ASSERT_EQUAL(1, ext_size);
+
+    g_test_fragment_num = 0;
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_subcontract_write(&dest_addr, MESH_TOS_P2P, &iov, 1, MESH_DATA_P2P, &opt));
+    TEST_ASSERT_EQUAL(1, g_test_fragment_num);
+    TEST_ASSERT_TRUE(g_test_fragment[0].ext);
+    TEST_ASSERT_EQUAL(sizeof(payload) + MWIFI_DATA_HEAD_EXT_LEN, g_test_fragment[0].size);
+    TEST_ASSERT_EQUAL_MEMORY(MWIFI_DATA_HEAD_EXT(&data_head), g_test_fragment[0].copy, MWIFI_DATA_HEAD_EXT_LEN);
+
+    /**< The nodes a packet is forwarded to may run an earlier version */
+    g_test_fragment_num = 0;
+    data_head.transmit_num = 1;
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_subcontract_write(&dest_addr, MESH_TOS_P2P, &iov, 1, MESH_DATA_P2P, &opt));
+    TEST_ASSERT_FALSE(g_test_fragment[0].ext);
+
+    /**< Nothing to carry */
+    g_test_fragment_num = 0;
+    data_head.transmit_num = 0;
+    data_head.uncompressed_size = 0;
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_subcontract_write(&dest_addr, MESH_TOS_P2P, &iov, 1, MESH_DATA_P2P, &opt));
+    TEST_ASSERT_FALSE(g_test_fragment[0].ext);
+    host_mesh_set_send_cb(NULL);
+
+    /**< The oldest device is forgotten */
+    for (int i = 0; i < MWIFI_EXT_PEER_NUM; ++i) {
+        mesh_addr_t addr = {0};
+        test_node_addr(&addr, 4, i);
+        mwifi_ext_peer_add(addr.addr);
+    }
+
+    TEST_ASSERT_FALSE(mwifi_ext_peer_find(dest_addr.addr));
+}
+
+TEST_CASE("mwifi packets carry their priority to known devices", "[mwifi][ext]")
+{
+    uint8_t payload[100]        = {0};
+    uint8_t ext[MWIFI_DATA_HEAD_EXT_LEN] = {0};
+    size_t ext_size             = sizeof(ext);
+    mesh_addr_t dest_addr       = {0};
+    mwifi_data_head_t data_head = {.type.priority = MWIFI_PRIORITY_CONTROL};
+    mwifi_data_head_t recv_head = {0};
+    mwifi_iovec_t iov           = {.data = payload, .size = sizeof(payload)};
+    mesh_opt_t opt              = {
+        .type = MESH_OPT_RECV_DS_ADDR,
+        .len  = MWIFI_DATA_HEAD_LEN,
+        .val  = (uint8_t *) &data_head,
+    };
+
+    test_mwifi_init();
+    test_node_addr(&dest_addr, 3, 9);
+    memset(g_ext_peer.addr, 0, sizeof(g_ext_peer.addr));
+    host_mesh_set_send_cb(test_mesh_send_record);
+
+    /**< Not known yet, it may run an earlier version */
+    g_test_fragment_num = 0;
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_subcontract_write(&dest_addr, MESH_TOS_P2P, &iov, 1, MESH_DATA_P2P, &opt));
+    TEST_ASSERT_FALSE(g_test_fragment[0].ext);
+
+    recv_head.type.reserved = true;
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_data_head_ext_pull(dest_addr.addr, &recv_head, ext, &ext_size));
+
+    /**< Only the default class goes without it, to the device itself or to relay to others */
+    for (int transmit_num = 0; transmit_num < 2; ++transmit_num) {
+        for (int priority = MWIFI_PRIORITY_INTERACTIVE; priority < MWIFI_PRIORITY_MAX; ++priority) {
+            data_head.transmit_num  = transmit_num;
+            data_head.type.priority = priority;
+            g_test_fragment_num     = 0;
+            TEST_ASSERT_EQUAL(MDF_OK, mwifi_subcontract_write(&dest_addr, MESH_TOS_P2P, &iov, 1, MESH_DATA_P2P, &opt));
+            TEST_ASSERT_EQUAL(priority != MWIFI_PRIORITY_INTERACTIVE, g_test_fragment[0].ext);
+
+            if (g_test_fragment[0].ext) {
+                size_t size = g_test_fragment[0].size;
+                memset(&recv_head, 0, sizeof(recv_head));
+                recv_head.type.reserved = true;
+                TEST_ASSERT_EQUAL(MDF_OK, mwifi_data_head_ext_pull(dest_addr.addr, &recv_head,
+                                  g_test_fragment[0].copy, &size));
+                TEST_ASSERT_EQUAL(priority, recv_head.type.priority);
+                TEST_ASSERT_EQUAL(sizeof(payload), size);
+            }
+        }
+    }
+
+    /**< A broadcast packet reaches every device */
+    g_test_fragment_num     = 0;
+    data_head.transmit_num  = 0;
+    data_head.transmit_all  = true;
+    data_head.type.priority = MWIFI_PRIORITY_BULK;
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_subcontract_write(&dest_addr, MESH_TOS_P2P, &iov, 1, MESH_DATA_P2P, &opt));
+    TEST_ASSERT_FALSE(g_test_fragment[0].ext);
+    host_mesh_set_send_cb(NULL);
+}
+
+/**
+ * @brief Queue a packet for mwifi_read(), sent by `from` to this node, or flooded to all the nodes
+ */
+static void test_mesh_push_recv(const mesh_addr_t *from, uint32_t magic, bool transmit_all, const char *payload)
+{
+    mwifi_data_head_t data_head = {
+        .magic          = magic,
+        .transmit_self  = true,
+        .transmit_all   = transmit_all,
+        .total_size_low = strlen(payload),
+    };
+
+    data_head.type.communicate = transmit_all ? MWIFI_COMMUNICATE_BROADCAST : MWIFI_COMMUNICATE_UNICAST;
+
+    TEST_ASSERT_EQUAL(ESP_OK, host_mesh_push_recv(from, payload, strlen(payload), &data_head, MWIFI_DATA_HEAD_LEN));
+}
+
+/**
+ * @brief Read the next packet of mwifi_read(), or none within 20 ms
+ */
+static void test_mwifi_read_expect(const mesh_addr_t *from, const char *payload)
+{
+    uint8_t src_addr[MWIFI_ADDR_LEN] = {0};
+    mwifi_data_type_t data_type      = {0};
+    char data[64]                    = {0};
+    size_t size                      = sizeof(data);
+    mdf_err_t ret                    = mwifi_read(src_addr, &data_type, data, &size, pdMS_TO_TICKS(20));
+
+    if (!payload) {
+        TEST_ASSERT_EQUAL(ESP_ERR_MESH_TIMEOUT, ret);
+        return;
+    }
+
+    TEST_ASSERT_EQUAL(MDF_OK, ret);
+    TEST_ASSERT_EQUAL_MEMORY(from->addr, src_addr, MWIFI_ADDR_LEN);
+    TEST_ASSERT_EQUAL(strlen(payload), size);
+    TEST_ASSERT_EQUAL_MEMORY(payload, data, size);
+}
+
+/**
+ * @brief Take the packets handed to the relay task, which test_relay_init() stops
+ *
+ * @return Number of packets, the magic of the last one in `magic`
+ */
+static int test_relay_drain(uint32_t *magic)
+{
+    mwifi_relay_packet_t packet = {0};
+    int packet_num              = 0;
+
+    while (xQueueReceive(g_relay.queue, &packet, 0)) {
+        *magic = packet.data_head.magic;
+        mwifi_buffer_free(&packet.data);
+        packet_num++;
+    }
+
+    return packet_num;
+}
+
+/**
+ * @brief The relay queue is kept without its task, so that the test sees what is forwarded.
+ *        No other test needs the task.
+ */
+static void test_relay_init(void)
+{
+    test_mwifi_init();
+    mwifi_relay_stop();
+
+    if (!g_read_reassembly.dedup) {
+        g_read_reassembly.dedup = mdf_dedup_create(MDF_DEDUP_ENTRY_NUM, MDF_DEDUP_AGING_MS);
+    }
+
+    g_relay.queue = xQueueCreate(CONFIG_MWIFI_RELAY_QUEUE_SIZE, sizeof(mwifi_relay_packet_t));
+    TEST_ASSERT_NOT_NULL(g_read_reassembly.dedup);
+    TEST_ASSERT_NOT_NULL(g_relay.queue);
+    mdf_dedup_reset(g_read_reassembly.dedup);
+}
+
+TEST_CASE("mwifi flooded packets are filtered by their magic alone", "[mwifi][flood]")
+{
+    mesh_addr_t parent_addr     = {0};
+    mesh_addr_t new_parent_addr = {0};
+    uint32_t magic              = 0;
+
+    test_relay_init();
+    test_node_addr(&parent_addr, 1, 0);
+    test_node_addr(&new_parent_addr, 2, 0);
+    g_mwifi_started_flag = true;
+
+    /**< Delivered and forwarded once */
+    test_mesh_push_recv(&parent_addr, 0x1000, true, "flood");
+    test_mwifi_read_expect(&parent_addr, "flood");
+    TEST_ASSERT_EQUAL(1, test_relay_drain(&magic));
+    TEST_ASSERT_EQUAL(0x1000, magic);
+
+    /**< Again from a new parent after the topology changed, neither delivered nor forwarded */
+    test_mesh_push_recv(&new_parent_addr, 0x1000, true, "flood");
+    test_mwifi_read_expect(&new_parent_addr, NULL);
+    TEST_ASSERT_EQUAL(0, test_relay_drain(&magic));
+
+    /**< The packets to this node are still filtered by their source, with the same magic */
+    test_mesh_push_recv(&new_parent_addr, 0x1000, false, "unicast");
+    test_mesh_push_recv(&parent_addr, 0x1000, false, "unicast");
+    test_mesh_push_recv(&parent_addr, 0x1000, false, "unicast");
+    test_mwifi_read_expect(&new_parent_addr, "unicast");
+    test_mwifi_read_expect(&parent_addr, "unicast");
+    test_mwifi_read_expect(&parent_addr, NULL);
+    TEST_ASSERT_EQUAL(0, test_relay_drain(&magic));
+
+    /**< A new flood is delivered */
+    test_mesh_push_recv(&new_parent_addr, 0x1001, true, "flood 2");
+    test_mwifi_read_expect(&new_parent_addr, "flood 2");
+    TEST_ASSERT_EQUAL(1, test_relay_drain(&magic));
+
+    g_mwifi_started_flag = false;
+}
+
+TEST_CASE("mwifi relay drops the forwards, not the deliveries, when its queue is full", "[mwifi][relay]")
+{
+    mesh_addr_t parent_addr          = {0};
+    mwifi_stats_t stats              = {0};
+    mwifi_relay_packet_t packet      = {0};
+    uint8_t src_addr[MWIFI_ADDR_LEN] = {0};
+    mwifi_data_type_t data_type      = {0};
+    uint8_t *data                    = NULL;
+    size_t size                      = 0;
+    uint32_t magic                   = 0;
+    char payload[32]                 = {0};
+    uint8_t multicast[2 * MWIFI_ADDR_LEN + 9] = {0};
+    mwifi_data_head_t data_head      = {
+        .magic          = 0x3000,
+        .transmit_num   = 2,
+        .total_size_low = sizeof(multicast),
+    };
+
+    test_relay_init();
+    test_node_addr(&parent_addr, 1, 0);
+    mwifi_reset_stats();
+    g_mwifi_started_flag = true;
+
+    /**< The relay task is stuck, every flood is still delivered at once */
+    for (int i = 0; i < CONFIG_MWIFI_RELAY_QUEUE_SIZE + 2; ++i) {
+        sprintf(payload, "flood %d", i);
+        test_mesh_push_recv(&parent_addr, 0x2000 + i, true, payload);
+        test_mwifi_read_expect(&parent_addr, payload);
+    }
+
+    /**< The oldest ones are kept to be forwarded, the newest are dropped and counted */
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_get_stats(&stats, NULL, NULL));
+    TEST_ASSERT_EQUAL(2, stats.forward_dropped);
+    TEST_ASSERT_EQUAL(CONFIG_MWIFI_RELAY_QUEUE_SIZE, test_relay_drain(&magic));
+    TEST_ASSERT_EQUAL(0x2000 + CONFIG_MWIFI_RELAY_QUEUE_SIZE - 1, magic);
+
+    /**< A packet for other nodes only is handed over without copying, nothing is delivered */
+    memcpy(multicast + 2 * MWIFI_ADDR_LEN, "multicast", 9);
+    TEST_ASSERT_EQUAL(ESP_OK, host_mesh_push_recv(&parent_addr, multicast, sizeof(multicast),
+                      &data_head, MWIFI_DATA_HEAD_LEN));
+    test_mwifi_read_expect(&parent_addr, NULL);
+    TEST_ASSERT_TRUE(xQueueReceive(g_relay.queue, &packet, 0));
+    TEST_ASSERT_EQUAL(2, packet.data_head.transmit_num);
+    TEST_ASSERT_EQUAL(sizeof(multicast), packet.size);
+    TEST_ASSERT_EQUAL_MEMORY(multicast, packet.data, sizeof(multicast));
+    mwifi_buffer_free(&packet.data);
+
+    /**< A reader of the pool gets a copy of a buffer still to be forwarded */
+    test_mesh_push_recv(&parent_addr, 0x2100, true, "flood pool");
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_read_pool(src_addr, &data_type, &data, &size, pdMS_TO_TICKS(20)));
+    TEST_ASSERT_EQUAL(strlen("flood pool"), size);
+    TEST_ASSERT_EQUAL_MEMORY("flood pool", data, size);
+    TEST_ASSERT_TRUE(xQueueReceive(g_relay.queue, &packet, 0));
+    TEST_ASSERT_TRUE(packet.data != data);
+    TEST_ASSERT_EQUAL_MEMORY("flood pool", packet.data, size);
+    mwifi_buffer_free(&packet.data);
+    mwifi_read_release(data);
+
+    g_mwifi_started_flag = false;
+}
+
+TEST_CASE("mwifi coalesced messages keep their data types", "[mwifi][coalesce]")
+{
+    const mwifi_data_type_t data_type[] = {
+        {.custom = 1},
+        {.protocol = 1, .custom = 0xdeadbeef},
+        {.upgrade = true, .protocol = 3, .custom = 0x5a},
+        {.priority = MWIFI_PRIORITY_BULK, .custom = 0x12345678},
+    };
+    const int msg_num        = 24;
+    const uint8_t src_addr[] = {0x30, 0xae, 0xa4, 0x80, 0x01, 0x09};
+    static uint8_t msg[24][CONFIG_MWIFI_COALESCE_SIZE_MAX];
+    size_t msg_size[24]      = {0};
+    int read_num             = 0;
+
+    test_mwifi_init();
+
+    for (int i = 0; i < sizeof(msg); ++i) {
+        ((uint8_t *)msg)[i] = esp_random();
+    }
+
+    g_test_fragment_num = 0;
+    host_mesh_set_send_cb(test_mesh_send_record);
+
+    /**< Odd messages are gathered from two buffers */
+    for (int i = 0; i < msg_num; ++i) {
+        msg_size[i] = i * 37 % CONFIG_MWIFI_COALESCE_SIZE_MAX + 1;
+        mwifi_iovec_t iov[2] = {
+            {.data = msg[i], .size = msg_size[i] / 2},
+            {.data = msg[i] + msg_size[i] / 2, .size = msg_size[i] - msg_size[i] / 2},
+        };
+
+        if (i % 2) {
+            TEST_ASSERT_EQUAL(MDF_OK, mwifi_coalesce_write(data_type + i % 4, iov, 2, msg_size[i], true));
+        } else {
+            iov[0].size = msg_size[i];
+            TEST_ASSERT_EQUAL(MDF_OK, mwifi_coalesce_write(data_type + i % 4, iov, 1, msg_size[i], true));
+        }
+    }
+
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_coalesce_flush(true));
+    host_mesh_set_send_cb(NULL);
+
+    /**< Each packet fits in one fragment, the root splits them in order */
+    TEST_ASSERT_GREATER_THAN(1, g_test_fragment_num);
+
+    for (int i = 0; i < g_test_fragment_num; ++i) {
+        mwifi_data_head_t data_head = {.type.reserved = true};
+        size_t size                 = g_test_fragment[i].size;
+        uint8_t *packet             = mwifi_buffer_alloc(size);
+
+        TEST_ASSERT_NOT_NULL(packet);
+        TEST_ASSERT_TRUE(g_test_fragment[i].ext);
+        memcpy(packet, g_test_fragment[i].copy, size);
+        TEST_ASSERT_EQUAL(MDF_OK, mwifi_data_head_ext_pull(src_addr, &data_head, packet, &size));
+        TEST_ASSERT_TRUE(data_head.coalesced);
+
+        mwifi_coalesce_split(&g_coalesce_rx, src_addr, &packet, size);
+        TEST_ASSERT_NULL(packet);
+
+        for (;;) {
+            uint8_t recv_addr[MWIFI_ADDR_LEN]     = {0};
+            mwifi_data_type_t recv_type           = {0};
+            uint8_t data[CONFIG_MWIFI_COALESCE_SIZE_MAX] = {0};
+            size_t recv_size                      = sizeof(data);
+            mdf_err_t ret = mwifi_coalesce_pop(&g_coalesce_rx, recv_addr, &recv_type, data, &recv_size,
+                                               MWIFI_DATA_MEMORY_MALLOC_EXTERNAL);
+
+            if (ret == MDF_ERR_NOT_FOUND) {
+                break;
+            }
+
+            TEST_ASSERT_EQUAL(MDF_OK, ret);
+            TEST_ASSERT_LESS_THAN(msg_num, read_num);
+            TEST_ASSERT_EQUAL_MEMORY(src_addr, recv_addr, MWIFI_ADDR_LEN);
+            TEST_ASSERT_EQUAL_MEMORY(data_type + read_num % 4, &recv_type, sizeof(mwifi_data_type_t));
+            TEST_ASSERT_EQUAL(msg_size[read_num], recv_size);
+            TEST_ASSERT_EQUAL_MEMORY(msg[read_num], data, recv_size);
+            read_num++;
+        }
+    }
+
+    TEST_ASSERT_EQUAL(msg_num, read_num);
+}
+
+#define TEST_PACER_XON_QSIZE (32)
+
+/**
+ * @brief Fill the queues of ESP-WIFI-MESH to `tx_num` frames to the parent and `rx_num`
+ *        frames to read
+ */
+static void test_pacer_pending(int tx_num, int rx_num)
+{
+    mesh_tx_pending_t tx_pending = {.to_parent = tx_num};
+    mesh_rx_pending_t rx_pending = {.toSelf = rx_num};
+
+    host_mesh_set_pending(&tx_pending, &rx_pending);
+}
+
+static void test_pacer_reset(uint32_t rate)
+{
+    esp_mesh_set_xon_qsize(TEST_PACER_XON_QSIZE);
+    memset(&g_tx.rate, 0, sizeof(g_tx.rate));
+    g_tx.rate.rate = rate;
+    test_pacer_pending(0, 0);
+}
+
+TEST_CASE("mwifi pacer decreases the rate once per drained queue", "[mwifi][pacer]")
+{
+    int xon_qsize = esp_mesh_get_xon_qsize();
+
+    /**< Above MWIFI_TX_OCCUPANCY_HIGH, by the sent and by the received frames */
+    test_pacer_reset(1000);
+    test_pacer_pending(TEST_PACER_XON_QSIZE * 3 / 4, 0);
+    mwifi_tx_rate_wait();
+    TEST_ASSERT_EQUAL(750, g_tx.rate.rate);
+
+    /**< Not again before the queue drains at the new rate, about 43 ms */
+    mwifi_tx_rate_wait();
+    mwifi_tx_rate_wait();
+    TEST_ASSERT_EQUAL(750, g_tx.rate.rate);
+
+    g_tx.rate.decrease_us -= 1000000LL * TEST_PACER_XON_QSIZE / 750;
+    test_pacer_pending(0, TEST_PACER_XON_QSIZE);
+    mwifi_tx_rate_wait();
+    TEST_ASSERT_EQUAL(562, g_tx.rate.rate);
+
+    /**< Kept between the two thresholds */
+    test_pacer_pending(TEST_PACER_XON_QSIZE * MWIFI_TX_OCCUPANCY_LOW / 100, 0);
+    g_tx.rate.decrease_us = 0;
+    mwifi_tx_rate_wait();
+    TEST_ASSERT_EQUAL(562, g_tx.rate.rate);
+
+    /**< Never below MWIFI_TX_RATE_MIN */
+    test_pacer_reset(MWIFI_TX_RATE_MIN + 1);
+    test_pacer_pending(TEST_PACER_XON_QSIZE, 0);
+    mwifi_tx_rate_wait();
+    TEST_ASSERT_EQUAL(MWIFI_TX_RATE_MIN, g_tx.rate.rate);
+
+    /**< Halved when ESP-WIFI-MESH has no buffer, whatever the occupancy */
+    test_pacer_reset(1000);
+    mwifi_tx_rate_decrease();
+    TEST_ASSERT_EQUAL(500, g_tx.rate.rate);
+    TEST_ASSERT_GREATER_OR_EQUAL(esp_timer_get_time() + (portTICK_PERIOD_MS - 1) * 1000, g_tx.rate.next_us);
+
+    test_pacer_reset(MWIFI_TX_RATE_MIN + 1);
+    mwifi_tx_rate_decrease();
+    TEST_ASSERT_EQUAL(MWIFI_TX_RATE_MIN, g_tx.rate.rate);
+
+    test_pacer_reset(MWIFI_TX_RATE_MAX);
+    esp_mesh_set_xon_qsize(xon_qsize);
+}
+
+TEST_CASE("mwifi pacer increases the rate and stops pacing on short queues", "[mwifi][pacer]")
+{
+    int xon_qsize    = esp_mesh_get_xon_qsize();
+    int64_t start_us = 0;
+
+    test_pacer_reset(MWIFI_TX_RATE_MAX - 3 * MWIFI_TX_RATE_STEP);
+
+    for (int i = 1; i <= 3; ++i) {
+        mwifi_tx_rate_wait();
+        TEST_ASSERT_EQUAL(MWIFI_TX_RATE_MAX - (3 - i) * MWIFI_TX_RATE_STEP, g_tx.rate.rate);
+    }
+
+    /**< Not paced at MWIFI_TX_RATE_MAX */
+    start_us = esp_timer_get_time();
+
+    for (int i = 0; i < 100; ++i) {
+        TEST_ASSERT_EQUAL(0, mwifi_tx_rate_wait());
+    }
+
+    TEST_ASSERT_EQUAL(MWIFI_TX_RATE_MAX, g_tx.rate.rate);
+    TEST_ASSERT_LESS_THAN(20 * 1000, esp_timer_get_time() - start_us);
+
+    test_pacer_reset(MWIFI_TX_RATE_MAX);
+    esp_mesh_set_xon_qsize(xon_qsize);
+}
+
+TEST_CASE("mwifi pacer spaces the fragments at the rate", "[mwifi][pacer]")
+{
+    int xon_qsize    = esp_mesh_get_xon_qsize();
+    int64_t start_us = 0;
+    uint32_t wait_ms = 0;
+
+    /**< Between the two thresholds the rate doesn't change, 20 fragments at 100/s take 200 ms */
+    test_pacer_reset(100);
+    test_pacer_pending(TEST_PACER_XON_QSIZE * MWIFI_TX_OCCUPANCY_LOW / 100, 0);
+    start_us = esp_timer_get_time();
+
+    for (int i = 0; i < 20; ++i) {
+        wait_ms += mwifi_tx_rate_wait();
+    }
+
+    int64_t elapsed_ms = (esp_timer_get_time() - start_us) / 1000;
+    printf("20 fragments at 100/s: %d ms, %d ms waited\n", (int)elapsed_ms, wait_ms);
+
+    TEST_ASSERT_EQUAL(100, g_tx.rate.rate);
+    TEST_ASSERT_GREATER_OR_EQUAL(180, elapsed_ms);
+    TEST_ASSERT_LESS_THAN(400, elapsed_ms);
+    TEST_ASSERT_GREATER_OR_EQUAL(180, wait_ms);
+
+    /**< A sender idle for a while gets no burst */
+    vTaskDelay(pdMS_TO_TICKS(100));
+    start_us = esp_timer_get_time();
+
+    for (int i = 0; i < 5; ++i) {
+        mwifi_tx_rate_wait();
+    }
+
+    TEST_ASSERT_GREATER_OR_EQUAL(35 * 1000, esp_timer_get_time() - start_us);
+
+    test_pacer_reset(MWIFI_TX_RATE_MAX);
+    esp_mesh_set_xon_qsize(xon_qsize);
+}
+
+TEST_CASE("mwifi flow queue task runs on the root only", "[mwifi][fq]")
+{
+    const uint8_t src_addr[MWIFI_ADDR_LEN] = {0x30, 0xae, 0xa4, 0x80, 0x01, 0x01};
+    mwifi_data_head_t data_head           = {0};
+    uint8_t recv_addr[MWIFI_ADDR_LEN]     = {0};
+    uint8_t *data                         = NULL;
+    size_t size                           = 0;
+
+    test_mwifi_init();
+    g_mwifi_started_flag = true;
+
+    /**< Not started on a node */
+    host_mesh_set_root(false);
+    esp_mesh_event_cb(NULL, MESH_EVENT, MESH_EVENT_PARENT_CONNECTED, NULL);
+    TEST_ASSERT_NULL(g_fq.task);
+
+    host_mesh_set_root(true);
+    esp_mesh_event_cb(NULL, MESH_EVENT, MESH_EVENT_PARENT_CONNECTED, NULL);
+    TEST_ASSERT_NOT_NULL(g_fq.task);
+
+    /**< The packets queued by the former root are dropped when it becomes a node */
+    data = mwifi_buffer_alloc(100);
+    mwifi_fq_put(src_addr, &data_head, &data, 100);
+    TEST_ASSERT_EQUAL(1, g_fq.packet_num);
+
+    host_mesh_set_root(false);
+    esp_mesh_event_cb(NULL, MESH_EVENT, MESH_EVENT_LAYER_CHANGE, NULL);
+    TEST_ASSERT_NULL(g_fq.task);
+    TEST_ASSERT_EQUAL(0, g_fq.packet_num);
+    TEST_ASSERT_EQUAL(ESP_ERR_MESH_TIMEOUT, mwifi_fq_get(recv_addr, &data_head, &data, &size, 0));
+
+    /**< Stopped with the mesh */
+    host_mesh_set_root(true);
+    esp_mesh_event_cb(NULL, MESH_EVENT, MESH_EVENT_LAYER_CHANGE, NULL);
+    TEST_ASSERT_NOT_NULL(g_fq.task);
+
+    g_mwifi_started_flag = false;
+    esp_mesh_event_cb(NULL, MESH_EVENT, MESH_EVENT_STOPPED, NULL);
+    TEST_ASSERT_NULL(g_fq.task);
+    host_mesh_set_root(false);
+}
+
+/**
+ * @brief A source floods the root at twice the rate it reads, another one sends a small
+ *        packet every 10 reads. The packets of the second one wait for at most one turn
+ *        of the flooding queue, instead of the whole backlog with a single queue.
+ */
+TEST_CASE("mwifi flow queues bound the latency of a low-rate flow", "[mwifi][fq]")
+{
+    const uint8_t flood_addr[MWIFI_ADDR_LEN] = {0x30, 0xae, 0xa4, 0x80, 0x01, 0x01};
+    const uint8_t low_addr[MWIFI_ADDR_LEN]   = {0x30, 0xae, 0xa4, 0x80, 0x02, 0x01};
+    mwifi_data_head_t data_head             = {0};
+    uint8_t recv_addr[MWIFI_ADDR_LEN]       = {0};
+    uint8_t *data                           = NULL;
+    size_t size                             = 0;
+    int low_sent                            = 0;
+    int low_read                            = 0;
+    int flood_read                          = 0;
+    int wait_max                            = 0;
+    int backlog_max                         = 0;
+
+    test_mwifi_init();
+    mwifi_fq_stop();
+
+    for (int round = 0; round < 400; ++round) {
+        for (int i = 0; i < 2; ++i) {
+            data = mwifi_buffer_alloc(MWIFI_PAYLOAD_LEN);
+            mwifi_fq_put(flood_addr, &data_head, &data, MWIFI_PAYLOAD_LEN);
+        }
+
+        /**< The round is written in the packet, to count the reads it waits for */
+        if (round % 10 == 0) {
+            data = mwifi_buffer_alloc(sizeof(int));
+            memcpy(data, &round, sizeof(int));
+            mwifi_fq_put(low_addr, &data_head, &data, sizeof(int));
+            low_sent++;
+        }
+
+        backlog_max = MAX(backlog_max, g_fq.packet_num);
+        TEST_ASSERT_EQUAL(MDF_OK, mwifi_fq_get(recv_addr, &data_head, &data, &size, 0));
+
+        if (!memcmp(recv_addr, low_addr, MWIFI_ADDR_LEN)) {
+            int sent_round = 0;
+            memcpy(&sent_round, data, sizeof(int));
+            wait_max = MAX(wait_max, round - sent_round);
+            low_read++;
+        } else {
+            flood_read++;
+        }
+
+        mwifi_buffer_free(&data);
+    }
+
+    printf("backlog: %d packets, wait of the low-rate flow: %d reads at most\n", backlog_max, wait_max);
+
+    /**< The flood fills its queue, none of the low-rate packets is dropped */
+    TEST_ASSERT_EQUAL(CONFIG_MWIFI_ROOT_FAIR_QUEUE_SIZE + 1, backlog_max);
+    TEST_ASSERT_EQUAL(low_sent, low_read);
+    TEST_ASSERT_LESS_OR_EQUAL(1, wait_max);
+    TEST_ASSERT_EQUAL(400 - low_read, flood_read);
+
+    mwifi_fq_stop();
+}
+
+/**
+ * @brief An mlink response of `size` bytes at most: the device info and its characteristics
+ */
+static size_t test_mlink_json(char *json, size_t size)
+{
+    const char *name[] = {"on", "hue", "saturation", "value", "color_temperature", "brightness", "mode"};
+    size_t len         = 0;
+
+    len += snprintf(json + len, size - len, "{\"status_code\":0,\"tid\":\"%d\",\"name\":\"light_%02x%02x\","
+                    "\"mlink_version\":2,\"idf_version\":\"v3.3.1\",\"mdf_version\":\"v1.0\","
+                    "\"mesh_id\":\"123456\",\"layer\":%d,\"rssi\":-%d,\"characteristics\":[",
+                    esp_random() % 1000, esp_random() & 0xff, esp_random() & 0xff, 1 + esp_random() % 6, 30 + esp_random() % 60);
+
+    for (int i = 0; len + 120 < size; ++i) {
+        len += snprintf(json + len, size - len, "%s{\"cid\":%d,\"name\":\"%s\",\"format\":\"int\",\"perms\":%d,"
+                        "\"value\":%d,\"min\":0,\"max\":%d,\"step\":1}",
+                        i ? "," : "", i, name[i % 7], 3 + 4 * (i % 2), esp_random() % 100, i % 2 ? 100 : 360);
+    }
+
+    len += snprintf(json + len, size - len, "]}");
+
+    return len;
+}
+
+/**
+ * @brief Throughput and heap of the compression of mlink JSON. The heap is the peak while
+ *        a packet is compressed and uncompressed, the contexts are allocated again first.
+ */
+TEST_CASE("mwifi compression of mlink JSON", "[mwifi][compress][bench]")
+{
+    const size_t json_size[] = {256, 1024, 4096, 8000};
+    const int loop_num       = 200;
+    static char json[8192];
+    static uint8_t compressed[8192 + 64];
+    static uint8_t uncompressed[8192];
+
+    test_mwifi_init();
+
+    printf("size, compressed (%%), compress (KB/s), uncompress (KB/s), peak heap (bytes), kept heap (bytes)\n");
+
+    for (int i = 0; i < sizeof(json_size) / sizeof(json_size[0]); ++i) {
+        size_t size              = test_mlink_json(json, json_size[i]);
+        size_t compressed_size   = sizeof(compressed);
+        size_t uncompressed_size = sizeof(uncompressed);
+        size_t free_size         = 0;
+        int64_t compress_time    = 0;
+        int64_t uncompress_time  = 0;
+        int64_t start_time       = 0;
+
+        mwifi_zstream_free();
+        free_size = esp_get_free_heap_size();
+        host_heap_reset_minimum();
+
+        TEST_ASSERT_EQUAL(MZ_OK, mwifi_compress(compressed, &compressed_size, (uint8_t *)json, size, false));
+        TEST_ASSERT_EQUAL(MZ_OK, mwifi_uncompress(uncompressed, &uncompressed_size, compressed, compressed_size, false));
+        TEST_ASSERT_EQUAL(size, uncompressed_size);
+        TEST_ASSERT_EQUAL_MEMORY(json, uncompressed, size);
+
+        size_t peak_size = free_size - esp_get_minimum_free_heap_size();
+        size_t kept_size = free_size - esp_get_free_heap_size();
+
+        for (int j = 0; j < loop_num; ++j) {
+            compressed_size   = sizeof(compressed);
+            uncompressed_size = sizeof(uncompressed);
+
+            start_time = esp_timer_get_time();
+            mwifi_compress(compressed, &compressed_size, (uint8_t *)json, size, false);
+            compress_time += esp_timer_get_time() - start_time;
+
+            start_time = esp_timer_get_time();
+            mwifi_uncompress(uncompressed, &uncompressed_size, compressed, compressed_size, false);
+            uncompress_time += esp_timer_get_time() - start_time;
+        }
+
+        printf("%zu, %zu, %lld, %lld, %zu, %zu\n", size, compressed_size * 100 / size,
+               (long long)(size * loop_num * 1000000 / 1024 / MAX(compress_time, 1)),
+               (long long)(size * loop_num * 1000000 / 1024 / MAX(uncompress_time, 1)), peak_size, kept_size);
+
+        /**< The characteristics repeat, 1KB of JSON compresses to less than half */
+        if (size >= 1000) {
+            TEST_ASSERT_LESS_THAN(size / 2, compressed_size);
+        }
+    }
+
+    mwifi_zstream_free();
+}
@@ -0,0 +1,264 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @brief The calls are tested with the source included. The requests sent by mwifi_writev()
+ *        are queued, the test decides when and in which order the peer answers them, and
+ *        the responses are handed to mwifi_rpc_handle() of the caller at once.
+ */
+#include "sdkconfig.h"
+
+#undef CONFIG_MWIFI_RPC_CALL_NUM
+#define CONFIG_MWIFI_RPC_CALL_NUM 8
+
+#include "mwifi.h"
+
+#define mwifi_writev test_rpc_writev
+
+mdf_err_t test_rpc_writev(const uint8_t *dest_addrs, const mwifi_data_type_t *data_type,
+                          const mwifi_iovec_t *iov, size_t iovcnt, bool block);
+
+#include "mwifi_rpc.c"
+#include "unity.h"
+
+#define TEST_RPC_WAIT_MS     (50)
+#define TEST_RPC_REQ_ERROR   (0xdead)  /**< Request answered with MDF_ERR_NOT_SUPPORTED */
+#define TEST_RPC_REQ_LARGE   (0xbeef)  /**< Request answered with a response of 64 bytes */
+
+typedef struct {
+    mwifi_data_type_t data_type;
+    uint8_t packet[sizeof(mwifi_rpc_head_t) + sizeof(uint32_t)];
+    size_t size;
+} test_rpc_request_t;
+
+typedef struct {
+    uint32_t req;
+    uint32_t resp;
+    size_t resp_size;
+    mdf_err_t ret;
+} test_rpc_caller_t;
+
+static const uint8_t g_test_caller_addr[] = {0x30, 0xae, 0xa4, 0x80, 0x00, 0x01};
+static const uint8_t g_test_peer_addr[]   = {0x30, 0xae, 0xa4, 0x80, 0x00, 0x02};
+static const uint8_t g_test_other_addr[]  = {0x30, 0xae, 0xa4, 0x80, 0x00, 0x03};
+static QueueHandle_t g_test_request_queue = NULL;
+static SemaphoreHandle_t g_test_done      = NULL;
+static const uint8_t *g_test_resp_src     = g_test_peer_addr;
+static bool g_test_answer_at_once         = false;
+
+static mdf_err_t test_rpc_handler(const uint8_t *src_addr, const mwifi_data_type_t *data_type,
+                                  const void *req_data, size_t req_size, void **resp_data, size_t *resp_size)
+{
+    uint32_t req = 0;
+
+    TEST_ASSERT_EQUAL_MEMORY(g_test_caller_addr, src_addr, MWIFI_ADDR_LEN);
+    TEST_ASSERT_EQUAL(0x5a, data_type->custom);
+    TEST_ASSERT_EQUAL(sizeof(req), req_size);
+    memcpy(&req, req_data, sizeof(req));
+
+    if (req == TEST_RPC_REQ_ERROR) {
+        return MDF_ERR_NOT_SUPPORTED;
+    }
+
+    *resp_size = req == TEST_RPC_REQ_LARGE ? 64 : sizeof(uint32_t);
+    *resp_data = MDF_CALLOC(1, *resp_size);
+    TEST_ASSERT_NOT_NULL(*resp_data);
+    **(uint32_t **)resp_data = req * 3 + 1;
+
+    return MDF_OK;
+}
+
+/**
+ * @brief The peer answers a request queued by mwifi_writev()
+ */
+static void test_rpc_answer(const test_rpc_request_t *request)
+{
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_rpc_handle(g_test_caller_addr, &request->data_type,
+                      request->packet, request->size));
+}
+
+mdf_err_t test_rpc_writev(const uint8_t *dest_addrs, const mwifi_data_type_t *data_type,
+                          const mwifi_iovec_t *iov, size_t iovcnt, bool block)
+{
+    uint8_t packet[MWIFI_PAYLOAD_LEN];
+    size_t size = 0;
+
+    for (int i = 0; i < iovcnt; ++i) {
+        memcpy(packet + size, iov[i].data, iov[i].size);
+        size += iov[i].size;
+    }
+
+    if (packet[0] == MWIFI_RPC_TYPE_RESPONSE) {
+        TEST_ASSERT_EQUAL_MEMORY(g_test_caller_addr, dest_addrs, MWIFI_ADDR_LEN);
+        return mwifi_rpc_handle(g_test_resp_src, data_type, packet, size);
+    }
+
+    test_rpc_request_t request = {.data_type = *data_type, .size = size};
+
+    /**< The caller of a request may be a task of the test, nothing is asserted here */
+    if (packet[0] != MWIFI_RPC_TYPE_REQUEST || !data_type->rpc || size > sizeof(request.packet)
+            || memcmp(dest_addrs, g_test_peer_addr, MWIFI_ADDR_LEN)) {
+        return MDF_FAIL;
+    }
+
+    memcpy(request.packet, packet, size);
+
+    if (g_test_answer_at_once) {
+        test_rpc_answer(&request);
+        return MDF_OK;
+    }
+
+    return xQueueSend(g_test_request_queue, &request, 0) ? MDF_OK : MDF_FAIL;
+}
+
+static mdf_err_t test_rpc_call(uint32_t req, uint32_t *resp, size_t *resp_size, TickType_t wait_ticks)
+{
+    mwifi_data_type_t data_type = {.custom = 0x5a};
+
+    return mwifi_rpc_call(g_test_peer_addr, &data_type, &req, sizeof(req), resp, resp_size, wait_ticks);
+}
+
+static void test_rpc_caller_task(void *arg)
+{
+    test_rpc_caller_t *caller = arg;
+
+    caller->resp_size = sizeof(caller->resp);
+    caller->ret       = test_rpc_call(caller->req, &caller->resp, &caller->resp_size, portMAX_DELAY);
+
+    xSemaphoreGive(g_test_done);
+    vTaskDelete(NULL);
+}
+
+static void test_rpc_reset(void)
+{
+    if (!g_test_request_queue) {
+        g_test_request_queue = xQueueCreate(MWIFI_RPC_CALL_NUM * 2, sizeof(test_rpc_request_t));
+        g_test_done          = xSemaphoreCreateCounting(MWIFI_RPC_CALL_NUM, 0);
+    }
+
+    xQueueReset(g_test_request_queue);
+    g_test_resp_src       = g_test_peer_addr;
+    g_test_answer_at_once = false;
+    mwifi_rpc_set_handler(test_rpc_handler);
+}
+
+TEST_CASE("mwifi rpc gives each caller its own response", "[mwifi][rpc]")
+{
+    test_rpc_request_t request[MWIFI_RPC_CALL_NUM];
+    test_rpc_caller_t caller[MWIFI_RPC_CALL_NUM] = {0};
+    uint32_t resp    = 0;
+    size_t resp_size = sizeof(resp);
+
+    test_rpc_reset();
+
+    for (int i = 0; i < MWIFI_RPC_CALL_NUM; ++i) {
+        caller[i].req = 100 + i;
+        xTaskCreate(test_rpc_caller_task, "rpc_caller", 4 * 1024, caller + i, CONFIG_MDF_TASK_DEFAULT_PRIOTY, NULL);
+    }
+
+    for (int i = 0; i < MWIFI_RPC_CALL_NUM; ++i) {
+        TEST_ASSERT_TRUE(xQueueReceive(g_test_request_queue, request + i, pdMS_TO_TICKS(1000)));
+    }
+
+    /**< Every entry is waiting, one more call fails at once */
+    TEST_ASSERT_EQUAL(MDF_ERR_NO_MEM, test_rpc_call(1, &resp, &resp_size, portMAX_DELAY));
+
+    /**< The IDs differ, the responses come back in the reverse order of the requests */
+    for (int i = 0; i < MWIFI_RPC_CALL_NUM; ++i) {
+        for (int j = 0; j < i; ++j) {
+            TEST_ASSERT_NOT_EQUAL(((mwifi_rpc_head_t *)request[i].packet)->id,
+                                  ((mwifi_rpc_head_t *)request[j].packet)->id);
+        }
+    }
+
+    for (int i = MWIFI_RPC_CALL_NUM - 1; i >= 0; --i) {
+        test_rpc_answer(request + i);
+    }
+
+    for (int i = 0; i < MWIFI_RPC_CALL_NUM; ++i) {
+        TEST_ASSERT_TRUE(xSemaphoreTake(g_test_done, pdMS_TO_TICKS(1000)));
+    }
+
+    for (int i = 0; i < MWIFI_RPC_CALL_NUM; ++i) {
+        TEST_ASSERT_EQUAL(MDF_OK, caller[i].ret);
+        TEST_ASSERT_EQUAL(sizeof(uint32_t), caller[i].resp_size);
+        TEST_ASSERT_EQUAL(caller[i].req * 3 + 1, caller[i].resp);
+    }
+}
+
+TEST_CASE("mwifi rpc times out and drops the late and the foreign responses", "[mwifi][rpc]")
+{
+    test_rpc_request_t request = {0};
+    test_rpc_caller_t caller   = {.req = 7};
+    uint32_t resp              = 0;
+    size_t resp_size           = sizeof(resp);
+    int64_t start_us           = esp_timer_get_time();
+
+    test_rpc_reset();
+
+    /**< Not answered */
+    TEST_ASSERT_EQUAL(MDF_ERR_MWIFI_TIMEOUT, test_rpc_call(5, &resp, &resp_size, pdMS_TO_TICKS(TEST_RPC_WAIT_MS)));
+    TEST_ASSERT_GREATER_OR_EQUAL(TEST_RPC_WAIT_MS * 1000, esp_timer_get_time() - start_us);
+    TEST_ASSERT_TRUE(xQueueReceive(g_test_request_queue, &request, 0));
+
+    /**< Answered while the next call waits, the late response is dropped */
+    xTaskCreate(test_rpc_caller_task, "rpc_caller", 4 * 1024, &caller, CONFIG_MDF_TASK_DEFAULT_PRIOTY, NULL);
+    test_rpc_answer(&request);
+    TEST_ASSERT_TRUE(xQueueReceive(g_test_request_queue, &request, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_FALSE(xSemaphoreTake(g_test_done, pdMS_TO_TICKS(TEST_RPC_WAIT_MS)));
+
+    /**< A response with the right ID from another device is dropped too */
+    g_test_resp_src = g_test_other_addr;
+    test_rpc_answer(&request);
+    TEST_ASSERT_FALSE(xSemaphoreTake(g_test_done, pdMS_TO_TICKS(TEST_RPC_WAIT_MS)));
+
+    g_test_resp_src = g_test_peer_addr;
+    test_rpc_answer(&request);
+    TEST_ASSERT_TRUE(xSemaphoreTake(g_test_done, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_EQUAL(MDF_OK, caller.ret);
+    TEST_ASSERT_EQUAL(7 * 3 + 1, caller.resp);
+
+    /**< A response after the call is over changes nothing */
+    test_rpc_answer(&request);
+    TEST_ASSERT_FALSE(xSemaphoreTake(g_test_done, 0));
+}
+
+TEST_CASE("mwifi rpc returns the error of the handler and the size of a large response", "[mwifi][rpc]")
+{
+    uint32_t resp    = 0;
+    size_t resp_size = sizeof(resp);
+
+    test_rpc_reset();
+    g_test_answer_at_once = true;
+
+    TEST_ASSERT_EQUAL(MDF_OK, test_rpc_call(2, &resp, &resp_size, portMAX_DELAY));
+    TEST_ASSERT_EQUAL(7, resp);
+
+    TEST_ASSERT_EQUAL(MDF_ERR_NOT_SUPPORTED, test_rpc_call(TEST_RPC_REQ_ERROR, &resp, &resp_size, portMAX_DELAY));
+
+    resp_size = sizeof(resp);
+    TEST_ASSERT_EQUAL(MDF_ERR_BUF, test_rpc_call(TEST_RPC_REQ_LARGE, &resp, &resp_size, portMAX_DELAY));
+    TEST_ASSERT_EQUAL(64, resp_size);
+
+    /**< No handler */
+    mwifi_rpc_set_handler(NULL);
+    resp_size = sizeof(resp);
+    TEST_ASSERT_EQUAL(MDF_ERR_NOT_SUPPORTED, test_rpc_call(2, &resp, &resp_size, portMAX_DELAY));
+
+    /**< Every call released its entry */
+    for (int i = 0; i < MWIFI_RPC_CALL_NUM; ++i) {
+        TEST_ASSERT_EQUAL(0, g_rpc_call[i].busy);
+        TEST_ASSERT_EQUAL(0, g_rpc_call[i].waiting_id);
+    }
+}
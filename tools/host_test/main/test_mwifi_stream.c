@@ -0,0 +1,258 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @brief The static functions of the streams are tested, the source is included. The packets
+ *        of mwifi_write() and mwifi_writev() are handed to mwifi_stream_handle() at once, the
+ *        sender and the receiver of a stream are the same device with two addresses. The
+ *        retransmission timeout is shortened so that a failed stream doesn't take seconds.
+ */
+#include "sdkconfig.h"
+
+#undef CONFIG_MWIFI_STREAM_RETRANSMIT_MS
+#define CONFIG_MWIFI_STREAM_RETRANSMIT_MS 50
+
+#include "mwifi.h"
+
+#define mwifi_write  test_stream_write
+#define mwifi_writev test_stream_writev
+
+mdf_err_t test_stream_write(const uint8_t *dest_addrs, const mwifi_data_type_t *data_type,
+                            const void *data, size_t size, bool block);
+mdf_err_t test_stream_writev(const uint8_t *dest_addrs, const mwifi_data_type_t *data_type,
+                             const mwifi_iovec_t *iov, size_t iovcnt, bool block);
+
+#include "mwifi_stream.c"
+#include "host_heap.h"
+#include "unity.h"
+
+#define TEST_STREAM_CHUNK_MAX (512)  /**< Chunks of the longest message of the tests */
+
+typedef struct {
+    uint8_t sent[TEST_STREAM_CHUNK_MAX];    /**< Times each chunk is sent */
+    bool drop[TEST_STREAM_CHUNK_MAX];       /**< The first sending of the chunk is lost */
+    bool drop_all;                          /**< The receiver is gone */
+    size_t received;                        /**< Bytes passed to the callback, in order */
+    int window_max;                         /**< Chunks sent ahead of the ones received in order */
+    uint32_t acks;
+    bool abort;                             /**< The callback fails */
+} test_stream_t;
+
+static const uint8_t g_test_src_addr[]  = {0x30, 0xae, 0xa4, 0x80, 0x00, 0x01};
+static const uint8_t g_test_dest_addr[] = {0x30, 0xae, 0xa4, 0x80, 0x00, 0x02};
+static test_stream_t g_test_stream      = {0};
+
+static uint8_t test_stream_byte(size_t offset)
+{
+    return offset * 7 + (offset >> 11);
+}
+
+/**
+ * @brief The chunks of a stream are sent by the sender to the receiver
+ */
+mdf_err_t test_stream_writev(const uint8_t *dest_addrs, const mwifi_data_type_t *data_type,
+                             const mwifi_iovec_t *iov, size_t iovcnt, bool block)
+{
+    uint8_t packet[MWIFI_PAYLOAD_LEN];
+    size_t size                = 0;
+    mwifi_stream_head_t *head  = (mwifi_stream_head_t *)packet;
+
+    TEST_ASSERT_EQUAL_MEMORY(g_test_dest_addr, dest_addrs, MWIFI_ADDR_LEN);
+    TEST_ASSERT_TRUE(data_type->stream);
+
+    for (int i = 0; i < iovcnt; ++i) {
+        TEST_ASSERT_LESS_OR_EQUAL(sizeof(packet), size + iov[i].size);
+        memcpy(packet + size, iov[i].data, iov[i].size);
+        size += iov[i].size;
+    }
+
+    TEST_ASSERT_EQUAL(MWIFI_STREAM_TYPE_DATA, head->type);
+    TEST_ASSERT_LESS_THAN(TEST_STREAM_CHUNK_MAX, head->seq);
+
+    int ahead                = head->seq + 1 - (int)(g_test_stream.received / MWIFI_STREAM_CHUNK_SIZE);
+    g_test_stream.window_max = MAX(g_test_stream.window_max, ahead);
+
+    if (g_test_stream.drop_all || (g_test_stream.drop[head->seq] && !g_test_stream.sent[head->seq])) {
+        g_test_stream.sent[head->seq]++;
+        return MDF_OK;
+    }
+
+    g_test_stream.sent[head->seq]++;
+
+    return mwifi_stream_handle(g_test_src_addr, data_type, packet, size);
+}
+
+/**
+ * @brief The acknowledgements are sent by the receiver to the sender
+ */
+mdf_err_t test_stream_write(const uint8_t *dest_addrs, const mwifi_data_type_t *data_type,
+                            const void *data, size_t size, bool block)
+{
+    TEST_ASSERT_EQUAL_MEMORY(g_test_src_addr, dest_addrs, MWIFI_ADDR_LEN);
+    TEST_ASSERT_TRUE(data_type->stream);
+    TEST_ASSERT_EQUAL(MWIFI_PRIORITY_CONTROL, data_type->priority);
+    TEST_ASSERT_EQUAL(sizeof(mwifi_stream_head_t), size);
+
+    g_test_stream.acks++;
+
+    return mwifi_stream_handle(g_test_dest_addr, data_type, data, size);
+}
+
+static mdf_err_t test_stream_recv_cb(const uint8_t *src_addr, const mwifi_data_type_t *data_type,
+                                     size_t offset, const void *data, size_t size, size_t total_size)
+{
+    TEST_ASSERT_EQUAL_MEMORY(g_test_src_addr, src_addr, MWIFI_ADDR_LEN);
+    TEST_ASSERT_EQUAL(0x5a, data_type->custom);
+
+    /**< In order and without gaps */
+    TEST_ASSERT_EQUAL(g_test_stream.received, offset);
+    TEST_ASSERT_LESS_OR_EQUAL(total_size, offset + size);
+
+    for (size_t i = 0; i < size; ++i) {
+        TEST_ASSERT_EQUAL(test_stream_byte(offset + i), ((uint8_t *)data)[i]);
+    }
+
+    g_test_stream.received += size;
+
+    return g_test_stream.abort ? MDF_FAIL : MDF_OK;
+}
+
+/**
+ * @brief Send a message in parts of `part_size` bytes
+ */
+static mdf_err_t test_stream_send(size_t total_size, size_t part_size)
+{
+    mdf_err_t ret               = MDF_OK;
+    mwifi_stream_t *stream      = NULL;
+    mwifi_data_type_t data_type = {.custom = 0x5a};
+    uint8_t *part               = MDF_MALLOC(part_size);
+
+    TEST_ASSERT_NOT_NULL(part);
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_stream_set_recv_cb(test_stream_recv_cb));
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_stream_open(g_test_dest_addr, &data_type, total_size, &stream));
+
+    for (size_t offset = 0; offset < total_size && ret == MDF_OK; offset += part_size) {
+        size_t size = MIN(part_size, total_size - offset);
+
+        for (size_t i = 0; i < size; ++i) {
+            part[i] = test_stream_byte(offset + i);
+        }
+
+        ret = mwifi_stream_write(stream, part, size);
+    }
+
+    mdf_err_t close_ret = mwifi_stream_close(stream);
+    MDF_FREE(part);
+
+    return ret != MDF_OK ? ret : close_ret;
+}
+
+static void test_stream_reset(void)
+{
+    memset(&g_test_stream, 0, sizeof(g_test_stream));
+
+    /**< Forget the streams received by the earlier tests */
+    for (int i = 0; i < MWIFI_STREAM_RECV_NUM; ++i) {
+        MDF_FREE(g_stream_recv[i].data);
+    }
+
+    memset(g_stream_recv, 0, sizeof(g_stream_recv));
+}
+
+TEST_CASE("mwifi stream sends a message in order within the window", "[mwifi][stream]")
+{
+    const size_t total_size = 300 * MWIFI_STREAM_CHUNK_SIZE + 123;
+    uint32_t free_size      = 0;
+
+    test_stream_reset();
+    free_size = esp_get_free_heap_size();
+    host_heap_reset_minimum();
+
+    /**< The parts don't match the chunks */
+    TEST_ASSERT_EQUAL(MDF_OK, test_stream_send(total_size, 1000));
+    TEST_ASSERT_EQUAL(total_size, g_test_stream.received);
+
+    /**< Nothing is lost, every chunk is sent once and the receiver keeps no buffer */
+    for (int i = 0; i < 301; ++i) {
+        TEST_ASSERT_EQUAL(1, g_test_stream.sent[i]);
+    }
+
+    TEST_ASSERT_EQUAL(0, g_test_stream.sent[301]);
+    TEST_ASSERT_LESS_OR_EQUAL(MWIFI_STREAM_WINDOW, g_test_stream.window_max);
+    TEST_ASSERT_NULL(g_stream_recv[0].data);
+    TEST_ASSERT_TRUE(g_stream_recv[0].done);
+
+    /**< An acknowledgement covers half a window */
+    TEST_ASSERT_LESS_OR_EQUAL(301 * 2 / MWIFI_STREAM_WINDOW + 1, g_test_stream.acks);
+
+    /**< The sender and the receiver keep a window of chunks each, not the message */
+    TEST_ASSERT_LESS_THAN(2 * MWIFI_STREAM_WINDOW * MWIFI_STREAM_CHUNK_SIZE + 2048,
+                          free_size - esp_get_minimum_free_heap_size());
+}
+
+TEST_CASE("mwifi stream sends only the lost chunks again", "[mwifi][stream]")
+{
+    const size_t total_size = 40 * MWIFI_STREAM_CHUNK_SIZE;
+
+    test_stream_reset();
+    g_test_stream.drop[3]  = true;
+    g_test_stream.drop[5]  = true;
+    g_test_stream.drop[20] = true;
+    g_test_stream.drop[21] = true;
+    g_test_stream.drop[39] = true;
+
+    TEST_ASSERT_EQUAL(MDF_OK, test_stream_send(total_size, MWIFI_STREAM_CHUNK_SIZE));
+    TEST_ASSERT_EQUAL(total_size, g_test_stream.received);
+
+    /**< The chunks received after a lost one are acknowledged selectively, not sent again */
+    for (int i = 0; i < 40; ++i) {
+        TEST_ASSERT_EQUAL(g_test_stream.drop[i] ? 2 : 1, g_test_stream.sent[i]);
+    }
+
+    TEST_ASSERT_LESS_OR_EQUAL(MWIFI_STREAM_WINDOW, g_test_stream.window_max);
+    TEST_ASSERT_NULL(g_stream_recv[0].data);
+}
+
+TEST_CASE("mwifi stream fails when nothing is acknowledged", "[mwifi][stream]")
+{
+    int64_t start_us = esp_timer_get_time();
+
+    test_stream_reset();
+    g_test_stream.drop_all = true;
+
+    /**< The window is sent, then its first chunk again on each timeout */
+    TEST_ASSERT_EQUAL(MDF_ERR_MWIFI_TIMEOUT, test_stream_send(20 * MWIFI_STREAM_CHUNK_SIZE, MWIFI_STREAM_CHUNK_SIZE));
+    TEST_ASSERT_EQUAL(0, g_test_stream.received);
+    TEST_ASSERT_EQUAL(1 + MWIFI_STREAM_RETRY_MAX, g_test_stream.sent[0]);
+
+    for (int i = 1; i < MWIFI_STREAM_WINDOW; ++i) {
+        TEST_ASSERT_EQUAL(1, g_test_stream.sent[i]);
+    }
+
+    TEST_ASSERT_EQUAL(0, g_test_stream.sent[MWIFI_STREAM_WINDOW]);
+    TEST_ASSERT_GREATER_OR_EQUAL(MWIFI_STREAM_RETRANSMIT_MS * MWIFI_STREAM_RETRY_MAX * 1000,
+                                 esp_timer_get_time() - start_us);
+}
+
+TEST_CASE("mwifi stream is aborted by the receiver", "[mwifi][stream]")
+{
+    test_stream_reset();
+    g_test_stream.abort = true;
+
+    /**< The first chunk fails the callback, the sender learns it from the acknowledgement */
+    TEST_ASSERT_EQUAL(MDF_ERR_MWIFI_TIMEOUT, test_stream_send(20 * MWIFI_STREAM_CHUNK_SIZE, MWIFI_STREAM_CHUNK_SIZE));
+    TEST_ASSERT_EQUAL(MWIFI_STREAM_CHUNK_SIZE, g_test_stream.received);
+    TEST_ASSERT_TRUE(g_stream_recv[0].aborted);
+    TEST_ASSERT_EQUAL(0, g_test_stream.sent[MWIFI_STREAM_WINDOW]);
+}
@@ -0,0 +1,910 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+/**
+ * @brief The components run unchanged in the nodes of a simulated mesh network, see
+ *        `host_sim.h`. Each test case starts the network, the root checks what it reads
+ *        and leaves its figures in the memory shared with the test case.
+ */
+#include <unistd.h>
+
+#include "mdf_common.h"
+#include "mwifi.h"
+#include "mupgrade.h"
+#include "mdebug_console.h"
+#include "esp_console.h"
+#include "host_sim.h"
+#include "unity.h"
+
+#define TEST_SIM_NODE_NUM      (43)    /**< A root, 6 nodes on layer 2 and 36 leaves on layer 3 */
+#define TEST_SIM_FANOUT        (6)
+#define TEST_SIM_PACKET_NUM    (50)    /**< Packets sent by each node */
+#define TEST_SIM_PACKET_SIZE   (200)
+#define TEST_SIM_LAYER_MAX     (4)
+#define TEST_SIM_FIRMWARE_SIZE (64 * 1024 + 100)
+#define TEST_SIM_TIMEOUT_MS    (120 * 1000)
+#define TEST_SIM_BENCH_NUM     (3)     /**< Tests of mesh_bench run by the root */
+#define TEST_SIM_LEAF_NUM      (200)   /**< Nodes sending small messages, under a root with 10 children */
+#define TEST_SIM_LEAF_FANOUT   (10)
+#define TEST_SIM_MESSAGE_NUM   (50)    /**< Messages sent by each of them */
+#define TEST_SIM_MESSAGE_MIN   (20)
+#define TEST_SIM_MESSAGE_MAX   (80)
+#define TEST_SIM_CONTROL_TYPE  (0xc0)  /**< Custom type of the control messages sent during an upgrade */
+#define TEST_SIM_CONTROL_MS    (20)    /**< Interval of the control messages */
+#define TEST_SIM_CONTROL_MAX   (1024)
+
+static const char *TAG = "test_sim";
+
+/**
+ * @brief A mesh where a frame of 1472 bytes takes 2 ms on air, 1 ms is spent in each node
+ *        and 5% of the frames on air are lost
+ */
+static const host_sim_link_t g_test_sim_link = {
+    .bandwidth  = 6 * 1000 * 1000,
+    .latency_us = 1000,
+    .loss       = 5,
+};
+
+typedef struct {
+    uint16_t node;
+    uint16_t seq;
+    int64_t send_us;
+    uint8_t pattern[TEST_SIM_PACKET_SIZE - 12];
+} __attribute__((packed)) test_sim_packet_t;
+
+/**
+ * @brief The rows printed by a test of mesh_bench, see mesh_bench_print() of the console example
+ */
+typedef struct {
+    char test[8];
+    int peers;          /**< Rows of a single node */
+    int peers_received; /**< Rows of a single node which received packets */
+    int totals;         /**< Rows of all the nodes, to MWIFI_ADDR_BROADCAST */
+    uint32_t sent;      /**< Sum of the rows of all the nodes */
+    uint32_t received;
+} test_sim_bench_t;
+
+/**
+ * @brief A control message, e.g. to turn a light on, sent by the root to a node
+ */
+typedef struct {
+    uint16_t node;
+    uint16_t seq;
+    int64_t send_us;
+} __attribute__((packed)) test_sim_control_t;
+
+typedef struct {
+    int done;                                 /**< Nodes done with their part of the test */
+    int started;
+    int failed;                               /**< Packets not read, or read out of order or damaged */
+    uint32_t read;
+    uint64_t read_bytes;
+    uint32_t write_failed;                    /**< Messages failed by the flow control */
+    uint32_t lost;                            /**< Messages not read whose write didn't fail */
+    int64_t start_us;
+    int64_t end_us;
+    uint32_t latency_p50_ms[TEST_SIM_LAYER_MAX + 1];
+    uint32_t latency_p99_ms[TEST_SIM_LAYER_MAX + 1];
+    uint32_t read_num[HOST_SIM_NODE_MAX];     /**< Packets read by each node */
+    uint32_t successed_num;
+    test_sim_bench_t bench[TEST_SIM_BENCH_NUM];
+    int control_stop;                         /**< The root stops sending control messages */
+    int control_done;                         /**< The root sent its last control message */
+    uint32_t control_sent;
+    uint32_t control_read;
+    uint32_t control_latency_ms[TEST_SIM_CONTROL_MAX];
+} test_sim_result_t;
+
+static test_sim_result_t *test_sim_result(void)
+{
+    return host_sim_data();
+}
+
+static mdf_err_t test_sim_event_cb(mdf_event_loop_t event, void *ctx)
+{
+    return MDF_OK;
+}
+
+/**
+ * @brief Start mwifi as an application does, the node joins its parent at once
+ */
+static void test_sim_start(int node)
+{
+    mwifi_init_config_t init_config = MWIFI_INIT_CONFIG_DEFAULT();
+    mwifi_config_t config           = {
+        .mesh_id   = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66},
+        .mesh_type = node ? MWIFI_MESH_NODE : MWIFI_MESH_ROOT,
+        .channel   = 1,
+    };
+
+    TEST_ASSERT_EQUAL(MDF_OK, mdf_event_loop_init(test_sim_event_cb));
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_init(&init_config));
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_set_config(&config));
+    TEST_ASSERT_EQUAL(MDF_OK, mwifi_start());
+    TEST_ASSERT_TRUE(mwifi_is_connected());
+    TEST_ASSERT_EQUAL(node == 0, esp_mesh_is_root());
+
+    /**< No traffic before all the nodes are started */
+    __atomic_add_fetch(&test_sim_result()->started, 1, __ATOMIC_SEQ_CST);
+    host_sim_barrier();
+}
+
+static void test_sim_pattern(uint8_t *pattern, size_t size, int node, int seq)
+{
+    for (int i = 0; i < size; ++i) {
+        pattern[i] = node * 31 + seq * 7 + i;
+    }
+}
+
+static int test_sim_compare(const void *a, const void *b)
+{
+    return *(const uint32_t *)a - *(const uint32_t *)b;
+}
+
+static void test_sim_run(void (*node_main)(int, void *), void *arg, int node_num, int fanout,
+                         host_sim_stats_t *stats)
+{
+    host_sim_config_t config = {0};
+
+    host_sim_tree(&config, node_num, fanout, &g_test_sim_link);
+    TEST_ASSERT_EQUAL(ESP_OK, host_sim_run(&config, node_main, arg, TEST_SIM_TIMEOUT_MS));
+    TEST_ASSERT_EQUAL(node_num, test_sim_result()->started);
+
+    host_sim_get_stats(stats);
+    printf("frames: %u, hops: %u, frames on air: %u, dropped: %u, rejected by the flow control: %u\n",
+           stats->frames, stats->hops, stats->attempts, stats->drops, stats->rejected);
+}
+
+/**
+ * @brief Every node but the root sends its packets to the root, which reads them with
+ *        mwifi_root_read() and keeps the latency of each one by the layer of its source
+ */
+static void test_sim_uplink_main(int node, void *arg)
+{
+    test_sim_result_t *result  = test_sim_result();
+    test_sim_packet_t packet   = {0};
+    mwifi_data_type_t data_type = {0};
+
+    test_sim_start(node);
+
+    if (node) {
+        for (int seq = 0; seq < TEST_SIM_PACKET_NUM; ++seq) {
+            packet.node    = node;
+            packet.seq     = seq;
+            packet.send_us = esp_timer_get_time();
+            test_sim_pattern(packet.pattern, sizeof(packet.pattern), node, seq);
+            TEST_ASSERT_EQUAL(MDF_OK, mwifi_write(NULL, &data_type, &packet, sizeof(packet), true));
+        }
+
+        host_sim_barrier();
+        return;
+    }
+
+    int total_num             = (TEST_SIM_NODE_NUM - 1) * TEST_SIM_PACKET_NUM;
+    uint32_t *latency[TEST_SIM_LAYER_MAX + 1] = {0};
+    int latency_num[TEST_SIM_LAYER_MAX + 1]   = {0};
+    int next_seq[TEST_SIM_NODE_NUM]           = {0};
+    uint8_t pattern[sizeof(packet.pattern)];
+    uint8_t src_addr[MWIFI_ADDR_LEN];
+
+    for (int i = 0; i <= TEST_SIM_LAYER_MAX; ++i) {
+        latency[i] = MDF_CALLOC(total_num, sizeof(uint32_t));
+    }
+
+    result->start_us = esp_timer_get_time();
+
+    for (result->read = 0; result->read < total_num; result->read++) {
+        size_t size = sizeof(packet);
+
+        if (mwifi_root_read(src_addr, &data_type, (uint8_t *)&packet, &size, pdMS_TO_TICKS(10 * 1000)) != MDF_OK) {
+            break;
+        }
+
+        int src   = host_sim_find(src_addr);
+        int layer = MIN(host_sim_layer(src), TEST_SIM_LAYER_MAX);
+        test_sim_pattern(pattern, sizeof(pattern), src, packet.seq);
+
+        /**< The packets of a source arrive in order and intact */
+        if (size != sizeof(packet) || src != packet.node || packet.seq != next_seq[src]++
+                || memcmp(pattern, packet.pattern, sizeof(pattern))) {
+            result->failed++;
+        }
+
+        latency[layer][latency_num[layer]++] = (esp_timer_get_time() - packet.send_us) / 1000;
+    }
+
+    result->end_us = esp_timer_get_time();
+    result->failed += total_num - result->read;
+
+    for (int i = 0; i <= TEST_SIM_LAYER_MAX; ++i) {
+        if (latency_num[i]) {
+            qsort(latency[i], latency_num[i], sizeof(uint32_t), test_sim_compare);
+            result->latency_p50_ms[i] = latency[i][latency_num[i] / 2];
+            result->latency_p99_ms[i] = latency[i][latency_num[i] * 99 / 100];
+        }
+
+        MDF_FREE(latency[i]);
+    }
+
+    host_sim_barrier();
+}
+
+TEST_CASE("sim nodes send to the root over a lossy tree", "[sim][uplink]")
+{
+    test_sim_result_t *result = NULL;
+    host_sim_stats_t stats    = {0};
+
+    test_sim_run(test_sim_uplink_main, NULL, TEST_SIM_NODE_NUM, TEST_SIM_FANOUT, &stats);
+    result = test_sim_result();
+
+    int64_t spend_us = result->end_us - result->start_us;
+    printf("nodes: %d, packets read: %u, throughput: %lld KB/s, packets/s: %lld\n",
+           TEST_SIM_NODE_NUM, result->read, (long long)(result->read * TEST_SIM_PACKET_SIZE * 1000LL / spend_us),
+           (long long)(result->read * 1000000LL / spend_us));
+    printf("layer, latency p50 (ms), latency p99 (ms)\n");
+
+    for (int i = 2; i <= TEST_SIM_LAYER_MAX; ++i) {
+        if (result->latency_p99_ms[i]) {
+            printf("%d, %u, %u\n", i, result->latency_p50_ms[i], result->latency_p99_ms[i]);
+        }
+    }
+
+    TEST_ASSERT_EQUAL(0, result->failed);
+    TEST_ASSERT_EQUAL((TEST_SIM_NODE_NUM - 1) * TEST_SIM_PACKET_NUM, result->read);
+
+    /**< A packet of the second layer takes one hop, a packet of the third layer two, the lost ones are retried */
+    TEST_ASSERT_EQUAL((TEST_SIM_FANOUT + (TEST_SIM_NODE_NUM - 1 - TEST_SIM_FANOUT) * 2) * TEST_SIM_PACKET_NUM,
+                      stats.hops);
+    TEST_ASSERT_GREATER_THAN(stats.hops, stats.attempts);
+    TEST_ASSERT_EQUAL(0, stats.drops);
+}
+
+/**
+ * @brief The root broadcasts packets to all the nodes and multicasts them to the nodes
+ *        of odd index. Each node reads until all of them are done, it forwards the
+ *        multicast packets of its subnet meanwhile.
+ */
+static void test_sim_downlink_main(int node, void *arg)
+{
+    test_sim_result_t *result    = test_sim_result();
+    test_sim_packet_t packet     = {0};
+    mwifi_data_type_t data_type  = {0};
+    uint8_t src_addr[MWIFI_ADDR_LEN];
+    uint8_t pattern[sizeof(packet.pattern)];
+    int next_seq[MWIFI_COMMUNICATE_BROADCAST + 1] = {0};
+    int expect_num               = node ? TEST_SIM_PACKET_NUM * (node % 2 ? 2 : 1) : 0;
+
+    test_sim_start(node);
+
+    if (!node) {
+        uint8_t broadcast_addr[] = MWIFI_ADDR_ANY;
+        uint8_t *multicast_addrs = MDF_CALLOC(TEST_SIM_NODE_NUM / 2, MWIFI_ADDR_LEN);
+        int multicast_num        = 0;
+
+        for (int i = 1; i < TEST_SIM_NODE_NUM; i += 2) {
+            host_sim_addr(i, multicast_addrs + multicast_num++ * MWIFI_ADDR_LEN);
+        }
+
+        result->start_us = esp_timer_get_time();
+
+        for (int seq = 0; seq < TEST_SIM_PACKET_NUM; ++seq) {
+            packet.node    = MWIFI_COMMUNICATE_BROADCAST;
+            packet.seq     = seq;
+            packet.send_us = esp_timer_get_time();
+            test_sim_pattern(packet.pattern, sizeof(packet.pattern), packet.node, seq);
+            data_type.communicate = MWIFI_COMMUNICATE_BROADCAST;
+            TEST_ASSERT_EQUAL(MDF_OK, mwifi_root_write(broadcast_addr, 1, &data_type, &packet, sizeof(packet), true));
+
+            packet.node = MWIFI_COMMUNICATE_MULTICAST;
+            test_sim_pattern(packet.pattern, sizeof(packet.pattern), packet.node, seq);
+            data_type.communicate = MWIFI_COMMUNICATE_MULTICAST;
+            TEST_ASSERT_EQUAL(MDF_OK, mwifi_root_write(multicast_addrs, multicast_num, &data_type,
+                                                       &packet, sizeof(packet), true));
+        }
+
+        MDF_FREE(multicast_addrs);
+
+        /**< The root is done once it has sent its packets */
+        __atomic_add_fetch(&result->done, 1, __ATOMIC_SEQ_CST);
+    }
+
+    while (__atomic_load_n(&result->done, __ATOMIC_SEQ_CST) < TEST_SIM_NODE_NUM) {
+        size_t size = sizeof(packet);
+
+        if (mwifi_read(src_addr, &data_type, (uint8_t *)&packet, &size, pdMS_TO_TICKS(100)) != MDF_OK) {
+            continue;
+        }
+
+        test_sim_pattern(pattern, sizeof(pattern), packet.node, packet.seq);
+
+        if (size != sizeof(packet) || packet.node > MWIFI_COMMUNICATE_BROADCAST
+                || packet.seq != next_seq[packet.node]++ || memcmp(pattern, packet.pattern, sizeof(pattern))
+                || (packet.node == MWIFI_COMMUNICATE_MULTICAST && node % 2 == 0)) {
+            __atomic_add_fetch(&result->failed, 1, __ATOMIC_SEQ_CST);
+        }
+
+        if (++result->read_num[node] == expect_num) {
+            __atomic_add_fetch(&result->done, 1, __ATOMIC_SEQ_CST);
+            __atomic_store_n(&result->end_us, esp_timer_get_time(), __ATOMIC_SEQ_CST);
+        }
+    }
+
+    host_sim_barrier();
+}
+
+TEST_CASE("sim root broadcasts and multicasts down the tree", "[sim][downlink]")
+{
+    test_sim_result_t *result = NULL;
+    host_sim_stats_t stats    = {0};
+
+    test_sim_run(test_sim_downlink_main, NULL, TEST_SIM_NODE_NUM, TEST_SIM_FANOUT, &stats);
+    result = test_sim_result();
+
+    printf("nodes: %d, time to the last node: %lld ms\n", TEST_SIM_NODE_NUM,
+           (long long)(result->end_us - result->start_us) / 1000);
+
+    TEST_ASSERT_EQUAL(0, result->failed);
+
+    for (int i = 1; i < TEST_SIM_NODE_NUM; ++i) {
+        TEST_ASSERT_EQUAL(TEST_SIM_PACKET_NUM * (i % 2 ? 2 : 1), result->read_num[i]);
+    }
+}
+
+/**
+ * @brief Content of the firmware, which differs from one packet of mupgrade to the next
+ */
+static void test_sim_firmware(uint8_t *data, size_t offset, size_t size)
+{
+    for (int i = 0; i < size; ++i) {
+        data[i] = (offset + i) * 131 + ((offset + i) >> 8);
+    }
+}
+
+/**
+ * @brief Read until the root is done, the packets of mupgrade are handled and forwarded,
+ *        the latency of the control messages to this node is kept
+ */
+static void test_sim_node_read(void)
+{
+    test_sim_result_t *result   = test_sim_result();
+    mwifi_data_type_t data_type = {0};
+    uint8_t *data               = MDF_MALLOC(MWIFI_PAYLOAD_LEN);
+    uint8_t src_addr[MWIFI_ADDR_LEN];
+
+    while (!__atomic_load_n(&result->done, __ATOMIC_SEQ_CST)) {
+        size_t size = MWIFI_PAYLOAD_LEN;
+
+        if (mwifi_read(src_addr, &data_type, data, &size, pdMS_TO_TICKS(100)) != MDF_OK) {
+            continue;
+        }
+
+        if (data_type.upgrade) {
+            mupgrade_handle(src_addr, data, size);
+        } else if (data_type.custom == TEST_SIM_CONTROL_TYPE) {
+            test_sim_control_t *control = (test_sim_control_t *)data;
+            uint32_t index              = __atomic_fetch_add(&result->control_read, 1, __ATOMIC_SEQ_CST);
+
+            if (size != sizeof(test_sim_control_t) || control->node != host_sim_node()) {
+                __atomic_add_fetch(&result->failed, 1, __ATOMIC_SEQ_CST);
+            }
+
+            if (index < TEST_SIM_CONTROL_MAX) {
+                result->control_latency_ms[index] = (esp_timer_get_time() - control->send_us) / 1000;
+            }
+        }
+    }
+
+    MDF_FREE(data);
+}
+
+static void test_sim_node_read_task(void *arg)
+{
+    test_sim_node_read();
+    vTaskDelete(NULL);
+}
+
+static void test_sim_root_read_task(void *arg)
+{
+    uint8_t *data               = MDF_MALLOC(MWIFI_PAYLOAD_LEN);
+    mwifi_data_type_t data_type = {0};
+    uint8_t src_addr[MWIFI_ADDR_LEN];
+
+    while (!__atomic_load_n(&test_sim_result()->done, __ATOMIC_SEQ_CST)) {
+        size_t size = MWIFI_PAYLOAD_LEN;
+
+        if (mwifi_root_read(src_addr, &data_type, data, &size, pdMS_TO_TICKS(100)) == MDF_OK && data_type.upgrade) {
+            mupgrade_root_handle(src_addr, data, size);
+        }
+    }
+
+    MDF_FREE(data);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief The root downloads the firmware to send with mupgrade
+ */
+static void test_sim_firmware_download(void)
+{
+    uint8_t firmware[MUPGRADE_PACKET_MAX_SIZE];
+
+    TEST_ASSERT_EQUAL(MDF_OK, mupgrade_firmware_init("host_sim", TEST_SIM_FIRMWARE_SIZE));
+
+    for (size_t offset = 0, size = 0; offset < TEST_SIM_FIRMWARE_SIZE; offset += size) {
+        size = MIN(TEST_SIM_FIRMWARE_SIZE - offset, sizeof(firmware));
+        test_sim_firmware(firmware, offset, size);
+        TEST_ASSERT_EQUAL(MDF_OK, mupgrade_firmware_download(firmware, size));
+    }
+}
+
+/**
+ * @brief The root downloads a firmware and sends it to all the nodes with mupgrade,
+ *        the nodes hand the packets read to mupgrade_handle() and check what is written
+ */
+static void test_sim_mupgrade_main(int node, void *arg)
+{
+    test_sim_result_t *result = test_sim_result();
+    uint8_t firmware[MUPGRADE_PACKET_MAX_SIZE];
+    uint8_t written[MUPGRADE_PACKET_MAX_SIZE];
+
+    test_sim_start(node);
+
+    if (!node) {
+        uint8_t dest_addr[]              = MWIFI_ADDR_ANY;
+        mupgrade_result_t upgrade_result = {0};
+
+        test_sim_firmware_download();
+
+        /**< The root reads its own status requests too, MWIFI_ADDR_ANY includes it */
+        xTaskCreate(test_sim_root_read_task, "root_read", 4 * 1024, NULL, CONFIG_MDF_TASK_DEFAULT_PRIOTY, NULL);
+        xTaskCreate(test_sim_node_read_task, "node_read", 4 * 1024, NULL, CONFIG_MDF_TASK_DEFAULT_PRIOTY, NULL);
+
+        result->start_us = esp_timer_get_time();
+        TEST_ASSERT_EQUAL(MDF_OK, mupgrade_firmware_send(dest_addr, 1, &upgrade_result));
+        result->end_us        = esp_timer_get_time();
+        result->successed_num = upgrade_result.successed_num;
+        mupgrade_result_free(&upgrade_result);
+
+        __atomic_store_n(&result->done, 1, __ATOMIC_SEQ_CST);
+        host_sim_barrier();
+        return;
+    }
+
+    test_sim_node_read();
+
+    /**< The whole firmware is in the update partition, which boots next */
+    const esp_partition_t *update = esp_ota_get_next_update_partition(NULL);
+    TEST_ASSERT_EQUAL_PTR(update, esp_ota_get_boot_partition());
+
+    for (size_t offset = 0, size = 0; offset < TEST_SIM_FIRMWARE_SIZE; offset += size) {
+        size = MIN(TEST_SIM_FIRMWARE_SIZE - offset, sizeof(firmware));
+        test_sim_firmware(firmware, offset, size);
+        TEST_ASSERT_EQUAL(ESP_OK, esp_partition_read(update, offset, written, size));
+        TEST_ASSERT_EQUAL_MEMORY(firmware, written, size);
+    }
+
+    __atomic_add_fetch(&result->read_num[0], 1, __ATOMIC_SEQ_CST);
+    host_sim_barrier();
+}
+
+TEST_CASE("sim mupgrade sends a firmware to all the nodes", "[sim][mupgrade]")
+{
+    test_sim_result_t *result = NULL;
+    host_sim_stats_t stats    = {0};
+
+    test_sim_run(test_sim_mupgrade_main, NULL, TEST_SIM_NODE_NUM, TEST_SIM_FANOUT, &stats);
+    result = test_sim_result();
+
+    printf("nodes: %d, firmware: %d bytes, upgraded: %u, time: %lld ms\n", TEST_SIM_NODE_NUM,
+           TEST_SIM_FIRMWARE_SIZE, result->successed_num, (long long)(result->end_us - result->start_us) / 1000);
+
+    /**< The root itself is counted by mupgrade_firmware_send() */
+    TEST_ASSERT_EQUAL(TEST_SIM_NODE_NUM, result->successed_num);
+    TEST_ASSERT_EQUAL(TEST_SIM_NODE_NUM - 1, result->read_num[0]);
+}
+
+/**
+ * @brief Send a control message to the nodes in turn every TEST_SIM_CONTROL_MS,
+ *        in the priority class `arg`, until the root stops it
+ */
+static void test_sim_control_task(void *arg)
+{
+    test_sim_result_t *result   = test_sim_result();
+    mwifi_data_type_t data_type = {.custom = TEST_SIM_CONTROL_TYPE, .priority = (intptr_t)arg};
+    test_sim_control_t control  = {0};
+    uint8_t dest_addr[MWIFI_ADDR_LEN];
+
+    for (int seq = 0; !__atomic_load_n(&result->control_stop, __ATOMIC_SEQ_CST); ++seq) {
+        control.node    = 1 + seq % (TEST_SIM_NODE_NUM - 1);
+        control.seq     = seq;
+        control.send_us = esp_timer_get_time();
+        host_sim_addr(control.node, dest_addr);
+
+        if (mwifi_write(dest_addr, &data_type, &control, sizeof(control), true) == MDF_OK) {
+            __atomic_add_fetch(&result->control_sent, 1, __ATOMIC_SEQ_CST);
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(TEST_SIM_CONTROL_MS));
+    }
+
+    __atomic_store_n(&result->control_done, 1, __ATOMIC_SEQ_CST);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief The root sends a firmware to all the nodes with mupgrade, in the bulk class,
+ *        and a control message to one of them every TEST_SIM_CONTROL_MS meanwhile.
+ *        The nodes keep the latency of the control messages.
+ */
+static void test_sim_priority_main(int node, void *arg)
+{
+    test_sim_result_t *result = test_sim_result();
+
+    test_sim_start(node);
+
+    if (node) {
+        test_sim_node_read();
+        host_sim_barrier();
+        return;
+    }
+
+    uint8_t dest_addr[]              = MWIFI_ADDR_ANY;
+    mupgrade_result_t upgrade_result = {0};
+
+    test_sim_firmware_download();
+
+    xTaskCreate(test_sim_root_read_task, "root_read", 4 * 1024, NULL, CONFIG_MDF_TASK_DEFAULT_PRIOTY, NULL);
+    xTaskCreate(test_sim_node_read_task, "node_read", 4 * 1024, NULL, CONFIG_MDF_TASK_DEFAULT_PRIOTY, NULL);
+    xTaskCreate(test_sim_control_task, "control", 4 * 1024, arg, CONFIG_MDF_TASK_DEFAULT_PRIOTY, NULL);
+
+    result->start_us = esp_timer_get_time();
+    TEST_ASSERT_EQUAL(MDF_OK, mupgrade_firmware_send(dest_addr, 1, &upgrade_result));
+    result->end_us        = esp_timer_get_time();
+    result->successed_num = upgrade_result.successed_num;
+    mupgrade_result_free(&upgrade_result);
+
+    /**< The last control messages are read before the nodes stop reading */
+    __atomic_store_n(&result->control_stop, 1, __ATOMIC_SEQ_CST);
+
+    for (int i = 0; i < 300 && (!__atomic_load_n(&result->control_done, __ATOMIC_SEQ_CST)
+                                || result->control_read < result->control_sent); ++i) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    __atomic_store_n(&result->done, 1, __ATOMIC_SEQ_CST);
+    host_sim_barrier();
+}
+
+TEST_CASE("sim control messages keep a low latency during an upgrade", "[sim][priority]")
+{
+    test_sim_result_t *result = NULL;
+    host_sim_stats_t stats    = {0};
+    const int priority[2]     = {MWIFI_PRIORITY_BULK, MWIFI_PRIORITY_CONTROL};
+    const char *name[2]       = {"bulk, as the firmware", "control"};
+    uint32_t latency_p99[2]   = {0};
+
+    printf("nodes: %d, firmware: %d bytes, a control message every %d ms\n",
+           TEST_SIM_NODE_NUM, TEST_SIM_FIRMWARE_SIZE, TEST_SIM_CONTROL_MS);
+    printf("class, upgrade time (ms), control messages, latency p50 (ms), latency p99 (ms), max (ms)\n");
+
+    for (int i = 0; i < 2; ++i) {
+        test_sim_run(test_sim_priority_main, (void *)(intptr_t)priority[i], TEST_SIM_NODE_NUM, TEST_SIM_FANOUT, &stats);
+        result = test_sim_result();
+
+        uint32_t num = MIN(result->control_read, TEST_SIM_CONTROL_MAX);
+        TEST_ASSERT_EQUAL(TEST_SIM_NODE_NUM, result->successed_num);
+        TEST_ASSERT_EQUAL(0, result->failed);
+        TEST_ASSERT_EQUAL(result->control_sent, result->control_read);
+        TEST_ASSERT_GREATER_THAN(TEST_SIM_NODE_NUM, num);
+
+        qsort(result->control_latency_ms, num, sizeof(uint32_t), test_sim_compare);
+        latency_p99[i] = result->control_latency_ms[num * 99 / 100];
+        printf("%s, %lld, %u, %u, %u, %u\n", name[i], (long long)(result->end_us - result->start_us) / 1000,
+               num, result->control_latency_ms[num / 2], latency_p99[i], result->control_latency_ms[num - 1]);
+    }
+
+    /**
+     * @brief The control class doesn't wait behind the queued packets of the firmware, nor
+     *        behind a full queue of ESP-MESH, whose frames of firmware take 2 ms each on air
+     */
+    TEST_ASSERT_LESS_OR_EQUAL(latency_p99[0], latency_p99[1]);
+    TEST_ASSERT_LESS_THAN(CONFIG_MWIFI_XON_QSIZE * 2, latency_p99[1]);
+}
+
+/**
+ * @brief The console is not started in the nodes, the test runs their commands with
+ *        esp_console_run(), the common commands of mdebug are not registered
+ */
+mdf_err_t mdebug_console_init(void)
+{
+    return MDF_OK;
+}
+
+void mdebug_cmd_register_common(void)
+{
+}
+
+/**< The console example, examples/function_demo/mwifi/console_test, runs in each node */
+void app_main(void);
+
+static void test_sim_console_run(const char *command, int expect_ret)
+{
+    int cmd_ret = 0;
+
+    TEST_ASSERT_EQUAL(ESP_OK, esp_console_run(command, &cmd_ret));
+    TEST_ASSERT_EQUAL(expect_ret, cmd_ret);
+}
+
+/**
+ * @brief Run a test of mesh_bench and wait until it ends: while a test runs, mesh_bench
+ *        fails with ESP_ERR_NOT_SUPPORTED before it looks at the name of the test
+ */
+static void test_sim_bench_run(const char *command)
+{
+    int cmd_ret = ESP_ERR_NOT_SUPPORTED;
+
+    test_sim_console_run(command, ESP_OK);
+
+    while (cmd_ret == ESP_ERR_NOT_SUPPORTED) {
+        vTaskDelay(pdMS_TO_TICKS(500));
+        TEST_ASSERT_EQUAL(ESP_OK, esp_console_run("mesh_bench -m none", &cmd_ret));
+    }
+}
+
+/**
+ * @brief Count the JSON rows printed by mesh_bench, the other lines are echoed
+ */
+static void test_sim_bench_parse(FILE *output)
+{
+    test_sim_result_t *result = test_sim_result();
+    char line[512];
+
+    rewind(output);
+
+    while (fgets(line, sizeof(line), output)) {
+        char test[8]             = {0};
+        char peer[18]            = {0};
+        uint32_t sent            = 0;
+        uint32_t received        = 0;
+        test_sim_bench_t *bench  = NULL;
+
+        fputs(line, stdout);
+
+        if (sscanf(line, "{\"test\":\"%7[^\"]\",\"peer\":\"%17[^\"]\",\"hops\":%*d,\"len\":%*u,"
+                   "\"compress\":%*d,\"time_ms\":%*u,\"sent\":%u,\"received\":%u",
+                   test, peer, &sent, &received) != 4) {
+            continue;
+        }
+
+        for (int i = 0; i < TEST_SIM_BENCH_NUM && !bench; ++i) {
+            if (!result->bench[i].test[0] || !strcmp(result->bench[i].test, test)) {
+                bench = result->bench + i;
+                strcpy(bench->test, test);
+            }
+        }
+
+        TEST_ASSERT_NOT_NULL(bench);
+
+        if (!strcmp(peer, "ff:ff:ff:ff:ff:fe")) {
+            bench->totals++;
+            bench->sent     += sent;
+            bench->received += received;
+        } else {
+            bench->peers++;
+            bench->peers_received += (received > 0);
+        }
+    }
+}
+
+/**
+ * @brief Each node runs app_main() of the console example and is configured with its
+ *        commands, then the root runs mesh_bench against the servers of the other nodes
+ */
+static void test_sim_bench_main(int node, void *arg)
+{
+    test_sim_result_t *result = test_sim_result();
+    char command[64]          = {0};
+
+    app_main();
+
+    sprintf(command, "mesh_config -i 11:22:33:44:55:66 -t %s -c 1", node ? "node" : "root");
+    test_sim_console_run(command, ESP_OK);
+    TEST_ASSERT_TRUE(mwifi_is_connected());
+
+    if (node) {
+        test_sim_console_run("mesh_iperf -s", ESP_OK);
+    }
+
+    __atomic_add_fetch(&result->started, 1, __ATOMIC_SEQ_CST);
+    host_sim_barrier();
+
+    if (!node) {
+        FILE *output = tmpfile();
+        int saved_fd = dup(STDOUT_FILENO);
+
+        /**< mesh_bench prints its results, they are read back from the file */
+        TEST_ASSERT_NOT_NULL(output);
+        fflush(stdout);
+        dup2(fileno(output), STDOUT_FILENO);
+
+        test_sim_bench_run("mesh_bench -m many -t 2 -j");
+        test_sim_bench_run("mesh_bench -m bcast -t 2 -j");
+        test_sim_bench_run("mesh_bench -m rtt -n 4 -j");
+
+        fflush(stdout);
+        dup2(saved_fd, STDOUT_FILENO);
+        close(saved_fd);
+
+        test_sim_bench_parse(output);
+        fclose(output);
+
+        __atomic_store_n(&result->done, 1, __ATOMIC_SEQ_CST);
+    }
+
+    while (!__atomic_load_n(&result->done, __ATOMIC_SEQ_CST)) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+
+    host_sim_barrier();
+}
+
+TEST_CASE("sim mesh_bench of the console example runs on the nodes", "[sim][mesh_bench]")
+{
+    test_sim_result_t *result = NULL;
+    host_sim_stats_t stats    = {0};
+
+    test_sim_run(test_sim_bench_main, NULL, TEST_SIM_NODE_NUM, TEST_SIM_FANOUT, &stats);
+    result = test_sim_result();
+
+    for (int i = 0; i < TEST_SIM_BENCH_NUM; ++i) {
+        test_sim_bench_t *bench = result->bench + i;
+
+        printf("%s: %d rows of a node, %d of them received, %d rows of all the nodes, sent: %u, received: %u\n",
+               bench->test, bench->peers, bench->peers_received, bench->totals, bench->sent, bench->received);
+    }
+
+    /**< many and bcast print a row for each node and one with the sum */
+    TEST_ASSERT_EQUAL_STRING("many", result->bench[0].test);
+    TEST_ASSERT_EQUAL(TEST_SIM_NODE_NUM - 1, result->bench[0].peers_received);
+    TEST_ASSERT_EQUAL(1, result->bench[0].totals);
+    TEST_ASSERT_EQUAL_STRING("bcast", result->bench[1].test);
+    TEST_ASSERT_EQUAL(TEST_SIM_NODE_NUM - 1, result->bench[1].peers_received);
+    TEST_ASSERT_EQUAL(1, result->bench[1].totals);
+    TEST_ASSERT_GREATER_THAN(0, result->bench[1].received);
+
+    /**< rtt prints a row for each hop count, layer 2 and layer 3, every ping is answered */
+    TEST_ASSERT_EQUAL_STRING("rtt", result->bench[2].test);
+    TEST_ASSERT_EQUAL(2, result->bench[2].totals);
+    TEST_ASSERT_EQUAL((TEST_SIM_NODE_NUM - 1) * 4, result->bench[2].sent);
+    TEST_ASSERT_EQUAL(result->bench[2].sent, result->bench[2].received);
+}
+
+/**
+ * @brief Every node but the root sends small messages to the root back to back. With
+ *        `coalesce`, they are sent by mwifi_write(NULL, ...) and packed into packets,
+ *        otherwise they are sent to MWIFI_ADDR_ROOT, which is never coalesced, each one
+ *        in its own frame. A message still finding no room after the flow control timeout
+ *        fails and is counted. The root checks the messages and their data type in order.
+ *
+ *        The last coalesced messages of a node are sent by the deadline, without blocking,
+ *        and are lost with their packet if it fails, see CONFIG_MWIFI_COALESCE_ENABLE.
+ */
+static void test_sim_coalesce_main(int node, void *arg)
+{
+    bool coalesce                = (intptr_t)arg;
+    test_sim_result_t *result    = test_sim_result();
+    mwifi_data_type_t data_type  = {0};
+    const uint8_t root_addr[]    = MWIFI_ADDR_ROOT;
+    uint8_t message[TEST_SIM_MESSAGE_MAX];
+
+    test_sim_start(node);
+
+    if (node) {
+        for (int seq = 0; seq < TEST_SIM_MESSAGE_NUM; ++seq) {
+            size_t size      = TEST_SIM_MESSAGE_MIN + (node * 7 + seq * 13) % (TEST_SIM_MESSAGE_MAX - TEST_SIM_MESSAGE_MIN + 1);
+            data_type.custom = seq;
+            test_sim_pattern(message, size, node, seq);
+            mdf_err_t ret    = mwifi_write(coalesce ? NULL : root_addr, &data_type, message, size, true);
+
+            if (ret != MDF_OK) {
+                TEST_ASSERT_EQUAL(ESP_ERR_MESH_QUEUE_FULL, ret);
+                __atomic_add_fetch(&result->write_failed, 1, __ATOMIC_SEQ_CST);
+            }
+        }
+
+        __atomic_add_fetch(&result->done, 1, __ATOMIC_SEQ_CST);
+        host_sim_barrier();
+        return;
+    }
+
+    int total_num                            = TEST_SIM_LEAF_NUM * TEST_SIM_MESSAGE_NUM;
+    uint32_t next_seq[TEST_SIM_LEAF_NUM + 1] = {0};
+    uint8_t *buffer                          = message; /**< mwifi_root_read() takes a pointer, not an array */
+    uint8_t pattern[TEST_SIM_MESSAGE_MAX];
+    uint8_t src_addr[MWIFI_ADDR_LEN];
+
+    result->start_us = esp_timer_get_time();
+
+    /**
+     * @brief Read until every message is read or failed, a failed message leaves a gap in the order.
+     *        A packet may wait for its retries in the sender task after the last write returned.
+     */
+    while (result->read + __atomic_load_n(&result->write_failed, __ATOMIC_SEQ_CST) < total_num) {
+        size_t size   = sizeof(message);
+        mdf_err_t ret = coalesce ? mwifi_root_read(src_addr, &data_type, buffer, &size, pdMS_TO_TICKS(3 * 1000))
+                        : mwifi_read(src_addr, &data_type, buffer, &size, pdMS_TO_TICKS(3 * 1000));
+
+        if (ret != MDF_OK) {
+            if (__atomic_load_n(&result->done, __ATOMIC_SEQ_CST) == TEST_SIM_LEAF_NUM) {
+                break;
+            }
+
+            continue;
+        }
+
+        int src = host_sim_find(src_addr);
+        TEST_ASSERT_TRUE(src > 0 && src <= TEST_SIM_LEAF_NUM);
+        test_sim_pattern(pattern, size, src, data_type.custom);
+
+        if (data_type.custom < next_seq[src] || size < TEST_SIM_MESSAGE_MIN || memcmp(pattern, message, size)) {
+            result->failed++;
+        }
+
+        next_seq[src]       = data_type.custom + 1;
+        result->read_bytes += size;
+        result->end_us      = esp_timer_get_time();
+        result->read++;
+    }
+
+    result->lost = total_num - result->read - result->write_failed;
+
+    host_sim_barrier();
+}
+
+TEST_CASE("sim 200 nodes send small messages to the root, coalesced or not", "[sim][coalesce]")
+{
+    test_sim_result_t *result = NULL;
+    host_sim_stats_t stats[2] = {0};
+    const char *name[2]       = {"one frame per message", "coalesced"};
+
+    printf("nodes sending: %d, messages: %d each, %d to %d bytes\n", TEST_SIM_LEAF_NUM,
+           TEST_SIM_MESSAGE_NUM, TEST_SIM_MESSAGE_MIN, TEST_SIM_MESSAGE_MAX);
+
+    for (int coalesce = 0; coalesce < 2; ++coalesce) {
+        test_sim_run(test_sim_coalesce_main, (void *)(intptr_t)coalesce, TEST_SIM_LEAF_NUM + 1,
+                     TEST_SIM_LEAF_FANOUT, stats + coalesce);
+        result = test_sim_result();
+
+        int64_t spend_us = MAX(result->end_us - result->start_us, 1);
+        printf("%s: messages read: %u, failed by the flow control: %u, lost: %u, throughput: %lld KB/s, messages/s: %lld, "
+               "frames/s: %lld, frames on air/s: %lld, time: %lld ms\n", name[coalesce], result->read, result->write_failed,
+               result->lost,
+               (long long)(result->read_bytes * 1000 / spend_us), (long long)(result->read * 1000000LL / spend_us),
+               (long long)(stats[coalesce].frames * 1000000LL / spend_us),
+               (long long)(stats[coalesce].attempts * 1000000LL / spend_us), (long long)spend_us / 1000);
+
+        TEST_ASSERT_EQUAL(0, result->failed);
+        TEST_ASSERT_LESS_THAN(TEST_SIM_LEAF_NUM * TEST_SIM_MESSAGE_NUM / 50, result->lost);
+
+        /**< A message goes in its own frame without coalescing, its write reports its error */
+        if (!coalesce) {
+            TEST_ASSERT_EQUAL(result->read, stats[0].frames);
+            TEST_ASSERT_EQUAL(0, result->lost);
+        }
+    }
+
+    /**< A packet carries many of them with it */
+    TEST_ASSERT_LESS_THAN(stats[0].frames / 4, stats[1].frames);
+}
@@ -0,0 +1,331 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "argtable3/argtable3.h"
+
+/**
+ * @brief Errors kept in the arg_end of a table
+ */
+enum {
+    HOST_ARG_ERR_UNKNOWN = 1, /**< The option isn't in the table */
+    HOST_ARG_ERR_NOVALUE,     /**< The option is the last argument, its value is missing */
+    HOST_ARG_ERR_BADINT,      /**< The value isn't an integer */
+    HOST_ARG_ERR_MINCOUNT,    /**< The option is missing */
+    HOST_ARG_ERR_MAXCOUNT,    /**< The option is given too many times */
+};
+
+/**
+ * @brief The values of an argument are allocated with it, behind the structure
+ */
+static void *host_arg_alloc(size_t size, size_t value_size, arg_type_t type, const char *shortopts,
+                            const char *longopts, const char *datatype, int mincount, int maxcount,
+                            const char *glossary)
+{
+    struct arg_hdr *hdr = calloc(1, size + value_size * maxcount);
+
+    if (!hdr) {
+        return NULL;
+    }
+
+    hdr->flag      = (type == ARG_TYPE_INT || type == ARG_TYPE_STR) ? ARG_HASVALUE : 0;
+    hdr->shortopts = shortopts;
+    hdr->longopts  = longopts;
+    hdr->datatype  = datatype;
+    hdr->glossary  = glossary;
+    hdr->mincount  = mincount;
+    hdr->maxcount  = maxcount < mincount ? mincount : maxcount;
+    hdr->type      = type;
+
+    return hdr;
+}
+
+struct arg_lit *arg_litn(const char *shortopts, const char *longopts, int mincount, int maxcount,
+                         const char *glossary)
+{
+    return host_arg_alloc(sizeof(struct arg_lit), 0, ARG_TYPE_LIT, shortopts, longopts, NULL,
+                          mincount, maxcount, glossary);
+}
+
+struct arg_lit *arg_lit0(const char *shortopts, const char *longopts, const char *glossary)
+{
+    return arg_litn(shortopts, longopts, 0, 1, glossary);
+}
+
+struct arg_lit *arg_lit1(const char *shortopts, const char *longopts, const char *glossary)
+{
+    return arg_litn(shortopts, longopts, 1, 1, glossary);
+}
+
+struct arg_int *arg_intn(const char *shortopts, const char *longopts, const char *datatype,
+                         int mincount, int maxcount, const char *glossary)
+{
+    struct arg_int *result = host_arg_alloc(sizeof(struct arg_int), sizeof(int), ARG_TYPE_INT, shortopts,
+                                            longopts, datatype, mincount, maxcount, glossary);
+
+    if (result) {
+        result->ival = (int *)(result + 1);
+    }
+
+    return result;
+}
+
+struct arg_int *arg_int0(const char *shortopts, const char *longopts, const char *datatype, const char *glossary)
+{
+    return arg_intn(shortopts, longopts, datatype, 0, 1, glossary);
+}
+
+struct arg_int *arg_int1(const char *shortopts, const char *longopts, const char *datatype, const char *glossary)
+{
+    return arg_intn(shortopts, longopts, datatype, 1, 1, glossary);
+}
+
+struct arg_str *arg_strn(const char *shortopts, const char *longopts, const char *datatype,
+                         int mincount, int maxcount, const char *glossary)
+{
+    struct arg_str *result = host_arg_alloc(sizeof(struct arg_str), sizeof(char *), ARG_TYPE_STR, shortopts,
+                                            longopts, datatype, mincount, maxcount, glossary);
+
+    if (result) {
+        result->sval = (const char **)(result + 1);
+    }
+
+    return result;
+}
+
+struct arg_str *arg_str0(const char *shortopts, const char *longopts, const char *datatype, const char *glossary)
+{
+    return arg_strn(shortopts, longopts, datatype, 0, 1, glossary);
+}
+
+struct arg_str *arg_str1(const char *shortopts, const char *longopts, const char *datatype, const char *glossary)
+{
+    return arg_strn(shortopts, longopts, datatype, 1, 1, glossary);
+}
+
+struct arg_end *arg_end(int maxerrors)
+{
+    struct arg_end *result = host_arg_alloc(sizeof(struct arg_end), sizeof(int) + sizeof(void *) + sizeof(char *),
+                                            ARG_TYPE_END, NULL, NULL, NULL, maxerrors, maxerrors, NULL);
+
+    if (result) {
+        result->hdr.flag = ARG_TERMINATOR;
+        result->parent   = (void **)(result + 1);
+        result->argval   = (const char **)(result->parent + maxerrors);
+        result->error    = (int *)(result->argval + maxerrors);
+    }
+
+    return result;
+}
+
+void arg_freetable(void **argtable, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        free(argtable[i]);
+        argtable[i] = NULL;
+    }
+}
+
+static void host_arg_error(struct arg_end *end, int error, void *parent, const char *argval)
+{
+    if (end->count < end->hdr.maxcount) {
+        end->error[end->count]  = error;
+        end->parent[end->count] = parent;
+        end->argval[end->count] = argval;
+        end->count++;
+    }
+}
+
+/**
+ * @brief Find an option by its short name, or by one of its long names separated by commas
+ */
+static struct arg_hdr *host_arg_find(void **argtable, char shortopt, const char *longopt, size_t longopt_len)
+{
+    for (int i = 0; !(((struct arg_hdr *)argtable[i])->flag & ARG_TERMINATOR); ++i) {
+        struct arg_hdr *hdr = argtable[i];
+
+        if (shortopt && hdr->shortopts && strchr(hdr->shortopts, shortopt)) {
+            return hdr;
+        }
+
+        for (const char *name = hdr->longopts; longopt && name && *name;) {
+            size_t name_len = strcspn(name, ",");
+
+            if (name_len == longopt_len && !strncmp(name, longopt, longopt_len)) {
+                return hdr;
+            }
+
+            name += name_len + (name[name_len] == ',');
+        }
+    }
+
+    return NULL;
+}
+
+static void host_arg_store(struct arg_end *end, struct arg_hdr *hdr, const char *value, const char *arg)
+{
+    char *value_end = NULL;
+
+    if ((hdr->flag & ARG_HASVALUE) && !value) {
+        host_arg_error(end, HOST_ARG_ERR_NOVALUE, hdr, arg);
+        return;
+    }
+
+    /**< All the argument types start with a header and a count */
+    int *count = (int *)(hdr + 1);
+
+    if (*count >= hdr->maxcount) {
+        host_arg_error(end, HOST_ARG_ERR_MAXCOUNT, hdr, arg);
+        return;
+    }
+
+    switch (hdr->type) {
+        case ARG_TYPE_INT: {
+            struct arg_int *arg_int = (struct arg_int *)hdr;
+            long ival               = strtol(value, &value_end, 0);
+
+            if (!*value || *value_end) {
+                host_arg_error(end, HOST_ARG_ERR_BADINT, hdr, value);
+                return;
+            }
+
+            arg_int->ival[arg_int->count] = ival;
+            break;
+        }
+
+        case ARG_TYPE_STR: {
+            struct arg_str *arg_str       = (struct arg_str *)hdr;
+            arg_str->sval[arg_str->count] = value;
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    (*count)++;
+}
+
+int arg_parse(int argc, char **argv, void **argtable)
+{
+    struct arg_end *end = NULL;
+    int num             = 0;
+
+    for (num = 0; !(((struct arg_hdr *)argtable[num])->flag & ARG_TERMINATOR); ++num) {
+        *(int *)((struct arg_hdr *)argtable[num] + 1) = 0;
+    }
+
+    end        = argtable[num];
+    end->count = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        char *arg           = argv[i];
+        struct arg_hdr *hdr = NULL;
+
+        if (arg[0] == '-' && arg[1] == '-' && arg[2]) {
+            /**< --name value, or --name=value */
+            char *name     = arg + 2;
+            char *equal    = strchr(name, '=');
+            size_t len     = equal ? equal - name : strlen(name);
+            hdr            = host_arg_find(argtable, '\0', name, len);
+
+            if (!hdr) {
+                host_arg_error(end, HOST_ARG_ERR_UNKNOWN, NULL, arg);
+            } else if (hdr->flag & ARG_HASVALUE) {
+                host_arg_store(end, hdr, equal ? equal + 1 : (i + 1 < argc ? argv[++i] : NULL), arg);
+            } else {
+                host_arg_store(end, hdr, NULL, arg);
+            }
+        } else if (arg[0] == '-' && arg[1] && !isdigit((unsigned char)arg[1])) {
+            /**< -abc, or -n value, or -nvalue */
+            for (char *opt = arg + 1; *opt; ++opt) {
+                hdr = host_arg_find(argtable, *opt, NULL, 0);
+
+                if (!hdr) {
+                    host_arg_error(end, HOST_ARG_ERR_UNKNOWN, NULL, arg);
+                    break;
+                }
+
+                if (hdr->flag & ARG_HASVALUE) {
+                    host_arg_store(end, hdr, opt[1] ? opt + 1 : (i + 1 < argc ? argv[++i] : NULL), arg);
+                    break;
+                }
+
+                host_arg_store(end, hdr, NULL, arg);
+            }
+        } else {
+            /**< A positional value goes to the first argument without names that has room for it */
+            for (int j = 0; j < num && !hdr; ++j) {
+                struct arg_hdr *entry = argtable[j];
+
+                if (!entry->shortopts && !entry->longopts && *(int *)(entry + 1) < entry->maxcount) {
+                    hdr = entry;
+                }
+            }
+
+            if (hdr) {
+                host_arg_store(end, hdr, arg, arg);
+            } else {
+                host_arg_error(end, HOST_ARG_ERR_UNKNOWN, NULL, arg);
+            }
+        }
+    }
+
+    for (int i = 0; i < num; ++i) {
+        struct arg_hdr *hdr = argtable[i];
+
+        if (*(int *)(hdr + 1) < hdr->mincount) {
+            host_arg_error(end, HOST_ARG_ERR_MINCOUNT, hdr, NULL);
+        }
+    }
+
+    return end->count;
+}
+
+void arg_print_errors(FILE *fp, struct arg_end *end, const char *progname)
+{
+    for (int i = 0; i < end->count; ++i) {
+        struct arg_hdr *hdr = end->parent[i];
+        const char *option  = hdr ? (hdr->longopts ? hdr->longopts : hdr->shortopts) : NULL;
+
+        switch (end->error[i]) {
+            case HOST_ARG_ERR_UNKNOWN:
+                fprintf(fp, "%s: invalid option \"%s\"\n", progname, end->argval[i]);
+                break;
+
+            case HOST_ARG_ERR_NOVALUE:
+                fprintf(fp, "%s: option \"%s\" needs a value\n", progname, end->argval[i]);
+                break;
+
+            case HOST_ARG_ERR_BADINT:
+                fprintf(fp, "%s: invalid integer \"%s\" to option %s\n", progname, end->argval[i], option);
+                break;
+
+            case HOST_ARG_ERR_MINCOUNT:
+                fprintf(fp, "%s: missing option %s\n", progname, option ? option : hdr->datatype);
+                break;
+
+            case HOST_ARG_ERR_MAXCOUNT:
+                fprintf(fp, "%s: excess option \"%s\"\n", progname, end->argval[i]);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
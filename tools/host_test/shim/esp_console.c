@@ -0,0 +1,137 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <pthread.h>
+#include <string.h>
+
+#include "esp_console.h"
+
+static pthread_mutex_t g_console_mutex = PTHREAD_MUTEX_INITIALIZER;
+static esp_console_cmd_t g_console_cmd[HOST_CONSOLE_CMD_NUM];
+
+esp_err_t esp_console_cmd_register(const esp_console_cmd_t *cmd)
+{
+    esp_err_t ret              = ESP_ERR_NO_MEM;
+    esp_console_cmd_t *entry   = NULL;
+
+    if (!cmd || !cmd->command || strchr(cmd->command, ' ')) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&g_console_mutex);
+
+    for (int i = 0; i < HOST_CONSOLE_CMD_NUM; ++i) {
+        if (g_console_cmd[i].command && !strcmp(g_console_cmd[i].command, cmd->command)) {
+            entry = g_console_cmd + i;
+            break;
+        } else if (!g_console_cmd[i].command && !entry) {
+            entry = g_console_cmd + i;
+        }
+    }
+
+    if (entry) {
+        *entry = *cmd;
+        ret    = ESP_OK;
+    }
+
+    pthread_mutex_unlock(&g_console_mutex);
+
+    return ret;
+}
+
+/**
+ * @brief Arguments are separated by spaces, a quoted argument keeps its spaces,
+ *        a backslash escapes the next character
+ */
+size_t esp_console_split_argv(char *line, char **argv, size_t argv_size)
+{
+    size_t argc = 0;
+    char *dest  = line;
+
+    for (char *src = line; *src && argc + 1 < argv_size;) {
+        bool quoted = false;
+
+        while (*src == ' ') {
+            src++;
+        }
+
+        if (!*src) {
+            break;
+        }
+
+        argv[argc++] = dest;
+
+        for (; *src && (quoted || *src != ' '); ++src) {
+            if (*src == '"') {
+                quoted = !quoted;
+            } else if (*src == '\\' && src[1]) {
+                *dest++ = *++src;
+            } else {
+                *dest++ = *src;
+            }
+        }
+
+        /**< The end of an argument is written over the separator or behind it */
+        if (*src) {
+            src++;
+        }
+
+        *dest++ = '\0';
+    }
+
+    argv[argc] = NULL;
+
+    return argc;
+}
+
+esp_err_t esp_console_run(const char *cmdline, int *cmd_ret)
+{
+    char *argv[HOST_CONSOLE_ARGV_NUM] = {NULL};
+    esp_console_cmd_func_t func       = NULL;
+    char *line                        = strdup(cmdline);
+    size_t argc                       = 0;
+
+    if (!line) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    argc = esp_console_split_argv(line, argv, HOST_CONSOLE_ARGV_NUM);
+
+    if (!argc) {
+        free(line);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&g_console_mutex);
+
+    for (int i = 0; i < HOST_CONSOLE_CMD_NUM; ++i) {
+        if (g_console_cmd[i].command && !strcmp(g_console_cmd[i].command, argv[0])) {
+            func = g_console_cmd[i].func;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&g_console_mutex);
+
+    if (!func) {
+        free(line);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    *cmd_ret = func(argc, argv);
+    free(line);
+
+    return ESP_OK;
+}
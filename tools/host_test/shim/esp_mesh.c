@@ -0,0 +1,914 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "esp_mesh.h"
+#include "esp_mesh_internal.h"
+#include "host_mesh.h"
+#include "host_sim.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+typedef struct {
+    mesh_addr_t addr;
+    mesh_addr_t subnet[HOST_MESH_SUBNET_MAX_NUM];
+    int subnet_num;
+} host_mesh_child_t;
+
+typedef struct {
+    mesh_addr_t from;
+    uint8_t *data;
+    int size;
+    uint8_t opt[HOST_MESH_OPT_MAX_LEN];
+    int opt_len;
+} host_mesh_packet_t;
+
+static pthread_mutex_t g_mesh_mutex         = PTHREAD_MUTEX_INITIALIZER;
+static host_mesh_send_cb_t g_mesh_send_cb   = NULL;
+static bool g_mesh_root                     = false;
+static host_mesh_child_t g_mesh_child[ESP_WIFI_MAX_CONN_NUM];
+static int g_mesh_child_num                 = 0;
+static mesh_cfg_t g_mesh_config             = {0};
+static mesh_attempts_t g_mesh_attempts      = {0};
+static mesh_switch_parent_t g_mesh_paras    = {0};
+static mesh_rssi_threshold_t g_mesh_rssi    = {0};
+static int g_mesh_max_layer                 = 0;
+static float g_mesh_vote_percentage         = 0;
+static wifi_auth_mode_t g_mesh_authmode     = WIFI_AUTH_OPEN;
+static int g_mesh_assoc_expire              = 0;
+static int g_mesh_xon_qsize                 = 0;
+static mesh_tx_pending_t g_mesh_tx_pending  = {0};
+static mesh_rx_pending_t g_mesh_rx_pending  = {0};
+static host_mesh_packet_t g_mesh_recv[HOST_MESH_RECV_NUM];
+static int g_mesh_recv_head                 = 0;
+static int g_mesh_recv_num                  = 0;
+static bool g_mesh_root_conflicts           = false;
+static int g_mesh_healing_delay             = 0;
+static int g_mesh_capacity_num              = 0;
+static esp_mesh_topology_t g_mesh_topology  = MESH_TOPO_TREE;
+static int g_mesh_beacon_interval           = 0;
+static int g_mesh_passive_scan_time         = 0;
+static mesh_type_t g_mesh_type              = MESH_IDLE;
+
+/**
+ * Simulation
+ */
+void host_mesh_set_send_cb(host_mesh_send_cb_t send_cb)
+{
+    pthread_mutex_lock(&g_mesh_mutex);
+    g_mesh_send_cb = send_cb;
+    pthread_mutex_unlock(&g_mesh_mutex);
+}
+
+void host_mesh_set_root(bool root)
+{
+    g_mesh_root = root;
+}
+
+void host_mesh_set_pending(const mesh_tx_pending_t *tx_pending, const mesh_rx_pending_t *rx_pending)
+{
+    pthread_mutex_lock(&g_mesh_mutex);
+    g_mesh_tx_pending = *tx_pending;
+    g_mesh_rx_pending = *rx_pending;
+    pthread_mutex_unlock(&g_mesh_mutex);
+}
+
+esp_err_t host_mesh_add_child(const mesh_addr_t *child, const mesh_addr_t *subnet, int subnet_num)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (!child || subnet_num < 0 || subnet_num > HOST_MESH_SUBNET_MAX_NUM || (subnet_num && !subnet)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&g_mesh_mutex);
+
+    if (g_mesh_child_num < ESP_WIFI_MAX_CONN_NUM) {
+        host_mesh_child_t *entry = g_mesh_child + g_mesh_child_num++;
+        memcpy(&entry->addr, child, sizeof(mesh_addr_t));
+        memcpy(entry->subnet, subnet, subnet_num * sizeof(mesh_addr_t));
+        entry->subnet_num = subnet_num;
+    } else {
+        ret = ESP_ERR_NO_MEM;
+    }
+
+    pthread_mutex_unlock(&g_mesh_mutex);
+
+    return ret;
+}
+
+void host_mesh_clear_children(void)
+{
+    pthread_mutex_lock(&g_mesh_mutex);
+    g_mesh_child_num = 0;
+    pthread_mutex_unlock(&g_mesh_mutex);
+}
+
+/**
+ * @brief The calls are served by the simulated network in the process of a node, see `host_sim.h`
+ */
+static bool host_mesh_simulated(void)
+{
+    return host_sim_node() >= 0;
+}
+
+static host_mesh_child_t *host_mesh_find_child(const mesh_addr_t *addr)
+{
+    for (int i = 0; i < g_mesh_child_num; ++i) {
+        if (!memcmp(g_mesh_child[i].addr.addr, addr->addr, sizeof(addr->addr))) {
+            return g_mesh_child + i;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * ESP-MESH
+ */
+esp_err_t esp_mesh_send(const mesh_addr_t *to, const mesh_data_t *data,
+                        int flag, const mesh_opt_t opt[], int opt_count)
+{
+    host_mesh_send_cb_t send_cb = NULL;
+
+    if (host_mesh_simulated()) {
+        return host_sim_send(to, data, flag, opt_count > 0 ? opt : NULL);
+    }
+
+    pthread_mutex_lock(&g_mesh_mutex);
+    send_cb = g_mesh_send_cb;
+    pthread_mutex_unlock(&g_mesh_mutex);
+
+    return send_cb ? send_cb(to, data, flag, opt, opt_count) : ESP_OK;
+}
+
+esp_err_t host_mesh_push_recv(const mesh_addr_t *from, const void *data, int size, const void *opt, int opt_len)
+{
+    esp_err_t ret = ESP_ERR_NO_MEM;
+
+    if (!from || !data || size <= 0 || opt_len < 0 || opt_len > HOST_MESH_OPT_MAX_LEN || (opt_len && !opt)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&g_mesh_mutex);
+
+    if (g_mesh_recv_num < HOST_MESH_RECV_NUM) {
+        host_mesh_packet_t *packet = g_mesh_recv + (g_mesh_recv_head + g_mesh_recv_num) % HOST_MESH_RECV_NUM;
+        packet->data               = malloc(size);
+
+        if (packet->data) {
+            packet->from    = *from;
+            packet->size    = size;
+            packet->opt_len = opt_len;
+            memcpy(packet->data, data, size);
+            memcpy(packet->opt, opt, opt_len);
+            g_mesh_recv_num++;
+            ret = ESP_OK;
+        }
+    }
+
+    pthread_mutex_unlock(&g_mesh_mutex);
+
+    return ret;
+}
+
+/**
+ * @brief Out of a simulation esp_mesh_recv() only returns the packets of host_mesh_push_recv(),
+ *        and waits for the timeout when there is none
+ */
+esp_err_t esp_mesh_recv(mesh_addr_t *from, mesh_data_t *data, int timeout_ms,
+                        int *flag, mesh_opt_t opt[], int opt_count)
+{
+    host_mesh_packet_t packet = {0};
+
+    if (host_mesh_simulated()) {
+        return host_sim_recv(false, from, NULL, data, timeout_ms, flag, opt_count > 0 ? opt : NULL);
+    }
+
+    pthread_mutex_lock(&g_mesh_mutex);
+
+    if (g_mesh_recv_num) {
+        packet           = g_mesh_recv[g_mesh_recv_head];
+        g_mesh_recv_head = (g_mesh_recv_head + 1) % HOST_MESH_RECV_NUM;
+        g_mesh_recv_num--;
+    }
+
+    pthread_mutex_unlock(&g_mesh_mutex);
+
+    if (!packet.data) {
+        vTaskDelay(pdMS_TO_TICKS(timeout_ms > 0 ? timeout_ms : 100));
+        return ESP_ERR_MESH_TIMEOUT;
+    }
+
+    if (packet.size > data->size) {
+        free(packet.data);
+        return ESP_ERR_MESH_ARGUMENT;
+    }
+
+    *from      = packet.from;
+    data->size = packet.size;
+    memcpy(data->data, packet.data, packet.size);
+    free(packet.data);
+
+    if (flag) {
+        *flag = 0;
+    }
+
+    if (opt_count > 0 && opt) {
+        memcpy(opt->val, packet.opt, MIN(packet.opt_len, opt->len));
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_recv_toDS(mesh_addr_t *from, mesh_addr_t *to, mesh_data_t *data, int timeout_ms,
+                             int *flag, mesh_opt_t opt[], int opt_count)
+{
+    if (host_mesh_simulated()) {
+        return host_sim_recv(true, from, to, data, timeout_ms, flag, opt_count > 0 ? opt : NULL);
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(timeout_ms > 0 ? timeout_ms : 100));
+    return ESP_ERR_MESH_TIMEOUT;
+}
+
+esp_err_t esp_mesh_get_subnet_nodes_num(const mesh_addr_t *child_mac, int *nodes_num)
+{
+    host_mesh_child_t *child = NULL;
+
+    if (host_mesh_simulated()) {
+        int node = host_sim_find(child_mac->addr);
+        int nodes[HOST_SIM_NODE_MAX];
+
+        if (node < 0 || host_sim_parent(node) != host_sim_node()) {
+            return ESP_ERR_MESH_ARGUMENT;
+        }
+
+        *nodes_num = host_sim_subnet(node, nodes, HOST_SIM_NODE_MAX);
+        return ESP_OK;
+    }
+
+    pthread_mutex_lock(&g_mesh_mutex);
+    child = host_mesh_find_child(child_mac);
+
+    if (child) {
+        *nodes_num = child->subnet_num;
+    }
+
+    pthread_mutex_unlock(&g_mesh_mutex);
+
+    return child ? ESP_OK : ESP_ERR_MESH_ARGUMENT;
+}
+
+esp_err_t esp_mesh_get_subnet_nodes_list(const mesh_addr_t *child_mac, mesh_addr_t *nodes, int nodes_num)
+{
+    esp_err_t ret            = ESP_OK;
+    host_mesh_child_t *child = NULL;
+
+    if (host_mesh_simulated()) {
+        int node = host_sim_find(child_mac->addr);
+        int subnet[HOST_SIM_NODE_MAX];
+
+        if (node < 0 || host_sim_parent(node) != host_sim_node()
+                || host_sim_subnet(node, subnet, HOST_SIM_NODE_MAX) != nodes_num) {
+            return ESP_ERR_MESH_ARGUMENT;
+        }
+
+        for (int i = 0; i < nodes_num; ++i) {
+            host_sim_addr(subnet[i], nodes[i].addr);
+        }
+
+        return ESP_OK;
+    }
+
+    pthread_mutex_lock(&g_mesh_mutex);
+    child = host_mesh_find_child(child_mac);
+
+    if (!child || nodes_num != child->subnet_num) {
+        ret = ESP_ERR_MESH_ARGUMENT;
+    } else {
+        memcpy(nodes, child->subnet, nodes_num * sizeof(mesh_addr_t));
+    }
+
+    pthread_mutex_unlock(&g_mesh_mutex);
+
+    return ret;
+}
+
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t *sta)
+{
+    memset(sta, 0, sizeof(wifi_sta_list_t));
+
+    if (host_mesh_simulated()) {
+        int children[ESP_WIFI_MAX_CONN_NUM];
+
+        sta->num = host_sim_children(host_sim_node(), children, ESP_WIFI_MAX_CONN_NUM);
+
+        for (int i = 0; i < sta->num; ++i) {
+            host_sim_addr(children[i], sta->sta[i].mac);
+        }
+
+        return ESP_OK;
+    }
+
+    pthread_mutex_lock(&g_mesh_mutex);
+
+    for (int i = 0; i < g_mesh_child_num; ++i) {
+        memcpy(sta->sta[i].mac, g_mesh_child[i].addr.addr, sizeof(sta->sta[i].mac));
+    }
+
+    sta->num = g_mesh_child_num;
+    pthread_mutex_unlock(&g_mesh_mutex);
+
+    return ESP_OK;
+}
+
+bool esp_mesh_is_root(void)
+{
+    return host_mesh_simulated() ? host_sim_parent(host_sim_node()) < 0 : g_mesh_root;
+}
+
+int esp_mesh_get_layer(void)
+{
+    return host_mesh_simulated() ? host_sim_layer(host_sim_node()) : (g_mesh_root ? MESH_ROOT_LAYER : 0);
+}
+
+/**
+ * @brief The softAP address of the parent in a simulation, none otherwise
+ */
+esp_err_t esp_mesh_get_parent_bssid(mesh_addr_t *bssid)
+{
+    memset(bssid, 0, sizeof(mesh_addr_t));
+
+    if (host_mesh_simulated() && host_sim_parent(host_sim_node()) >= 0) {
+        host_sim_addr(host_sim_parent(host_sim_node()), bssid->addr);
+        bssid->addr[3]++;
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief In a simulation, the type follows the place of the node in the tree
+ */
+mesh_type_t esp_mesh_get_type(void)
+{
+    int children[1];
+
+    if (!host_mesh_simulated()) {
+        return g_mesh_type;
+    } else if (esp_mesh_is_root()) {
+        return MESH_ROOT;
+    }
+
+    return host_sim_children(host_sim_node(), children, 1) ? MESH_NODE : MESH_LEAF;
+}
+
+/**
+ * @brief The node itself and the nodes of its subnet
+ */
+int esp_mesh_get_routing_table_size(void)
+{
+    int nodes[HOST_SIM_NODE_MAX];
+
+    if (!host_mesh_simulated()) {
+        return esp_mesh_get_total_node_num();
+    }
+
+    return host_sim_subnet(host_sim_node(), nodes, HOST_SIM_NODE_MAX) + 1;
+}
+
+esp_err_t esp_mesh_get_routing_table(mesh_addr_t *mac, int len, int *size)
+{
+    int nodes[HOST_SIM_NODE_MAX];
+    int node_num = 0;
+
+    if (!mac || !size || len < sizeof(mesh_addr_t)) {
+        return ESP_ERR_MESH_ARGUMENT;
+    }
+
+    esp_wifi_get_mac(WIFI_IF_STA, mac[0].addr);
+    *size = 1;
+
+    if (!host_mesh_simulated()) {
+        return ESP_OK;
+    }
+
+    node_num = host_sim_subnet(host_sim_node(), nodes, HOST_SIM_NODE_MAX);
+
+    for (int i = 0; i < node_num && *size < len / sizeof(mesh_addr_t); ++i) {
+        host_sim_addr(nodes[i], mac[(*size)++].addr);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_post_toDS_state(bool reachable)
+{
+    return ESP_OK;
+}
+
+int esp_mesh_get_total_node_num(void)
+{
+    int node_num = 1;
+
+    if (host_mesh_simulated()) {
+        int nodes[HOST_SIM_NODE_MAX];
+        return host_sim_subnet(0, nodes, HOST_SIM_NODE_MAX) + 1;
+    }
+
+    pthread_mutex_lock(&g_mesh_mutex);
+
+    for (int i = 0; i < g_mesh_child_num; ++i) {
+        node_num += g_mesh_child[i].subnet_num + 1;
+    }
+
+    pthread_mutex_unlock(&g_mesh_mutex);
+
+    return node_num;
+}
+
+esp_err_t esp_mesh_get_tx_pending(mesh_tx_pending_t *pending)
+{
+    mesh_rx_pending_t rx_pending;
+
+    memset(pending, 0, sizeof(mesh_tx_pending_t));
+
+    if (host_mesh_simulated()) {
+        host_sim_get_pending(pending, &rx_pending);
+    } else {
+        pthread_mutex_lock(&g_mesh_mutex);
+        *pending = g_mesh_tx_pending;
+        pthread_mutex_unlock(&g_mesh_mutex);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_get_rx_pending(mesh_rx_pending_t *pending)
+{
+    mesh_tx_pending_t tx_pending;
+
+    memset(pending, 0, sizeof(mesh_rx_pending_t));
+
+    if (host_mesh_simulated()) {
+        host_sim_get_pending(&tx_pending, pending);
+    } else {
+        pthread_mutex_lock(&g_mesh_mutex);
+        *pending = g_mesh_rx_pending;
+        pthread_mutex_unlock(&g_mesh_mutex);
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * Configuration, the values are only stored
+ */
+esp_err_t esp_mesh_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_deinit(void)
+{
+    return ESP_OK;
+}
+
+/**
+ * @brief In a simulation the node is connected to its parent as soon as it starts
+ */
+esp_err_t esp_mesh_start(void)
+{
+    mesh_event_info_t event_info = {0};
+
+    if (host_mesh_simulated()) {
+        host_sim_set_started(true);
+        esp_event_post(MESH_EVENT, MESH_EVENT_STARTED, &event_info, sizeof(event_info), portMAX_DELAY);
+        esp_event_post(MESH_EVENT, MESH_EVENT_PARENT_CONNECTED, &event_info, sizeof(event_info), portMAX_DELAY);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_stop(void)
+{
+    mesh_event_info_t event_info = {0};
+
+    if (host_mesh_simulated() && host_sim_is_started()) {
+        host_sim_set_started(false);
+        esp_event_post(MESH_EVENT, MESH_EVENT_STOPPED, &event_info, sizeof(event_info), portMAX_DELAY);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_config(const mesh_cfg_t *config)
+{
+    memcpy(&g_mesh_config, config, sizeof(mesh_cfg_t));
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_get_config(mesh_cfg_t *config)
+{
+    memcpy(config, &g_mesh_config, sizeof(mesh_cfg_t));
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_type(mesh_type_t type)
+{
+    g_mesh_root = (type == MESH_ROOT);
+    g_mesh_type = type;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_self_organized(bool enable, bool select_parent)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_6m_rate(bool is_6m)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_max_layer(int max_layer)
+{
+    g_mesh_max_layer = max_layer;
+    return ESP_OK;
+}
+
+int esp_mesh_get_max_layer(void)
+{
+    return g_mesh_max_layer;
+}
+
+esp_err_t esp_mesh_set_vote_percentage(float percentage)
+{
+    g_mesh_vote_percentage = percentage;
+    return ESP_OK;
+}
+
+float esp_mesh_get_vote_percentage(void)
+{
+    return g_mesh_vote_percentage;
+}
+
+esp_err_t esp_mesh_set_ap_authmode(wifi_auth_mode_t authmode)
+{
+    g_mesh_authmode = authmode;
+    return ESP_OK;
+}
+
+wifi_auth_mode_t esp_mesh_get_ap_authmode(void)
+{
+    return g_mesh_authmode;
+}
+
+esp_err_t esp_mesh_set_ap_assoc_expire(int seconds)
+{
+    g_mesh_assoc_expire = seconds;
+    return ESP_OK;
+}
+
+int esp_mesh_get_ap_assoc_expire(void)
+{
+    return g_mesh_assoc_expire;
+}
+
+esp_err_t esp_mesh_fix_root(bool enable)
+{
+    return ESP_OK;
+}
+
+bool esp_mesh_is_root_fixed(void)
+{
+    return false;
+}
+
+esp_err_t esp_mesh_waive_root(const void *vote, int reason)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_xon_qsize(int qsize)
+{
+    g_mesh_xon_qsize = qsize;
+    return ESP_OK;
+}
+
+int esp_mesh_get_xon_qsize(void)
+{
+    return g_mesh_xon_qsize;
+}
+
+esp_err_t esp_mesh_allow_root_conflicts(bool allowed)
+{
+    g_mesh_root_conflicts = allowed;
+    return ESP_OK;
+}
+
+bool esp_mesh_is_root_conflicts_allowed(void)
+{
+    return g_mesh_root_conflicts;
+}
+
+esp_err_t esp_mesh_set_root_healing_delay(int delay_ms)
+{
+    g_mesh_healing_delay = delay_ms;
+    return ESP_OK;
+}
+
+int esp_mesh_get_root_healing_delay(void)
+{
+    return g_mesh_healing_delay;
+}
+
+bool esp_mesh_is_my_group(const mesh_addr_t *addr)
+{
+    return false;
+}
+
+esp_err_t esp_mesh_set_capacity_num(int num)
+{
+    g_mesh_capacity_num = num;
+    return ESP_OK;
+}
+
+int esp_mesh_get_capacity_num(void)
+{
+    return g_mesh_capacity_num;
+}
+
+esp_err_t esp_mesh_disconnect(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_topology(esp_mesh_topology_t topo)
+{
+    g_mesh_topology = topo;
+    return ESP_OK;
+}
+
+esp_mesh_topology_t esp_mesh_get_topology(void)
+{
+    return g_mesh_topology;
+}
+
+esp_err_t esp_mesh_enable_ps(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_disable_ps(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_active_duty_cycle(int dev_duty, int dev_duty_type)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_network_duty_cycle(int nwk_duty, int duration_mins, int applied_rule)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_beacon_interval(int interval_ms)
+{
+    g_mesh_beacon_interval = interval_ms;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_get_beacon_interval(int *interval_ms)
+{
+    *interval_ms = g_mesh_beacon_interval;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_attempts(mesh_attempts_t *attempts)
+{
+    memcpy(&g_mesh_attempts, attempts, sizeof(mesh_attempts_t));
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_get_attempts(mesh_attempts_t *attempts)
+{
+    memcpy(attempts, &g_mesh_attempts, sizeof(mesh_attempts_t));
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_switch_parent_paras(mesh_switch_parent_t *paras)
+{
+    memcpy(&g_mesh_paras, paras, sizeof(mesh_switch_parent_t));
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_get_switch_parent_paras(mesh_switch_parent_t *paras)
+{
+    memcpy(paras, &g_mesh_paras, sizeof(mesh_switch_parent_t));
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_rssi_threshold(const mesh_rssi_threshold_t *threshold)
+{
+    memcpy(&g_mesh_rssi, threshold, sizeof(mesh_rssi_threshold_t));
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_get_rssi_threshold(mesh_rssi_threshold_t *threshold)
+{
+    memcpy(threshold, &g_mesh_rssi, sizeof(mesh_rssi_threshold_t));
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_passive_scan_time(int time_ms)
+{
+    g_mesh_passive_scan_time = time_ms;
+    return ESP_OK;
+}
+
+int esp_mesh_get_passive_scan_time(void)
+{
+    return g_mesh_passive_scan_time;
+}
+
+esp_err_t esp_mesh_set_announce_interval(int short_ms, int long_ms)
+{
+    return ESP_OK;
+}
+
+/**
+ * @brief The scan finds no AP, there is no record to get
+ */
+esp_err_t esp_mesh_scan_get_ap_ie_len(int *len)
+{
+    *len = 0;
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t esp_mesh_scan_get_ap_record(wifi_ap_record_t *ap_record, void *buffer)
+{
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t esp_wifi_vnd_mesh_get(mesh_assoc_t *mesh_assoc, mesh_chain_layer_t *mesh_chain)
+{
+    memset(mesh_assoc, 0, sizeof(mesh_assoc_t));
+    memset(mesh_chain, 0, sizeof(mesh_chain_layer_t));
+    mesh_assoc->toDS  = esp_mesh_is_root();
+    mesh_assoc->layer = esp_mesh_get_layer();
+
+    return ESP_OK;
+}
+
+/**
+ * Wi-Fi
+ */
+static uint8_t g_wifi_channel = 1;
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_max_tx_power(int8_t *power)
+{
+    *power = 78;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_start(const wifi_scan_config_t *config, bool block)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_stop(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_get_ap_num(uint16_t *number)
+{
+    *number = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_mac(wifi_interface_t ifx, uint8_t mac[6])
+{
+    const uint8_t host_mac[6] = {0x30, 0xae, 0xa4, 0x00, 0x00, 0x01};
+
+    /**< The softAP address of a simulated node differs from the station one in byte 3 */
+    if (host_mesh_simulated()) {
+        host_sim_addr(host_sim_node(), mac);
+        mac[3] += (ifx == WIFI_IF_AP);
+        return ESP_OK;
+    }
+
+    memcpy(mac, host_mac, sizeof(host_mac));
+    mac[5] += (ifx == WIFI_IF_AP);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second)
+{
+    g_wifi_channel = primary;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_channel(uint8_t *primary, wifi_second_chan_t *second)
+{
+    *primary = g_wifi_channel;
+    *second  = WIFI_SECOND_CHAN_NONE;
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Out of a simulation there is no parent, as when the node is disconnected
+ */
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap_info)
+{
+    mesh_addr_t parent_bssid = {0};
+
+    memset(ap_info, 0, sizeof(wifi_ap_record_t));
+
+    if (!host_mesh_simulated() || esp_mesh_is_root()) {
+        return ESP_FAIL;
+    }
+
+    esp_mesh_get_parent_bssid(&parent_bssid);
+    memcpy(ap_info->bssid, parent_bssid.addr, sizeof(ap_info->bssid));
+    ap_info->primary = 1;
+    ap_info->rssi    = -50;
+
+    return ESP_OK;
+}
+
+/**
+ * Network interface
+ */
+static struct esp_netif_obj {
+    int unused;
+} g_netif_sta;
+
+esp_err_t esp_netif_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_create_default_wifi_mesh_netifs(esp_netif_t **p_netif_sta, esp_netif_t **p_netif_ap)
+{
+    if (p_netif_sta) {
+        *p_netif_sta = &g_netif_sta;
+    }
+
+    if (p_netif_ap) {
+        *p_netif_ap = NULL;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcpc_start(esp_netif_t *esp_netif)
+{
+    return ESP_OK;
+}
@@ -0,0 +1,341 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_now.h"
+#include "esp_timer.h"
+#include "host_espnow.h"
+
+#define HOST_ESPNOW_FRAME_MAX_NUM (64) /**< Maximum of `buffer_num` */
+
+typedef struct {
+    uint8_t dest_addr[ESP_NOW_ETH_ALEN];
+    uint8_t data[ESP_NOW_MAX_DATA_LEN];
+    int size;
+    int64_t done_time;              /**< Time of the send callback */
+    esp_now_send_status_t status;
+    bool received;
+} host_espnow_frame_t;
+
+typedef struct {
+    uint8_t addr[ESP_NOW_ETH_ALEN];
+    bool used;
+} host_espnow_peer_t;
+
+static pthread_mutex_t g_espnow_mutex            = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_espnow_cond              = PTHREAD_COND_INITIALIZER;
+static pthread_t g_espnow_thread;
+static bool g_espnow_inited                      = false;
+static bool g_espnow_thread_run                  = false;
+static esp_now_recv_cb_t g_espnow_recv_cb        = NULL;
+static esp_now_send_cb_t g_espnow_send_cb        = NULL;
+static host_espnow_sniffer_cb_t g_espnow_sniffer = NULL;
+static host_espnow_link_t g_espnow_link          = HOST_ESPNOW_LINK_DEFAULT();
+static unsigned int g_espnow_seed                = 1;
+static host_espnow_frame_t g_espnow_frame[HOST_ESPNOW_FRAME_MAX_NUM];
+static uint32_t g_espnow_frame_head              = 0; /**< Count of the frames sent */
+static uint32_t g_espnow_frame_tail              = 0; /**< Count of the frames completed */
+static int64_t g_espnow_air_free_time            = 0; /**< The frames on air end at this time */
+static host_espnow_peer_t g_espnow_peer[ESP_NOW_MAX_TOTAL_PEER_NUM];
+
+static const uint8_t g_broadcast_addr[ESP_NOW_ETH_ALEN] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+
+/**
+ * Simulation
+ */
+void host_espnow_set_link(const host_espnow_link_t *link)
+{
+    pthread_mutex_lock(&g_espnow_mutex);
+    g_espnow_link = *link;
+    g_espnow_seed = link->seed;
+
+    if (g_espnow_link.buffer_num > HOST_ESPNOW_FRAME_MAX_NUM) {
+        g_espnow_link.buffer_num = HOST_ESPNOW_FRAME_MAX_NUM;
+    }
+
+    pthread_mutex_unlock(&g_espnow_mutex);
+}
+
+void host_espnow_set_sniffer(host_espnow_sniffer_cb_t sniffer_cb)
+{
+    pthread_mutex_lock(&g_espnow_mutex);
+    g_espnow_sniffer = sniffer_cb;
+    pthread_mutex_unlock(&g_espnow_mutex);
+}
+
+void host_espnow_wait_idle(void)
+{
+    pthread_mutex_lock(&g_espnow_mutex);
+
+    while (g_espnow_frame_tail != g_espnow_frame_head) {
+        pthread_cond_wait(&g_espnow_cond, &g_espnow_mutex);
+    }
+
+    pthread_mutex_unlock(&g_espnow_mutex);
+}
+
+static void host_espnow_sleep_until(int64_t time_us)
+{
+    int64_t delay_us = time_us - esp_timer_get_time();
+
+    if (delay_us > 0) {
+        struct timespec ts = {.tv_sec = delay_us / 1000000, .tv_nsec = (delay_us % 1000000) * 1000};
+        nanosleep(&ts, NULL);
+    }
+}
+
+/**
+ * @brief Receives the frames on air and calls the send callbacks, in the order of sending.
+ *        The callbacks run without the lock, as they do in the Wi-Fi task.
+ */
+static void *host_espnow_link_thread(void *arg)
+{
+    uint8_t src_addr[ESP_NOW_ETH_ALEN] = {0};
+    host_espnow_frame_t frame;
+
+    esp_wifi_get_mac(WIFI_IF_STA, src_addr);
+    pthread_mutex_lock(&g_espnow_mutex);
+
+    while (g_espnow_thread_run) {
+        if (g_espnow_frame_tail == g_espnow_frame_head) {
+            pthread_cond_wait(&g_espnow_cond, &g_espnow_mutex);
+            continue;
+        }
+
+        frame = g_espnow_frame[g_espnow_frame_tail % HOST_ESPNOW_FRAME_MAX_NUM];
+        esp_now_recv_cb_t recv_cb = g_espnow_recv_cb;
+        esp_now_send_cb_t send_cb = g_espnow_send_cb;
+        pthread_mutex_unlock(&g_espnow_mutex);
+
+        host_espnow_sleep_until(frame.done_time);
+
+        if (frame.received && recv_cb) {
+            recv_cb(src_addr, frame.data, frame.size);
+        }
+
+        if (send_cb) {
+            send_cb(frame.dest_addr, frame.status);
+        }
+
+        pthread_mutex_lock(&g_espnow_mutex);
+        g_espnow_frame_tail++;
+        pthread_cond_broadcast(&g_espnow_cond);
+    }
+
+    pthread_mutex_unlock(&g_espnow_mutex);
+
+    return NULL;
+}
+
+static host_espnow_peer_t *host_espnow_find_peer(const uint8_t *addr)
+{
+    for (int i = 0; i < ESP_NOW_MAX_TOTAL_PEER_NUM; ++i) {
+        if (g_espnow_peer[i].used && !memcmp(g_espnow_peer[i].addr, addr, ESP_NOW_ETH_ALEN)) {
+            return g_espnow_peer + i;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * ESP-NOW
+ */
+esp_err_t esp_now_init(void)
+{
+    pthread_mutex_lock(&g_espnow_mutex);
+
+    if (!g_espnow_inited) {
+        g_espnow_inited     = true;
+        g_espnow_thread_run = true;
+        pthread_create(&g_espnow_thread, NULL, host_espnow_link_thread, NULL);
+    }
+
+    pthread_mutex_unlock(&g_espnow_mutex);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_now_deinit(void)
+{
+    pthread_mutex_lock(&g_espnow_mutex);
+
+    if (!g_espnow_inited) {
+        pthread_mutex_unlock(&g_espnow_mutex);
+        return ESP_ERR_ESPNOW_NOT_INIT;
+    }
+
+    g_espnow_inited     = false;
+    g_espnow_thread_run = false;
+    pthread_cond_broadcast(&g_espnow_cond);
+    pthread_mutex_unlock(&g_espnow_mutex);
+
+    pthread_join(g_espnow_thread, NULL);
+
+    /**< The frames not completed are dropped with their callbacks */
+    pthread_mutex_lock(&g_espnow_mutex);
+    g_espnow_frame_tail = g_espnow_frame_head;
+    memset(g_espnow_peer, 0, sizeof(g_espnow_peer));
+    pthread_cond_broadcast(&g_espnow_cond);
+    pthread_mutex_unlock(&g_espnow_mutex);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb)
+{
+    g_espnow_recv_cb = cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_unregister_recv_cb(void)
+{
+    g_espnow_recv_cb = NULL;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb)
+{
+    g_espnow_send_cb = cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_unregister_send_cb(void)
+{
+    g_espnow_send_cb = NULL;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_send(const uint8_t *peer_addr, const uint8_t *data, size_t len)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (!data || !len || len > ESP_NOW_MAX_DATA_LEN) {
+        return ESP_ERR_ESPNOW_ARG;
+    }
+
+    pthread_mutex_lock(&g_espnow_mutex);
+
+    if (!g_espnow_inited) {
+        ret = ESP_ERR_ESPNOW_NOT_INIT;
+    } else if (!peer_addr || !host_espnow_find_peer(peer_addr)) {
+        ret = ESP_ERR_ESPNOW_NOT_FOUND;
+    } else if (g_espnow_frame_head - g_espnow_frame_tail >= g_espnow_link.buffer_num) {
+        ret = ESP_ERR_ESPNOW_NO_MEM;
+    } else {
+        host_espnow_frame_t *frame = g_espnow_frame + g_espnow_frame_head % HOST_ESPNOW_FRAME_MAX_NUM;
+        int64_t now_time           = esp_timer_get_time();
+        bool lost                  = rand_r(&g_espnow_seed) % 100 < g_espnow_link.loss_percent;
+        bool ack_lost              = rand_r(&g_espnow_seed) % 100 < g_espnow_link.ack_loss_percent;
+
+        /**< The frames take the air one after the other */
+        g_espnow_air_free_time = (g_espnow_air_free_time > now_time ? g_espnow_air_free_time : now_time)
+                                 + g_espnow_link.air_time_us;
+
+        memcpy(frame->dest_addr, peer_addr, ESP_NOW_ETH_ALEN);
+        memcpy(frame->data, data, len);
+        frame->size      = len;
+        frame->done_time = g_espnow_air_free_time + g_espnow_link.cb_latency_us;
+        frame->received  = !lost;
+        frame->status    = (lost || ack_lost) ? ESP_NOW_SEND_FAIL : ESP_NOW_SEND_SUCCESS;
+
+        /**< A broadcast is not acknowledged */
+        if (!memcmp(peer_addr, g_broadcast_addr, ESP_NOW_ETH_ALEN)) {
+            frame->status = ESP_NOW_SEND_SUCCESS;
+        }
+
+        if (g_espnow_sniffer) {
+            g_espnow_sniffer(peer_addr, data, len);
+        }
+
+        g_espnow_frame_head++;
+        pthread_cond_broadcast(&g_espnow_cond);
+    }
+
+    pthread_mutex_unlock(&g_espnow_mutex);
+
+    return ret;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t *peer)
+{
+    esp_err_t ret = ESP_ERR_ESPNOW_FULL;
+
+    pthread_mutex_lock(&g_espnow_mutex);
+
+    if (host_espnow_find_peer(peer->peer_addr)) {
+        ret = ESP_ERR_ESPNOW_EXIST;
+    } else {
+        for (int i = 0; i < ESP_NOW_MAX_TOTAL_PEER_NUM; ++i) {
+            if (!g_espnow_peer[i].used) {
+                memcpy(g_espnow_peer[i].addr, peer->peer_addr, ESP_NOW_ETH_ALEN);
+                g_espnow_peer[i].used = true;
+                ret = ESP_OK;
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&g_espnow_mutex);
+
+    return ret;
+}
+
+esp_err_t esp_now_del_peer(const uint8_t *peer_addr)
+{
+    esp_err_t ret             = ESP_ERR_ESPNOW_NOT_FOUND;
+    host_espnow_peer_t *peer  = NULL;
+
+    pthread_mutex_lock(&g_espnow_mutex);
+
+    if ((peer = host_espnow_find_peer(peer_addr))) {
+        peer->used = false;
+        ret        = ESP_OK;
+    }
+
+    pthread_mutex_unlock(&g_espnow_mutex);
+
+    return ret;
+}
+
+esp_err_t esp_now_mod_peer(const esp_now_peer_info_t *peer)
+{
+    esp_err_t ret = ESP_ERR_ESPNOW_NOT_FOUND;
+
+    pthread_mutex_lock(&g_espnow_mutex);
+    ret = host_espnow_find_peer(peer->peer_addr) ? ESP_OK : ESP_ERR_ESPNOW_NOT_FOUND;
+    pthread_mutex_unlock(&g_espnow_mutex);
+
+    return ret;
+}
+
+bool esp_now_is_peer_exist(const uint8_t *peer_addr)
+{
+    bool exist = false;
+
+    pthread_mutex_lock(&g_espnow_mutex);
+    exist = host_espnow_find_peer(peer_addr) != NULL;
+    pthread_mutex_unlock(&g_espnow_mutex);
+
+    return exist;
+}
+
+esp_err_t esp_now_set_pmk(const uint8_t *pmk)
+{
+    return ESP_OK;
+}
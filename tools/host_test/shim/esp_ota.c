@@ -0,0 +1,250 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_ota_ops.h"
+
+#define HOST_PARTITION_SIZE (1024 * 1024)
+
+static const esp_partition_t g_partition[] = {
+    {ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_0, 0x10000, HOST_PARTITION_SIZE, "ota_0", false},
+    {ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_1, 0x110000, HOST_PARTITION_SIZE, "ota_1", false},
+};
+
+static uint8_t g_partition_data[2][HOST_PARTITION_SIZE];
+static const esp_partition_t *g_boot_partition = g_partition;
+
+/**< Only one update is written at a time, the handle is 1 while it is */
+static esp_ota_handle_t g_ota_handle = 0;
+static size_t g_ota_written          = 0;
+
+static uint8_t *host_partition_data(const esp_partition_t *partition)
+{
+    for (int i = 0; i < sizeof(g_partition) / sizeof(g_partition[0]); ++i) {
+        if (partition == g_partition + i) {
+            return g_partition_data[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Partition, an iterator is the partition it points to
+ */
+struct esp_partition_iterator_opaque_ {
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    const char *label;
+    int index;
+};
+
+static esp_partition_iterator_t host_partition_match(esp_partition_iterator_t it)
+{
+    for (; it->index < sizeof(g_partition) / sizeof(g_partition[0]); ++it->index) {
+        const esp_partition_t *partition = g_partition + it->index;
+
+        if (partition->type == it->type
+                && (it->subtype == ESP_PARTITION_SUBTYPE_ANY || partition->subtype == it->subtype)
+                && (!it->label || !strcmp(partition->label, it->label))) {
+            return it;
+        }
+    }
+
+    free(it);
+    return NULL;
+}
+
+esp_partition_iterator_t esp_partition_find(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label)
+{
+    esp_partition_iterator_t it = calloc(1, sizeof(struct esp_partition_iterator_opaque_));
+
+    if (!it) {
+        return NULL;
+    }
+
+    it->type    = type;
+    it->subtype = subtype;
+    it->label   = label;
+
+    return host_partition_match(it);
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label)
+{
+    esp_partition_iterator_t it      = esp_partition_find(type, subtype, label);
+    const esp_partition_t *partition = it ? esp_partition_get(it) : NULL;
+
+    esp_partition_iterator_release(it);
+
+    return partition;
+}
+
+const esp_partition_t *esp_partition_get(esp_partition_iterator_t iterator)
+{
+    return iterator ? g_partition + iterator->index : NULL;
+}
+
+esp_partition_iterator_t esp_partition_next(esp_partition_iterator_t iterator)
+{
+    ++iterator->index;
+    return host_partition_match(iterator);
+}
+
+void esp_partition_iterator_release(esp_partition_iterator_t iterator)
+{
+    free(iterator);
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    uint8_t *data = host_partition_data(partition);
+
+    if (!data || !dst) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (src_offset > partition->size || size > partition->size - src_offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memcpy(dst, data + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    uint8_t *data = host_partition_data(partition);
+
+    if (!data || !src) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (dst_offset > partition->size || size > partition->size - dst_offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memcpy(data + dst_offset, src, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    uint8_t *data = host_partition_data(partition);
+
+    if (!data) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (offset > partition->size || size > partition->size - offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memset(data + offset, 0xff, size);
+    return ESP_OK;
+}
+
+/**
+ * OTA
+ */
+esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp_ota_handle_t *out_handle)
+{
+    uint8_t *data = host_partition_data(partition);
+
+    if (!data || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (partition == esp_ota_get_running_partition()) {
+        return ESP_ERR_OTA_PARTITION_CONFLICT;
+    }
+
+    if (image_size != OTA_SIZE_UNKNOWN && image_size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    /**< The partition is erased, as the flash is */
+    memset(data, 0xff, image_size == OTA_SIZE_UNKNOWN ? partition->size : image_size);
+    g_ota_handle  = 1;
+    g_ota_written = 0;
+    *out_handle   = g_ota_handle;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (!handle || handle != g_ota_handle) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    ret = esp_partition_write(esp_ota_get_next_update_partition(NULL), g_ota_written, data, size);
+
+    if (ret == ESP_OK) {
+        g_ota_written += size;
+    }
+
+    return ret;
+}
+
+esp_err_t esp_ota_end(esp_ota_handle_t handle)
+{
+    if (!handle || handle != g_ota_handle) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    g_ota_handle = 0;
+
+    return g_ota_written ? ESP_OK : ESP_ERR_OTA_VALIDATE_FAILED;
+}
+
+esp_err_t esp_ota_abort(esp_ota_handle_t handle)
+{
+    if (!handle || handle != g_ota_handle) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    g_ota_handle = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition)
+{
+    if (!host_partition_data(partition)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    g_boot_partition = partition;
+    return ESP_OK;
+}
+
+const esp_partition_t *esp_ota_get_boot_partition(void)
+{
+    return g_boot_partition;
+}
+
+const esp_partition_t *esp_ota_get_running_partition(void)
+{
+    return g_partition;
+}
+
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start_from)
+{
+    return g_partition + 1;
+}
@@ -0,0 +1,351 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <malloc.h>
+#include <pthread.h>
+#include <sys/param.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_event.h"
+#include "esp32/rom/crc.h"
+#include "esp32/rom/ets_sys.h"
+#include "host_heap.h"
+
+#define HOST_HEAP_SIZE (256 * 1024) /**< Heap of the device, the free size is this minus the bytes allocated */
+
+esp_event_base_t const IP_EVENT   = "IP_EVENT";
+esp_event_base_t const MESH_EVENT = "MESH_EVENT";
+
+static esp_log_level_t g_log_level = ESP_LOG_VERBOSE;
+static vprintf_like_t g_log_vprintf = vprintf;
+
+/**
+ * Log
+ */
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    va_list args;
+
+    if (level > g_log_level) {
+        return;
+    }
+
+    va_start(args, format);
+    g_log_vprintf(format, args);
+    va_end(args);
+}
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
+{
+    vprintf_like_t orig = g_log_vprintf;
+
+    g_log_vprintf = func;
+
+    return orig;
+}
+
+/**
+ * @note Only the level of all tags, "*", is supported
+ */
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    if (!strcmp(tag, "*")) {
+        g_log_level = level;
+    }
+}
+
+int ets_printf(const char *fmt, ...)
+{
+    va_list args;
+    int ret = 0;
+
+    va_start(args, fmt);
+    ret = vprintf(fmt, args);
+    va_end(args);
+
+    return ret;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK:
+            return "ESP_OK";
+
+        case ESP_FAIL:
+            return "ESP_FAIL";
+
+        case ESP_ERR_NO_MEM:
+            return "ESP_ERR_NO_MEM";
+
+        case ESP_ERR_INVALID_ARG:
+            return "ESP_ERR_INVALID_ARG";
+
+        case ESP_ERR_INVALID_STATE:
+            return "ESP_ERR_INVALID_STATE";
+
+        case ESP_ERR_INVALID_SIZE:
+            return "ESP_ERR_INVALID_SIZE";
+
+        case ESP_ERR_NOT_FOUND:
+            return "ESP_ERR_NOT_FOUND";
+
+        case ESP_ERR_NOT_SUPPORTED:
+            return "ESP_ERR_NOT_SUPPORTED";
+
+        case ESP_ERR_TIMEOUT:
+            return "ESP_ERR_TIMEOUT";
+
+        default:
+            return "UNKNOWN ERROR";
+    }
+}
+
+/**
+ * ROM
+ */
+uint8_t crc8_le(uint8_t crc, uint8_t const *buf, uint32_t len)
+{
+    crc = ~crc;
+
+    while (len--) {
+        crc ^= *buf++;
+
+        for (int i = 0; i < 8; ++i) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0x8c : crc >> 1;
+        }
+    }
+
+    return ~crc;
+}
+
+/**
+ * System
+ */
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t esp_random(void)
+{
+    return (uint32_t)random() << 16 ^ (uint32_t)random();
+}
+
+/**
+ * Heap, malloc() and co. are wrapped by the linker to count the bytes allocated
+ */
+static volatile int64_t g_heap_used     = 0;
+static volatile int64_t g_heap_used_max = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static void host_heap_add(int64_t size)
+{
+    int64_t used     = __atomic_add_fetch(&g_heap_used, size, __ATOMIC_RELAXED);
+    int64_t used_max = __atomic_load_n(&g_heap_used_max, __ATOMIC_RELAXED);
+
+    while (used > used_max && !__atomic_compare_exchange_n(&g_heap_used_max, &used_max, used, true,
+            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void *__wrap_malloc(size_t size)
+{
+    void *ptr = __real_malloc(size);
+    host_heap_add(ptr ? malloc_usable_size(ptr) : 0);
+    return ptr;
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    void *ptr = __real_calloc(n, size);
+    host_heap_add(ptr ? malloc_usable_size(ptr) : 0);
+    return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    int64_t old_size = ptr ? malloc_usable_size(ptr) : 0;
+
+    ptr = __real_realloc(ptr, size);
+
+    /**< The old block is kept when the reallocation fails */
+    if (ptr || !size) {
+        host_heap_add((ptr ? (int64_t)malloc_usable_size(ptr) : 0) - old_size);
+    }
+
+    return ptr;
+}
+
+void __wrap_free(void *ptr)
+{
+    host_heap_add(ptr ? -(int64_t)malloc_usable_size(ptr) : 0);
+    __real_free(ptr);
+}
+
+size_t host_heap_get_used(void)
+{
+    return MAX(__atomic_load_n(&g_heap_used, __ATOMIC_RELAXED), 0);
+}
+
+void host_heap_reset_minimum(void)
+{
+    __atomic_store_n(&g_heap_used_max, __atomic_load_n(&g_heap_used, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return HOST_HEAP_SIZE - MIN(host_heap_get_used(), HOST_HEAP_SIZE);
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return HOST_HEAP_SIZE - MIN(MAX(g_heap_used_max, 0), HOST_HEAP_SIZE);
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    return calloc(n, size);
+}
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps)
+{
+    return realloc(ptr, size);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    return esp_get_free_heap_size();
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    return esp_get_minimum_free_heap_size();
+}
+
+/**
+ * Event, the handlers are called by the task posting the event
+ */
+#define HOST_EVENT_HANDLER_NUM (8)
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void *arg;
+} host_event_handler_t;
+
+static pthread_mutex_t g_event_mutex = PTHREAD_MUTEX_INITIALIZER;
+static host_event_handler_t g_event_handler[HOST_EVENT_HANDLER_NUM];
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id,
+                                     esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    esp_err_t ret                 = ESP_ERR_NO_MEM;
+    host_event_handler_t *handler = NULL;
+
+    pthread_mutex_lock(&g_event_mutex);
+
+    /**< A handler registered again for the same event only takes the new argument */
+    for (int i = 0; i < HOST_EVENT_HANDLER_NUM; ++i) {
+        host_event_handler_t *entry = g_event_handler + i;
+
+        if (entry->handler == event_handler && entry->base == event_base && entry->id == event_id) {
+            handler = entry;
+            break;
+        } else if (!entry->handler && !handler) {
+            handler = entry;
+        }
+    }
+
+    if (handler) {
+        handler->base    = event_base;
+        handler->id      = event_id;
+        handler->handler = event_handler;
+        handler->arg     = event_handler_arg;
+        ret              = ESP_OK;
+    }
+
+    pthread_mutex_unlock(&g_event_mutex);
+
+    return ret;
+}
+
+esp_err_t esp_event_handler_unregister(esp_event_base_t event_base, int32_t event_id,
+                                       esp_event_handler_t event_handler)
+{
+    pthread_mutex_lock(&g_event_mutex);
+
+    for (int i = 0; i < HOST_EVENT_HANDLER_NUM; ++i) {
+        host_event_handler_t *entry = g_event_handler + i;
+
+        if (entry->handler == event_handler && entry->base == event_base && entry->id == event_id) {
+            memset(entry, 0, sizeof(host_event_handler_t));
+        }
+    }
+
+    pthread_mutex_unlock(&g_event_mutex);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id,
+                         void *event_data, size_t event_data_size, TickType_t ticks_to_wait)
+{
+    host_event_handler_t handler[HOST_EVENT_HANDLER_NUM];
+    int handler_num = 0;
+
+    pthread_mutex_lock(&g_event_mutex);
+
+    for (int i = 0; i < HOST_EVENT_HANDLER_NUM; ++i) {
+        if (g_event_handler[i].handler && g_event_handler[i].base == event_base
+                && (g_event_handler[i].id == event_id || g_event_handler[i].id == ESP_EVENT_ANY_ID)) {
+            handler[handler_num++] = g_event_handler[i];
+        }
+    }
+
+    pthread_mutex_unlock(&g_event_mutex);
+
+    for (int i = 0; i < handler_num; ++i) {
+        handler[i].handler(handler[i].arg, event_base, event_id, event_data);
+    }
+
+    return ESP_OK;
+}
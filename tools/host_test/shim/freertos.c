@@ -0,0 +1,677 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include "esp_timer.h"
+
+struct SemaphoreDefinition {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    UBaseType_t count;
+    UBaseType_t max_count;
+    pthread_t holder;        /**< Task holding a recursive mutex */
+    UBaseType_t depth;       /**< Takes of the holder not given back yet */
+};
+
+struct QueueDefinition {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_send;
+    pthread_cond_t cond_recv;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    uint8_t *storage;
+};
+
+struct TimerDefinition {
+    const char *name;
+    TickType_t period;
+    bool auto_reload;
+    bool active;
+    bool deleted;
+    int64_t expiry_us;
+    void *id;
+    TimerCallbackFunction_t callback;
+    struct TimerDefinition *next;
+};
+
+typedef struct {
+    pthread_t thread;
+    TaskFunction_t func;
+    void *arg;
+    char name[16];
+} host_task_t;
+
+static pthread_mutex_t g_critical_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static volatile UBaseType_t g_task_num  = 1; /**< The main thread */
+static __thread host_task_t *g_current_task = NULL;
+
+static pthread_once_t g_timer_once      = PTHREAD_ONCE_INIT;
+static pthread_mutex_t g_timer_mutex    = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_timer_cond;
+static struct TimerDefinition *g_timer_list = NULL;
+
+static void host_cond_init(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static void host_deadline(int64_t time_us, struct timespec *deadline)
+{
+    deadline->tv_sec  = time_us / 1000000;
+    deadline->tv_nsec = (time_us % 1000000) * 1000;
+}
+
+/**
+ * @return false if the wait timed out, `mutex` is held in both cases
+ */
+static bool host_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex, int64_t deadline_us)
+{
+    struct timespec deadline;
+
+    if (deadline_us < 0) {
+        pthread_cond_wait(cond, mutex);
+        return true;
+    }
+
+    host_deadline(deadline_us, &deadline);
+    return pthread_cond_timedwait(cond, mutex, &deadline) != ETIMEDOUT;
+}
+
+/**
+ * @return -1 to wait forever
+ */
+static int64_t host_ticks_to_deadline(TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY) {
+        return -1;
+    }
+
+    return esp_timer_get_time() + (int64_t)ticks * portTICK_PERIOD_MS * 1000;
+}
+
+void vPortEnterCritical(portMUX_TYPE *mux)
+{
+    pthread_mutex_lock(&g_critical_mutex);
+}
+
+void vPortExitCritical(portMUX_TYPE *mux)
+{
+    pthread_mutex_unlock(&g_critical_mutex);
+}
+
+/**
+ * Task
+ */
+static void *host_task_entry(void *arg)
+{
+    host_task_t *task = (host_task_t *)arg;
+
+    g_current_task = task;
+    pthread_setname_np(pthread_self(), task->name);
+    task->func(task->arg);
+
+    /**< A task function must never return */
+    vTaskDelete(NULL);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char *pcName, uint32_t usStackDepth,
+                                   void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pvCreatedTask,
+                                   BaseType_t xCoreID)
+{
+    host_task_t *task = calloc(1, sizeof(host_task_t));
+
+    if (!task) {
+        return pdFAIL;
+    }
+
+    task->func = pvTaskCode;
+    task->arg  = pvParameters;
+    strncpy(task->name, pcName ? pcName : "", sizeof(task->name) - 1);
+
+    if (pvCreatedTask) {
+        *pvCreatedTask = task;
+    }
+
+    __atomic_add_fetch(&g_task_num, 1, __ATOMIC_RELAXED);
+
+    if (pthread_create(&task->thread, NULL, host_task_entry, task)) {
+        __atomic_sub_fetch(&g_task_num, 1, __ATOMIC_RELAXED);
+        free(task);
+        return pdFAIL;
+    }
+
+    pthread_detach(task->thread);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char *pcName, uint32_t usStackDepth,
+                       void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pvCreatedTask)
+{
+    return xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth, pvParameters,
+                                   uxPriority, pvCreatedTask, tskNO_AFFINITY);
+}
+
+/**
+ * @note Another task is cancelled at its next cancellation point, usually while it waits
+ */
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+    host_task_t *task = xTaskToDelete ? (host_task_t *)xTaskToDelete : g_current_task;
+
+    if (!task) {
+        return;
+    }
+
+    __atomic_sub_fetch(&g_task_num, 1, __ATOMIC_RELAXED);
+
+    if (task == g_current_task) {
+        free(task);
+        pthread_exit(NULL);
+    }
+
+    pthread_cancel(task->thread);
+}
+
+void vTaskDelay(TickType_t xTicksToDelay)
+{
+    int64_t delay_us   = (int64_t)xTicksToDelay * portTICK_PERIOD_MS * 1000;
+    struct timespec ts = {delay_us / 1000000, (delay_us % 1000000) * 1000};
+
+    while (nanosleep(&ts, &ts) && errno == EINTR);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS);
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void)
+{
+    return __atomic_load_n(&g_task_num, __ATOMIC_RELAXED);
+}
+
+char *pcTaskGetTaskName(TaskHandle_t xTaskToQuery)
+{
+    host_task_t *task = xTaskToQuery ? (host_task_t *)xTaskToQuery : g_current_task;
+
+    return task ? task->name : "main";
+}
+
+/**
+ * @note The stacks of the threads are far larger than the depth asked for, nothing is measured
+ */
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask)
+{
+    return 0;
+}
+
+/**
+ * Queue
+ */
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+    QueueHandle_t queue = calloc(1, sizeof(struct QueueDefinition));
+
+    if (!queue || !uxQueueLength) {
+        free(queue);
+        return NULL;
+    }
+
+    queue->storage = malloc(uxQueueLength * (uxItemSize ? uxItemSize : 1));
+
+    if (!queue->storage) {
+        free(queue);
+        return NULL;
+    }
+
+    queue->length    = uxQueueLength;
+    queue->item_size = uxItemSize;
+    pthread_mutex_init(&queue->mutex, NULL);
+    host_cond_init(&queue->cond_send);
+    host_cond_init(&queue->cond_recv);
+
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t xQueue)
+{
+    if (!xQueue) {
+        return;
+    }
+
+    pthread_mutex_destroy(&xQueue->mutex);
+    pthread_cond_destroy(&xQueue->cond_send);
+    pthread_cond_destroy(&xQueue->cond_recv);
+    free(xQueue->storage);
+    free(xQueue);
+}
+
+static BaseType_t host_queue_send(QueueHandle_t queue, const void *item, TickType_t ticks, bool to_front)
+{
+    int64_t deadline_us = host_ticks_to_deadline(ticks);
+    UBaseType_t index   = 0;
+
+    pthread_mutex_lock(&queue->mutex);
+
+    while (queue->count == queue->length) {
+        if (!ticks || !host_cond_wait(&queue->cond_send, &queue->mutex, deadline_us)) {
+            if (queue->count == queue->length) {
+                pthread_mutex_unlock(&queue->mutex);
+                return pdFAIL;
+            }
+        }
+    }
+
+    if (to_front) {
+        queue->head = (queue->head + queue->length - 1) % queue->length;
+        index       = queue->head;
+    } else {
+        index = (queue->head + queue->count) % queue->length;
+    }
+
+    memcpy(queue->storage + index * queue->item_size, item, queue->item_size);
+    queue->count++;
+    pthread_cond_signal(&queue->cond_recv);
+    pthread_mutex_unlock(&queue->mutex);
+
+    return pdPASS;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+    return host_queue_send(xQueue, pvItemToQueue, xTicksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+    return host_queue_send(xQueue, pvItemToQueue, xTicksToWait, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+    int64_t deadline_us = host_ticks_to_deadline(xTicksToWait);
+
+    pthread_mutex_lock(&xQueue->mutex);
+
+    while (!xQueue->count) {
+        if (!xTicksToWait || !host_cond_wait(&xQueue->cond_recv, &xQueue->mutex, deadline_us)) {
+            if (!xQueue->count) {
+                pthread_mutex_unlock(&xQueue->mutex);
+                return pdFAIL;
+            }
+        }
+    }
+
+    memcpy(pvBuffer, xQueue->storage + xQueue->head * xQueue->item_size, xQueue->item_size);
+    xQueue->head = (xQueue->head + 1) % xQueue->length;
+    xQueue->count--;
+    pthread_cond_signal(&xQueue->cond_send);
+    pthread_mutex_unlock(&xQueue->mutex);
+
+    return pdPASS;
+}
+
+BaseType_t xQueueReset(QueueHandle_t xQueue)
+{
+    pthread_mutex_lock(&xQueue->mutex);
+    xQueue->head  = 0;
+    xQueue->count = 0;
+    pthread_cond_broadcast(&xQueue->cond_send);
+    pthread_mutex_unlock(&xQueue->mutex);
+
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue)
+{
+    UBaseType_t count = 0;
+
+    pthread_mutex_lock(&xQueue->mutex);
+    count = xQueue->count;
+    pthread_mutex_unlock(&xQueue->mutex);
+
+    return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue)
+{
+    UBaseType_t spaces = 0;
+
+    pthread_mutex_lock(&xQueue->mutex);
+    spaces = xQueue->length - xQueue->count;
+    pthread_mutex_unlock(&xQueue->mutex);
+
+    return spaces;
+}
+
+/**
+ * Semaphore, a mutex is a binary semaphore without priority inheritance
+ */
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount)
+{
+    SemaphoreHandle_t semaphore = calloc(1, sizeof(struct SemaphoreDefinition));
+
+    if (!semaphore || !uxMaxCount || uxInitialCount > uxMaxCount) {
+        free(semaphore);
+        return NULL;
+    }
+
+    semaphore->count     = uxInitialCount;
+    semaphore->max_count = uxMaxCount;
+    pthread_mutex_init(&semaphore->mutex, NULL);
+    host_cond_init(&semaphore->cond);
+
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime)
+{
+    int64_t deadline_us = host_ticks_to_deadline(xBlockTime);
+
+    pthread_mutex_lock(&xSemaphore->mutex);
+
+    while (!xSemaphore->count) {
+        if (!xBlockTime || !host_cond_wait(&xSemaphore->cond, &xSemaphore->mutex, deadline_us)) {
+            if (!xSemaphore->count) {
+                pthread_mutex_unlock(&xSemaphore->mutex);
+                return pdFAIL;
+            }
+        }
+    }
+
+    xSemaphore->count--;
+    pthread_mutex_unlock(&xSemaphore->mutex);
+
+    return pdPASS;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore)
+{
+    BaseType_t ret = pdFAIL;
+
+    pthread_mutex_lock(&xSemaphore->mutex);
+
+    if (xSemaphore->count < xSemaphore->max_count) {
+        xSemaphore->count++;
+        pthread_cond_signal(&xSemaphore->cond);
+        ret = pdPASS;
+    }
+
+    pthread_mutex_unlock(&xSemaphore->mutex);
+
+    return ret;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t xMutex, TickType_t xBlockTime)
+{
+    pthread_mutex_lock(&xMutex->mutex);
+
+    if (xMutex->depth && pthread_equal(xMutex->holder, pthread_self())) {
+        xMutex->depth++;
+        pthread_mutex_unlock(&xMutex->mutex);
+        return pdPASS;
+    }
+
+    pthread_mutex_unlock(&xMutex->mutex);
+
+    if (xSemaphoreTake(xMutex, xBlockTime) != pdPASS) {
+        return pdFAIL;
+    }
+
+    pthread_mutex_lock(&xMutex->mutex);
+    xMutex->holder = pthread_self();
+    xMutex->depth  = 1;
+    pthread_mutex_unlock(&xMutex->mutex);
+
+    return pdPASS;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t xMutex)
+{
+    pthread_mutex_lock(&xMutex->mutex);
+
+    if (!xMutex->depth || !pthread_equal(xMutex->holder, pthread_self())) {
+        pthread_mutex_unlock(&xMutex->mutex);
+        return pdFAIL;
+    }
+
+    if (--xMutex->depth) {
+        pthread_mutex_unlock(&xMutex->mutex);
+        return pdPASS;
+    }
+
+    pthread_mutex_unlock(&xMutex->mutex);
+
+    return xSemaphoreGive(xMutex);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore)
+{
+    if (!xSemaphore) {
+        return;
+    }
+
+    pthread_mutex_destroy(&xSemaphore->mutex);
+    pthread_cond_destroy(&xSemaphore->cond);
+    free(xSemaphore);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t xSemaphore)
+{
+    UBaseType_t count = 0;
+
+    pthread_mutex_lock(&xSemaphore->mutex);
+    count = xSemaphore->count;
+    pthread_mutex_unlock(&xSemaphore->mutex);
+
+    return count;
+}
+
+/**
+ * Timer
+ */
+static void *host_timer_task(void *arg)
+{
+    pthread_mutex_lock(&g_timer_mutex);
+
+    for (;;) {
+        struct TimerDefinition **prev  = &g_timer_list;
+        struct TimerDefinition *expired = NULL;
+        int64_t deadline_us            = -1;
+        int64_t now_us                 = esp_timer_get_time();
+
+        /**< Free the deleted timers and find the first expired one */
+        while (*prev) {
+            struct TimerDefinition *timer = *prev;
+
+            if (timer->deleted) {
+                *prev = timer->next;
+                free(timer);
+                continue;
+            }
+
+            if (timer->active && timer->expiry_us <= now_us && !expired) {
+                expired = timer;
+            } else if (timer->active && (deadline_us < 0 || timer->expiry_us < deadline_us)) {
+                deadline_us = timer->expiry_us;
+            }
+
+            prev = &timer->next;
+        }
+
+        if (!expired) {
+            host_cond_wait(&g_timer_cond, &g_timer_mutex, deadline_us);
+            continue;
+        }
+
+        if (expired->auto_reload) {
+            expired->expiry_us += (int64_t)expired->period * portTICK_PERIOD_MS * 1000;
+        } else {
+            expired->active = false;
+        }
+
+        /**< The timer is only freed by this task, the callback may delete it */
+        pthread_mutex_unlock(&g_timer_mutex);
+        expired->callback(expired);
+        pthread_mutex_lock(&g_timer_mutex);
+    }
+
+    return NULL;
+}
+
+static void host_timer_init(void)
+{
+    pthread_t thread;
+
+    host_cond_init(&g_timer_cond);
+    pthread_create(&thread, NULL, host_timer_task, NULL);
+    pthread_detach(thread);
+}
+
+TimerHandle_t xTimerCreate(const char *pcTimerName, TickType_t xTimerPeriod, UBaseType_t uxAutoReload,
+                           void *pvTimerID, TimerCallbackFunction_t pxCallbackFunction)
+{
+    struct TimerDefinition *timer = NULL;
+
+    if (!xTimerPeriod || !pxCallbackFunction) {
+        return NULL;
+    }
+
+    pthread_once(&g_timer_once, host_timer_init);
+
+    timer = calloc(1, sizeof(struct TimerDefinition));
+
+    if (!timer) {
+        return NULL;
+    }
+
+    timer->name        = pcTimerName;
+    timer->period      = xTimerPeriod;
+    timer->auto_reload = uxAutoReload;
+    timer->id          = pvTimerID;
+    timer->callback    = pxCallbackFunction;
+
+    pthread_mutex_lock(&g_timer_mutex);
+    timer->next  = g_timer_list;
+    g_timer_list = timer;
+    pthread_mutex_unlock(&g_timer_mutex);
+
+    return timer;
+}
+
+BaseType_t xTimerStart(TimerHandle_t xTimer, TickType_t xTicksToWait)
+{
+    struct TimerDefinition *timer = xTimer;
+
+    pthread_mutex_lock(&g_timer_mutex);
+    timer->active    = true;
+    timer->expiry_us = esp_timer_get_time() + (int64_t)timer->period * portTICK_PERIOD_MS * 1000;
+    pthread_cond_signal(&g_timer_cond);
+    pthread_mutex_unlock(&g_timer_mutex);
+
+    return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t xTimer, TickType_t xTicksToWait)
+{
+    return xTimerStart(xTimer, xTicksToWait);
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t xTimer, TickType_t xNewPeriod, TickType_t xTicksToWait)
+{
+    struct TimerDefinition *timer = xTimer;
+
+    if (!xNewPeriod) {
+        return pdFAIL;
+    }
+
+    pthread_mutex_lock(&g_timer_mutex);
+    timer->period = xNewPeriod;
+    pthread_mutex_unlock(&g_timer_mutex);
+
+    return xTimerStart(xTimer, xTicksToWait);
+}
+
+BaseType_t xTimerStop(TimerHandle_t xTimer, TickType_t xTicksToWait)
+{
+    struct TimerDefinition *timer = xTimer;
+
+    pthread_mutex_lock(&g_timer_mutex);
+    timer->active = false;
+    pthread_mutex_unlock(&g_timer_mutex);
+
+    return pdPASS;
+}
+
+BaseType_t xTimerDelete(TimerHandle_t xTimer, TickType_t xTicksToWait)
+{
+    struct TimerDefinition *timer = xTimer;
+
+    pthread_mutex_lock(&g_timer_mutex);
+    timer->active  = false;
+    timer->deleted = true;
+    pthread_cond_signal(&g_timer_cond);
+    pthread_mutex_unlock(&g_timer_mutex);
+
+    return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t xTimer)
+{
+    struct TimerDefinition *timer = xTimer;
+
+    BaseType_t active = pdFALSE;
+
+    pthread_mutex_lock(&g_timer_mutex);
+    active = timer->active;
+    pthread_mutex_unlock(&g_timer_mutex);
+
+    return active;
+}
+
+void *pvTimerGetTimerID(TimerHandle_t xTimer)
+{
+    struct TimerDefinition *timer = xTimer;
+
+    return timer->id;
+}
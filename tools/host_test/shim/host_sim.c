@@ -0,0 +1,737 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/param.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "unity.h"
+#include "esp_timer.h"
+#include "host_sim.h"
+
+#define HOST_SIM_OPT_SIZE (32) /**< Bytes of the option kept with a frame, the header of mwifi */
+
+enum {
+    HOST_SIM_INBOX_SELF, /**< Read by esp_mesh_recv() */
+    HOST_SIM_INBOX_TODS, /**< Read by esp_mesh_recv_toDS() of the root */
+    HOST_SIM_INBOX_MAX,
+};
+
+typedef struct {
+    int64_t deliver_us;              /**< Time the frame arrives at the destination */
+    int next;                        /**< Next frame of the list, -1 for none */
+    int src;                         /**< Node which sent the frame */
+    uint8_t to[6];                   /**< Destination given to esp_mesh_send() */
+    int flag;
+    uint8_t tos;
+    uint8_t opt_type;
+    uint16_t opt_len;
+    uint8_t opt[HOST_SIM_OPT_SIZE];
+    uint16_t size;
+    uint8_t data[MESH_MPS];
+} host_sim_frame_t;
+
+typedef struct {
+    int head;                        /**< Frames sorted by their time of arrival */
+    int num;
+    pthread_cond_t cond;
+} host_sim_inbox_t;
+
+typedef struct {
+    int64_t busy_us;                 /**< Time the radio of the node is free */
+    bool started;
+    host_sim_inbox_t inbox[HOST_SIM_INBOX_MAX];
+} host_sim_state_t;
+
+/**
+ * @brief Mapped before the nodes are forked, the mutex and the conditions are shared by the processes
+ */
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_barrier_t barrier;
+    host_sim_config_t config;
+    uint64_t random;
+    int free_head;
+    int free_num;
+    host_sim_stats_t stats;
+    host_sim_state_t node[HOST_SIM_NODE_MAX];
+    host_sim_frame_t frame[HOST_SIM_FRAME_NUM];
+    uint8_t data[HOST_SIM_DATA_SIZE];
+} host_sim_shm_t;
+
+static host_sim_shm_t *g_sim = NULL;
+static int g_sim_node        = -1;
+
+/**
+ * Network
+ */
+void host_sim_tree(host_sim_config_t *config, int node_num, int fanout, const host_sim_link_t *link)
+{
+    memset(config, 0, sizeof(host_sim_config_t));
+
+    config->node_num      = MIN(node_num, HOST_SIM_NODE_MAX);
+    config->queue_size    = 32;
+    config->rx_queue_size = 64;
+    config->seed          = 1;
+
+    for (int i = 0; i < config->node_num; ++i) {
+        config->parent[i] = i ? (i - 1) / fanout : -1;
+        memcpy(config->link + i, link, sizeof(host_sim_link_t));
+    }
+}
+
+void host_sim_addr(int node, uint8_t addr[6])
+{
+    const uint8_t sta_addr[6] = {0x30, 0xae, 0xa4, 0x80, node >> 8, node & 0xff};
+
+    memcpy(addr, sta_addr, sizeof(sta_addr));
+}
+
+int host_sim_find(const uint8_t addr[6])
+{
+    int node = addr[4] << 8 | addr[5];
+
+    if (addr[0] != 0x30 || addr[1] != 0xae || addr[2] != 0xa4 || (addr[3] != 0x80 && addr[3] != 0x81)
+            || !g_sim || node >= g_sim->config.node_num) {
+        return -1;
+    }
+
+    return node;
+}
+
+int host_sim_node(void)
+{
+    return g_sim_node;
+}
+
+int host_sim_parent(int node)
+{
+    return g_sim->config.parent[node];
+}
+
+int host_sim_layer(int node)
+{
+    int layer = MESH_ROOT_LAYER;
+
+    for (; g_sim->config.parent[node] >= 0; node = g_sim->config.parent[node]) {
+        layer++;
+    }
+
+    return layer;
+}
+
+int host_sim_children(int node, int *children, int max_num)
+{
+    int num = 0;
+
+    for (int i = 0; i < g_sim->config.node_num; ++i) {
+        if (g_sim->config.parent[i] == node && num < max_num) {
+            children[num++] = i;
+        }
+    }
+
+    return num;
+}
+
+int host_sim_subnet(int node, int *nodes, int max_num)
+{
+    int num = 0;
+
+    for (int i = 0; i < g_sim->config.node_num; ++i) {
+        int ancestor = g_sim->config.parent[i];
+
+        while (ancestor >= 0 && ancestor != node) {
+            ancestor = g_sim->config.parent[ancestor];
+        }
+
+        if (ancestor == node && num < max_num) {
+            nodes[num++] = i;
+        }
+    }
+
+    return num;
+}
+
+void *host_sim_data(void)
+{
+    return g_sim ? g_sim->data : NULL;
+}
+
+void host_sim_barrier(void)
+{
+    pthread_barrier_wait(&g_sim->barrier);
+}
+
+void host_sim_get_stats(host_sim_stats_t *stats)
+{
+    memset(stats, 0, sizeof(host_sim_stats_t));
+
+    if (g_sim) {
+        pthread_mutex_lock(&g_sim->mutex);
+        memcpy(stats, &g_sim->stats, sizeof(host_sim_stats_t));
+        pthread_mutex_unlock(&g_sim->mutex);
+    }
+}
+
+/**
+ * Links, the mutex must be held
+ */
+static uint32_t host_sim_random(void)
+{
+    g_sim->random ^= g_sim->random << 13;
+    g_sim->random ^= g_sim->random >> 7;
+    g_sim->random ^= g_sim->random << 17;
+
+    return (uint32_t)(g_sim->random >> 32);
+}
+
+static const host_sim_link_t *host_sim_link(int node_a, int node_b)
+{
+    return g_sim->config.link + (g_sim->config.parent[node_b] == node_a ? node_b : node_a);
+}
+
+static int64_t host_sim_air_us(const host_sim_link_t *link, size_t size)
+{
+    return link->bandwidth ? (int64_t)(size + HOST_SIM_FRAME_HEAD) * 8 * 1000000 / link->bandwidth : 0;
+}
+
+/**
+ * @brief Frames waiting for the radio of a node to send them to another node
+ */
+static int host_sim_backlog(int node, int next, int64_t now_us)
+{
+    int64_t air_us = host_sim_air_us(host_sim_link(node, next), MESH_MPS);
+
+    return air_us && g_sim->node[node].busy_us > now_us ? (g_sim->node[node].busy_us - now_us) / air_us : 0;
+}
+
+/**
+ * @brief Send a frame over a link, the radios of both nodes are busy until it is received or dropped
+ *
+ * @param time_us Time the frame is ready to be sent as input, time it is received as output
+ */
+static bool host_sim_hop(int node_a, int node_b, size_t size, int64_t *time_us)
+{
+    const host_sim_link_t *link = host_sim_link(node_a, node_b);
+    int64_t air_us              = host_sim_air_us(link, size);
+    host_sim_state_t *state     = g_sim->node;
+
+    for (int i = 0; i <= HOST_SIM_RETRY_MAX; ++i) {
+        *time_us = MAX(*time_us, MAX(state[node_a].busy_us, state[node_b].busy_us)) + air_us;
+        state[node_a].busy_us = *time_us;
+        state[node_b].busy_us = *time_us;
+        g_sim->stats.attempts++;
+        g_sim->stats.air_us += air_us;
+
+        if (host_sim_random() % 100 >= link->loss) {
+            *time_us += link->latency_us;
+            g_sim->stats.hops++;
+            return true;
+        }
+    }
+
+    g_sim->stats.drops++;
+    return false;
+}
+
+/**
+ * @brief Nodes on the way from a node to another, both included
+ *
+ * @return Number of nodes
+ */
+static int host_sim_path(int src, int dest, int *path)
+{
+    int up[HOST_SIM_NODE_MAX];
+    int down[HOST_SIM_NODE_MAX];
+    int up_num   = 0;
+    int down_num = 0;
+
+    for (int node = src; node >= 0; node = g_sim->config.parent[node]) {
+        up[up_num++] = node;
+    }
+
+    for (int node = dest; node >= 0; node = g_sim->config.parent[node]) {
+        down[down_num++] = node;
+    }
+
+    /**< Drop the common ancestors but the nearest one */
+    while (up_num > 1 && down_num > 1 && up[up_num - 2] == down[down_num - 2]) {
+        up_num--;
+        down_num--;
+    }
+
+    memcpy(path, up, up_num * sizeof(int));
+
+    for (int i = down_num - 2; i >= 0; --i) {
+        path[up_num++] = down[i];
+    }
+
+    return up_num;
+}
+
+static void host_sim_inbox_put(int node, int inbox_index, int frame_index)
+{
+    host_sim_inbox_t *inbox = g_sim->node[node].inbox + inbox_index;
+    host_sim_frame_t *frame = g_sim->frame + frame_index;
+    int *prev               = &inbox->head;
+
+    while (*prev >= 0 && g_sim->frame[*prev].deliver_us <= frame->deliver_us) {
+        prev = &g_sim->frame[*prev].next;
+    }
+
+    frame->next = *prev;
+    *prev       = frame_index;
+    inbox->num++;
+    pthread_cond_broadcast(&inbox->cond);
+}
+
+static int host_sim_frame_alloc(int src, const mesh_addr_t *to, const mesh_data_t *data,
+                                int flag, const mesh_opt_t *opt)
+{
+    int index               = g_sim->free_head;
+    host_sim_frame_t *frame = g_sim->frame + index;
+
+    g_sim->free_head = frame->next;
+    g_sim->free_num--;
+
+    frame->src      = src;
+    frame->flag     = flag;
+    frame->tos      = data->tos;
+    frame->size     = data->size;
+    frame->opt_type = opt ? opt->type : 0;
+    frame->opt_len  = opt && opt->val ? MIN(opt->len, HOST_SIM_OPT_SIZE) : 0;
+    memcpy(frame->to, to ? to->addr : (uint8_t [6]) {0}, sizeof(frame->to));
+
+    if (frame->opt_len) {
+        memcpy(frame->opt, opt->val, frame->opt_len);
+    }
+
+    memcpy(frame->data, data->data, data->size);
+
+    return index;
+}
+
+static void host_sim_frame_free(int index)
+{
+    g_sim->frame[index].next = g_sim->free_head;
+    g_sim->free_head         = index;
+    g_sim->free_num++;
+}
+
+/**
+ * @brief A frame to all the nodes is flooded along the tree, each link carries it once
+ */
+static esp_err_t host_sim_flood(int src, const mesh_addr_t *to, const mesh_data_t *data,
+                                int flag, const mesh_opt_t *opt, int64_t now_us)
+{
+    int queue[HOST_SIM_NODE_MAX];
+    int from[HOST_SIM_NODE_MAX];
+    int64_t arrive_us[HOST_SIM_NODE_MAX];
+    int head = 0;
+    int tail = 0;
+
+    if (g_sim->free_num < g_sim->config.node_num - 1) {
+        return ESP_ERR_MESH_NO_MEMORY;
+    }
+
+    if (g_sim->config.parent[src] >= 0
+            && host_sim_backlog(src, g_sim->config.parent[src], now_us) >= g_sim->config.queue_size) {
+        return ESP_ERR_MESH_QUEUE_FULL;
+    }
+
+    queue[tail++] = src;
+    from[src]     = -1;
+    arrive_us[src] = now_us;
+
+    while (head < tail) {
+        int node = queue[head++];
+
+        for (int next = 0; next < g_sim->config.node_num; ++next) {
+            if ((g_sim->config.parent[next] != node && g_sim->config.parent[node] != next) || next == from[node]) {
+                continue;
+            }
+
+            from[next]      = node;
+            arrive_us[next] = arrive_us[node];
+
+            if (!host_sim_hop(node, next, data->size, arrive_us + next)) {
+                continue;
+            }
+
+            int index = host_sim_frame_alloc(src, to, data, flag, opt);
+            g_sim->frame[index].deliver_us = arrive_us[next];
+            host_sim_inbox_put(next, HOST_SIM_INBOX_SELF, index);
+            queue[tail++] = next;
+        }
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * ESP-MESH
+ */
+esp_err_t host_sim_send(const mesh_addr_t *to, const mesh_data_t *data, int flag, const mesh_opt_t *opt)
+{
+    const uint8_t broadcast_addr[6] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+    const uint8_t empty_addr[6]     = {0};
+    esp_err_t ret                   = ESP_OK;
+    int src                         = g_sim_node;
+    int dest                        = 0;
+    int inbox                       = HOST_SIM_INBOX_SELF;
+    int path[HOST_SIM_NODE_MAX * 2];
+    int path_num                    = 0;
+
+    if (!data || !data->data || data->size > MESH_MPS) {
+        return ESP_ERR_MESH_ARGUMENT;
+    }
+
+    if (flag & MESH_DATA_GROUP) {
+        return ESP_ERR_MESH_NOT_SUPPORT;
+    }
+
+    /**< To the external IP network, to the root, or to a node */
+    if (flag & MESH_DATA_TODS) {
+        inbox = HOST_SIM_INBOX_TODS;
+    } else if (to && memcmp(to->addr, empty_addr, sizeof(empty_addr))
+               && memcmp(to->addr, broadcast_addr, sizeof(broadcast_addr))) {
+        dest = host_sim_find(to->addr);
+    }
+
+    if (dest < 0) {
+        return ESP_ERR_MESH_NO_ROUTE_FOUND;
+    }
+
+    pthread_mutex_lock(&g_sim->mutex);
+
+    for (;;) {
+        int64_t now_us = esp_timer_get_time();
+
+        if (!g_sim->node[src].started) {
+            ret = ESP_ERR_MESH_NOT_START;
+        } else if (to && !memcmp(to->addr, broadcast_addr, sizeof(broadcast_addr)) && !(flag & MESH_DATA_TODS)) {
+            ret = host_sim_flood(src, to, data, flag, opt, now_us);
+        } else if (!g_sim->free_num) {
+            ret = ESP_ERR_MESH_NO_MEMORY;
+        } else {
+            path_num = host_sim_path(src, dest, path);
+            ret      = g_sim->node[dest].inbox[inbox].num >= g_sim->config.rx_queue_size ? ESP_ERR_MESH_QUEUE_FULL : ESP_OK;
+
+            for (int i = 0; i < path_num - 1 && ret == ESP_OK; ++i) {
+                if (host_sim_backlog(path[i], path[i + 1], now_us) >= g_sim->config.queue_size) {
+                    ret = ESP_ERR_MESH_QUEUE_FULL;
+                }
+            }
+
+            if (ret == ESP_OK) {
+                int64_t time_us = now_us;
+                bool delivered  = true;
+
+                for (int i = 0; i < path_num - 1 && delivered; ++i) {
+                    delivered = host_sim_hop(path[i], path[i + 1], data->size, &time_us);
+                }
+
+                if (delivered) {
+                    int index = host_sim_frame_alloc(src, to, data, flag, opt);
+                    g_sim->frame[index].deliver_us = time_us;
+                    host_sim_inbox_put(dest, inbox, index);
+                }
+            }
+        }
+
+        /**< A blocking call waits for room in the queues */
+        if ((ret != ESP_ERR_MESH_QUEUE_FULL && ret != ESP_ERR_MESH_NO_MEMORY) || (flag & MESH_DATA_NONBLOCK)) {
+            break;
+        }
+
+        pthread_mutex_unlock(&g_sim->mutex);
+        usleep(1000);
+        pthread_mutex_lock(&g_sim->mutex);
+    }
+
+    if (ret == ESP_OK) {
+        g_sim->stats.frames++;
+    } else if (ret == ESP_ERR_MESH_QUEUE_FULL || ret == ESP_ERR_MESH_NO_MEMORY) {
+        g_sim->stats.rejected++;
+    }
+
+    pthread_mutex_unlock(&g_sim->mutex);
+
+    return ret;
+}
+
+static bool host_sim_cond_wait(pthread_cond_t *cond, int64_t deadline_us)
+{
+    struct timespec deadline;
+
+    if (deadline_us < 0) {
+        return !pthread_cond_wait(cond, &g_sim->mutex);
+    }
+
+    deadline.tv_sec  = deadline_us / 1000000;
+    deadline.tv_nsec = (deadline_us % 1000000) * 1000;
+
+    return pthread_cond_timedwait(cond, &g_sim->mutex, &deadline) != ETIMEDOUT;
+}
+
+esp_err_t host_sim_recv(bool toDS, mesh_addr_t *from, mesh_addr_t *to, mesh_data_t *data,
+                        int timeout_ms, int *flag, mesh_opt_t *opt)
+{
+    host_sim_state_t *state = g_sim->node + g_sim_node;
+    host_sim_inbox_t *inbox = state->inbox + (toDS ? HOST_SIM_INBOX_TODS : HOST_SIM_INBOX_SELF);
+    int64_t deadline_us     = timeout_ms < 0 ? -1 : esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    host_sim_frame_t *frame = NULL;
+    int index               = -1;
+
+    pthread_mutex_lock(&g_sim->mutex);
+
+    for (;;) {
+        int64_t now_us  = esp_timer_get_time();
+        int64_t wait_us = deadline_us;
+
+        if (!state->started) {
+            pthread_mutex_unlock(&g_sim->mutex);
+            return ESP_ERR_MESH_NOT_START;
+        }
+
+        if (inbox->head >= 0) {
+            if (g_sim->frame[inbox->head].deliver_us <= now_us) {
+                break;
+            }
+
+            wait_us = deadline_us < 0 ? g_sim->frame[inbox->head].deliver_us
+                      : MIN(deadline_us, g_sim->frame[inbox->head].deliver_us);
+        }
+
+        if (deadline_us >= 0 && now_us >= deadline_us) {
+            pthread_mutex_unlock(&g_sim->mutex);
+            return ESP_ERR_MESH_TIMEOUT;
+        }
+
+        host_sim_cond_wait(&inbox->cond, wait_us);
+    }
+
+    index       = inbox->head;
+    frame       = g_sim->frame + index;
+    inbox->head = frame->next;
+    inbox->num--;
+
+    if (from) {
+        host_sim_addr(frame->src, from->addr);
+    }
+
+    if (to) {
+        memcpy(to->addr, frame->to, sizeof(to->addr));
+    }
+
+    if (flag) {
+        *flag = frame->flag;
+    }
+
+    if (opt && opt->val) {
+        memcpy(opt->val, frame->opt, MIN(opt->len, frame->opt_len));
+        opt->type = frame->opt_type;
+    }
+
+    data->size = MIN(data->size, frame->size);
+    data->tos  = frame->tos;
+    memcpy(data->data, frame->data, data->size);
+
+    host_sim_frame_free(index);
+    pthread_mutex_unlock(&g_sim->mutex);
+
+    return ESP_OK;
+}
+
+void host_sim_set_started(bool started)
+{
+    pthread_mutex_lock(&g_sim->mutex);
+    g_sim->node[g_sim_node].started = started;
+    pthread_mutex_unlock(&g_sim->mutex);
+}
+
+bool host_sim_is_started(void)
+{
+    return g_sim->node[g_sim_node].started;
+}
+
+/**
+ * @brief The frames waiting for the radio of this node, counted on its link to the parent
+ *        or, on the root, to its first child, and the frames not read
+ */
+void host_sim_get_pending(mesh_tx_pending_t *tx_pending, mesh_rx_pending_t *rx_pending)
+{
+    int node = g_sim_node;
+    int next = g_sim->config.parent[node];
+
+    memset(tx_pending, 0, sizeof(mesh_tx_pending_t));
+    memset(rx_pending, 0, sizeof(mesh_rx_pending_t));
+
+    pthread_mutex_lock(&g_sim->mutex);
+
+    if (next >= 0) {
+        tx_pending->to_parent = host_sim_backlog(node, next, esp_timer_get_time());
+    } else if (host_sim_children(node, &next, 1)) {
+        tx_pending->to_child = host_sim_backlog(node, next, esp_timer_get_time());
+    }
+
+    rx_pending->toSelf = g_sim->node[node].inbox[HOST_SIM_INBOX_SELF].num;
+    rx_pending->toDS   = g_sim->node[node].inbox[HOST_SIM_INBOX_TODS].num;
+
+    pthread_mutex_unlock(&g_sim->mutex);
+}
+
+/**
+ * Processes
+ */
+static void host_sim_init(const host_sim_config_t *config)
+{
+    pthread_mutexattr_t mutex_attr;
+    pthread_condattr_t cond_attr;
+    pthread_barrierattr_t barrier_attr;
+
+    if (!g_sim) {
+        g_sim = mmap(NULL, sizeof(host_sim_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        assert(g_sim != MAP_FAILED);
+    } else {
+        pthread_barrier_destroy(&g_sim->barrier);
+    }
+
+    memset(g_sim, 0, sizeof(host_sim_shm_t));
+    memcpy(&g_sim->config, config, sizeof(host_sim_config_t));
+    g_sim->random = config->seed * 0x9e3779b97f4a7c15ULL + 1;
+
+    pthread_mutexattr_init(&mutex_attr);
+    pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&g_sim->mutex, &mutex_attr);
+    pthread_mutexattr_destroy(&mutex_attr);
+
+    pthread_barrierattr_init(&barrier_attr);
+    pthread_barrierattr_setpshared(&barrier_attr, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_init(&g_sim->barrier, &barrier_attr, config->node_num);
+    pthread_barrierattr_destroy(&barrier_attr);
+
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+
+    for (int i = 0; i < config->node_num; ++i) {
+        for (int j = 0; j < HOST_SIM_INBOX_MAX; ++j) {
+            g_sim->node[i].inbox[j].head = -1;
+            pthread_cond_init(&g_sim->node[i].inbox[j].cond, &cond_attr);
+        }
+    }
+
+    pthread_condattr_destroy(&cond_attr);
+
+    for (int i = 0; i < HOST_SIM_FRAME_NUM; ++i) {
+        g_sim->frame[i].next = i + 1 < HOST_SIM_FRAME_NUM ? i + 1 : -1;
+    }
+
+    g_sim->free_num = HOST_SIM_FRAME_NUM;
+}
+
+/**
+ * @brief The process of a node, a failed assertion jumps back here
+ */
+static void host_sim_node_run(int node, const host_sim_config_t *config, host_sim_main_t node_main, void *arg)
+{
+    g_sim_node = node;
+    srandom(config->seed * HOST_SIM_NODE_MAX + node);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    if (TEST_PROTECT()) {
+        node_main(node, arg);
+    }
+
+    fflush(stdout);
+    _exit(Unity.CurrentTestFailed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+esp_err_t host_sim_run(const host_sim_config_t *config, host_sim_main_t node_main, void *arg, int timeout_ms)
+{
+    pid_t pid[HOST_SIM_NODE_MAX] = {0};
+    esp_err_t ret                = ESP_OK;
+    int64_t deadline_us          = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    int running                  = 0;
+
+    if (!config || config->node_num <= 0 || config->node_num > HOST_SIM_NODE_MAX || !node_main) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    host_sim_init(config);
+    fflush(stdout);
+    fflush(stderr);
+
+    for (int i = 0; i < config->node_num; ++i, ++running) {
+        pid[i] = fork();
+
+        if (pid[i] == 0) {
+            host_sim_node_run(i, config, node_main, arg);
+        }
+
+        if (pid[i] < 0) {
+            printf("host_sim: fork node %d: %s\n", i, strerror(errno));
+            ret = ESP_FAIL;
+            break;
+        }
+    }
+
+    while (running > 0) {
+        int status = 0;
+        pid_t done = waitpid(-1, &status, WNOHANG);
+
+        if (done <= 0 && ret == ESP_OK && esp_timer_get_time() < deadline_us) {
+            usleep(10 * 1000);
+            continue;
+        }
+
+        /**< Kill the remaining nodes, they could wait for the failed one forever */
+        if (done <= 0) {
+            ret = (ret == ESP_OK) ? ESP_ERR_TIMEOUT : ret;
+
+            for (int i = 0; i < config->node_num; ++i) {
+                if (pid[i] > 0) {
+                    kill(pid[i], SIGKILL);
+                    pid[i] = -pid[i];
+                }
+            }
+
+            done = waitpid(-1, &status, 0);
+        }
+
+        for (int i = 0; i < config->node_num; ++i) {
+            if (pid[i] == done && (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)) {
+                printf("host_sim: node %d failed, status: 0x%x\n", i, status);
+                ret = ESP_FAIL;
+            } else if (pid[i] == -done && ret == ESP_ERR_TIMEOUT) {
+                printf("host_sim: node %d is killed after %d ms\n", i, timeout_ms);
+            }
+        }
+
+        running--;
+    }
+
+    return ret;
+}
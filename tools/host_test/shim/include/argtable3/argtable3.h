@@ -0,0 +1,103 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef __ARGTABLE3_H__
+#define __ARGTABLE3_H__
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /**< _cplusplus */
+
+/**
+ * @brief The subset of argtable3 used by the console commands: options with a short
+ *        and a long name, literals, integers and strings. An argument without names
+ *        takes the positional values.
+ */
+#define ARG_TERMINATOR 0x1 /**< Flag of the arg_end of a table */
+#define ARG_HASVALUE   0x2 /**< Flag of the options followed by a value */
+
+typedef enum {
+    ARG_TYPE_LIT,
+    ARG_TYPE_INT,
+    ARG_TYPE_STR,
+    ARG_TYPE_END,
+} arg_type_t;
+
+struct arg_hdr {
+    char flag;
+    const char *shortopts;
+    const char *longopts;
+    const char *datatype;
+    const char *glossary;
+    int mincount;
+    int maxcount;
+    arg_type_t type;
+};
+
+struct arg_lit {
+    struct arg_hdr hdr;
+    int count;
+};
+
+struct arg_int {
+    struct arg_hdr hdr;
+    int count;
+    int *ival;
+};
+
+struct arg_str {
+    struct arg_hdr hdr;
+    int count;
+    const char **sval;
+};
+
+struct arg_end {
+    struct arg_hdr hdr;
+    int count;            /**< Errors of the last arg_parse() */
+    int *error;           /**< Kind of each error, see arg_print_errors() */
+    void **parent;        /**< Argument of each error, NULL if it is unknown */
+    const char **argval;  /**< Value of each error */
+};
+
+struct arg_lit *arg_lit0(const char *shortopts, const char *longopts, const char *glossary);
+struct arg_lit *arg_lit1(const char *shortopts, const char *longopts, const char *glossary);
+struct arg_lit *arg_litn(const char *shortopts, const char *longopts, int mincount, int maxcount,
+                         const char *glossary);
+struct arg_int *arg_int0(const char *shortopts, const char *longopts, const char *datatype, const char *glossary);
+struct arg_int *arg_int1(const char *shortopts, const char *longopts, const char *datatype, const char *glossary);
+struct arg_int *arg_intn(const char *shortopts, const char *longopts, const char *datatype,
+                         int mincount, int maxcount, const char *glossary);
+struct arg_str *arg_str0(const char *shortopts, const char *longopts, const char *datatype, const char *glossary);
+struct arg_str *arg_str1(const char *shortopts, const char *longopts, const char *datatype, const char *glossary);
+struct arg_str *arg_strn(const char *shortopts, const char *longopts, const char *datatype,
+                         int mincount, int maxcount, const char *glossary);
+struct arg_end *arg_end(int maxerrors);
+
+/**
+ * @brief  Parse the arguments into a table of arguments ended by arg_end()
+ *
+ * @return Number of errors, they are kept in the arg_end of the table
+ */
+int arg_parse(int argc, char **argv, void **argtable);
+void arg_print_errors(FILE *fp, struct arg_end *end, const char *progname);
+void arg_freetable(void **argtable, size_t n);
+
+#ifdef __cplusplus
+}
+#endif /**< _cplusplus */
+
+#endif /**< __ARGTABLE3_H__ */
@@ -0,0 +1,25 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __ESP32_ROM_CRC_H__
+#define __ESP32_ROM_CRC_H__
+
+#include <stdint.h>
+
+/**
+ * @brief CRC-8 of the ROM, the same function on both ends is all the shims need
+ */
+uint8_t crc8_le(uint8_t crc, uint8_t const *buf, uint32_t len);
+
+#endif /**< __ESP32_ROM_CRC_H__ */
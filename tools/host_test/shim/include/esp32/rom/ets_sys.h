@@ -0,0 +1,20 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __ESP32_ROM_ETS_SYS_H__
+#define __ESP32_ROM_ETS_SYS_H__
+
+int ets_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+#endif /**< __ESP32_ROM_ETS_SYS_H__ */
@@ -0,0 +1,67 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef __ESP_CONSOLE_H__
+#define __ESP_CONSOLE_H__
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /**< _cplusplus */
+
+/**
+ * @brief The commands are only run by esp_console_run(), there is no REPL on the host
+ */
+#define HOST_CONSOLE_CMD_NUM  (32) /**< Commands that can be registered */
+#define HOST_CONSOLE_ARGV_NUM (32) /**< Arguments of a command line */
+
+typedef int (*esp_console_cmd_func_t)(int argc, char **argv);
+
+typedef struct {
+    const char *command;          /**< Name of the command, without spaces */
+    const char *help;
+    const char *hint;
+    esp_console_cmd_func_t func;
+    void *argtable;               /**< Table of argtable3, only for the help */
+} esp_console_cmd_t;
+
+/**
+ * @brief  Register a command, a command registered again replaces the previous one
+ */
+esp_err_t esp_console_cmd_register(const esp_console_cmd_t *cmd);
+
+/**
+ * @brief  Split a command line into arguments, with the quotes and escapes of ESP-IDF
+ *
+ * @return Number of arguments
+ */
+size_t esp_console_split_argv(char *line, char **argv, size_t argv_size);
+
+/**
+ * @brief  Run a command line
+ *
+ * @return
+ *    - ESP_OK: The command ran, its return value is in cmd_ret
+ *    - ESP_ERR_INVALID_ARG: The command line is empty
+ *    - ESP_ERR_NOT_FOUND: No command of this name is registered
+ */
+esp_err_t esp_console_run(const char *cmdline, int *cmd_ret);
+
+#ifdef __cplusplus
+}
+#endif /**< _cplusplus */
+
+#endif /**< __ESP_CONSOLE_H__ */
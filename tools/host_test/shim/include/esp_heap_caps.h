@@ -0,0 +1,35 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __ESP_HEAP_CAPS_H__
+#define __ESP_HEAP_CAPS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MALLOC_CAP_DEFAULT   (1 << 12)
+#define MALLOC_CAP_INTERNAL  (1 << 11)
+#define MALLOC_CAP_SPIRAM    (1 << 10)
+#define MALLOC_CAP_8BIT      (1 << 2)
+
+/**
+ * @brief The capabilities are ignored, the memory is allocated with the C library
+ */
+void *heap_caps_malloc(size_t size, uint32_t caps);
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps);
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+
+#endif /**< __ESP_HEAP_CAPS_H__ */
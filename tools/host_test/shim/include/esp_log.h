@@ -0,0 +1,61 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __ESP_LOG_H__
+#define __ESP_LOG_H__
+
+#include <stdint.h>
+#include <stdarg.h>
+#include "sdkconfig.h"
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+/**< No colors, as ESP-IDF without CONFIG_LOG_COLORS */
+#define LOG_COLOR_E     ""
+#define LOG_COLOR_W     ""
+#define LOG_COLOR_I     ""
+#define LOG_COLOR_D     ""
+#define LOG_COLOR_V     ""
+#define LOG_RESET_COLOR ""
+
+typedef int (*vprintf_like_t)(const char *, va_list);
+
+/**
+ * @brief  Set the function writing the logs, vprintf() by default
+ *
+ * @return The function set before
+ */
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func);
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+uint32_t esp_log_timestamp(void);
+
+#define ESP_LOGE(tag, format, ...) esp_log_write(ESP_LOG_ERROR, tag, format "\n", ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) esp_log_write(ESP_LOG_WARN, tag, format "\n", ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) esp_log_write(ESP_LOG_INFO, tag, format "\n", ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) esp_log_write(ESP_LOG_DEBUG, tag, format "\n", ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) esp_log_write(ESP_LOG_VERBOSE, tag, format "\n", ##__VA_ARGS__)
+
+/**< The buffers are not dumped, they are binary more often than not */
+#define ESP_LOG_BUFFER_CHAR_LEVEL(tag, buffer, buff_len, level) \
+    do { (void)(tag); (void)(buffer); (void)(buff_len); (void)(level); } while (0)
+
+#endif /**< __ESP_LOG_H__ */
@@ -0,0 +1,292 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __ESP_MESH_H__
+#define __ESP_MESH_H__
+
+#include "esp_err.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+
+/**
+ * @brief Declarations of the ESP-MESH API used by mwifi, the values of the constants are
+ *        those of ESP-IDF. Only `esp_mesh_send()` and the subnets are simulated, see
+ *        `host_mesh.h`, the other functions succeed without doing anything. In the nodes
+ *        of a simulated network the data and the topology come from `host_sim.h`.
+ */
+
+#define ESP_ERR_MESH_BASE              0x4000
+#define ESP_ERR_MESH_WIFI_NOT_START    (ESP_ERR_MESH_BASE + 1)
+#define ESP_ERR_MESH_NOT_INIT          (ESP_ERR_MESH_BASE + 2)
+#define ESP_ERR_MESH_NOT_CONFIG        (ESP_ERR_MESH_BASE + 3)
+#define ESP_ERR_MESH_NOT_START         (ESP_ERR_MESH_BASE + 4)
+#define ESP_ERR_MESH_NOT_SUPPORT       (ESP_ERR_MESH_BASE + 5)
+#define ESP_ERR_MESH_NOT_ALLOWED       (ESP_ERR_MESH_BASE + 6)
+#define ESP_ERR_MESH_NO_MEMORY         (ESP_ERR_MESH_BASE + 7)
+#define ESP_ERR_MESH_ARGUMENT          (ESP_ERR_MESH_BASE + 8)
+#define ESP_ERR_MESH_EXCEED_MTU        (ESP_ERR_MESH_BASE + 9)
+#define ESP_ERR_MESH_TIMEOUT           (ESP_ERR_MESH_BASE + 10)
+#define ESP_ERR_MESH_DISCONNECTED      (ESP_ERR_MESH_BASE + 11)
+#define ESP_ERR_MESH_QUEUE_FAIL        (ESP_ERR_MESH_BASE + 12)
+#define ESP_ERR_MESH_QUEUE_FULL        (ESP_ERR_MESH_BASE + 13)
+#define ESP_ERR_MESH_NO_PARENT_FOUND   (ESP_ERR_MESH_BASE + 14)
+#define ESP_ERR_MESH_NO_ROUTE_FOUND    (ESP_ERR_MESH_BASE + 15)
+#define ESP_ERR_MESH_OPTION_NULL       (ESP_ERR_MESH_BASE + 16)
+#define ESP_ERR_MESH_OPTION_UNKNOWN    (ESP_ERR_MESH_BASE + 17)
+#define ESP_ERR_MESH_XON_NO_WINDOW     (ESP_ERR_MESH_BASE + 18)
+#define ESP_ERR_MESH_INTERFACE         (ESP_ERR_MESH_BASE + 19)
+#define ESP_ERR_MESH_DISCARD_DUPLICATE (ESP_ERR_MESH_BASE + 20)
+#define ESP_ERR_MESH_DISCARD           (ESP_ERR_MESH_BASE + 21)
+#define ESP_ERR_MESH_VOTING            (ESP_ERR_MESH_BASE + 22)
+#define ESP_ERR_MESH_XMIT              (ESP_ERR_MESH_BASE + 23)
+#define ESP_ERR_MESH_QUEUE_READ        (ESP_ERR_MESH_BASE + 24)
+#define ESP_ERR_MESH_PS                (ESP_ERR_MESH_BASE + 25)
+#define ESP_ERR_MESH_RECV_RELEASE      (ESP_ERR_MESH_BASE + 26)
+#define ESP_ERR_MESH_OPT_UNKNOWN       ESP_ERR_MESH_OPTION_UNKNOWN
+
+#define MESH_ROOT_LAYER       (1)
+#define MESH_MTU              (1500)
+#define MESH_MPS              (1472)
+
+#define MESH_DATA_ENC         (0x01)
+#define MESH_DATA_P2P         (0x02)
+#define MESH_DATA_FROMDS      (0x04)
+#define MESH_DATA_TODS        (0x08)
+#define MESH_DATA_NONBLOCK    (0x10)
+#define MESH_DATA_DROP        (0x20)
+#define MESH_DATA_GROUP       (0x40)
+
+#define MESH_OPT_SEND_GROUP   (7)
+#define MESH_OPT_RECV_DS_ADDR (8)
+
+#define MESH_PS_DEVICE_DUTY_REQUEST          (0x01)
+#define MESH_PS_DEVICE_DUTY_DEMAND           (0x04)
+#define MESH_PS_NETWORK_DUTY_APPLIED_ENTIRE  (0)
+#define MESH_PS_NETWORK_DUTY_APPLIED_UPLINK  (1)
+
+typedef enum {
+    MESH_EVENT_STARTED,
+    MESH_EVENT_STOPPED,
+    MESH_EVENT_CHANNEL_SWITCH,
+    MESH_EVENT_CHILD_CONNECTED,
+    MESH_EVENT_CHILD_DISCONNECTED,
+    MESH_EVENT_ROUTING_TABLE_ADD,
+    MESH_EVENT_ROUTING_TABLE_REMOVE,
+    MESH_EVENT_PARENT_CONNECTED,
+    MESH_EVENT_PARENT_DISCONNECTED,
+    MESH_EVENT_NO_PARENT_FOUND,
+    MESH_EVENT_LAYER_CHANGE,
+    MESH_EVENT_TODS_STATE,
+    MESH_EVENT_VOTE_STARTED,
+    MESH_EVENT_VOTE_STOPPED,
+    MESH_EVENT_ROOT_ADDRESS,
+    MESH_EVENT_ROOT_SWITCH_REQ,
+    MESH_EVENT_ROOT_SWITCH_ACK,
+    MESH_EVENT_ROOT_ASKED_YIELD,
+    MESH_EVENT_ROOT_FIXED,
+    MESH_EVENT_SCAN_DONE,
+    MESH_EVENT_NETWORK_STATE,
+    MESH_EVENT_STOP_RECONNECTION,
+    MESH_EVENT_FIND_NETWORK,
+    MESH_EVENT_ROUTER_SWITCH,
+    MESH_EVENT_PS_PARENT_DUTY,
+    MESH_EVENT_PS_CHILD_DUTY,
+    MESH_EVENT_PS_DEVICE_DUTY,
+    MESH_EVENT_MAX,
+} mesh_event_id_t;
+
+typedef enum {
+    MESH_IDLE,
+    MESH_ROOT,
+    MESH_NODE,
+    MESH_LEAF,
+    MESH_STA,
+} mesh_type_t;
+
+typedef enum {
+    MESH_PROTO_BIN,
+    MESH_PROTO_HTTP,
+    MESH_PROTO_JSON,
+    MESH_PROTO_MQTT,
+    MESH_PROTO_AP,
+    MESH_PROTO_STA,
+} mesh_proto_t;
+
+typedef enum {
+    MESH_TOS_P2P,
+    MESH_TOS_E2E,
+    MESH_TOS_DEF,
+} mesh_tos_t;
+
+typedef enum {
+    MESH_VOTE_REASON_ROOT_INITIATED = 1,
+    MESH_VOTE_REASON_CHILD_INITIATED,
+} mesh_vote_reason_t;
+
+typedef enum {
+    MESH_TOPO_TREE,
+    MESH_TOPO_CHAIN,
+} esp_mesh_topology_t;
+
+typedef enum {
+    MESH_TODS_UNREACHABLE,
+    MESH_TODS_REACHABLE,
+} mesh_event_toDS_state_t;
+
+typedef union {
+    uint8_t addr[6];
+    struct {
+        uint32_t ip4;
+        uint16_t port;
+    } __attribute__((packed)) mip;
+} mesh_addr_t;
+
+typedef struct {
+    uint8_t *data;
+    uint16_t size;
+    mesh_proto_t proto;
+    mesh_tos_t tos;
+} mesh_data_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t *val;
+    uint16_t len;
+} __attribute__((packed)) mesh_opt_t;
+
+typedef struct {
+    int reason;
+} mesh_event_disconnected_t;
+
+typedef struct {
+    uint8_t mac[6];
+    uint8_t aid;
+} mesh_event_child_connected_t;
+
+typedef mesh_event_child_connected_t mesh_event_child_disconnected_t;
+
+typedef struct {
+    uint16_t rt_size_new;
+    uint16_t rt_size_change;
+} mesh_event_routing_table_change_t;
+
+typedef struct {
+    bool is_rootless;
+} mesh_event_network_state_t;
+
+typedef union {
+    mesh_event_toDS_state_t toDS_state;
+    mesh_event_disconnected_t disconnected;
+    mesh_event_child_connected_t child_connected;
+    mesh_event_child_disconnected_t child_disconnected;
+    mesh_event_routing_table_change_t routing_table;
+    mesh_event_network_state_t network_state;
+    uint8_t raw[64];
+} mesh_event_info_t;
+
+typedef struct {
+    uint8_t ssid[32];
+    uint8_t ssid_len;
+    uint8_t bssid[6];
+    uint8_t password[64];
+    bool allow_router_switch;
+} mesh_router_t;
+
+typedef struct {
+    uint8_t password[64];
+    uint8_t max_connection;
+    uint8_t nonmesh_max_connection;
+} mesh_ap_cfg_t;
+
+typedef struct {
+    uint8_t channel;
+    bool allow_channel_switch;
+    mesh_addr_t mesh_id;
+    mesh_router_t router;
+    mesh_ap_cfg_t mesh_ap;
+    const void *crypto_funcs;
+} mesh_cfg_t;
+
+typedef struct {
+    int to_parent;
+    int to_parent_p2p;
+    int to_child;
+    int to_child_p2p;
+    int mgmt;
+    int broadcast;
+} mesh_tx_pending_t;
+
+typedef struct {
+    int toDS;
+    int toSelf;
+} mesh_rx_pending_t;
+
+#define MESH_INIT_CONFIG_DEFAULT() {0}
+
+esp_err_t esp_mesh_init(void);
+esp_err_t esp_mesh_deinit(void);
+esp_err_t esp_mesh_start(void);
+esp_err_t esp_mesh_stop(void);
+esp_err_t esp_mesh_send(const mesh_addr_t *to, const mesh_data_t *data,
+                        int flag, const mesh_opt_t opt[], int opt_count);
+esp_err_t esp_mesh_recv(mesh_addr_t *from, mesh_data_t *data, int timeout_ms,
+                        int *flag, mesh_opt_t opt[], int opt_count);
+esp_err_t esp_mesh_recv_toDS(mesh_addr_t *from, mesh_addr_t *to, mesh_data_t *data, int timeout_ms,
+                             int *flag, mesh_opt_t opt[], int opt_count);
+esp_err_t esp_mesh_set_config(const mesh_cfg_t *config);
+esp_err_t esp_mesh_get_config(mesh_cfg_t *config);
+esp_err_t esp_mesh_set_type(mesh_type_t type);
+esp_err_t esp_mesh_set_self_organized(bool enable, bool select_parent);
+esp_err_t esp_mesh_set_6m_rate(bool is_6m);
+esp_err_t esp_mesh_set_max_layer(int max_layer);
+int esp_mesh_get_max_layer(void);
+esp_err_t esp_mesh_set_vote_percentage(float percentage);
+float esp_mesh_get_vote_percentage(void);
+esp_err_t esp_mesh_set_ap_authmode(wifi_auth_mode_t authmode);
+wifi_auth_mode_t esp_mesh_get_ap_authmode(void);
+esp_err_t esp_mesh_set_ap_assoc_expire(int seconds);
+int esp_mesh_get_ap_assoc_expire(void);
+int esp_mesh_get_total_node_num(void);
+bool esp_mesh_is_root(void);
+int esp_mesh_get_layer(void);
+esp_err_t esp_mesh_get_parent_bssid(mesh_addr_t *bssid);
+mesh_type_t esp_mesh_get_type(void);
+int esp_mesh_get_routing_table_size(void);
+esp_err_t esp_mesh_get_routing_table(mesh_addr_t *mac, int len, int *size);
+esp_err_t esp_mesh_post_toDS_state(bool reachable);
+esp_err_t esp_mesh_fix_root(bool enable);
+bool esp_mesh_is_root_fixed(void);
+esp_err_t esp_mesh_waive_root(const void *vote, int reason);
+esp_err_t esp_mesh_set_xon_qsize(int qsize);
+int esp_mesh_get_xon_qsize(void);
+esp_err_t esp_mesh_allow_root_conflicts(bool allowed);
+bool esp_mesh_is_root_conflicts_allowed(void);
+esp_err_t esp_mesh_set_root_healing_delay(int delay_ms);
+int esp_mesh_get_root_healing_delay(void);
+bool esp_mesh_is_my_group(const mesh_addr_t *addr);
+esp_err_t esp_mesh_set_capacity_num(int num);
+int esp_mesh_get_capacity_num(void);
+esp_err_t esp_mesh_get_subnet_nodes_num(const mesh_addr_t *child_mac, int *nodes_num);
+esp_err_t esp_mesh_get_subnet_nodes_list(const mesh_addr_t *child_mac, mesh_addr_t *nodes, int nodes_num);
+esp_err_t esp_mesh_disconnect(void);
+esp_err_t esp_mesh_set_topology(esp_mesh_topology_t topo);
+esp_mesh_topology_t esp_mesh_get_topology(void);
+esp_err_t esp_mesh_enable_ps(void);
+esp_err_t esp_mesh_disable_ps(void);
+esp_err_t esp_mesh_set_active_duty_cycle(int dev_duty, int dev_duty_type);
+esp_err_t esp_mesh_set_network_duty_cycle(int nwk_duty, int duration_mins, int applied_rule);
+esp_err_t esp_mesh_get_tx_pending(mesh_tx_pending_t *pending);
+esp_err_t esp_mesh_get_rx_pending(mesh_rx_pending_t *pending);
+
+#endif /**< __ESP_MESH_H__ */
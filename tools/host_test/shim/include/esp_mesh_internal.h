@@ -0,0 +1,75 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __ESP_MESH_INTERNAL_H__
+#define __ESP_MESH_INTERNAL_H__
+
+#include "esp_mesh.h"
+
+typedef struct {
+    int scan;
+    int vote;
+    int fail;
+    int monitor_ie;
+} mesh_attempts_t;
+
+typedef struct {
+    int duration_ms;
+    int cnx_rssi;
+    int select_rssi;
+    int switch_rssi;
+    int backoff_rssi;
+} mesh_switch_parent_t;
+
+typedef struct {
+    int high;
+    int medium;
+    int low;
+} mesh_rssi_threshold_t;
+
+/**
+ * @brief The fields of the mesh IE used by the components and the examples
+ */
+typedef struct {
+    uint8_t mesh_type;
+    uint8_t mesh_id[6];
+    uint8_t layer_cap;
+    uint8_t layer;
+    uint8_t assoc_cap;
+    uint8_t assoc;
+    int8_t rssi;
+    int8_t router_rssi;
+    uint8_t toDS;
+} mesh_assoc_t;
+
+typedef struct {
+    uint16_t layer_cap;
+    uint16_t layer;
+} mesh_chain_layer_t;
+
+esp_err_t esp_mesh_set_beacon_interval(int interval_ms);
+esp_err_t esp_mesh_get_beacon_interval(int *interval_ms);
+esp_err_t esp_mesh_set_attempts(mesh_attempts_t *attempts);
+esp_err_t esp_mesh_get_attempts(mesh_attempts_t *attempts);
+esp_err_t esp_mesh_set_switch_parent_paras(mesh_switch_parent_t *paras);
+esp_err_t esp_mesh_get_switch_parent_paras(mesh_switch_parent_t *paras);
+esp_err_t esp_mesh_set_rssi_threshold(const mesh_rssi_threshold_t *threshold);
+esp_err_t esp_mesh_get_rssi_threshold(mesh_rssi_threshold_t *threshold);
+esp_err_t esp_mesh_set_passive_scan_time(int time_ms);
+int esp_mesh_get_passive_scan_time(void);
+esp_err_t esp_mesh_set_announce_interval(int short_ms, int long_ms);
+esp_err_t esp_mesh_scan_get_ap_ie_len(int *len);
+esp_err_t esp_mesh_scan_get_ap_record(wifi_ap_record_t *ap_record, void *buffer);
+
+#endif /**< __ESP_MESH_INTERNAL_H__ */
@@ -0,0 +1,57 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef __ESP_NETIF_H__
+#define __ESP_NETIF_H__
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/**
+ * @brief The network interfaces only exist to be passed around, no IP address is obtained
+ */
+typedef struct esp_netif_obj esp_netif_t;
+
+typedef struct {
+    uint32_t addr;
+} esp_ip4_addr_t;
+
+typedef struct {
+    esp_ip4_addr_t ip;
+    esp_ip4_addr_t netmask;
+    esp_ip4_addr_t gw;
+} esp_netif_ip_info_t;
+
+typedef struct {
+    int if_index;
+    esp_netif_t *esp_netif;
+    esp_netif_ip_info_t ip_info;
+    bool ip_changed;
+} ip_event_got_ip_t;
+
+#define esp_ip4_addr1(ipaddr) ((uint8_t)((ipaddr)->addr >> 0) & 0xff)
+#define esp_ip4_addr2(ipaddr) ((uint8_t)((ipaddr)->addr >> 8) & 0xff)
+#define esp_ip4_addr3(ipaddr) ((uint8_t)((ipaddr)->addr >> 16) & 0xff)
+#define esp_ip4_addr4(ipaddr) ((uint8_t)((ipaddr)->addr >> 24) & 0xff)
+
+#define IP2STR(ipaddr) esp_ip4_addr1(ipaddr), esp_ip4_addr2(ipaddr), esp_ip4_addr3(ipaddr), esp_ip4_addr4(ipaddr)
+#define IPSTR "%d.%d.%d.%d"
+
+esp_err_t esp_netif_init(void);
+esp_err_t esp_netif_create_default_wifi_mesh_netifs(esp_netif_t **p_netif_sta, esp_netif_t **p_netif_ap);
+esp_err_t esp_netif_dhcpc_start(esp_netif_t *esp_netif);
+
+#endif /**< __ESP_NETIF_H__ */
@@ -0,0 +1,75 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __HOST_ESPNOW_H__
+#define __HOST_ESPNOW_H__
+
+#include "esp_now.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /**< _cplusplus */
+
+/**
+ * @brief Model of the radio link of esp_now_send().
+ *
+ *        The frames are sent one after the other, each takes `air_time_us`. The send
+ *        callback of a frame comes `cb_latency_us` after it is sent. A frame sent
+ *        to a peer is received by this device itself, from its own station address.
+ */
+typedef struct {
+    uint32_t air_time_us;       /**< Time on air of a frame */
+    uint32_t cb_latency_us;     /**< Delay of the send callback after the frame is on air */
+    uint8_t loss_percent;       /**< Frames not received, reported as ESP_NOW_SEND_FAIL */
+    uint8_t ack_loss_percent;   /**< Frames received but reported as ESP_NOW_SEND_FAIL */
+    uint8_t buffer_num;         /**< Frames waiting for their callback before ESP_ERR_ESPNOW_NO_MEM */
+    uint32_t seed;              /**< Seed of the losses, the same seed loses the same frames */
+} host_espnow_link_t;
+
+#define HOST_ESPNOW_LINK_DEFAULT() { \
+    .air_time_us      = 100, \
+    .cb_latency_us    = 0, \
+    .loss_percent     = 0, \
+    .ack_loss_percent = 0, \
+    .buffer_num       = 16, \
+    .seed             = 1, \
+}
+
+/**
+ * @brief Called by esp_now_send() for each frame accepted, in the order of sending
+ */
+typedef void (*host_espnow_sniffer_cb_t)(const uint8_t *dest_addr, const uint8_t *data, int size);
+
+/**
+ * @brief  Set the model of the link, the frames already sent keep the previous one
+ */
+void host_espnow_set_link(const host_espnow_link_t *link);
+
+/**
+ * @brief  Set the function called for each frame sent
+ *
+ * @param  sniffer_cb  NULL to stop
+ */
+void host_espnow_set_sniffer(host_espnow_sniffer_cb_t sniffer_cb);
+
+/**
+ * @brief  Wait until the send callbacks of all the frames are called
+ */
+void host_espnow_wait_idle(void);
+
+#ifdef __cplusplus
+}
+#endif /**< _cplusplus */
+
+#endif /**< __HOST_ESPNOW_H__ */
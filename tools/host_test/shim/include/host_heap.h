@@ -0,0 +1,39 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __HOST_HEAP_H__
+#define __HOST_HEAP_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /**< _cplusplus */
+
+/**
+ * @brief  Bytes allocated with malloc() and co. by the components and the tests.
+ *         esp_get_free_heap_size() is the heap of the device minus this.
+ */
+size_t host_heap_get_used(void);
+
+/**
+ * @brief  Start the measure of esp_get_minimum_free_heap_size() again from now
+ */
+void host_heap_reset_minimum(void);
+
+#ifdef __cplusplus
+}
+#endif /**< _cplusplus */
+
+#endif /**< __HOST_HEAP_H__ */
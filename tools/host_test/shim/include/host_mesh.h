@@ -0,0 +1,91 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __HOST_MESH_H__
+#define __HOST_MESH_H__
+
+#include "esp_mesh.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /**< _cplusplus */
+
+#define HOST_MESH_SUBNET_MAX_NUM (64) /**< Max number of nodes in the subnet of a child */
+#define HOST_MESH_RECV_NUM       (16) /**< Packets waiting for esp_mesh_recv() */
+#define HOST_MESH_OPT_MAX_LEN    (32) /**< Max length of the option of a received packet */
+
+/**
+ * @brief Called instead of sending the packet, the data is only valid during the call
+ */
+typedef esp_err_t (*host_mesh_send_cb_t)(const mesh_addr_t *to, const mesh_data_t *data,
+                                         int flag, const mesh_opt_t opt[], int opt_count);
+
+/**
+ * @brief  Set the function called by esp_mesh_send()
+ *
+ * @param  send_cb  NULL to drop the packets and return ESP_OK
+ */
+void host_mesh_set_send_cb(host_mesh_send_cb_t send_cb);
+
+/**
+ * @brief  Set the value returned by esp_mesh_is_root()
+ */
+void host_mesh_set_root(bool root);
+
+/**
+ * @brief  Set the values returned by esp_mesh_get_tx_pending() and esp_mesh_get_rx_pending()
+ *         outside of a simulation, nothing is pending by default
+ */
+void host_mesh_set_pending(const mesh_tx_pending_t *tx_pending, const mesh_rx_pending_t *rx_pending);
+
+/**
+ * @brief  Connect a child to the softAP, the nodes below it make its subnet
+ *
+ * @param  child       MAC address of the child
+ * @param  subnet      Nodes reached through the child, not including it
+ * @param  subnet_num  Number of the nodes, at most HOST_MESH_SUBNET_MAX_NUM
+ *
+ * @return
+ *    - ESP_OK
+ *    - ESP_ERR_INVALID_ARG
+ *    - ESP_ERR_NO_MEM: There are already ESP_WIFI_MAX_CONN_NUM children
+ */
+esp_err_t host_mesh_add_child(const mesh_addr_t *child, const mesh_addr_t *subnet, int subnet_num);
+
+/**
+ * @brief  Disconnect all the children
+ */
+void host_mesh_clear_children(void);
+
+/**
+ * @brief  Queue a packet for esp_mesh_recv(), outside of a simulation
+ *
+ * @param  from     Source of the packet
+ * @param  data     Payload
+ * @param  size     Length of the payload
+ * @param  opt      Copied to the value of the first option given to esp_mesh_recv(), may be NULL
+ * @param  opt_len  Length of the option, at most HOST_MESH_OPT_MAX_LEN
+ *
+ * @return
+ *    - ESP_OK
+ *    - ESP_ERR_INVALID_ARG
+ *    - ESP_ERR_NO_MEM: HOST_MESH_RECV_NUM packets are already waiting
+ */
+esp_err_t host_mesh_push_recv(const mesh_addr_t *from, const void *data, int size, const void *opt, int opt_len);
+
+#ifdef __cplusplus
+}
+#endif /**< _cplusplus */
+
+#endif /**< __HOST_MESH_H__ */
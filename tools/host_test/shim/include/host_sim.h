@@ -0,0 +1,148 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __HOST_SIM_H__
+#define __HOST_SIM_H__
+
+#include "esp_mesh.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /**< _cplusplus */
+
+/**
+ * @brief Simulation of a mesh network on the host.
+ *
+ *        Each node is a process forked by host_sim_run(), as mwifi keeps its state in globals,
+ *        and runs the real components over the shims. The frames sent by esp_mesh_send() go
+ *        through a shared memory: they are routed along the tree, store and forward, and are
+ *        received by esp_mesh_recv() or esp_mesh_recv_toDS() of the destination once they
+ *        arrive. The model of the links:
+ *
+ *        - A hop keeps the radios of both nodes busy for the time of the frame on air, the
+ *          siblings share the radio of their parent, the links of other nodes work in parallel.
+ *        - An attempt is lost with the loss rate of the link, it is retried up to
+ *          HOST_SIM_RETRY_MAX times and the frame is dropped after that.
+ *        - The latency of the link is added after each hop, it stands for the processing
+ *          time of the receiver.
+ *        - esp_mesh_send() fails with ESP_ERR_MESH_QUEUE_FULL when a radio on the path has
+ *          more than `queue_size` frames waiting, or when the destination has `rx_queue_size`
+ *          frames not read, as the flow control of ESP-MESH does.
+ *
+ *        The tree is fixed: every node starts connected to its parent, node 0 is the root.
+ *        MESH_DATA_GROUP and the change of the topology are not simulated.
+ */
+
+#define HOST_SIM_NODE_MAX      (256)         /**< Max number of nodes in the network */
+#define HOST_SIM_FRAME_NUM     (8192)        /**< Frames in flight or waiting to be read, in all the network */
+#define HOST_SIM_DATA_SIZE     (256 * 1024)  /**< Size of the memory shared by the nodes and the test */
+#define HOST_SIM_RETRY_MAX     (7)           /**< Retries of a frame on a hop before it is dropped */
+#define HOST_SIM_FRAME_HEAD    (60)          /**< Bytes sent on air in front of the payload of each frame */
+
+typedef struct {
+    uint32_t bandwidth;  /**< Bits per second on air */
+    uint32_t latency_us; /**< Time added to each hop */
+    uint8_t loss;        /**< Percentage of the attempts that are lost */
+} host_sim_link_t;
+
+typedef struct {
+    int node_num;                            /**< Number of nodes, node 0 is the root */
+    int parent[HOST_SIM_NODE_MAX];           /**< Parent of each node, -1 for the root */
+    host_sim_link_t link[HOST_SIM_NODE_MAX]; /**< Link of each node to its parent */
+    int queue_size;                          /**< Frames waiting for a radio, as CONFIG_MWIFI_XON_QSIZE */
+    int rx_queue_size;                       /**< Frames waiting to be read by a node */
+    uint32_t seed;                           /**< Seed of the losses */
+} host_sim_config_t;
+
+typedef struct {
+    uint32_t frames;    /**< Frames sent by esp_mesh_send() */
+    uint32_t hops;      /**< Successful hops */
+    uint32_t attempts;  /**< Frames on air, including the retries */
+    uint32_t drops;     /**< Frames dropped after HOST_SIM_RETRY_MAX retries */
+    uint32_t rejected;  /**< Calls to esp_mesh_send() failed by the flow control */
+    uint64_t air_us;    /**< Time on air of all the attempts */
+} host_sim_stats_t;
+
+/**
+ * @brief Main function of a node, run in the process of the node. A failed assertion
+ *        fails the node, it must be called from this function, not from another task.
+ */
+typedef void (*host_sim_main_t)(int node, void *arg);
+
+/**
+ * @brief  Fill the tree of a configuration: node i is the child of node (i - 1) / fanout,
+ *         all the links are alike, the queues take their default size
+ */
+void host_sim_tree(host_sim_config_t *config, int node_num, int fanout, const host_sim_link_t *link);
+
+/**
+ * @brief  Run the network, node_main() is called in each node with its index.
+ *         The memory shared by the nodes is cleared before and kept after the run.
+ *
+ * @return
+ *    - ESP_OK: All the nodes returned from node_main()
+ *    - ESP_FAIL: A node failed an assertion, or exited abnormally
+ *    - ESP_ERR_TIMEOUT: The nodes were killed after timeout_ms
+ */
+esp_err_t host_sim_run(const host_sim_config_t *config, host_sim_main_t node_main, void *arg, int timeout_ms);
+
+/**
+ * @brief  Index of this node, -1 outside of a simulation
+ */
+int host_sim_node(void);
+
+/**
+ * @brief  Station MAC address of a node, which identifies it in the mesh network
+ */
+void host_sim_addr(int node, uint8_t addr[6]);
+
+/**
+ * @brief  Index of the node with a station or softAP MAC address, -1 if there is none
+ */
+int host_sim_find(const uint8_t addr[6]);
+
+/**
+ * @brief  Memory shared by the nodes and the test, HOST_SIM_DATA_SIZE bytes
+ */
+void *host_sim_data(void);
+
+/**
+ * @brief  Wait until all the nodes call it
+ */
+void host_sim_barrier(void);
+
+/**
+ * @brief  Statistics of the links of the last run
+ */
+void host_sim_get_stats(host_sim_stats_t *stats);
+
+/**
+ * @brief Called by the shim of ESP-MESH in a simulation
+ */
+esp_err_t host_sim_send(const mesh_addr_t *to, const mesh_data_t *data, int flag, const mesh_opt_t *opt);
+esp_err_t host_sim_recv(bool toDS, mesh_addr_t *from, mesh_addr_t *to, mesh_data_t *data,
+                        int timeout_ms, int *flag, mesh_opt_t *opt);
+int host_sim_parent(int node);
+int host_sim_layer(int node);
+int host_sim_children(int node, int *children, int max_num);
+int host_sim_subnet(int node, int *nodes, int max_num);
+void host_sim_set_started(bool started);
+bool host_sim_is_started(void);
+void host_sim_get_pending(mesh_tx_pending_t *tx_pending, mesh_rx_pending_t *rx_pending);
+
+#ifdef __cplusplus
+}
+#endif /**< _cplusplus */
+
+#endif /**< __HOST_SIM_H__ */
@@ -0,0 +1,118 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @brief Kconfig defaults of the components built on the host,
+ *        keep them in sync with the Kconfig files.
+ */
+
+#ifndef __SDKCONFIG_H__
+#define __SDKCONFIG_H__
+
+#define CONFIG_IDF_TARGET_ESP32 1
+#define MDF_VER "host"
+
+/**< mcommon */
+#define CONFIG_MDF_TASK_DEFAULT_PRIOTY 6
+#define CONFIG_MDF_TASK_PINNED_TO_CORE 0
+#define CONFIG_MDF_EVENT_TASK_STACK_SIZE 4096
+#define CONFIG_MDF_MEM_DEBUG 1
+#define CONFIG_MDF_MEM_DBG_INFO_MAX 128
+#define CONFIG_MDF_DEDUP_ENTRY_NUM 128
+#define CONFIG_MDF_DEDUP_AGING_MS 5000
+#define CONFIG_MDF_ERR_TO_NAME_LOOKUP 1
+#define CONFIG_MDF_LOG_LEVEL 2 /**< Warning, the tests print their own results */
+
+/**< miniz */
+#define CONFIG_MINIZ_SPLIT_TINFL_DECOMPRESSOR_TAG 1
+#define CONFIG_MINIZ_SPLIT_TDEFL_COMPRESSOR 1
+#define CONFIG_MINIZ_MINIMIZE_STACK_CONSUME 1
+
+/**< mespnow */
+#define CONFIG_MESPNOW_RETRANSMIT_NUM 3
+#define CONFIG_MESPNOW_SEND_WINDOW 1
+#define CONFIG_MESPNOW_REASSEMBLY_SLOT_NUM 8
+#define CONFIG_MESPNOW_REASSEMBLY_TIMEOUT_MS 1000
+#define CONFIG_MESPNOW_LEGACY_REASSEMBLY 1
+#define CONFIG_MESPNOW_PEER_CACHE_NUM 8
+#define CONFIG_MESPNOW_DEFAULT_PMK "pmk1234567890123"
+#define CONFIG_MESPNOW_LOG_LEVEL 2
+#define CONFIG_MESPNOW_TRANS_PIPE_DEBUG_QUEUE_SIZE 5
+#define CONFIG_MESPNOW_TRANS_PIPE_CONTROL_QUEUE_SIZE 5
+#define CONFIG_MESPNOW_TRANS_PIPE_MCONFIG_QUEUE_SIZE 10
+#define CONFIG_MESPNOW_TRANS_PIPE_RESERVED_QUEUE_SIZE 5
+
+/**< mwifi */
+#define CONFIG_MWIFI_VOTE_PERCENTAGE 90
+#define CONFIG_MWIFI_VOTE_MAX_COUNT 15
+#define CONFIG_MWIFI_BACKOFF_RSSI -78
+#define CONFIG_MWIFI_SCAN_MINI_COUNT 10
+#define CONFIG_MWIFI_ROOT_HEALING_MS 6000
+#define CONFIG_MWIFI_CAPACITY_NUM 512
+#define CONFIG_MWIFI_TOPOLOGY 0
+#define CONFIG_MWIFI_MAX_LAYER 16
+#define CONFIG_MWIFI_MAX_CONNECTION 6
+#define CONFIG_MWIFI_ASSOC_EXPIRE_MS 30000
+#define CONFIG_MWIFI_BEACON_INTERVAL_MS 100
+#define CONFIG_MWIFI_PASSIVE_SCAN_MS 300
+#define CONFIG_MWIFI_MONITOR_DURATION_MS 60000
+#define CONFIG_MWIFI_CNX_RSSI -120
+#define CONFIG_MWIFI_SELECT_RSSI -78
+#define CONFIG_MWIFI_SWITCH_RSSI -78
+#define CONFIG_MWIFI_ATTEMPT_COUNT 60
+#define CONFIG_MWIFI_MONITOR_IE_COUNT 10
+#define CONFIG_MWIFI_WAIVE_ROOT 1
+#define CONFIG_MWIFI_WAIVE_ROOT_RSSI -70
+#define CONFIG_MWIFI_RSSI_THRESHOUD_HIGH -78
+#define CONFIG_MWIFI_RSSI_THRESHOUD_MEDIUM -82
+#define CONFIG_MWIFI_RSSI_THRESHOUD_LOW -85
+#define CONFIG_MWIFI_XON_QSIZE 32
+#define CONFIG_MWIFI_RETRANSMIT_ENABLE 1
+#define CONFIG_MWIFI_DATA_DROP_ENABLE 1
+#define CONFIG_MWIFI_LEGACY_REASSEMBLY 1
+#define CONFIG_MWIFI_REASSEMBLY_SLOT_NUM 6
+#define CONFIG_MWIFI_REASSEMBLY_TIMEOUT_MS 3000
+#define CONFIG_MWIFI_RECV_POOL_SMALL_NUM 4
+#define CONFIG_MWIFI_RECV_POOL_LARGE_NUM 2
+#define CONFIG_MWIFI_DATA_HEAD_EXT_LEARN 1
+#define CONFIG_MWIFI_COMPRESS_LEVEL 6
+#define CONFIG_MWIFI_COMPRESS_CONTEXT_CACHE 1
+#define CONFIG_MWIFI_TX_QUEUE_NUM 4
+#define CONFIG_MWIFI_TX_QUEUE_SIZE 8
+#define CONFIG_MWIFI_FLOW_CONTROL_ENABLE 1
+#define CONFIG_MWIFI_FLOW_CONTROL_TIMEOUT_MS 1000
+#define CONFIG_MWIFI_TX_BULK_OCCUPANCY_MAX 25
+#define CONFIG_MWIFI_RELAY_QUEUE_SIZE 8
+#define CONFIG_MWIFI_STREAM_WINDOW 8
+#define CONFIG_MWIFI_STREAM_RETRANSMIT_MS 1000
+#define CONFIG_MWIFI_RPC_CALL_NUM 32
+#define CONFIG_MWIFI_STATS_ENABLE 1
+#define CONFIG_MWIFI_STATS_PEER_NUM 16
+#define CONFIG_MWIFI_MESH_IE_ENABLE 1
+
+/**
+ * mupgrade, without CONFIG_MUPGRADE_VERSION_FALLBACK_RESTART: its constructor would create
+ * a task before the nodes of a simulation are forked, and no image is checked for its flag
+ */
+#define CONFIG_MUPGRADE_RETRY_COUNT 20
+#define CONFIG_MUPGRADE_WAIT_RESPONSE_TIMEOUT 3000
+#define CONFIG_MUPGRADE_STATUS_REPORT_INTERVAL 10
+
+/**< mdebug */
+#define CONFIG_MDEBUG_LOG_PARTITION_LABEL "reserved"
+#define CONFIG_MDEBUG_LOG_PARTITION_OFFSET 0
+#define CONFIG_MDEBUG_LOG_PACKET_MAX_SIZE 1188
+#define CONFIG_MDEBUG_LOG_FILE_MAX_SIZE 32768
+
+#endif /**< __SDKCONFIG_H__ */
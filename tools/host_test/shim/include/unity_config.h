@@ -0,0 +1,64 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __UNITY_CONFIG_H__
+#define __UNITY_CONFIG_H__
+
+/**
+ * @brief Included by unity.h, registers the TEST_CASE() of ESP-IDF unit tests
+ *        so that main.c runs them on the host
+ */
+
+#define UNITY_INCLUDE_DOUBLE
+#define UNITY_SUPPORT_64
+
+#ifndef __ASSEMBLER__
+
+typedef struct host_test_desc {
+    const char *name;
+    const char *desc;
+    void (*fn)(void);
+    const char *file;
+    int line;
+    struct host_test_desc *next;
+} host_test_desc_t;
+
+/**
+ * @brief  Add a test case to the end of the list, called before main()
+ */
+void host_test_register(host_test_desc_t *desc);
+
+#define UNITY_TEST_UID(what) UNITY_TEST_UID_(what, __LINE__)
+#define UNITY_TEST_UID_(what, line) UNITY_TEST_UID__(what, line)
+#define UNITY_TEST_UID__(what, line) what ## line
+
+#define TEST_CASE(name_, desc_) \
+    static void UNITY_TEST_UID(test_func_)(void); \
+    static void __attribute__((constructor)) UNITY_TEST_UID(test_reg_helper_)(void) \
+    { \
+        static host_test_desc_t test_desc = { \
+            .name = name_, \
+            .desc = desc_, \
+            .fn   = &UNITY_TEST_UID(test_func_), \
+            .file = __FILE__, \
+            .line = __LINE__, \
+            .next = NULL, \
+        }; \
+        host_test_register(&test_desc); \
+    } \
+    static void UNITY_TEST_UID(test_func_)(void)
+
+#endif /**< __ASSEMBLER__ */
+
+#endif /**< __UNITY_CONFIG_H__ */
@@ -0,0 +1,202 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nvs_flash.h"
+
+#define HOST_NVS_ENTRY_NUM  (16)
+#define HOST_NVS_VALUE_SIZE (4096)
+
+typedef struct {
+    nvs_handle handle;                   /**< Namespace of the entry, 0 if it is free */
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    size_t length;
+    uint8_t value[HOST_NVS_VALUE_SIZE];
+} host_nvs_entry_t;
+
+static pthread_mutex_t g_nvs_mutex = PTHREAD_MUTEX_INITIALIZER;
+static host_nvs_entry_t g_nvs_entry[HOST_NVS_ENTRY_NUM];
+static char g_nvs_namespace[HOST_NVS_ENTRY_NUM][NVS_KEY_NAME_MAX_SIZE];
+
+/**
+ * @brief The mutex must be held
+ */
+static host_nvs_entry_t *host_nvs_find(nvs_handle handle, const char *key)
+{
+    for (int i = 0; i < HOST_NVS_ENTRY_NUM; ++i) {
+        if (g_nvs_entry[i].handle == handle && (!key || !strcmp(g_nvs_entry[i].key, key))) {
+            return g_nvs_entry + i;
+        }
+    }
+
+    return NULL;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    pthread_mutex_lock(&g_nvs_mutex);
+    memset(g_nvs_entry, 0, sizeof(g_nvs_entry));
+    pthread_mutex_unlock(&g_nvs_mutex);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief The handle is the index of the namespace plus one
+ */
+esp_err_t nvs_open(const char *name, nvs_open_mode open_mode, nvs_handle *out_handle)
+{
+    esp_err_t ret = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+
+    if (!name || !out_handle || strlen(name) >= NVS_KEY_NAME_MAX_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&g_nvs_mutex);
+
+    for (int i = 0; i < HOST_NVS_ENTRY_NUM; ++i) {
+        if (!g_nvs_namespace[i][0] || !strcmp(g_nvs_namespace[i], name)) {
+            strcpy(g_nvs_namespace[i], name);
+            *out_handle = i + 1;
+            ret         = ESP_OK;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&g_nvs_mutex);
+
+    return ret;
+}
+
+void nvs_close(nvs_handle handle)
+{
+}
+
+esp_err_t nvs_commit(nvs_handle handle)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle handle, const char *key, const void *value, size_t length)
+{
+    host_nvs_entry_t *entry = NULL;
+
+    if (!handle || !key || !value) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (strlen(key) >= NVS_KEY_NAME_MAX_SIZE) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+
+    if (length > HOST_NVS_VALUE_SIZE) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+
+    pthread_mutex_lock(&g_nvs_mutex);
+
+    entry = host_nvs_find(handle, key);
+    entry = entry ? entry : host_nvs_find(0, NULL);
+
+    if (entry) {
+        entry->handle = handle;
+        entry->length = length;
+        strcpy(entry->key, key);
+        memcpy(entry->value, value, length);
+    }
+
+    pthread_mutex_unlock(&g_nvs_mutex);
+
+    return entry ? ESP_OK : ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+}
+
+/**
+ * @brief Without out_value, only the length of the blob is returned
+ */
+esp_err_t nvs_get_blob(nvs_handle handle, const char *key, void *out_value, size_t *length)
+{
+    esp_err_t ret           = ESP_OK;
+    host_nvs_entry_t *entry = NULL;
+
+    if (!handle || !key || !length) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&g_nvs_mutex);
+
+    entry = host_nvs_find(handle, key);
+
+    if (!entry) {
+        ret = ESP_ERR_NVS_NOT_FOUND;
+    } else if (out_value && *length < entry->length) {
+        ret = ESP_ERR_NVS_INVALID_LENGTH;
+    } else if (out_value) {
+        memcpy(out_value, entry->value, entry->length);
+    }
+
+    if (entry) {
+        *length = entry->length;
+    }
+
+    pthread_mutex_unlock(&g_nvs_mutex);
+
+    return ret;
+}
+
+esp_err_t nvs_erase_key(nvs_handle handle, const char *key)
+{
+    host_nvs_entry_t *entry = NULL;
+
+    if (!handle || !key) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&g_nvs_mutex);
+
+    entry = host_nvs_find(handle, key);
+
+    if (entry) {
+        memset(entry, 0, sizeof(host_nvs_entry_t));
+    }
+
+    pthread_mutex_unlock(&g_nvs_mutex);
+
+    return entry ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle handle)
+{
+    if (!handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&g_nvs_mutex);
+
+    for (host_nvs_entry_t *entry = NULL; (entry = host_nvs_find(handle, NULL));) {
+        memset(entry, 0, sizeof(host_nvs_entry_t));
+    }
+
+    pthread_mutex_unlock(&g_nvs_mutex);
+
+    return ESP_OK;
+}